@@ -23,6 +23,230 @@
 #define INKPLATE_ESP32_SPI_MAX_MESAGE_DATA_BUFFER 4092
 #define INKPLATE_ESP32_SPI_DATA_INFO_MAGIC_NUM    0xFE
 
+// Memory footprint. All buffer sizes below (and in the module headers) can be changed with the build flags.
+// Defining INKPLATE_ESP32_LOW_MEMORY selects smaller defaults for boards with little RAM (less throughput,
+// fewer links and shorter scan list). Define INKPLATE_ESP32_RAM_BUDGET (in bytes) to get a compile error if
+// the global WiFi object does not fit into it and INKPLATE_ESP32_MEMORY_REPORT to get the static RAM used
+// by each class as a compiler warning.
+#ifdef INKPLATE_ESP32_LOW_MEMORY
+#ifndef INKPLATE_ESP32_AT_CMD_BUFFER_SIZE
+#define INKPLATE_ESP32_AT_CMD_BUFFER_SIZE 4096ULL
+#endif
+#ifndef INKPLATE_ESP32_MAX_SCAN_AP
+#define INKPLATE_ESP32_MAX_SCAN_AP 16
+#endif
+#ifndef INKPLATE_ESP32_DNS_CACHE_SIZE
+#define INKPLATE_ESP32_DNS_CACHE_SIZE 2
+#endif
+#ifndef INKPLATE_ESP32_MAX_LINKS
+#define INKPLATE_ESP32_MAX_LINKS 2
+#endif
+#ifndef INKPLATE_ESP32_LINK_RX_BUFFER_SIZE
+#define INKPLATE_ESP32_LINK_RX_BUFFER_SIZE 512
+#endif
+#ifndef INKPLATE_ESP32_LINK_TX_BUFFER_SIZE
+#define INKPLATE_ESP32_LINK_TX_BUFFER_SIZE 256
+#endif
+#ifndef INKPLATE_ESP32_LINK_TX_CHUNK
+#define INKPLATE_ESP32_LINK_TX_CHUNK 128
+#endif
+#ifndef INKPLATE_ESP32_LINK_MAX_PACKETS
+#define INKPLATE_ESP32_LINK_MAX_PACKETS 4
+#endif
+#ifndef INKPLATE_ESP32_MQTT_RX_BUFFER_SIZE
+#define INKPLATE_ESP32_MQTT_RX_BUFFER_SIZE 512
+#endif
+#ifndef INKPLATE_ESP32_UDP_MAX_PACKET_SIZE
+#define INKPLATE_ESP32_UDP_MAX_PACKET_SIZE 256
+#endif
+#ifndef INKPLATE_ESP32_UDP_BATCH_SIZE
+#define INKPLATE_ESP32_UDP_BATCH_SIZE 512
+#endif
+#endif
+
+// Data buffer for AT Commands (in bytes). It must hold at least one complete SPI packet from the modem and
+// the whole AT+CWLAP response (networks that do not fit are not listed).
+#ifndef INKPLATE_ESP32_AT_CMD_BUFFER_SIZE
+#define INKPLATE_ESP32_AT_CMD_BUFFER_SIZE 8192ULL
+#endif
+
+// Max. number of networks listed by the WiFi scan.
+#ifndef INKPLATE_ESP32_MAX_SCAN_AP
+#define INKPLATE_ESP32_MAX_SCAN_AP 40
+#endif
+
+// Default SPI clock for the ESP32 (in Hz).
+#ifndef INKPLATE_ESP32_SPI_CLOCK
+#define INKPLATE_ESP32_SPI_CLOCK 20000000UL
+#endif
+
+// SPI clock steps (in Hz, ascending) used by the SPI clock auto tuning and by the fallback to the lower
+// clock on the link errors. STM32 SPI uses the nearest lower clock it can make.
+#ifndef INKPLATE_ESP32_SPI_CLOCK_STEPS
+#define INKPLATE_ESP32_SPI_CLOCK_STEPS 5000000UL, 10000000UL, 20000000UL, 30000000UL, 40000000UL
+#endif
+
+// Max. SPI clock tried by the auto tuning (in Hz).
+#ifndef INKPLATE_ESP32_SPI_MAX_CLOCK
+#define INKPLATE_ESP32_SPI_MAX_CLOCK 40000000UL
+#endif
+
+// Number of echo round-trips of the SPI self test (each one with the different pattern).
+#ifndef INKPLATE_ESP32_SPI_SELF_TEST_ROUNDS
+#define INKPLATE_ESP32_SPI_SELF_TEST_ROUNDS 4
+#endif
+
+// Number of link errors in a row (invalid slave status or length) before the SPI clock drops one step.
+#ifndef INKPLATE_ESP32_SPI_ERROR_THRESHOLD
+#define INKPLATE_ESP32_SPI_ERROR_THRESHOLD 3
+#endif
+
+// NVIC priority of the handshake interrupt while the background reception is on (see backgroundRxStart()). Frame is
+// read in the ISR, so the lowest one is used - other interrupts are never held off by the transfer. EXTI lines 5-9
+// and 10-15 share one interrupt, other pins on the same lines get this priority too.
+#ifndef INKPLATE_ESP32_HANDSHAKE_IRQ_PRIORITY
+#define INKPLATE_ESP32_HANDSHAKE_IRQ_PRIORITY 15
+#endif
+
+// Number of retries of the slave status request (invalid status) and of the data send request (modem not
+// writeable or sequence number mismatch).
+#ifndef INKPLATE_ESP32_SPI_RETRIES
+#define INKPLATE_ESP32_SPI_RETRIES 3
+#endif
+
+// Command supervisor (see WiFiClass::execute()). Number of retries with the backoff (doubled after each
+// retry, in milliseconds) before the modem recovery, max. length of the command that can be repeated (longer
+// ones are sent only once), max. time to wait for the WiFi connection after the power cycle and max. time for
+// draining the modem at the resync (in milliseconds). Power cycle is opt-in, define
+// INKPLATE_ESP32_SUPERVISOR_POWER_CYCLE as 1 to power cycle the modem when the resync does not help.
+#ifndef INKPLATE_ESP32_SUPERVISOR_RETRIES
+#define INKPLATE_ESP32_SUPERVISOR_RETRIES 2
+#endif
+#ifndef INKPLATE_ESP32_SUPERVISOR_BACKOFF_MIN
+#define INKPLATE_ESP32_SUPERVISOR_BACKOFF_MIN 20UL
+#endif
+#ifndef INKPLATE_ESP32_SUPERVISOR_BACKOFF_MAX
+#define INKPLATE_ESP32_SUPERVISOR_BACKOFF_MAX 500UL
+#endif
+#ifndef INKPLATE_ESP32_SUPERVISOR_CMD_LEN
+#define INKPLATE_ESP32_SUPERVISOR_CMD_LEN 256
+#endif
+#ifndef INKPLATE_ESP32_SUPERVISOR_RECONNECT_TIMEOUT
+#define INKPLATE_ESP32_SUPERVISOR_RECONNECT_TIMEOUT 15000UL
+#endif
+#ifndef INKPLATE_ESP32_SUPERVISOR_DRAIN_TIMEOUT
+#define INKPLATE_ESP32_SUPERVISOR_DRAIN_TIMEOUT 1000UL
+#endif
+#ifndef INKPLATE_ESP32_SUPERVISOR_POWER_CYCLE
+#define INKPLATE_ESP32_SUPERVISOR_POWER_CYCLE 0
+#endif
+
+// Result of the supervised AT command (failure class).
+#define INKPLATE_ESP32_AT_RESULT_OK       0
+#define INKPLATE_ESP32_AT_RESULT_BUSY     1
+#define INKPLATE_ESP32_AT_RESULT_TIMEOUT  2
+#define INKPLATE_ESP32_AT_RESULT_PROTOCOL 3
+#define INKPLATE_ESP32_AT_RESULT_ERROR    4
+
+// What happens with the frame that does not fit into the response buffer (see WiFiClass::setOverflowPolicy()).
+#define INKPLATE_ESP32_OVERFLOW_DROP         0
+#define INKPLATE_ESP32_OVERFLOW_SINK         1
+#define INKPLATE_ESP32_OVERFLOW_BACKPRESSURE 2
+
+// Command types for the adaptive timeouts (see WiFiClass::timeout()). Message filter config and the data
+// after the prompt, short responses (echo of the command, HTTP headers), WiFi radio init (CWINIT), WiFi scan,
+// next chunk of the HTTP data and the first chunk of the HTTP data.
+#define INKPLATE_ESP32_TIMEOUT_FILTER     0
+#define INKPLATE_ESP32_TIMEOUT_SHORT      1
+#define INKPLATE_ESP32_TIMEOUT_INIT       2
+#define INKPLATE_ESP32_TIMEOUT_SCAN       3
+#define INKPLATE_ESP32_TIMEOUT_AVAILABLE  4
+#define INKPLATE_ESP32_TIMEOUT_FIRST_DATA 5
+#define INKPLATE_ESP32_TIMEOUT_TYPES      6
+
+// Adaptive timeouts. Timeout is the latency estimate plus INKPLATE_ESP32_TIMEOUT_JITTER_GAIN times the jitter
+// estimate plus the margin (in milliseconds), limited by the min. and max. timeout of the command type. Default
+// timeout is used until INKPLATE_ESP32_TIMEOUT_MIN_SAMPLES are measured. Each expired timeout doubles the next
+// one (up to INKPLATE_ESP32_TIMEOUT_MAX_BACKOFF times).
+#ifndef INKPLATE_ESP32_TIMEOUT_JITTER_GAIN
+#define INKPLATE_ESP32_TIMEOUT_JITTER_GAIN 4
+#endif
+#ifndef INKPLATE_ESP32_TIMEOUT_MARGIN
+#define INKPLATE_ESP32_TIMEOUT_MARGIN 5UL
+#endif
+#ifndef INKPLATE_ESP32_TIMEOUT_MIN_SAMPLES
+#define INKPLATE_ESP32_TIMEOUT_MIN_SAMPLES 4
+#endif
+#ifndef INKPLATE_ESP32_TIMEOUT_MAX_BACKOFF
+#define INKPLATE_ESP32_TIMEOUT_MAX_BACKOFF 3
+#endif
+
+// Max. number of modems (WiFiClass objects) used at the same time, each one on its own SPI bus or CS pin.
+#ifndef INKPLATE_ESP32_MAX_MODEMS
+#define INKPLATE_ESP32_MAX_MODEMS 2
+#endif
+
+// DNS cache settings. Number of cached hosts, max. host name length and time to live (in milliseconds).
+#ifndef INKPLATE_ESP32_DNS_CACHE_SIZE
+#define INKPLATE_ESP32_DNS_CACHE_SIZE 4
+#endif
+#ifndef INKPLATE_ESP32_DNS_CACHE_HOST_LEN
+#define INKPLATE_ESP32_DNS_CACHE_HOST_LEN 64
+#endif
+#ifndef INKPLATE_ESP32_DNS_CACHE_TTL
+#define INKPLATE_ESP32_DNS_CACHE_TTL 300000UL
+#endif
+
+// Multiple connections settings. Max. number of links (ESP-AT supports up to 5), size of the
+// receive and transmit queue of each link and max. bytes sent from one link in one scheduling turn.
+#ifndef INKPLATE_ESP32_MAX_LINKS
+#define INKPLATE_ESP32_MAX_LINKS 5
+#endif
+#ifndef INKPLATE_ESP32_LINK_RX_BUFFER_SIZE
+#define INKPLATE_ESP32_LINK_RX_BUFFER_SIZE 1024
+#endif
+#ifndef INKPLATE_ESP32_LINK_TX_BUFFER_SIZE
+#define INKPLATE_ESP32_LINK_TX_BUFFER_SIZE 512
+#endif
+#ifndef INKPLATE_ESP32_LINK_TX_CHUNK
+#define INKPLATE_ESP32_LINK_TX_CHUNK 256
+#endif
+
+// Max. number of received datagrams waiting in the queue of one UDP link.
+#ifndef INKPLATE_ESP32_LINK_MAX_PACKETS
+#define INKPLATE_ESP32_LINK_MAX_PACKETS 8
+#endif
+
+// Max. time linkWrite() waits for the room in the full transmit queue (in milliseconds).
+#ifndef INKPLATE_ESP32_LINK_WRITE_TIMEOUT
+#define INKPLATE_ESP32_LINK_WRITE_TIMEOUT 5000UL
+#endif
+
+// SPI trace. Each record is: cmd, addr, direction, payload length (2 bytes), captured length (2 bytes),
+// CRC-16/CCITT of the whole payload (2 bytes), timestamp in microseconds (4 bytes), followed by the captured
+// part of the payload. Multi-byte values are little-endian.
+#define INKPLATE_ESP32_SPI_TRACE_HEADER_SIZE 13
+#define INKPLATE_ESP32_SPI_TRACE_DIR_TX      0
+#define INKPLATE_ESP32_SPI_TRACE_DIR_RX      1
+
+// Default max. number of the payload bytes captured for each SPI packet. Use 4092 (whole SPI packet) if the
+// trace needs to be replayed exactly.
+#ifndef INKPLATE_ESP32_SPI_TRACE_CAPTURE
+#define INKPLATE_ESP32_SPI_TRACE_CAPTURE 64
+#endif
+
+// TLS authentication modes of the SSL links (AT+CIPSSLCCONF). Server certificate is checked with the CA from the
+// CA partition of the modem, client certificate and key are the PKI from the client certificate partition.
+#define INKPLATE_ESP32_TLS_AUTH_NONE   0
+#define INKPLATE_ESP32_TLS_AUTH_CLIENT 1
+#define INKPLATE_ESP32_TLS_AUTH_SERVER 2
+#define INKPLATE_ESP32_TLS_AUTH_MUTUAL 3
+
+// States of the "+IPD" incoming data parser.
+#define INKPLATE_ESP32_IPD_STATE_SCAN    0
+#define INKPLATE_ESP32_IPD_STATE_HEADER  1
+#define INKPLATE_ESP32_IPD_STATE_PAYLOAD 2
+
 // Typedef struct used for SPI ESP32 message format.
 struct spiAtCommandTypedef
 {
@@ -32,6 +256,18 @@ struct spiAtCommandTypedef
     uint8_t *data;
 };
 
+// Max. number of segments gathered into one data send (see WiFiClass::sendAtData()).
+#ifndef INKPLATE_ESP32_SPI_MAX_SEGMENTS
+#define INKPLATE_ESP32_SPI_MAX_SEGMENTS 8
+#endif
+
+// Typedef struct used for one segment of the data send (the data is sent as it is, without the copy).
+struct spiAtSegmentTypedef
+{
+    const void *data;
+    uint16_t len;
+};
+
 // USed for easier storing scaned WiFi networks.
 struct spiAtWiFiScanTypedef
 {
@@ -40,6 +276,115 @@ struct spiAtWiFiScanTypedef
     char ssidName[65];
 };
 
+// Used for storing resolved host names in the DNS cache.
+struct spiAtDnsCacheEntryTypedef
+{
+    char host[INKPLATE_ESP32_DNS_CACHE_HOST_LEN];
+    uint8_t ip[4];
+    unsigned long resolvedAt;
+    unsigned long lastUsed;
+    bool valid;
+};
+
+// Used for multiple connections - data queues of one link ID.
+struct spiAtLinkTypedef
+{
+    bool used;
+    bool connected;
+    uint8_t rxBuffer[INKPLATE_ESP32_LINK_RX_BUFFER_SIZE];
+    uint16_t rxHead;
+    uint16_t rxTail;
+    uint16_t rxCount;
+    uint32_t rxDropped;
+    bool datagram;
+    uint16_t rxPacketLen[INKPLATE_ESP32_LINK_MAX_PACKETS];
+    uint8_t rxPacketHead;
+    uint8_t rxPacketTail;
+    uint8_t rxPacketCount;
+    uint8_t txBuffer[INKPLATE_ESP32_LINK_TX_BUFFER_SIZE];
+    uint16_t txHead;
+    uint16_t txTail;
+    uint16_t txCount;
+    unsigned long handshakeTime;
+    bool accepted;
+    uint8_t session;
+};
+
+// Used for the TLS settings of the SSL link. PKI and CA numbers select the certificates in the modem partitions,
+// SNI is the server name sent in the handshake (NULL - use the host name of the connection).
+struct spiAtTlsConfigTypedef
+{
+    uint8_t authMode;
+    uint8_t pkiNumber;
+    uint8_t caNumber;
+    const char *sni;
+};
+
+// Used for the SPI data path statistics (data sent to and read from the modem, time spent in the SPI
+// transfers). Time is in CPU cycles if the DWT cycle counter is available, otherwise in microseconds (64-bit
+// sums, 32-bit cycle count wraps after 9 s at 480 MHz).
+// Frame counters come from the sequence numbers of the slave status (lost - skipped sequence numbers,
+// duplicated - same sequence number twice, resyncs - modem restarted or master/slave sequence mismatch,
+// overflows - frames dropped since they did not fit into the buffer, retries - repeated slave status
+// or send requests). Background frames are read by the handshake ISR into the receive ring, deferred ones are
+// left for the foreground (no room in the ring). Dropped bytes are the bytes of the frames dropped by the
+// overflow, spilled bytes are the bytes given to the overflow sink.
+struct spiAtStatsTypedef
+{
+    uint32_t packets;
+    uint32_t txBytes;
+    uint32_t rxBytes;
+    uint64_t txCycles;
+    uint64_t rxCycles;
+    uint64_t controlCycles;
+    uint32_t framesLost;
+    uint32_t framesDuplicated;
+    uint32_t seqResyncs;
+    uint32_t rxOverflows;
+    uint32_t retries;
+    uint32_t rxBackgroundFrames;
+    uint32_t rxDeferred;
+    uint32_t rxDroppedBytes;
+    uint32_t rxSpilledBytes;
+};
+
+// Used for the command supervisor statistics. Failures are counted for each attempt by their class, recovery
+// time is measured from the first failed attempt to the successful one (in milliseconds).
+struct spiAtSupervisorStatsTypedef
+{
+    uint32_t commands;
+    uint32_t retries;
+    uint32_t busy;
+    uint32_t timeouts;
+    uint32_t protocolErrors;
+    uint32_t errorReplies;
+    uint32_t resyncs;
+    uint32_t powerCycles;
+    uint32_t failures;
+    uint32_t recoveries;
+    uint32_t lastRecoveryMs;
+    uint32_t maxRecoveryMs;
+    uint32_t totalRecoveryMs;
+};
+
+// Used for the adaptive timeout of one command type. Latency and jitter are the moving averages of the measured
+// response time and of its deviation (in microseconds). For the commands without the result code, response time
+// is the longest gap between the response parts. Timeout, default, limits and the fixed timeout (set by the
+// user, 0 - adaptive) are in milliseconds.
+struct spiAtTimeoutTypedef
+{
+    uint32_t timeout;
+    uint32_t defaultTimeout;
+    uint32_t minTimeout;
+    uint32_t maxTimeout;
+    uint32_t fixedTimeout;
+    uint32_t latency;
+    uint32_t jitter;
+    uint32_t samples;
+    uint32_t expired;
+    uint8_t backoff;
+};
+
 // Typedef/union used for data write request to the ESP32.
 union spiAtCommandDataInfoTypedef {
     struct dataInfoStruct
@@ -1,25 +1,171 @@
 // Include header file.
 #include "esp32SpiAt.h"
 
-// Flag for the handshake for the ESP32. Use SPI MODE0, MSBFIRST data transfet with approx. SPI clock rate of 20MHz.
-static volatile bool _esp32HandshakePinFlag = false;
+// The buffer must hold at least one complete SPI packet from the modem.
+static_assert(INKPLATE_ESP32_AT_CMD_BUFFER_SIZE > INKPLATE_ESP32_SPI_MAX_MESAGE_DATA_BUFFER,
+              "INKPLATE_ESP32_AT_CMD_BUFFER_SIZE must be larger than one SPI packet (4092 bytes)");
+static_assert(INKPLATE_ESP32_AT_CMD_BUFFER_SIZE <= 65535, "INKPLATE_ESP32_AT_CMD_BUFFER_SIZE must fit into 16 bits");
+static_assert(INKPLATE_ESP32_MAX_SCAN_AP <= 127, "INKPLATE_ESP32_MAX_SCAN_AP must fit into int8_t");
+
+// Static memory budget check (size of the global WiFi object, see WiFiSPITypedef.h).
+#ifdef INKPLATE_ESP32_RAM_BUDGET
+static_assert(sizeof(WiFiClass) <= INKPLATE_ESP32_RAM_BUDGET,
+              "WiFi object does not fit into INKPLATE_ESP32_RAM_BUDGET, reduce the buffer sizes (or use INKPLATE_ESP32_LOW_MEMORY)");
+#endif
+
+// Static memory report. Compiler prints the template arguments (size of each class in bytes) in the warning.
+#ifdef INKPLATE_ESP32_MEMORY_REPORT
+template <size_t _wifiClass, size_t _wifiClient, size_t _wifiSocket, size_t _wifiUdp, size_t _wifiMqtt, size_t _wifiTime>
+struct esp32SpiAtMemoryReport
+{
+    [[deprecated("RAM report: <WiFiClass, WiFiClient, WiFiSocket, WiFiUDP, WiFiMQTT, WiFiTime> sizes in bytes")]]
+    static constexpr size_t total = _wifiClass;
+};
+static_assert(esp32SpiAtMemoryReport<sizeof(WiFiClass), sizeof(WiFiClient), sizeof(WiFiSocket), sizeof(WiFiUDP),
+                                     sizeof(WiFiMQTT), sizeof(WiFiTime)>::total != 0,
+              "Memory report");
+#endif
+
+// Timestamp for the SPI statistics. CPU cycle counter is used if available (Cortex-M DWT).
+static inline uint32_t esp32SpiTimestamp()
+{
+#ifdef DWT
+    return DWT->CYCCNT;
+#else
+    return micros();
+#endif
+}
+
+// SPI clock steps for the auto tuning and the fallback.
+static const uint32_t _esp32SpiClockSteps[] = {INKPLATE_ESP32_SPI_CLOCK_STEPS};
+static const uint8_t _esp32SpiClockStepsCount = sizeof(_esp32SpiClockSteps) / sizeof(_esp32SpiClockSteps[0]);
+
+// Default, min. and max. timeout of each command type for the adaptive timeouts (in milliseconds, see
+// INKPLATE_ESP32_TIMEOUT_xxx). Where the timeout means the end of the data (quiet time of the modem, no more HTTP
+// data), it's never learned below the default one - pause of the server longer than the usual gap would cut
+// the data.
+static const uint32_t _esp32TimeoutDefaults[INKPLATE_ESP32_TIMEOUT_TYPES][3] = {
+    {20UL, 20UL, 200UL},       // Message filter config.
+    {40UL, 40UL, 400UL},       // Short responses (echo, HTTP headers).
+    {250UL, 50UL, 2000UL},     // WiFi radio init.
+    {2500UL, 1000UL, 10000UL}, // WiFi scan.
+    {2500UL, 2500UL, 10000UL}, // Next HTTP data chunk.
+    {5000UL, 1000UL, 30000UL}, // First HTTP data chunk.
+};
+
+// CRC-16/CCITT (0xFFFF initial value) of the SPI payload for the SPI trace.
+static uint16_t esp32SpiTraceCrc(const uint8_t *_data, uint16_t _len, uint16_t _crc = 0xFFFF)
+{
+    for (uint16_t i = 0; i < _len; i++)
+    {
+        _crc ^= (uint16_t)_data[i] << 8;
+        for (int j = 0; j < 8; j++)
+        {
+            _crc = (_crc & 0x8000) ? ((_crc << 1) ^ 0x1021) : (_crc << 1);
+        }
+    }
 
-// SPI Settings for ESP32.
-static SPISettings _esp32AtSpiSettings(20000000ULL, MSBFIRST, SPI_MODE0);
+    return _crc;
+}
 
-// ISR for the ESP32 handshake pin. This will be called automatically from the interrupt.
-static void esp32HandshakeISR()
+// CRC of the data gathered from the segments (same as the CRC of the data in one piece).
+static uint16_t esp32SpiSegmentsCrc(const struct spiAtSegmentTypedef *_segments, uint8_t _count)
 {
-    _esp32HandshakePinFlag = true;
+    uint16_t _crc = 0xFFFF;
+
+    for (uint8_t i = 0; i < _count; i++)
+        _crc = esp32SpiTraceCrc((const uint8_t *)_segments[i].data, _segments[i].len, _crc);
+
+    return _crc;
+}
+
+// Modems with the handshake interrupt attached. Each one has its own ISR trampoline, since
+// attachInterrupt() can't pass the object to the ISR.
+static_assert(INKPLATE_ESP32_MAX_MODEMS <= 4, "Only up to 4 handshake ISR trampolines are available");
+static WiFiClass *_esp32Modems[INKPLATE_ESP32_MAX_MODEMS] = {NULL};
+
+// ISRs for the ESP32 handshake pin. These will be called automatically from the interrupt.
+static void esp32HandshakeISR0()
+{
+    _esp32Modems[0]->handshakeInterrupt();
+}
+
+static void esp32HandshakeISR1()
+{
+    _esp32Modems[1]->handshakeInterrupt();
+}
+
+static void esp32HandshakeISR2()
+{
+    _esp32Modems[2]->handshakeInterrupt();
+}
+
+static void esp32HandshakeISR3()
+{
+    _esp32Modems[3]->handshakeInterrupt();
 }
 
+static void (*const _esp32HandshakeISRs[4])() = {esp32HandshakeISR0, esp32HandshakeISR1, esp32HandshakeISR2,
+                                                  esp32HandshakeISR3};
+
 /**
- * @brief Construct a new Wi-Fi Class:: Wi Fi Class object
+ * @brief Construct a new Wi-Fi Class:: Wi Fi Class object for the modem on the Inkplate board (default
+ *        SPI bus and pins).
  *
  */
 WiFiClass::WiFiClass()
+    : WiFiClass(SPI, INKPLATE_ESP32_CS_PIN, INKPLATE_ESP32_HANDSHAKE_PIN, INKPLATE_ESP32_PWR_SWITCH_PIN,
+                INKPLATE_ESP32_MISO_PIN, INKPLATE_ESP32_MOSI_PIN, INKPLATE_ESP32_SCK_PIN)
+{
+}
+
+/**
+ * @brief Construct a new Wi-Fi Class:: Wi Fi Class object for the modem on the selected SPI bus and pins.
+ *        Use it for additional modems (up to INKPLATE_ESP32_MAX_MODEMS) and bind the clients to it.
+ *
+ * @param   SPIClass &_spiBus
+ *          SPI bus used for the modem.
+ * @param   uint32_t _csPin
+ *          SPI CS pin of the modem.
+ * @param   uint32_t _handshakePin
+ *          Handshake pin of the modem (must be able to trigger the interrupt).
+ * @param   uint32_t _pwrPin
+ *          Power switch pin of the modem.
+ * @param   uint32_t _misoPin
+ *          SPI MISO pin.
+ * @param   uint32_t _mosiPin
+ *          SPI MOSI pin.
+ * @param   uint32_t _sckPin
+ *          SPI SCK pin.
+ */
+WiFiClass::WiFiClass(SPIClass &_spiBus, uint32_t _csPin, uint32_t _handshakePin, uint32_t _pwrPin,
+                     uint32_t _misoPin, uint32_t _mosiPin, uint32_t _sckPin)
+    : _esp32AtSpiSettings(INKPLATE_ESP32_SPI_CLOCK, MSBFIRST, SPI_MODE0)
 {
-    // Empty...for now.
+    // Save the SPI bus and pins of this modem.
+    _spi = &_spiBus;
+    this->_csPin = _csPin;
+    this->_handshakePin = _handshakePin;
+    this->_pwrPin = _pwrPin;
+    this->_misoPin = _misoPin;
+    this->_mosiPin = _mosiPin;
+    this->_sckPin = _sckPin;
+
+    // Start with the empty statistics.
+    clearSpiStats();
+    clearSupervisorStats();
+
+    // Start with an empty DNS cache.
+    clearDnsCache();
+
+    // Start with the default timeouts.
+    resetTimeouts();
+
+    // Clear the data queues of all links.
+    for (int i = 0; i < INKPLATE_ESP32_MAX_LINKS; i++)
+    {
+        linkReset(i);
+    }
 }
 
 /**
@@ -34,28 +180,54 @@ bool WiFiClass::init()
 {
     // Set the hardware level stuff first.
 
+    // Find the ISR trampoline for this modem (the same one if init() is called again). Return false if
+    // all of them are already used.
+    if (_modemIndex < 0)
+    {
+        for (int i = 0; i < INKPLATE_ESP32_MAX_MODEMS; i++)
+        {
+            if (_esp32Modems[i] == NULL)
+            {
+                _esp32Modems[i] = this;
+                _modemIndex = i;
+                break;
+            }
+        }
+
+        if (_modemIndex < 0)
+            return false;
+    }
+
     // Set the SPI pins.
-    SPI.setMISO(INKPLATE_ESP32_MISO_PIN);
-    SPI.setMOSI(INKPLATE_ESP32_MOSI_PIN);
-    SPI.setSCLK(INKPLATE_ESP32_SCK_PIN);
+    _spi->setMISO(_misoPin);
+    _spi->setMOSI(_mosiPin);
+    _spi->setSCLK(_sckPin);
 
     // Initialize Arduino SPI Library.
-    SPI.begin();
+    _spi->begin();
 
     // Set handshake pin.
-    pinMode(INKPLATE_ESP32_HANDSHAKE_PIN, INPUT_PULLUP);
+    pinMode(_handshakePin, INPUT_PULLUP);
 
     // Set interrupt on handshake pin.
-    attachInterrupt(digitalPinToInterrupt(INKPLATE_ESP32_HANDSHAKE_PIN), esp32HandshakeISR, RISING);
+    attachInterrupt(digitalPinToInterrupt(_handshakePin), _esp32HandshakeISRs[_modemIndex], RISING);
 
-    // Set SPI CS Pin.
-    pinMode(INKPLATE_ESP32_CS_PIN, OUTPUT);
+    // Set SPI CS Pin. Get its port and mask for the fast HAL access.
+    pinMode(_csPin, OUTPUT);
+    _csPort = digitalPinToPort(_csPin);
+    _csPinMask = digitalPinToBitMask(_csPin);
 
     // Disable ESP32 SPI for now.
-    digitalWrite(INKPLATE_ESP32_CS_PIN, HIGH);
+    digitalWrite(_csPin, HIGH);
 
     // Set ESP32 power switch pin.
-    pinMode(INKPLATE_ESP32_PWR_SWITCH_PIN, OUTPUT);
+    pinMode(_pwrPin, OUTPUT);
+
+#ifdef DWT
+    // Enable the CPU cycle counter for the SPI statistics.
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
 
     // Try to power on the modem. Return false if failed.
     if (!power(true))
@@ -80,7 +252,7 @@ bool WiFiClass::power(bool _en)
     if (_en)
     {
         // Enable the power to the ESP32.
-        digitalWrite(INKPLATE_ESP32_PWR_SWITCH_PIN, HIGH);
+        digitalWrite(_pwrPin, HIGH);
 
         // Wait a little bit for the ESP32 to boot up.
         delay(100);
@@ -121,7 +293,7 @@ bool WiFiClass::power(bool _en)
     {
         // Disable the power to the modem.
         // Disable the power to the ESP32.
-        digitalWrite(INKPLATE_ESP32_PWR_SWITCH_PIN, HIGH);
+        digitalWrite(_pwrPin, LOW);
 
         // Wait a little bit for the ESP32 to power down.
         delay(100);
@@ -131,6 +303,127 @@ bool WiFiClass::power(bool _en)
     return true;
 }
 
+/**
+ * @brief   Called from the handshake ISR of this modem. Modem has the data for the master or it's ready to
+ *          accept the data. With the background reception (see backgroundRxStart()), the frame is read right
+ *          here if the SPI is free (no transfer in the foreground), no older frame is waiting for the foreground
+ *          and the receive ring has room for it. Otherwise the foreground reads it. Trace is recorded only by
+ *          the foreground, so nothing is read here while the trace is on.
+ *
+ */
+void WiFiClass::handshakeInterrupt()
+{
+    if ((_rxRing != NULL) && (_spiLock == 0) && !_esp32HandshakePinFlag && (_replayData == NULL) &&
+        !_traceRecording && backgroundRead())
+        return;
+
+    _esp32HandshakePinFlag = true;
+}
+
+/**
+ * @brief   Start the background reception. Frames from the modem are read from the handshake ISR into the
+ *          receive ring, so the modem is drained even while the application is busy (display update etc.).
+ *          Methods that read the response only take the frames from the ring.
+ *
+ * @param   uint8_t *_buffer
+ *          Buffer for the receive ring (it must stay valid until backgroundRxStop()).
+ * @param   uint32_t _size
+ *          Size of the buffer in bytes (it must hold at least one largest frame with its 2 byte header, more is
+ *          better).
+ * @return  bool
+ *          true - Background reception started.
+ *          false - Buffer is too small.
+ */
+bool WiFiClass::backgroundRxStart(uint8_t *_buffer, uint32_t _size)
+{
+    // Check for user mistake (null-pointer or too small buffer).
+    if ((_buffer == NULL) || (_size <= (INKPLATE_ESP32_SPI_MAX_MESAGE_DATA_BUFFER + 2)))
+        return false;
+
+    // Frame is read in the handshake ISR, so it goes to the lowest priority (every other interrupt can preempt
+    // the transfer). Previous priority is restored by backgroundRxStop().
+    if (_rxRing == NULL)
+    {
+        _handshakeIrqPriority = NVIC_GetPriority(handshakeIrq());
+        NVIC_SetPriority(handshakeIrq(), INKPLATE_ESP32_HANDSHAKE_IRQ_PRIORITY);
+    }
+
+    // Start with an empty ring. ISR can't run in the middle of it, since the ring is set last.
+    _rxRing = NULL;
+    _rxRingSize = _size;
+    _rxRingHead = 0;
+    _rxRingTail = 0;
+    _rxRing = _buffer;
+
+    return true;
+}
+
+/**
+ * @brief   Stop the background reception. Frames still in the ring are dropped, so stop it when no response
+ *          is expected.
+ *
+ */
+void WiFiClass::backgroundRxStop()
+{
+    if (_rxRing != NULL)
+        NVIC_SetPriority(handshakeIrq(), _handshakeIrqPriority);
+
+    _rxRing = NULL;
+    _rxRingHead = 0;
+    _rxRingTail = 0;
+}
+
+/**
+ * @brief   Helper method for getting the EXTI interrupt of the handshake pin (lines 5-9 and 10-15 share one).
+ *
+ * @return  IRQn_Type
+ *          Interrupt number.
+ */
+IRQn_Type WiFiClass::handshakeIrq()
+{
+    uint32_t _line = STM_PIN(digitalPinToPinName(_handshakePin));
+
+    if (_line <= 4)
+    {
+        const IRQn_Type _irqs[] = {EXTI0_IRQn, EXTI1_IRQn, EXTI2_IRQn, EXTI3_IRQn, EXTI4_IRQn};
+        return _irqs[_line];
+    }
+
+    return (_line <= 9) ? EXTI9_5_IRQn : EXTI15_10_IRQn;
+}
+
+/**
+ * @brief   Set what happens with the frame from the modem that does not fit into the response buffer.
+ *
+ * @param   uint8_t _policy
+ *          INKPLATE_ESP32_OVERFLOW_DROP - Frame is dropped (response is not complete, see rxDroppedBytes in the
+ *          SPI statistics).
+ *          INKPLATE_ESP32_OVERFLOW_SINK - Response received so far is given to the sink and the frame is stored
+ *          from the beginning of the buffer, so the buffer always has the latest part (with the result code).
+ *          INKPLATE_ESP32_OVERFLOW_BACKPRESSURE - Frame is left in the modem (or in the receive ring) until there
+ *          is room for it. Modem stops sending in the meantime. Only pollAtResult() with the hold enabled waits
+ *          this way (caller frees the space in its buffer), other methods drop the frame. Nothing can be sent
+ *          while the frame is held in the modem (its read is not finished).
+ * @param   spiAtOverflowSink _sink
+ *          Called with the spilled part of the response (only for INKPLATE_ESP32_OVERFLOW_SINK). Single frame
+ *          larger than the whole buffer is still dropped.
+ * @return  bool
+ *          true - Policy set.
+ *          false - Wrong policy or the sink is missing.
+ */
+bool WiFiClass::setOverflowPolicy(uint8_t _policy, spiAtOverflowSink _sink)
+{
+    // Check for user mistake.
+    if ((_policy > INKPLATE_ESP32_OVERFLOW_BACKPRESSURE) ||
+        ((_policy == INKPLATE_ESP32_OVERFLOW_SINK) && (_sink == NULL)))
+        return false;
+
+    _overflowPolicy = _policy;
+    _overflowSink = _sink;
+
+    return true;
+}
+
 /**
  * @brief   Methods sends AT command to the modem. It check if the modem is ready to accept the command or not.
  *
@@ -143,27 +436,132 @@ bool WiFiClass::power(bool _en)
  */
 bool WiFiClass::sendAtCommand(char *_atCommand)
 {
-    // Get the data size.
-    uint16_t _dataLen = strlen(_atCommand);
+    // Send the command with its string length.
+    return sendAtData(_atCommand, strlen(_atCommand));
+}
+
+/**
+ * @brief   Methods sends AT command made with the AtCommandBuilder to the modem. Length of the command is
+ *          already known, so there is no need for strlen().
+ *
+ * @param   AtCommandBuilder &_atCommand
+ *          Built AT command (with CRLF at the end).
+ * @return  bool
+ *          true - AT Command is successfully sent.
+ *          false - AT Command send failed (command did not fit into the buffer or modem not ready).
+ */
+bool WiFiClass::sendAtCommand(AtCommandBuilder &_atCommand)
+{
+    // Do not send incomplete command.
+    if (_atCommand.overflow())
+        return false;
+
+    return sendAtData(_atCommand.c_str(), _atCommand.length());
+}
+
+/**
+ * @brief   Methods sends raw data to the modem (binary data, data for AT+CIPSEND etc). It check if the
+ *          modem is ready to accept the data or not.
+ *
+ * @param   const char *_data
+ *          Pointer to the data that will be sent to the modem.
+ * @param   uint16_t _len
+ *          Length of the data (in bytes).
+ * @return  bool
+ *          true - Data is successfully sent.
+ *          false - Data send failed (modem not ready to accept the data).
+ */
+bool WiFiClass::sendAtData(const char *_data, uint16_t _len)
+{
+    // Data in one piece is one segment.
+    struct spiAtSegmentTypedef _segment = {_data, _len};
 
-    // First make a request for data send.
-    dataSendRequest(_dataLen, 1);
+    return sendAtData(&_segment, 1);
+}
 
-    // Read the slave status.
-    uint8_t _slaveStatus = 0;
-    _slaveStatus = requestSlaveStatus();
+/**
+ * @brief   Methods sends raw data gathered from the segments to the modem in one request (for example the prefix,
+ *          the payload and the CRLF, each from its own buffer). Lengths are exact, so the data can have any
+ *          bytes (NUL included) and nothing is copied into the data buffer first.
+ *
+ * @param   const struct spiAtSegmentTypedef *_segments
+ *          Segments of the data, sent one after the other.
+ * @param   uint8_t _count
+ *          Number of the segments (max. INKPLATE_ESP32_SPI_MAX_SEGMENTS).
+ * @return  bool
+ *          true - Data is successfully sent.
+ *          false - Data send failed (too many segments, data longer than 65535 bytes or modem not ready).
+ */
+bool WiFiClass::sendAtData(const struct spiAtSegmentTypedef *_segments, uint8_t _count)
+{
+    // Check for user mistake (null-pointer!).
+    if ((_segments == NULL) || (_count == 0) || (_count > INKPLATE_ESP32_SPI_MAX_SEGMENTS))
+        return false;
 
-    // Check the slave status, if must be INKPLATE_ESP32_SPI_SLAVE_STATUS_WRITEABLE.
-    if (_slaveStatus != INKPLATE_ESP32_SPI_SLAVE_STATUS_WRITEABLE)
+    // Get the data size.
+    uint32_t _totalLen = 0;
+    for (uint8_t i = 0; i < _count; i++)
+    {
+        if ((_segments[i].data == NULL) && (_segments[i].len != 0))
+            return false;
+        _totalLen += _segments[i].len;
+    }
+    if (_totalLen > 0xFFFF)
         return false;
+    uint16_t _dataLen = _totalLen;
 
-    // Send the data.
-    dataSend(_atCommand, _dataLen);
+    // Frame held back by the backpressure is in the middle of the read (its status has been read), the modem
+    // can't take anything until it's read.
+    if (_rxHeldLen != 0)
+        return false;
 
-    // Send data end.
-    dataSendEnd();
+    // New command, new response. Nothing has been dropped from it yet.
+    _spiRxOverflow = false;
 
-    return true;
+    // Send request, status and the data must not be interrupted by the background reception.
+    spiLock();
+
+    // Try a few times, each request has the next sequence number.
+    bool _sent = false;
+    for (int i = 0; (i <= INKPLATE_ESP32_SPI_RETRIES) && !_sent; i++)
+    {
+        // Count the retries.
+        if (i != 0)
+            _spiStats.retries++;
+
+        // First make a request for data send.
+        _spiTxSeq++;
+        dataSendRequest(_dataLen, _spiTxSeq);
+
+        // Read the slave status.
+        uint8_t _slaveSeq = 0;
+        uint8_t _slaveStatus = requestSlaveStatus(NULL, &_slaveSeq);
+
+        // Check the slave status, if must be INKPLATE_ESP32_SPI_SLAVE_STATUS_WRITEABLE.
+        if (_slaveStatus != INKPLATE_ESP32_SPI_SLAVE_STATUS_WRITEABLE)
+            continue;
+
+        // Modem must confirm the sequence number of this request. If it does not, the request got corrupted
+        // or the modem restarted (it starts again from 1), so make a new request.
+        if (_slaveSeq != _spiTxSeq)
+        {
+            _spiStats.seqResyncs++;
+            _spiTxSeq = _slaveSeq;
+            continue;
+        }
+
+        // Send the data.
+        dataSend(_segments, _count);
+
+        // Send data end.
+        dataSendEnd();
+
+        _sent = true;
+    }
+
+    spiUnlock();
+
+    return _sent;
 }
 
 /**
@@ -179,7 +577,8 @@ bool WiFiClass::sendAtCommand(char *_atCommand)
  * @param   unsigned long _timeout
  *          Timeout value from the last received char or packet in milliseconds.
  * @return  bool
- *          true - Response has been received (no error handle for now).
+ *          true - Response has been received.
+ *          false - Part of the response has been dropped (buffer too small).
  */
 bool WiFiClass::getAtResponse(char *_response, uint32_t _bufferLen, unsigned long _timeout)
 {
@@ -189,50 +588,43 @@ bool WiFiClass::getAtResponse(char *_response, uint32_t _bufferLen, unsigned lon
     // Variable for the response array index offset.
     uint32_t _resposeArrayOffset = 0;
 
+    // Nothing has been dropped (or received) yet.
+    _spiRxOverflow = false;
+    _lastResponseGap = 0;
+    _lastResponseReceived = false;
+
     // Capture the time!
     _timeoutCounter = millis();
 
     // Now loop until the timeout occurs
     while ((unsigned long)(millis() - _timeoutCounter) < _timeout)
     {
-        // Wait for the response by checking the handshake pin.
-        if (_esp32HandshakePinFlag)
+        // Wait for the response (handshake pin or the frame read in the background).
+        if (rxPending())
         {
-            // Update the timeout!
-            _timeoutCounter = millis();
-
-            // Read the slave status.
-            uint16_t _responseLen = 0;
-            uint8_t _slaveStatus = requestSlaveStatus(&_responseLen);
-
-            // Check the slave status, if must be INKPLATE_ESP32_SPI_SLAVE_STATUS_READABLE
-            if (_slaveStatus != INKPLATE_ESP32_SPI_SLAVE_STATUS_READABLE)
-                return false;
-
-            // Check if there is enough free memory in the buffer. If there is still free memory,
-            // get the response. Otherwise, drop everything.
-            if ((_responseLen + _resposeArrayOffset) < _bufferLen)
-            {
-                // Read the data.
-                dataRead((_response + _resposeArrayOffset), _responseLen);
+            // Time since the last part of the response (for the adaptive timeouts).
+            unsigned long _gap = millis() - _timeoutCounter;
 
-                // Move the index in response array.
-                _resposeArrayOffset += _responseLen;
-            }
+            // Get the frame and move the index in response array. Anything else is a stale handshake (or the
+            // frame held back by the overflow policy), skip it and wait for the next one.
+            if (fetchFrame(_response, _bufferLen, &_resposeArrayOffset) != 1)
+                continue;
 
-            // Send read done.
-            dataReadEnd();
+            // Update the timeout!
+            _timeoutCounter = millis();
 
-            // Clear the flag.
-            _esp32HandshakePinFlag = false;
+            // Remember the longest gap.
+            if (_gap > _lastResponseGap)
+                _lastResponseGap = _gap;
+            _lastResponseReceived = true;
         }
     }
 
     // Add null-terminating char.
     _response[_resposeArrayOffset] = '\0';
 
-    // Evertything went ok? Return true!
-    return true;
+    // Response is not complete if something has been dropped.
+    return !_spiRxOverflow;
 }
 
 /**
@@ -248,7 +640,8 @@ bool WiFiClass::getAtResponse(char *_response, uint32_t _bufferLen, unsigned lon
  * @param   uint16_t *_rxLen
  *          Pointer to the variable ehere length of the receiveds data will be stored.
  * @return  bool
- *          true - Response has been received (no error handle for now).
+ *          true - Response has been received.
+ *          false - Timeout, modem is not readable or the response does not fit into the buffer.
  */
 bool WiFiClass::getSimpleAtResponse(char *_response, uint32_t _bufferLen, unsigned long _timeout, uint16_t *_rxLen)
 {
@@ -262,837 +655,3394 @@ bool WiFiClass::getSimpleAtResponse(char *_response, uint32_t _bufferLen, unsign
     _timeoutCounter = millis();
 
     // Now loop until the timeout occurs
-    while (((unsigned long)(millis() - _timeoutCounter) < _timeout) && (!_esp32HandshakePinFlag))
+    while (((unsigned long)(millis() - _timeoutCounter) < _timeout) && !rxPending())
         ;
 
     // If the timeout occured, return false.
-    if (!_esp32HandshakePinFlag)
+    if (!rxPending())
         return false;
 
     // Otherwise read the data.
-    // Check the slave status, if must be INKPLATE_ESP32_SPI_SLAVE_STATUS_READABLE
-    uint8_t _slaveStatus = requestSlaveStatus(&_responseLen);
-
-    // Check the slave status, if must be INKPLATE_ESP32_SPI_SLAVE_STATUS_READABLE
-    if (_slaveStatus != INKPLATE_ESP32_SPI_SLAVE_STATUS_READABLE)
+    if (pollFrame(_response, _bufferLen, &_responseLen) != 1)
         return false;
 
-    // Check if the buffer is large enough for the data.
-    // If not, drop everything.
-    if (_responseLen < _bufferLen)
-    {
-        // Read the data.
-        dataRead(_response, _responseLen);
-    }
-
-    // Clear handshake pin.
-    _esp32HandshakePinFlag = false;
-
-    // Send read done.
-    dataReadEnd();
-
-    // Add null-terminating char if needed.
-    if (_rxLen == NULL)
-    {
-        _response[_responseLen] = '\0';
-    }
-    else
-    {
+    // Save the length if needed.
+    if (_rxLen != NULL)
         *_rxLen = _responseLen;
-    }
 
     // Evertything went ok? Return true!
     return true;
 }
 
 /**
- * @brief   Method pings the modem (sends "AT" command and waits for AT OK).
+ * @brief   Wait for the final result of the AT command ("OK" or "ERROR"). Unlike getAtResponse(), it
+ *          does not wait for the timeout to expire if the result code has already been received, so
+ *          it can be used for commands that need some time to execute (DNS, connect, etc).
  *
+ * @param   char *_response
+ *          Buffer where to store response.
+ * @param   uint32_t _bufferLen
+ *          length of the buffer for the response (in bytes, counting the null-terminating char).
+ * @param   unsigned long _timeout
+ *          Max. time to wait for the result code in milliseconds.
+ * @param   const char *_expected
+ *          Response that marks the success (by default "\r\nOK\r\n").
  * @return  bool
- *          true - Modem is available (received AT OK).
- *          false - Modem is not available.
+ *          true - Expected response has been received.
+ *          false - "ERROR" or "FAIL" has been received or timeout occured.
  */
-bool WiFiClass::modemPing()
+bool WiFiClass::waitForAtResult(char *_response, uint32_t _bufferLen, unsigned long _timeout, const char *_expected)
 {
-    // Send "AT" AT Command for Modem Ping.
-    sendAtCommand((char *)esp32AtPingCommand);
+    // Variable for the response array index offset.
+    uint32_t _resposeArrayOffset = 0;
 
-    // Wait for the response from the modem.
-    if (!getAtResponse((char *)_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE, 20ULL))
-        return false;
+    // Capture the time!
+    unsigned long _timeoutCounter = millis();
 
-    // Check if AT\r\n\r\nOK\r\n\r\n is received.
-    if (strcmp((char *)_dataBuffer, esp32AtPingResponse) != 0)
-        return false;
+    // Clear the response in the case nothing arrives.
+    _response[0] = '\0';
 
-    // If everything went ok, return true.
-    return true;
+    // Nothing has been dropped yet.
+    _spiRxOverflow = false;
+
+    // Now loop until the timeout occurs.
+    while ((unsigned long)(millis() - _timeoutCounter) < _timeout)
+    {
+        // Check for the new data and the result code. Stop as soon as it's found.
+        int8_t _ret = pollAtResult(_response, _bufferLen, &_resposeArrayOffset, _expected, false);
+        if (_ret >= 0)
+            return (_ret == 1);
+    }
+
+    // Timeout, no result code received.
+    return false;
 }
 
 /**
- * @brief   Methods sends AT command to set factory settings to the ESP32.
+ * @brief   Non-blocking part of waitForAtResult(). If the modem has the data for the master, one packet is read
+ *          and the response is checked for the result code. Use it to wait for the result without blocking.
  *
- * @return  bool
- *          true - Modem restored settings to it's factory values.
- *          false - Modem failed to restore settings.
+ * @param   char *_response
+ *          Buffer where to store response.
+ * @param   uint32_t _bufferLen
+ *          length of the buffer for the response (in bytes, counting the null-terminating char).
+ * @param   uint32_t *_offset
+ *          Pointer to the length of the response received so far (set it to zero before the first call).
+ * @param   const char *_expected
+ *          Result code that means success (default is "OK").
+ * @param   bool _hold
+ *          true - Frame that does not fit is held back with INKPLATE_ESP32_OVERFLOW_BACKPRESSURE policy (caller
+ *          must free the space by moving the response and the offset back, see setOverflowPolicy()).
+ *          false - Frame that does not fit is dropped.
+ * @return  int8_t
+ *          1 - Expected result code received.
+ *          0 - Command failed ("ERROR", "FAIL" or part of the response has been dropped).
+ *          -1 - No result yet.
  */
-bool WiFiClass::systemRestore()
+int8_t WiFiClass::pollAtResult(char *_response, uint32_t _bufferLen, uint32_t *_offset, const char *_expected,
+                               bool _hold)
 {
-    // Calling this command will set ESP32 to its factory settings.
-    if (!sendAtCommand((char *)esp32AtCmdSystemRestore))
-        return false;
+    // Get the next frame and move the index in response array. Nothing new from the modem or a stale
+    // handshake, wait for the next one.
+    if (fetchFrame(_response, _bufferLen, _offset, _hold) != 1)
+        return -1;
 
-    // ESP32 nonsense. Wait for 2 seconds after memory restore.
-    // Using handshake doesn't work reliably since it fires multiple times.
-    delay(2200);
+    // Add null-terminating char.
+    _response[*_offset] = '\0';
 
-    // Read a response to clear the flag.
-    if (!getAtResponse(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE, 40ULL)) return false;
+    // Check for the result code. Result is not valid if part of the response has been dropped.
+    if (strstr(_response, _expected) != NULL)
+        return _spiRxOverflow ? 0 : 1;
+    if ((strstr(_response, "ERROR\r\n") != NULL) || (strstr(_response, "FAIL\r\n") != NULL))
+        return 0;
 
-    // Everything went ok? Return true.
-    return true;
+    return -1;
 }
 
 /**
- * @brief   Enable or disable storing settings into ESP32 NVM. By default, while power up, it is
- *          disabled.
+ * @brief   Non-blocking part of getSimpleAtResponse(). If the modem has the data for the master, one packet is
+ *          read into the buffer (with the null-terminating char at the end).
  *
- * @param   bool _store
- *          true - Store settings into ESP32 NVM.
- *          false - Do not store settings into NVM.
- * @return  bool
- *          true - Command executed successfully.
- *          false - Command failed.
+ * @param   char *_buffer
+ *          Buffer where to store the data.
+ * @param   uint32_t _bufferLen
+ *          length of the buffer (in bytes, counting the null-terminating char).
+ * @param   uint16_t *_len
+ *          Pointer to the variable where the length of the received data will be stored.
+ * @return  int8_t
+ *          1 - Data received.
+ *          0 - Modem is not readable or the data does not fit into the buffer.
+ *          -1 - No data yet.
  */
-bool WiFiClass::storeSettingsInNVM(bool _store)
+int8_t WiFiClass::pollFrame(char *_buffer, uint32_t _bufferLen, uint16_t *_len)
 {
-    // Disable or enable storing data in NVM. By default, storing is enabled, but at the ESP
-    // start up is disabled.
-
-    // Make a AT Command depending on the choice of storing settings in NVM.
-    sprintf(_dataBuffer, "AT+SYSSTORE=%d\r\n", _store ? 1 : 0);
+    // Get the next frame. If the buffer is too small for it, it's handled by the overflow policy.
+    _spiRxOverflow = false;
+    uint32_t _responseLen = 0;
+    int8_t _ret = fetchFrame(_buffer, _bufferLen, &_responseLen);
 
-    // Send AT Command. Return false if failed.
-    if (!sendAtCommand(_dataBuffer))
-        return false;
+    // Nothing new from the modem or the modem is not readable.
+    if (_ret != 1)
+        return _ret;
 
-    // Wait for the response. Return false if failed.
-    if (!getAtResponse(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE, 10ULL))
-        return false;
+    // Frame dropped?
+    if (_spiRxOverflow)
+        return 0;
 
-    // Check for the respose. Try to find "\r\nOK\r\n". Return false if find failed.
-    if (strstr(_dataBuffer, esp32AtCmdResponse) == NULL)
-        return false;
+    // Add null-terminating char and save the length.
+    _buffer[_responseLen] = '\0';
+    if (_len != NULL)
+        *_len = _responseLen;
 
-    // Otherwise return true.
-    return true;
+    return 1;
 }
 
+#ifdef INKPLATE_ESP32_COROUTINES
 /**
- * @brief   Get the pointer (address) of the buffer for the SPI data.
+ * @brief   Send the AT command and wait for its result without blocking (co_await WiFi.command(...)). Command
+ *          is sent when the await starts, the response is in the data buffer.
  *
- * @return  char*
- *          Pointer of the SPI buffer for ESP32 communication and commands.
+ * @param   const char *_atCommand
+ *          AT command with CRLF at the end (it must stay valid until the await starts).
+ * @param   unsigned long _timeout
+ *          Max. time to wait for the result (in milliseconds).
+ * @param   const char *_expected
+ *          Result code that means success (default is "OK").
+ * @return  AtCommandAwaitable
+ *          Await for the result (true - success, false - failed or timeout).
  */
-char *WiFiClass::getDataBuffer()
+AtCommandAwaitable WiFiClass::command(const char *_atCommand, unsigned long _timeout, const char *_expected)
 {
-    // Return the main RX/TX buffer fopr SPI data.
-    return _dataBuffer;
+    return AtCommandAwaitable(this, _atCommand, _timeout, _expected);
 }
 
 /**
- * @brief   Methods sets WiFi mode (null, station, SoftAP or station and SoftAP).
+ * @brief   Send the AT command made with the AtCommandBuilder and wait for its result without blocking.
  *
- * @param   uint8_t _wifiMode
- *          Use preddifend macros (can be found in WiFiSPITypedef.h)
- *          INKPLATE_WIFI_MODE_NULL - Null mode (modem disabled)
- *          INKPLATE_WIFI_MODE_STA - Station mode
- *          INKPLATE_WIFI_MODE_AP - Soft Access Point (not implemeted yet!)
- *          INKPLATE_WIFI_MODE_STA_AP - Both station and Soft Access Point (AP mode still not implemeted!).
+ * @param   AtCommandBuilder &_atCommand
+ *          AT command made with the AtCommandBuilder (with CRLF at the end).
+ * @param   unsigned long _timeout
+ *          Max. time to wait for the result (in milliseconds).
+ * @param   const char *_expected
+ *          Result code that means success (default is "OK").
+ * @return  AtCommandAwaitable
+ *          Await for the result (true - success, false - failed, timeout or command too long).
+ */
+AtCommandAwaitable WiFiClass::command(AtCommandBuilder &_atCommand, unsigned long _timeout, const char *_expected)
+{
+    return AtCommandAwaitable(this, _atCommand.overflow() ? NULL : _atCommand.c_str(), _timeout, _expected);
+}
+
+/**
+ * @brief   Wait for the next data packet from the modem without blocking (co_await WiFi.frame(...)).
+ *
+ * @param   char *_buffer
+ *          Buffer where to store the data.
+ * @param   uint32_t _bufferLen
+ *          length of the buffer (in bytes, counting the null-terminating char).
+ * @param   unsigned long _timeout
+ *          Max. time to wait for the data (in milliseconds).
+ * @param   const void *_owner
+ *          Owner of the lock already taken with lock() (the modem stays taken after the await), NULL if the await
+ *          takes the modem only for itself (default).
+ * @return  AtFrameAwaitable
+ *          Await for the data (number of received bytes, -1 if failed or timeout).
+ */
+AtFrameAwaitable WiFiClass::frame(char *_buffer, uint32_t _bufferLen, unsigned long _timeout, const void *_owner)
+{
+    return AtFrameAwaitable(this, _buffer, _bufferLen, _timeout, _owner);
+}
+
+/**
+ * @brief   Wait for the modem to be free and keep it for the task (co_await WiFi.lock(this)), so the commands of
+ *          the other tasks do not get in the middle of a command sequence. Blocking commands and frame awaits
+ *          with the same owner can be used until the task releases the modem with awaitUnlock().
+ *
+ * @param   const void *_owner
+ *          Owner of the lock (usually the object the task runs for).
+ * @return  AtLockAwaitable
+ *          Await for the modem.
+ */
+AtLockAwaitable WiFiClass::lock(const void *_owner)
+{
+    return AtLockAwaitable(this, _owner);
+}
+
+/**
+ * @brief   Take the modem for the await. Awaits of different tasks on the same modem would take each other's
+ *          responses and share the data buffer, so they go one after another.
+ *
+ * @param   const void *_owner
+ *          Await that wants to use the modem.
  * @return  bool
- *          true - Mode set successfully on ESP32
- *          false - Mode set failed.
+ *          true - Modem is free (or already taken by this await).
+ *          false - Modem is used by another await, try again later.
  */
-bool WiFiClass::setMode(uint8_t _wifiMode)
+bool WiFiClass::awaitLock(const void *_owner)
 {
-    // Check for the proper mode.
-    if ((_wifiMode > INKPLATE_WIFI_MODE_STA_AP))
+    if ((_awaitOwner != NULL) && (_awaitOwner != _owner))
         return false;
 
-    // Create AT Command string depending on the mode.
-    sprintf(_dataBuffer, "AT+CWMODE=%d\r\n", _wifiMode);
+    _awaitOwner = _owner;
+    return true;
+}
 
-    // Issue a AT Command for WiFi Mode.
-    sendAtCommand(_dataBuffer);
+/**
+ * @brief   Release the modem taken with awaitLock().
+ *
+ * @param   const void *_owner
+ *          Await that used the modem.
+ */
+void WiFiClass::awaitUnlock(const void *_owner)
+{
+    if (_awaitOwner == _owner)
+        _awaitOwner = NULL;
+}
+#endif
 
-    // Wait for the response.
-    if (!getAtResponse(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE, 40ULL))
-        return false;
+/**
+ * @brief   Method pings the modem (sends "AT" command and waits for AT OK).
+ *
+ * @return  bool
+ *          true - Modem is available (received AT OK).
+ *          false - Modem is not available.
+ */
+bool WiFiClass::modemPing()
+{
+    // Send "AT" AT Command for Modem Ping.
+    sendAtCommand((char *)esp32AtPingCommand);
 
-    // Check for the result.
-    if (strstr(_dataBuffer, esp32AtCmdResponse) == NULL)
+    // Wait for the response from the modem.
+    if (!getAtResponse((char *)_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE, 20ULL))
         return false;
 
-    // Now disconnect from the network.
-    disconnect();
+    // Check if AT\r\n\r\nOK\r\n\r\n is received.
+    if (strcmp((char *)_dataBuffer, esp32AtPingResponse) != 0)
+        return false;
 
-    // Otherwise, return ok.
+    // If everything went ok, return true.
     return true;
 }
 
 /**
- * @brief   Connect to the access point.
+ * @brief   Methods sends AT command to set factory settings to the ESP32.
  *
- * @param   char *_ssid
- *          Char array/pointer to the AP name name.
- * @param   char *_pass
- *          Char array/pointer to the AP password.
  * @return  bool
- *          true - Command execution was successfull.
- *          false -  Command execution failed.
- * @note    Max characters for password is limited to 63 chars and SSID is only limited to UTF-8 encoding.
- *          Try to avoid usage following chars: {"}, {,}, {\\}. If used, escape char must be added.
+ *          true - Modem restored settings to it's factory values.
+ *          false - Modem failed to restore settings.
  */
-bool WiFiClass::begin(char *_ssid, char *_pass)
+bool WiFiClass::systemRestore()
 {
-    // Check for user mistake (null-pointer!).
-    if ((_ssid == NULL) || (_pass == NULL))
+    // Calling this command will set ESP32 to its factory settings.
+    if (!sendAtCommand((char *)esp32AtCmdSystemRestore))
         return false;
 
-    // Create string for AT comamnd.
-    sprintf(_dataBuffer, "AT+CWJAP=\"%s\",\"%s\"\r\n", _ssid, _pass);
+    // ESP32 nonsense. Wait for 2 seconds after memory restore.
+    // Using handshake doesn't work reliably since it fires multiple times.
+    delay(2200);
 
-    // Issue an AT Command to the modem.
-    if (!sendAtCommand(_dataBuffer))
-        false;
+    // Read a response to clear the flag.
+    if (!getAtResponse(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE, 40ULL)) return false;
 
-    // Do not wait for response eventhough modem will send reponse as soon as the WiFi connection is established.
+    // Everything went ok? Return true.
     return true;
 }
 
 /**
- * @brief   Methods returns the status of the ESP32 WiFi connection the AP.
+ * @brief   Enable or disable storing settings into ESP32 NVM. By default, while power up, it is
+ *          disabled.
  *
+ * @param   bool _store
+ *          true - Store settings into ESP32 NVM.
+ *          false - Do not store settings into NVM.
  * @return  bool
- *          true - ESP32 is connected to the AP.
- *          false - ESP32 is not connected to the AP.
+ *          true - Command executed successfully.
+ *          false - Command failed.
  */
-bool WiFiClass::connected()
+bool WiFiClass::storeSettingsInNVM(bool _store)
 {
-    // Flush AT Read Request.
-    requestSlaveStatus();
-    dataReadEnd();
-
-    // Create AT Command string to check WiFi connection status.
-    sprintf(_dataBuffer, "AT+CWSTATE?\r\n");
+    // Disable or enable storing data in NVM. By default, storing is enabled, but at the ESP
+    // start up is disabled.
 
-    // Issue a AT Command for WiFi Mode.
-    sendAtCommand(_dataBuffer);
+    // Make a AT Command depending on the choice of storing settings in NVM.
+    AtCommandBuilder _cmd(_dataBuffer, sizeof(_dataBuffer));
+    _cmd.add("AT+SYSSTORE=").addUInt(_store ? 1 : 0).end();
 
-    // Wait for the response.
-    if (!getSimpleAtResponse(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE, 40ULL))
+    // Send AT Command. Return false if failed.
+    if (!sendAtCommand(_cmd))
         return false;
 
-    // Find start of the response. Return false if failed.
-    char *_responseStart = strstr(_dataBuffer, "+CWSTATE:");
-    if (_responseStart == NULL)
+    // Wait for the response. Return false if failed.
+    if (!getAtResponse(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE, 10ULL))
         return false;
 
-    // Parse the data.
-    int _result;
-    if (sscanf(_responseStart, "+CWSTATE:%d", &_result) != 1)
+    // Check for the respose. Try to find "\r\nOK\r\n". Return false if find failed.
+    if (strstr(_dataBuffer, esp32AtCmdResponse) == NULL)
         return false;
 
-    if (_result == 2)
-    {
-        // Just classic questonable ESP32 things...must read WL CONNECTED, otherwise ESP32 hangs.
-        getAtResponse(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE, 200ULL);
+    // Otherwise return true.
+    return true;
+}
 
-        // Return true fir connection success.
-        return true;
-    }
+/**
+ * @brief   Get the pointer (address) of the buffer for the SPI data.
+ *
+ * @return  char*
+ *          Pointer of the SPI buffer for ESP32 communication and commands.
+ */
+char *WiFiClass::getDataBuffer()
+{
+    // Return the main RX/TX buffer fopr SPI data.
+    return _dataBuffer;
+}
 
-    return false;
+/**
+ * @brief   Set the SPI clock used for the communication with the modem. STM32 SPI can only use
+ *          the clock divided by the power of two, so the nearest lower clock will be used.
+ *
+ * @param   uint32_t _clock
+ *          New SPI clock in Hz.
+ */
+void WiFiClass::setSpiClock(uint32_t _clock)
+{
+    // Background reception must not use the settings while they are changed.
+    spiLock();
+    _spiClock = _clock;
+    _esp32AtSpiSettings = SPISettings(_clock, MSBFIRST, SPI_MODE0);
+    spiUnlock();
 }
+
 /**
- * @brief   Method executes command to the ESP32 to disconnects from the AP.
+ * @brief   Get the SPI clock used for the communication with the modem.
  *
- * @return  bool
- *          true - Command is executed successfully.
- *          false - Command failed.
+ * @return  uint32_t
+ *          SPI clock in Hz (requested one, see setSpiClock()).
  */
-bool WiFiClass::disconnect()
+uint32_t WiFiClass::getSpiClock()
 {
-    // Sent AT command for WiFi Disconnect.
-    sendAtCommand((char *)esp32AtWiFiDisconnectCommand);
+    return _spiClock;
+}
 
-    // Wait for the response from the modem.
-    if (!getAtResponse(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE, 40ULL))
+/**
+ * @brief   Test the SPI link with the echo of the known data patterns. Echo of the AT commands is enabled
+ *          (ATE1) and the pattern is sent as an unknown AT command, so the modem only echoes it back and
+ *          responds with "ERROR". Echo must be exactly the same as the sent pattern. Echo is turned off
+ *          (ATE0) at the end, whatever the result.
+ *
+ * @param   uint8_t _rounds
+ *          Number of round-trips (each one uses the pattern shifted by one char).
+ * @return  bool
+ *          true - All round-trips passed.
+ *          false - Data corrupted or modem not responding.
+ */
+bool WiFiClass::spiSelfTest(uint8_t _rounds)
+{
+    // Enable the echo.
+    if (!sendAtCommand((char *)esp32AtEchoOn))
         return false;
 
-    // Check if the proper response arrived from the modem.
-    if (strcmp(_dataBuffer, esp32AtWiFiDisconnectresponse) != 0)
-        return false;
+    // Return value variable (echo can be on even if the result is lost).
+    bool _retValue = waitForAtResult(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE, 200ULL);
 
-    return true;
+    uint16_t _patternLen = sizeof(esp32AtSelfTestPattern) - 1;
+
+    for (uint8_t i = 0; (i < _rounds) && _retValue; i++)
+    {
+        // Make the command with the pattern shifted for each round.
+        char _testCommand[sizeof(esp32AtSelfTestPattern) + 6];
+        AtCommandBuilder _cmd(_testCommand, sizeof(_testCommand));
+        _cmd.add("AT+");
+        for (uint16_t j = 0; j < _patternLen; j++)
+        {
+            _cmd.addChar(esp32AtSelfTestPattern[(i + j) % _patternLen]);
+        }
+        _cmd.end();
+
+        // Send it and wait for the "ERROR". Echo must be the same as the command.
+        _retValue = sendAtCommand(_cmd) &&
+                    waitForAtResult(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE, 200ULL, esp32AtResponseError) &&
+                    (strncmp(_dataBuffer, _cmd.c_str(), _cmd.length()) == 0);
+    }
+
+    // Turn the echo off again (it's sent even if the test failed, modem may still be able to get it).
+    if (sendAtCommand((char *)esp32AtEchoOff))
+        waitForAtResult(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE, 200ULL);
+
+    return _retValue;
 }
 
 /**
- * @brief   Methods prompts ESP32 to run a WiFi network scan. Scan takes about 2 seconds.
+ * @brief   Find the fastest SPI clock that works with this board. Self test is done at each clock step
+ *          (INKPLATE_ESP32_SPI_CLOCK_STEPS) from the lowest one up. To keep some margin, one step below the
+ *          first failed step is not used - the clock is set one step lower than the fastest passed step
+ *          (unless all steps up to the max. clock passed).
  *
- * @return  int
- *          Number of available networks (including encrypted and hidden ones).
+ * @param   uint32_t _maxClock
+ *          Max. SPI clock that can be used (in Hz).
+ * @return  uint32_t
+ *          Selected SPI clock in Hz (also used from now on, see getSpiClock()) or 0 if even the lowest
+ *          step failed (SPI clock is not changed).
  */
-int WiFiClass::scanNetworks()
+uint32_t WiFiClass::spiAutoTune(uint32_t _maxClock)
 {
-    // Issue a WiFi Scan command.
-    sendAtCommand((char *)esp32AtWiFiScan);
+    // Remember the current clock in the case everything fails.
+    uint32_t _oldClock = _spiClock;
+    int _lastPassed = -1;
+    bool _failed = false;
 
-    // First the modem will echo back AT Command and do the disconnect.
-    // If this does not happen, sometinhg is wrong, return error.
-    if (!getAtResponse(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE, 40ULL))
-        return 0;
+    // Go trough the clock steps until the first failed one.
+    for (int i = 0; i < _esp32SpiClockStepsCount; i++)
+    {
+        if (_esp32SpiClockSteps[i] > _maxClock)
+            break;
 
-    // Now wait for about 3 seconds for the WiFi scan to complete.
-    // If failed for some reason, return error.
-    if (!getAtResponse(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE, 2500UL))
+        setSpiClock(_esp32SpiClockSteps[i]);
+        if (!spiSelfTest())
+        {
+            _failed = true;
+            break;
+        }
+
+        _lastPassed = i;
+    }
+
+    // Even the lowest step failed? Keep the old clock.
+    if (_lastPassed < 0)
+    {
+        setSpiClock(_oldClock);
         return 0;
+    }
 
-    char *_wifiAPStart = strstr(_dataBuffer, "+CWLAP:");
+    // Keep the margin from the failed step.
+    if (_failed && (_lastPassed > 0))
+        _lastPassed--;
 
-    // Parse how many networks have been found.
-    while (_wifiAPStart != NULL)
+    // Use the selected clock. Modem may need a moment after the failed transfers.
+    setSpiClock(_esp32SpiClockSteps[_lastPassed]);
+    _spiLinkErrorsInRow = 0;
+    if (_failed)
     {
-        _startApindex[_foundWiFiAp] = _wifiAPStart - _dataBuffer;
-        _foundWiFiAp++;
-        _wifiAPStart = strstr(_wifiAPStart + 1, "+CWLAP:");
+        delay(10);
+        spiSelfTest(1);
     }
 
-    return _foundWiFiAp;
+    return _spiClock;
 }
 
 /**
- * @brief   Method gets SSID of a scaned network.
+ * @brief   Get the number of detected SPI link errors (invalid slave status or length).
  *
- * @param   int _ssidNumber
- *          Network number on the found network list.
- * @return  char*
- *          SSID of the network.
+ * @return  uint32_t
+ *          Number of link errors.
  */
-char *WiFiClass::ssid(int _ssidNumber)
+uint32_t WiFiClass::spiLinkErrors()
 {
-    // Check if the parsing is successfull. If not, return empty string.
-    if (!parseFoundNetworkData(_ssidNumber, &_lastUsedSsid, &_lastUsedSsidData))
-        return " ";
-
-    // If parsing is successfull, return SSID name.
-    return _lastUsedSsidData.ssidName;
+    return _spiLinkErrors;
 }
 
 /**
- * @brief   Method gets auth. status of the selected network after the scan.
+ * @brief   Get the statistics of the SPI data path (bytes sent and received, time spent in SPI transfers).
+ *          Useful for the benchmarks and tuning.
  *
- * @param   int _ssidNumber
- *          Network number on the found network list.
- * @return  bool
- *          true - Network is encrypted.
- *          false - Network is open.
+ * @return  const struct spiAtStatsTypedef*
+ *          Pointer to the copy of the statistics (taken at each call).
  */
-bool WiFiClass::auth(int _ssidNumber)
+const struct spiAtStatsTypedef *WiFiClass::getSpiStats()
 {
-    // Parse the found network data.
-    parseFoundNetworkData(_ssidNumber, &_lastUsedSsid, &_lastUsedSsidData);
+    // Take the copy, the background reception updates the statistics from the ISR.
+    spiLock();
+    _spiStatsCopy = _spiStats;
+    spiUnlock();
 
-    // If parsing is successfull, return auth status (false = open network, true = password locked".
-    return _lastUsedSsidData.authType ? true : false;
+    return &_spiStatsCopy;
 }
 
 /**
- * @brief   Method gets the RRIS value of the selected scaned networtk.
+ * @brief   Clear the statistics of the SPI data path.
  *
- * @param   int _ssidNumber
- *          Network number on the found network list.
- * @return  int
- *          RSSI value in dBm of the selected network.
  */
-int WiFiClass::rssi(int _ssidNumber)
+void WiFiClass::clearSpiStats()
 {
-    // Parse the found network data.
-    parseFoundNetworkData(_ssidNumber, &_lastUsedSsid, &_lastUsedSsidData);
-
-    // If parsing is successfull, return RSSI.
-    return _lastUsedSsidData.rssi;
+    spiLock();
+    memset(&_spiStats, 0, sizeof(_spiStats));
+    spiUnlock();
 }
 
 /**
- * @brief   Obtain a local IP.
+ * @brief   Start recording every SPI packet into the trace (binary ring buffer, see WiFiSPITypedef.h for the
+ *          record format). If the buffer gets full, the oldest records are overwritten, so the trace always
+ *          holds the latest SPI traffic.
  *
- * @return  IPAddress
- *          Returns the local IP with Arduino IPAddress class.
+ * @param   uint8_t *_buffer
+ *          Buffer for the trace records (must be valid until spiTraceStop()).
+ * @param   uint32_t _size
+ *          Size of the buffer (in bytes).
+ * @param   uint16_t _maxCapture
+ *          Max. number of the payload bytes captured for each SPI packet (CRC covers the whole payload).
  */
-IPAddress WiFiClass::localIP()
+void WiFiClass::spiTraceStart(uint8_t *_buffer, uint32_t _size, uint16_t _maxCapture)
 {
-    return ipAddressParse("ip");
+    _traceRecording = (_buffer != NULL) && (_size != 0);
+    _traceBuffer = _buffer;
+    _traceSize = _size;
+    _traceCapture = _maxCapture;
+    _traceHead = 0;
+    _traceTail = 0;
+    _traceCount = 0;
+    _traceDropped = 0;
 }
 
 /**
- * @brief   Get a gateway IP Address.
+ * @brief   Stop recording the SPI packets. Recorded data can still be read with spiTraceRead().
  *
- * @return  IPAddress
- *          Returns the Gateway IP with Arduino IPAddress class.
  */
-IPAddress WiFiClass::gatewayIP()
+void WiFiClass::spiTraceStop()
 {
-    return ipAddressParse("gateway");
+    _traceRecording = false;
 }
 
 /**
- * @brief   Get a network subnet mask.
+ * @brief   Get the number of recorded bytes in the trace that can be read with spiTraceRead().
  *
- * @return  IPAddress
- *          Returns the network subnet mask with Arduino IPAddress class.
+ * @return  uint32_t
+ *          Number of bytes in the trace.
  */
-IPAddress WiFiClass::subnetMask()
+uint32_t WiFiClass::spiTraceAvailable()
 {
-    return ipAddressParse("netmask");
+    return _traceCount;
 }
 
 /**
- * @brief   Get the DNS of the primary or secondary DNS.
+ * @brief   Read (and remove) the oldest bytes from the trace. Records are stored one after another, so
+ *          the trace can be read in any chunk size and saved or sent as it is. Reading stops the recording,
+ *          since the oldest records could be overwritten between two reads.
  *
- * @param   uint8_t i
- *          0 - Get the DNS IP Address of the primary DNS.
- *          1 - Get the DNS IP Address of the secondary DNS.
- * @return  IPAddress
- *          Returns the selected DNS IP Address with Arduino IPAddress class.
+ * @param   uint8_t *_buffer
+ *          Where to store the trace data.
+ * @param   uint32_t _len
+ *          Max. number of bytes to read.
+ * @return  uint32_t
+ *          Number of bytes read.
  */
-IPAddress WiFiClass::dns(uint8_t i)
+uint32_t WiFiClass::spiTraceRead(uint8_t *_buffer, uint32_t _len)
 {
-    // Filter out the selected DNS. It can only be three DNS IP Addreses.
-    if (i > 2)
-        return INADDR_NONE;
-
-    // DNS IP addresses array.
-    int _dnsIpAddresses[3][4];
-
-    // Clear the array.
-    memset(_dnsIpAddresses[0], 0, sizeof(int) * 4);
-    memset(_dnsIpAddresses[1], 0, sizeof(int) * 4);
-    memset(_dnsIpAddresses[2], 0, sizeof(int) * 4);
-
-    // Flag if the static or dynamic IP is used on ESP32.
-    int _dhcpFlag = 0;
-
-    // Issue a AT Command for DNS. Return invalid IP address if failed.
-    if (!sendAtCommand((char *)esp32AtGetDns))
-        return INADDR_NONE;
-
-    // Wait for the response. If timed out, return invalid IP address.
-    if (!getAtResponse(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE, 40ULL))
-        return INADDR_NONE;
-
-    // Try to parse the data.
-    char *_responseStart = strstr(_dataBuffer, "+CIPDNS:");
-
-    // If not found, return invalid IP Address.
-    if (_responseStart == NULL)
-        INADDR_NONE;
+    // Records can't be removed in the middle of the read.
+    _traceRecording = false;
 
-    // Parse it!
-    int _res = sscanf(_responseStart, "+CIPDNS:%d,\"%d.%d.%d.%d\",\"%d.%d.%d.%d\",\"%d.%d.%d.%d\"", &_dhcpFlag,
-                      &_dnsIpAddresses[0][0], &_dnsIpAddresses[0][1], &_dnsIpAddresses[0][2], &_dnsIpAddresses[0][3],
-                      &_dnsIpAddresses[1][0], &_dnsIpAddresses[1][1], &_dnsIpAddresses[1][2], &_dnsIpAddresses[1][3],
-                      &_dnsIpAddresses[2][0], &_dnsIpAddresses[2][1], &_dnsIpAddresses[2][2], &_dnsIpAddresses[2][3]);
+    if (_len > _traceCount)
+        _len = _traceCount;
 
-    // Check if all is parsed correctly, it should find at least one DNS. If not, return invalid IP Address.
-    if (_res < 4)
-        return INADDR_NONE;
+    for (uint32_t i = 0; i < _len; i++)
+    {
+        _buffer[i] = _traceBuffer[_traceTail];
+        _traceTail = (_traceTail + 1) % _traceSize;
+    }
+    _traceCount -= _len;
 
-    // Return wanted DNS.
-    return IPAddress(_dnsIpAddresses[i][0], _dnsIpAddresses[i][1], _dnsIpAddresses[i][2], _dnsIpAddresses[i][3]);
+    return _len;
 }
 
 /**
- * @brief   Get the MAC address of the ESP32. It will be returned with char array
- *          ("aa:bb:cc:11:22:33").
+ * @brief   Get the number of records lost because the trace buffer was full (oldest records are overwritten).
  *
- * @return  char*
- *          MAC Address of the ESP32.
- * @note    Original MAC can be changed with WiFiClass::macAddress(char *_mac) method.
+ * @return  uint32_t
+ *          Number of lost records.
  */
-char *WiFiClass::macAddress()
+uint32_t WiFiClass::spiTraceDropped()
 {
-    // Send AT Command for getting AT Command from the module.
-    if (!sendAtCommand((char *)esp32AtWiFiGetMac))
-        return _invalidMac;
+    return _traceDropped;
+}
 
-    // Wait for the response from the modem.
-    if (!getAtResponse(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE, 40ULL))
-        return _invalidMac;
+/**
+ * @brief   Start the replay of the recorded trace. While the replay is active, SPI is not used - every SPI
+ *          packet is taken from the trace (data from the modem is copied from the trace, data sent to the
+ *          modem is compared with its CRC) and the handshake is generated from the trace. Replay stops
+ *          at the end of the trace or at the first packet that does not match (different command or length).
+ *          Use it to profile the slow sequences without the modem.
+ *
+ * @param   const uint8_t *_trace
+ *          Recorded trace (see spiTraceRead()). Record the trace with the whole payload captured for the
+ *          exact replay.
+ * @param   uint32_t _len
+ *          Length of the trace (in bytes).
+ * @param   bool _realTime
+ *          true - Keep the recorded timing between the SPI packets.
+ *          false - Replay as fast as possible.
+ * @return  bool
+ *          true - Replay started.
+ *          false - Trace is empty.
+ */
+bool WiFiClass::spiReplayStart(const uint8_t *_trace, uint32_t _len, bool _realTime)
+{
+    // Check for the at least one record.
+    if ((_trace == NULL) || (_len < INKPLATE_ESP32_SPI_TRACE_HEADER_SIZE))
+        return false;
 
-    // Try to parse it.
-    char *_responseStart = strstr(_dataBuffer, "+CIPAPMAC:");
+    _replayData = _trace;
+    _replayLen = _len;
+    _replayPos = 0;
+    _replayRealTime = _realTime;
+    _replayMismatches = 0;
 
-    // If proper response is not found, return with invalid MAC address.
-    if (_responseStart == NULL)
-        return _invalidMac;
+    // Timing starts with the first record.
+    _replayLastStamp = _trace[9] | (_trace[10] << 8) | ((uint32_t)_trace[11] << 16) | ((uint32_t)_trace[12] << 24);
+    _replayLastTime = micros();
 
-    // Get the MAC address from the response.
-    int _res = sscanf(_responseStart, "+CIPAPMAC:%[^\r\n]", _esp32MacAddress);
+    // Generate the handshake if the modem has something to read.
+    _esp32HandshakePinFlag = spiReplayHandshake();
 
-    // If parsing failed, return invalid MAC address.
-    if (!_res)
-        return _invalidMac;
+    return true;
+}
 
-    // Return parsed MAC address.
-    return _esp32MacAddress;
+/**
+ * @brief   Stop the replay and use the modem again.
+ *
+ */
+void WiFiClass::spiReplayStop()
+{
+    _replayData = NULL;
+    _esp32HandshakePinFlag = false;
 }
 
 /**
- * @brief   Method set the MAC address of the ESP32.
+ * @brief   Check if the replay is still active (it stops at the end of the trace or at the first mismatch).
  *
- * @param   char *_mac
- *          Pointer to the char array of the new MAC address. String with the
- *          new MAC address must have "aa:bb:cc:dd:ee:ff" format.
  * @return  bool
- *          true - New MAC address is set.
- *          false - New MAC address set failed.
- * @note    MAC address only can be set if the WiFI mode is set to SoftAP mode.
+ *          true - Replay is active.
+ *          false - Replay is not used or it has ended.
  */
-bool WiFiClass::macAddress(char *_mac)
+bool WiFiClass::spiReplayActive()
 {
-    // Create a string for the new MAC address.
-    sprintf(_dataBuffer, "AT+CIPAPMAC=\"%s\"\r\n", _mac);
-
-    // Send AT Command. Return false if failed.
-    if (!sendAtCommand(_dataBuffer))
-        return false;
-
-    // Wait for the response.
-    if (!getAtResponse(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE, 40ULL))
-        return false;
-
-    // Get the response. Try to find \r\n\OK\r\n. Return false if failed.
-    if (strstr(_dataBuffer, esp32AtCmdResponse) == NULL)
-        return false;
+    return (_replayData != NULL);
+}
 
-    // Otherwise return true.
-    return true;
+/**
+ * @brief   Get the number of the SPI packets that did not match the trace during the replay (different command,
+ *          length or data sent to the modem).
+ *
+ * @return  uint32_t
+ *          Number of mismatches.
+ */
+uint32_t WiFiClass::spiReplayMismatches()
+{
+    return _replayMismatches;
 }
 
 /**
- * @brief   Methods enables complete WiFi config. Set LocalIP, GatewayIP, Subnet Mask and DNS with one call.
- *          To keep original value of the one IP address, use INADDR_NONE as parameter.
+ * @brief   Send the AT command and wait for its result under the supervision. Failed attempts are classified
+ *          (modem busy, timeout, SPI protocol error or the ERROR reply) and repeated with the backoff (up to
+ *          INKPLATE_ESP32_SUPERVISOR_RETRIES times). If that does not help, the SPI link is resynced (see
+ *          resync()) and as the last resort the modem is power cycled with the session restored (see
+ *          recover(), only if INKPLATE_ESP32_SUPERVISOR_POWER_CYCLE is 1), each followed by one more attempt.
+ *          ERROR reply is never repeated, since the modem would only reject the same command again.
  *
- * @param   IPAddress _staticIP
- *          Set the local IP Address. To keep the default one, use INADDR_NONE.
- * @param   IPAddress _gateway
- *          Set the gateway IP Address. To keep the default one, use INADDR_NONE.
- * @param   IPAddress _subnet
- *          Set the sunbet mask. To keep the default one, use INADDR_NONE.
- * @param   IPAddress _dns1
- *          Set the Primary DNS IP Address. To keep the default one, use INADDR_NONE.
- * @param   IPAddress _dns2
- *          Set the Secondary DNS IP Address. To keep the default one, use INADDR_NONE.
+ * @param   const char *_atCommand
+ *          AT command with CRLF at the end.
+ * @param   unsigned long _timeout
+ *          Max. time to wait for the result of each attempt (in milliseconds).
+ * @param   const char *_expected
+ *          Result code that means success (default is "OK").
  * @return  bool
- *          true - New IP config is set.
- *          false - New IP config set failed.
+ *          true - Command executed successfully (response is in the data buffer).
+ *          false - Command failed, see lastResult() for the reason.
  */
-bool WiFiClass::config(IPAddress _staticIP, IPAddress _gateway, IPAddress _subnet, IPAddress _dns1, IPAddress _dns2)
+bool WiFiClass::execute(const char *_atCommand, unsigned long _timeout, const char *_expected)
 {
-    // Return value variable.
-    bool _retValue = true;
-
-    // First get the current settings since not all of above must be included.
-    if (_staticIP == INADDR_NONE)
-    {
-        _staticIP = ipAddressParse("ip");
-    }
+    // Check for user mistake (null-pointer!).
+    if (_atCommand == NULL)
+        return false;
 
-    if (_gateway == INADDR_NONE)
-    {
-        _gateway = ipAddressParse("gateway");
-    }
+    _supervisorStats.commands++;
 
-    if (_subnet == INADDR_NONE)
+    // Keep a copy of the command, since the data buffer is used for the response and the recovery. The copy is
+    // local, the commands sent by recover() go through here again. Commands that do not fit are sent only once.
+    char _cmdCopy[INKPLATE_ESP32_SUPERVISOR_CMD_LEN];
+    size_t _cmdLen = strlen(_atCommand);
+    bool _canRetry = (_cmdLen < sizeof(_cmdCopy));
+    if (_canRetry)
     {
-        _subnet = ipAddressParse("netmask");
+        memcpy(_cmdCopy, _atCommand, _cmdLen + 1);
+        _atCommand = _cmdCopy;
     }
 
-    if (_dns1 == INADDR_NONE)
-    {
-        _dns1 = dns(0);
-    }
+    // Retry, backoff and recovery state.
+    uint8_t _retries = 0;
+    uint8_t _escalation = 0;
+    unsigned long _backoff = INKPLATE_ESP32_SUPERVISOR_BACKOFF_MIN;
+    unsigned long _firstFailure = 0;
 
-    if (_dns1 == INADDR_NONE)
+    while (true)
     {
-        _dns1 = dns(1);
-    }
+        // Try it!
+        _lastResult = executeOnce(_atCommand, _timeout, _expected);
 
-    // Now send modified data.
-    // Check if anything with the IP config have been modified. If so, send new settings.
-    if ((_staticIP != INADDR_NONE) || (_gateway != INADDR_NONE) || (_subnet != INADDR_NONE))
-    {
-        // Send the AT commands for the new IP config.
-        sprintf(_dataBuffer, "AT+CIPSTA=\"%d.%d.%d.%d\",\"%d.%d.%d.%d\",\"%d.%d.%d.%d\"\r\n", _staticIP[0],
-                _staticIP[1], _staticIP[2], _staticIP[3], _gateway[0], _gateway[1], _gateway[2], _gateway[3],
-                _subnet[0], _subnet[1], _subnet[2], _subnet[3]);
+        if (_lastResult == INKPLATE_ESP32_AT_RESULT_OK)
+        {
+            // Measure the recovery time if something failed before.
+            if ((_retries != 0) || (_escalation != 0))
+            {
+                uint32_t _recoveryTime = millis() - _firstFailure;
+                _supervisorStats.recoveries++;
+                _supervisorStats.lastRecoveryMs = _recoveryTime;
+                _supervisorStats.totalRecoveryMs += _recoveryTime;
+                if (_recoveryTime > _supervisorStats.maxRecoveryMs)
+                    _supervisorStats.maxRecoveryMs = _recoveryTime;
+            }
 
-        // Send AT command.
-        sendAtCommand(_dataBuffer);
+            return true;
+        }
 
-        // Wait for the response.
-        getAtResponse(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE, 50ULL);
+        // Count the failure by its class.
+        switch (_lastResult)
+        {
+        case INKPLATE_ESP32_AT_RESULT_BUSY:
+            _supervisorStats.busy++;
+            break;
+        case INKPLATE_ESP32_AT_RESULT_TIMEOUT:
+            _supervisorStats.timeouts++;
+            break;
+        case INKPLATE_ESP32_AT_RESULT_PROTOCOL:
+            _supervisorStats.protocolErrors++;
+            break;
+        default:
+            _supervisorStats.errorReplies++;
+            break;
+        }
 
-        // Check for the response. Set return value to false is setting IP has failed.
-        if (strstr(_dataBuffer, esp32AtCmdResponseOK) == NULL)
-            _retValue = false;
-    }
+        // ERROR reply is final.
+        if ((_lastResult == INKPLATE_ESP32_AT_RESULT_ERROR) || !_canRetry)
+            break;
 
-    // Check the same thing, but for DNS.
-    if ((_dns1 != INADDR_NONE) || (_dns2 != INADDR_NONE))
-    {
-        // Create AT command for the DNS settings.
-        sprintf(_dataBuffer, "AT+CIPDNS=1,\"%d.%d.%d.%d\",\"%d.%d.%d.%d\"\r\n", _dns1[0], _dns1[1], _dns1[2], _dns1[3],
-                _dns2[0], _dns2[1], _dns2[2], _dns2[3]);
+        if ((_retries == 0) && (_escalation == 0))
+            _firstFailure = millis();
 
-        // Send AT command.
-        sendAtCommand(_dataBuffer);
+        // Retry with the backoff first.
+        if (_retries < INKPLATE_ESP32_SUPERVISOR_RETRIES)
+        {
+            _retries++;
+            _supervisorStats.retries++;
+            delay(_backoff);
+            _backoff *= 2;
+            if (_backoff > INKPLATE_ESP32_SUPERVISOR_BACKOFF_MAX)
+                _backoff = INKPLATE_ESP32_SUPERVISOR_BACKOFF_MAX;
+            continue;
+        }
 
-        // Wait for the response.
-        getAtResponse(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE, 50ULL);
+        // Busy modem is not stuck, it's only slow. Also, do not start the recovery inside the recovery.
+        if ((_lastResult == INKPLATE_ESP32_AT_RESULT_BUSY) || _recovering)
+            break;
 
-        // Check for the response. Set return value to false is setting IP has failed.
-        if (strstr(_dataBuffer, esp32AtCmdResponseOK) == NULL)
-            _retValue = false;
+        // Escalate. Resync the link first, power cycle the modem if resync fails or does not help.
+        if ((_escalation == 0) && resync())
+        {
+            _escalation = 1;
+        }
+        else if ((_escalation < 2) && INKPLATE_ESP32_SUPERVISOR_POWER_CYCLE && recover())
+        {
+            _escalation = 2;
+        }
+        else
+        {
+            break;
+        }
     }
 
-    // Return true if everything went ok or false if something failed (IP config or DNS).
-    return _retValue;
+    _supervisorStats.failures++;
+    return false;
 }
 
 /**
- * @brief   Wait for the ESP32 handshake pin to trigger master request using digitalRead()
- *          (polling). This funciton is not used anymore.
+ * @brief   Send the AT command made with the AtCommandBuilder under the supervision (see execute()).
  *
- * @param   uint32_t _timeoutValue
- *          Timeout value until the request from the ESP32 happens in milliseconds.
- * @param   _validState
- *          Is the trigger state for the handshake pin HIGH or LOW.
+ * @param   AtCommandBuilder &_atCommand
+ *          AT command made with the AtCommandBuilder (with CRLF at the end).
+ * @param   unsigned long _timeout
+ *          Max. time to wait for the result of each attempt (in milliseconds).
+ * @param   const char *_expected
+ *          Result code that means success (default is "OK").
  * @return  bool
- *          true - Handshake pin trigger detected.
- *          false - Timeout, no handshake trigger detected.
+ *          true - Command executed successfully (response is in the data buffer).
+ *          false - Command failed or it does not fit into the buffer.
  */
-bool WiFiClass::waitForHandshakePin(uint32_t _timeoutValue, bool _validState)
+bool WiFiClass::execute(AtCommandBuilder &_atCommand, unsigned long _timeout, const char *_expected)
 {
-    // Variable for the timeout. Also capture the current state.
-    unsigned long _timeout = millis();
+    // Do not send incomplete commands.
+    if (_atCommand.overflow())
+        return false;
 
-    // Read the current state of the handshake pin.
-    bool _handshakePinState = digitalRead(INKPLATE_ESP32_HANDSHAKE_PIN);
+    return execute(_atCommand.c_str(), _timeout, _expected);
+}
 
-    // Check if the handshake pin is already set.
-    if (_handshakePinState == _validState)
-        return true;
+/**
+ * @brief   Get the result of the last supervised AT command.
+ *
+ * @return  uint8_t
+ *          INKPLATE_ESP32_AT_RESULT_OK, INKPLATE_ESP32_AT_RESULT_BUSY, INKPLATE_ESP32_AT_RESULT_TIMEOUT,
+ *          INKPLATE_ESP32_AT_RESULT_PROTOCOL or INKPLATE_ESP32_AT_RESULT_ERROR.
+ */
+uint8_t WiFiClass::lastResult()
+{
+    return _lastResult;
+}
 
-    // If not, wait for the valid pin state.
-    do
+/**
+ * @brief   Resync the SPI link with the modem. Everything the modem still has for the master is read and
+ *          dropped, sequence tracking starts again and the modem is pinged.
+ *
+ * @return  bool
+ *          true - Modem responds.
+ *          false - Modem does not respond (power cycle needed, see recover()).
+ */
+bool WiFiClass::resync()
+{
+    _supervisorStats.resyncs++;
+
+    // Drop the frames read in the background and drain the modem. Stop when nothing arrives for a while, but
+    // not later than the drain timeout (modem may be streaming the data all the time).
+    spiLock();
+    _rxRingTail = _rxRingHead;
+    _rxHeldLen = 0;
+    unsigned long _drainStart = millis();
+    unsigned long _timeoutCounter = _drainStart;
+    while (((unsigned long)(millis() - _timeoutCounter) < 100UL) &&
+           ((unsigned long)(millis() - _drainStart) < INKPLATE_ESP32_SUPERVISOR_DRAIN_TIMEOUT))
     {
-        // Read the new state of the pin.
-        _handshakePinState = digitalRead(INKPLATE_ESP32_HANDSHAKE_PIN);
+        if (_esp32HandshakePinFlag)
+        {
+            // Read done is sent only after the data has been read.
+            uint16_t _len = 0;
+            _esp32HandshakePinFlag = false;
+            if (requestSlaveStatus(&_len) == INKPLATE_ESP32_SPI_SLAVE_STATUS_READABLE)
+            {
+                readFrame(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE, _len);
+                dataReadEnd();
+            }
+            _timeoutCounter = millis();
+        }
+    }
 
-        // Wait a little bit.
-        delay(1);
-    } while (((unsigned long)(millis() - _timeout) < _timeoutValue) && (_handshakePinState != _validState));
+    // Take the next sequence number as it is.
+    _spiRxSeqValid = false;
+    spiUnlock();
 
-    // Check the state of the timeout. If timeout occured, return false.
-    if ((millis() - _timeout) >= _timeoutValue)
+    // Ping the modem. Echo may be off, so only look for the result code.
+    if (!sendAtCommand((char *)esp32AtPingCommand))
         return false;
 
-    // Otherwise return true.
-    return true;
+    return waitForAtResult(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE, 200ULL);
 }
 
 /**
- * @brief   Wait for the ESP32 handshake pin to trigger master request using interrutps.
+ * @brief   Power cycle the modem and restore the session - WiFi mode, multiple connections and the connection
+ *          to the last network used with begin(). Open links are lost (they are marked as closed). SPI clock
+ *          stays the same.
  *
- * @param   uint32_t _timeoutValue
- *          Timeout value until the request from the ESP32 happens in milliseconds.
  * @return  bool
- *          true - Handshake pin trigger detected.
- *          false - Timeout, no handshake trigger detected.
+ *          true - Modem is up again (WiFi connection may still fail, see connected()).
+ *          false - Modem did not start.
  */
-bool WiFiClass::waitForHandshakePinInt(uint32_t _timeoutValue)
+bool WiFiClass::recover()
 {
-    // First, clear the flag status.
-    _esp32HandshakePinFlag = false;
+    _supervisorStats.powerCycles++;
 
-    // Variable for the timeout. Also capture the current state.
-    unsigned long _timeout = millis();
+    // Do not start the recovery again from the commands used here. They are not counted in the statistics
+    // either, only the power cycle is.
+    _recovering = true;
+    struct spiAtSupervisorStatsTypedef _stats = _supervisorStats;
 
-    // Wait for the rising edge in Handshake pin.
-    while (((unsigned long)(millis() - _timeout) < _timeoutValue) && (!_esp32HandshakePinFlag))
-        ;
+    // All connections are lost.
+    bool _mux = _linkMuxEnabled;
+    _linkMuxEnabled = false;
+    for (int i = 0; i < INKPLATE_ESP32_MAX_LINKS; i++)
+    {
+        _links[i].connected = false;
+    }
 
-    // Clear the flag.
-    _esp32HandshakePinFlag = false;
+    // Power cycle.
+    power(false);
+    bool _ret = power(true);
 
-    // Check the state of the timeout. If timeout occured, return false.
-    if ((millis() - _timeout) >= _timeoutValue)
-        return false;
+    // Restore the session.
+    if (_ret)
+    {
+        if (_sessionMode != 0xFF)
+            setMode(_sessionMode);
+
+        if (_mux)
+            multipleConnections(true);
+
+        if (_sessionSsid[0] != '\0')
+        {
+            begin(_sessionSsid, _sessionPass);
+
+            // Wait for the WiFi connection.
+            unsigned long _timeoutCounter = millis();
+            while (!connected() &&
+                   ((unsigned long)(millis() - _timeoutCounter) < INKPLATE_ESP32_SUPERVISOR_RECONNECT_TIMEOUT))
+            {
+                delay(250);
+            }
+        }
+    }
+
+    _supervisorStats = _stats;
+    _recovering = false;
+
+    return _ret;
+}
+
+/**
+ * @brief   Get the statistics of the command supervisor (failures by class, retries, resyncs, power cycles and
+ *          the recovery time).
+ *
+ * @return  const struct spiAtSupervisorStatsTypedef*
+ *          Pointer to the statistics.
+ */
+const struct spiAtSupervisorStatsTypedef *WiFiClass::getSupervisorStats()
+{
+    return &_supervisorStats;
+}
+
+/**
+ * @brief   Clear the statistics of the command supervisor.
+ *
+ */
+void WiFiClass::clearSupervisorStats()
+{
+    memset(&_supervisorStats, 0, sizeof(_supervisorStats));
+}
+
+/**
+ * @brief   Get the current timeout of the command type. It's learned from the measured latency and jitter of
+ *          the previous responses (unless it's fixed with setTimeout()).
+ *
+ * @param   uint8_t _type
+ *          Command type (INKPLATE_ESP32_TIMEOUT_xxx, see WiFiSPITypedef.h).
+ * @return  unsigned long
+ *          Timeout in milliseconds.
+ */
+unsigned long WiFiClass::timeout(uint8_t _type)
+{
+    // Check for user mistake.
+    if (_type >= INKPLATE_ESP32_TIMEOUT_TYPES)
+        return 0;
+
+    return _timeouts[_type].timeout;
+}
+
+/**
+ * @brief   Add the measured response time to the latency and jitter estimates of the command type and calculate
+ *          the new timeout (latency + gain * jitter + margin, same as the TCP retransmission timeout).
+ *
+ * @param   uint8_t _type
+ *          Command type (INKPLATE_ESP32_TIMEOUT_xxx).
+ * @param   unsigned long _latency
+ *          Measured response time in milliseconds.
+ */
+void WiFiClass::timeoutSample(uint8_t _type, unsigned long _latency)
+{
+    // Check for user mistake.
+    if (_type >= INKPLATE_ESP32_TIMEOUT_TYPES)
+        return;
+
+    struct spiAtTimeoutTypedef *_t = &_timeouts[_type];
+    int32_t _sample = (int32_t)(_latency * 1000UL);
+
+    // Update the moving averages (1/8 of the error for the latency, 1/4 of the error for the jitter).
+    if (_t->samples == 0)
+    {
+        _t->latency = _sample;
+        _t->jitter = _sample / 2;
+    }
+    else
+    {
+        int32_t _error = _sample - (int32_t)_t->latency;
+        _t->latency = (int32_t)_t->latency + (_error / 8);
+        _t->jitter = (int32_t)_t->jitter + ((abs(_error) - (int32_t)_t->jitter) / 4);
+    }
+    _t->samples++;
+
+    // Response arrived in time, no more backoff.
+    _t->backoff = 0;
+
+    // Use the learned timeout once there are enough samples.
+    if ((_t->fixedTimeout == 0) && (_t->samples >= INKPLATE_ESP32_TIMEOUT_MIN_SAMPLES))
+    {
+        uint32_t _newTimeout = ((_t->latency + (INKPLATE_ESP32_TIMEOUT_JITTER_GAIN * _t->jitter)) / 1000UL) +
+                               INKPLATE_ESP32_TIMEOUT_MARGIN;
+        if (_newTimeout < _t->minTimeout)
+            _newTimeout = _t->minTimeout;
+        if (_newTimeout > _t->maxTimeout)
+            _newTimeout = _t->maxTimeout;
+        _t->timeout = _newTimeout;
+    }
+}
+
+/**
+ * @brief   Tell the adaptive timeout that the response did not arrive in time. Timeout of the command type is
+ *          doubled (up to the max. timeout), the next measured response brings it back to the estimate.
+ *
+ * @param   uint8_t _type
+ *          Command type (INKPLATE_ESP32_TIMEOUT_xxx).
+ */
+void WiFiClass::timeoutExpired(uint8_t _type)
+{
+    // Check for user mistake.
+    if (_type >= INKPLATE_ESP32_TIMEOUT_TYPES)
+        return;
+
+    struct spiAtTimeoutTypedef *_t = &_timeouts[_type];
+    _t->expired++;
+
+    // Fixed timeout stays as it is.
+    if ((_t->fixedTimeout != 0) || (_t->backoff >= INKPLATE_ESP32_TIMEOUT_MAX_BACKOFF))
+        return;
+
+    _t->backoff++;
+    _t->timeout = (_t->timeout * 2) > _t->maxTimeout ? _t->maxTimeout : (_t->timeout * 2);
+}
+
+/**
+ * @brief   Get the adaptive timeout of the command type (current timeout, estimates and limits).
+ *
+ * @param   uint8_t _type
+ *          Command type (INKPLATE_ESP32_TIMEOUT_xxx).
+ * @param   struct spiAtTimeoutTypedef *_timeout
+ *          Where to store it.
+ * @return  bool
+ *          true - Timeout copied.
+ *          false - Wrong command type.
+ */
+bool WiFiClass::getTimeout(uint8_t _type, struct spiAtTimeoutTypedef *_timeout)
+{
+    // Check for user mistake.
+    if ((_type >= INKPLATE_ESP32_TIMEOUT_TYPES) || (_timeout == NULL))
+        return false;
+
+    memcpy(_timeout, &_timeouts[_type], sizeof(struct spiAtTimeoutTypedef));
+
+    return true;
+}
+
+/**
+ * @brief   Set the fixed timeout of the command type (measurements are still done, but the timeout does not
+ *          change).
+ *
+ * @param   uint8_t _type
+ *          Command type (INKPLATE_ESP32_TIMEOUT_xxx).
+ * @param   unsigned long _timeout
+ *          Timeout in milliseconds, 0 - go back to the adaptive (learned) timeout.
+ * @return  bool
+ *          true - Timeout set.
+ *          false - Wrong command type.
+ */
+bool WiFiClass::setTimeout(uint8_t _type, unsigned long _timeout)
+{
+    // Check for user mistake.
+    if (_type >= INKPLATE_ESP32_TIMEOUT_TYPES)
+        return false;
+
+    struct spiAtTimeoutTypedef *_t = &_timeouts[_type];
+    _t->fixedTimeout = _timeout;
+    _t->backoff = 0;
+
+    // Back to adaptive? Start from the default one until the next measurement.
+    _t->timeout = (_timeout != 0) ? _timeout : _t->defaultTimeout;
+
+    return true;
+}
+
+/**
+ * @brief   Forget everything learned about the response times and use the default timeouts again (fixed
+ *          timeouts are removed as well).
+ *
+ */
+void WiFiClass::resetTimeouts()
+{
+    for (int i = 0; i < INKPLATE_ESP32_TIMEOUT_TYPES; i++)
+    {
+        memset(&_timeouts[i], 0, sizeof(struct spiAtTimeoutTypedef));
+        _timeouts[i].defaultTimeout = _esp32TimeoutDefaults[i][0];
+        _timeouts[i].minTimeout = _esp32TimeoutDefaults[i][1];
+        _timeouts[i].maxTimeout = _esp32TimeoutDefaults[i][2];
+        _timeouts[i].timeout = _timeouts[i].defaultTimeout;
+    }
+}
+
+/**
+ * @brief   getAtResponse() with the adaptive timeout of the command type. Longest gap between the response
+ *          parts is used as the measured response time.
+ *
+ * @param   char *_response
+ *          Buffer where to store response.
+ * @param   uint32_t _bufferLen
+ *          length of the buffer for the response (in bytes, counting the null-terminating char).
+ * @param   uint8_t _type
+ *          Command type (INKPLATE_ESP32_TIMEOUT_xxx).
+ * @param   bool _responseExpected
+ *          true - No response means the timeout expired (it's an error, timeout will be longer next time).
+ *          false - Command may not have any response (message filter). Timeout is still made longer for the
+ *          next time, since the late response would end up in the response of the next command.
+ * @return  bool
+ *          true - Response received (or nothing has been received and no response is expected).
+ *          false - Response does not fit into the buffer or the expected response did not arrive.
+ */
+bool WiFiClass::getAtResponseAdaptive(char *_response, uint32_t _bufferLen, uint8_t _type, bool _responseExpected)
+{
+    bool _ret = getAtResponse(_response, _bufferLen, timeout(_type));
+
+    // Learn from it.
+    if (_lastResponseReceived)
+    {
+        timeoutSample(_type, _lastResponseGap);
+        return _ret;
+    }
+
+    timeoutExpired(_type);
+
+    return _ret && !_responseExpected;
+}
+
+/**
+ * @brief   getSimpleAtResponse() with the adaptive timeout of the command type. Time until the data arrives is
+ *          used as the measured response time.
+ *
+ * @param   char *_response
+ *          Buffer where to store response.
+ * @param   uint32_t _bufferLen
+ *          length of the buffer for the response (in bytes, counting the null-terminating char).
+ * @param   uint8_t _type
+ *          Command type (INKPLATE_ESP32_TIMEOUT_xxx).
+ * @param   uint16_t *_rxLen
+ *          Pointer to the variable where length of the received data will be stored.
+ * @param   bool _responseExpected
+ *          true - No data means the timeout expired (it will be longer next time).
+ *          false - No data is also fine (end of the transfer).
+ * @return  bool
+ *          true - Response has been received.
+ *          false - Timeout, modem is not readable or the response does not fit into the buffer.
+ */
+bool WiFiClass::getSimpleAtResponseAdaptive(char *_response, uint32_t _bufferLen, uint8_t _type, uint16_t *_rxLen,
+                                            bool _responseExpected)
+{
+    // Capture the time!
+    unsigned long _startTime = millis();
+
+    bool _ret = getSimpleAtResponse(_response, _bufferLen, timeout(_type), _rxLen);
+
+    // Learn from it.
+    if (_ret)
+        timeoutSample(_type, millis() - _startTime);
+    else if (_responseExpected)
+        timeoutExpired(_type);
+
+    return _ret;
+}
+
+/**
+ * @brief   Methods sets WiFi mode (null, station, SoftAP or station and SoftAP).
+ *
+ * @param   uint8_t _wifiMode
+ *          Use preddifend macros (can be found in WiFiSPITypedef.h)
+ *          INKPLATE_WIFI_MODE_NULL - Null mode (modem disabled)
+ *          INKPLATE_WIFI_MODE_STA - Station mode
+ *          INKPLATE_WIFI_MODE_AP - Soft Access Point (not implemeted yet!)
+ *          INKPLATE_WIFI_MODE_STA_AP - Both station and Soft Access Point (AP mode still not implemeted!).
+ * @return  bool
+ *          true - Mode set successfully on ESP32
+ *          false - Mode set failed.
+ */
+bool WiFiClass::setMode(uint8_t _wifiMode)
+{
+    // Check for the proper mode.
+    if ((_wifiMode > INKPLATE_WIFI_MODE_STA_AP))
+        return false;
+
+    // Create AT Command string depending on the mode.
+    AtCommandBuilder _cmd(_dataBuffer, sizeof(_dataBuffer));
+    _cmd.add("AT+CWMODE=").addUInt(_wifiMode).end();
+
+    // Issue a AT Command for WiFi Mode and wait for the result.
+    if (!execute(_cmd, 1000ULL))
+        return false;
+
+    // Remember the mode for the modem recovery.
+    _sessionMode = _wifiMode;
+
+    // Now disconnect from the network.
+    disconnect();
+
+    // Otherwise, return ok.
+    return true;
+}
+
+/**
+ * @brief   Connect to the access point.
+ *
+ * @param   char *_ssid
+ *          Char array/pointer to the AP name name.
+ * @param   char *_pass
+ *          Char array/pointer to the AP password.
+ * @return  bool
+ *          true - Command execution was successfull.
+ *          false -  Command execution failed.
+ * @note    Max characters for password is limited to 63 chars and SSID is only limited to UTF-8 encoding.
+ *          Try to avoid usage following chars: {"}, {,}, {\\}. If used, escape char must be added.
+ */
+bool WiFiClass::begin(char *_ssid, char *_pass)
+{
+    // Check for user mistake (null-pointer!).
+    if ((_ssid == NULL) || (_pass == NULL))
+        return false;
+
+    // Create string for AT comamnd. Special chars in SSID and password are escaped.
+    AtCommandBuilder _cmd(_dataBuffer, sizeof(_dataBuffer));
+    _cmd.add("AT+CWJAP=").addQuoted(_ssid).add(",").addQuoted(_pass).end();
+
+    // Issue an AT Command to the modem.
+    if (!sendAtCommand(_cmd))
+        return false;
+
+    // Remember the network, so the connection can be restored after the modem recovery.
+    if (_ssid != _sessionSsid)
+    {
+        strncpy(_sessionSsid, _ssid, sizeof(_sessionSsid) - 1);
+        strncpy(_sessionPass, _pass, sizeof(_sessionPass) - 1);
+    }
+
+    // Do not wait for response eventhough modem will send reponse as soon as the WiFi connection is established.
+    return true;
+}
+
+/**
+ * @brief   Methods returns the status of the ESP32 WiFi connection the AP.
+ *
+ * @return  bool
+ *          true - ESP32 is connected to the AP.
+ *          false - ESP32 is not connected to the AP.
+ */
+bool WiFiClass::connected()
+{
+    // Flush AT Read Request (the held frame must be read first, see setOverflowPolicy()).
+    if (_rxHeldLen != 0)
+        return false;
+    spiLock();
+    requestSlaveStatus();
+    dataReadEnd();
+    spiUnlock();
+
+    // Create AT Command string to check WiFi connection status.
+    AtCommandBuilder _cmd(_dataBuffer, sizeof(_dataBuffer));
+    _cmd.add("AT+CWSTATE?\r\n");
+
+    // Issue a AT Command for WiFi Mode.
+    sendAtCommand(_cmd);
+
+    // Wait for the response.
+    if (!getSimpleAtResponse(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE, 40ULL))
+        return false;
+
+    // Find start of the response. Return false if failed.
+    char *_responseStart = strstr(_dataBuffer, "+CWSTATE:");
+    if (_responseStart == NULL)
+        return false;
+
+    // Parse the data.
+    int _result;
+    if (sscanf(_responseStart, "+CWSTATE:%d", &_result) != 1)
+        return false;
+
+    if (_result == 2)
+    {
+        // Just classic questonable ESP32 things...must read WL CONNECTED, otherwise ESP32 hangs.
+        getAtResponse(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE, 200ULL);
+
+        // Return true fir connection success.
+        return true;
+    }
+
+    return false;
+}
+/**
+ * @brief   Method executes command to the ESP32 to disconnects from the AP.
+ *
+ * @return  bool
+ *          true - Command is executed successfully.
+ *          false - Command failed.
+ */
+bool WiFiClass::disconnect()
+{
+    // Sent AT command for WiFi Disconnect.
+    sendAtCommand((char *)esp32AtWiFiDisconnectCommand);
+
+    // Wait for the response from the modem.
+    if (!getAtResponse(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE, 40ULL))
+        return false;
+
+    // Check if the proper response arrived from the modem.
+    if (strcmp(_dataBuffer, esp32AtWiFiDisconnectresponse) != 0)
+        return false;
+
+    return true;
+}
+
+/**
+ * @brief   Methods prompts ESP32 to run a WiFi network scan. Scan takes about 2 seconds.
+ *
+ * @return  int
+ *          Number of available networks (including encrypted and hidden ones).
+ */
+int WiFiClass::scanNetworks()
+{
+    // Issue a WiFi Scan command.
+    sendAtCommand((char *)esp32AtWiFiScan);
+
+    // First the modem will echo back AT Command and do the disconnect.
+    // If this does not happen, sometinhg is wrong, return error.
+    if (!getAtResponseAdaptive(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE, INKPLATE_ESP32_TIMEOUT_SHORT))
+        return 0;
+
+    // Now wait for about 3 seconds for the WiFi scan to complete.
+    // If failed for some reason, return error.
+    if (!getAtResponseAdaptive(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE, INKPLATE_ESP32_TIMEOUT_SCAN))
+        return 0;
+
+    char *_wifiAPStart = strstr(_dataBuffer, "+CWLAP:");
+
+    // Parse how many networks have been found. List only as many as the scan table can hold.
+    _foundWiFiAp = 0;
+    _lastUsedSsid = -1;
+    while ((_wifiAPStart != NULL) && (_foundWiFiAp < INKPLATE_ESP32_MAX_SCAN_AP))
+    {
+        _startApindex[_foundWiFiAp] = _wifiAPStart - _dataBuffer;
+        _foundWiFiAp++;
+        _wifiAPStart = strstr(_wifiAPStart + 1, "+CWLAP:");
+    }
+
+    return _foundWiFiAp;
+}
+
+/**
+ * @brief   Method gets SSID of a scaned network.
+ *
+ * @param   int _ssidNumber
+ *          Network number on the found network list.
+ * @return  char*
+ *          SSID of the network.
+ */
+char *WiFiClass::ssid(int _ssidNumber)
+{
+    // Check if the parsing is successfull. If not, return empty string.
+    if (!parseFoundNetworkData(_ssidNumber, &_lastUsedSsid, &_lastUsedSsidData))
+        return " ";
+
+    // If parsing is successfull, return SSID name.
+    return _lastUsedSsidData.ssidName;
+}
+
+/**
+ * @brief   Method gets auth. status of the selected network after the scan.
+ *
+ * @param   int _ssidNumber
+ *          Network number on the found network list.
+ * @return  bool
+ *          true - Network is encrypted.
+ *          false - Network is open.
+ */
+bool WiFiClass::auth(int _ssidNumber)
+{
+    // Parse the found network data.
+    parseFoundNetworkData(_ssidNumber, &_lastUsedSsid, &_lastUsedSsidData);
+
+    // If parsing is successfull, return auth status (false = open network, true = password locked".
+    return _lastUsedSsidData.authType ? true : false;
+}
+
+/**
+ * @brief   Method gets the RRIS value of the selected scaned networtk.
+ *
+ * @param   int _ssidNumber
+ *          Network number on the found network list.
+ * @return  int
+ *          RSSI value in dBm of the selected network.
+ */
+int WiFiClass::rssi(int _ssidNumber)
+{
+    // Parse the found network data.
+    parseFoundNetworkData(_ssidNumber, &_lastUsedSsid, &_lastUsedSsidData);
+
+    // If parsing is successfull, return RSSI.
+    return _lastUsedSsidData.rssi;
+}
+
+/**
+ * @brief   Obtain a local IP.
+ *
+ * @return  IPAddress
+ *          Returns the local IP with Arduino IPAddress class.
+ */
+IPAddress WiFiClass::localIP()
+{
+    return ipAddressParse("ip");
+}
+
+/**
+ * @brief   Get a gateway IP Address.
+ *
+ * @return  IPAddress
+ *          Returns the Gateway IP with Arduino IPAddress class.
+ */
+IPAddress WiFiClass::gatewayIP()
+{
+    return ipAddressParse("gateway");
+}
+
+/**
+ * @brief   Get a network subnet mask.
+ *
+ * @return  IPAddress
+ *          Returns the network subnet mask with Arduino IPAddress class.
+ */
+IPAddress WiFiClass::subnetMask()
+{
+    return ipAddressParse("netmask");
+}
+
+/**
+ * @brief   Get the DNS of the primary or secondary DNS.
+ *
+ * @param   uint8_t i
+ *          0 - Get the DNS IP Address of the primary DNS.
+ *          1 - Get the DNS IP Address of the secondary DNS.
+ * @return  IPAddress
+ *          Returns the selected DNS IP Address with Arduino IPAddress class.
+ */
+IPAddress WiFiClass::dns(uint8_t i)
+{
+    // Filter out the selected DNS. It can only be three DNS IP Addreses.
+    if (i > 2)
+        return INADDR_NONE;
+
+    // DNS IP addresses array.
+    int _dnsIpAddresses[3][4];
+
+    // Clear the array.
+    memset(_dnsIpAddresses[0], 0, sizeof(int) * 4);
+    memset(_dnsIpAddresses[1], 0, sizeof(int) * 4);
+    memset(_dnsIpAddresses[2], 0, sizeof(int) * 4);
+
+    // Flag if the static or dynamic IP is used on ESP32.
+    int _dhcpFlag = 0;
+
+    // Issue a AT Command for DNS. Return invalid IP address if failed.
+    if (!sendAtCommand((char *)esp32AtGetDns))
+        return INADDR_NONE;
+
+    // Wait for the response. If timed out, return invalid IP address.
+    if (!getAtResponse(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE, 40ULL))
+        return INADDR_NONE;
+
+    // Try to parse the data.
+    char *_responseStart = strstr(_dataBuffer, "+CIPDNS:");
+
+    // If not found, return invalid IP Address.
+    if (_responseStart == NULL)
+        return INADDR_NONE;
+
+    // Parse it!
+    int _res = sscanf(_responseStart, "+CIPDNS:%d,\"%d.%d.%d.%d\",\"%d.%d.%d.%d\",\"%d.%d.%d.%d\"", &_dhcpFlag,
+                      &_dnsIpAddresses[0][0], &_dnsIpAddresses[0][1], &_dnsIpAddresses[0][2], &_dnsIpAddresses[0][3],
+                      &_dnsIpAddresses[1][0], &_dnsIpAddresses[1][1], &_dnsIpAddresses[1][2], &_dnsIpAddresses[1][3],
+                      &_dnsIpAddresses[2][0], &_dnsIpAddresses[2][1], &_dnsIpAddresses[2][2], &_dnsIpAddresses[2][3]);
+
+    // Check if all is parsed correctly, it should find at least one DNS. If not, return invalid IP Address.
+    if (_res < 4)
+        return INADDR_NONE;
+
+    // Return wanted DNS.
+    return IPAddress(_dnsIpAddresses[i][0], _dnsIpAddresses[i][1], _dnsIpAddresses[i][2], _dnsIpAddresses[i][3]);
+}
+
+/**
+ * @brief   Get the MAC address of the ESP32. It will be returned with char array
+ *          ("aa:bb:cc:11:22:33").
+ *
+ * @return  char*
+ *          MAC Address of the ESP32.
+ * @note    Original MAC can be changed with WiFiClass::macAddress(char *_mac) method.
+ */
+char *WiFiClass::macAddress()
+{
+    // Send AT Command for getting AT Command from the module.
+    if (!sendAtCommand((char *)esp32AtWiFiGetMac))
+        return _invalidMac;
+
+    // Wait for the response from the modem.
+    if (!getAtResponse(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE, 40ULL))
+        return _invalidMac;
+
+    // Try to parse it.
+    char *_responseStart = strstr(_dataBuffer, "+CIPAPMAC:");
+
+    // If proper response is not found, return with invalid MAC address.
+    if (_responseStart == NULL)
+        return _invalidMac;
+
+    // Get the MAC address from the response.
+    int _res = sscanf(_responseStart, "+CIPAPMAC:%[^\r\n]", _esp32MacAddress);
+
+    // If parsing failed, return invalid MAC address.
+    if (!_res)
+        return _invalidMac;
+
+    // Return parsed MAC address.
+    return _esp32MacAddress;
+}
+
+/**
+ * @brief   Method set the MAC address of the ESP32.
+ *
+ * @param   char *_mac
+ *          Pointer to the char array of the new MAC address. String with the
+ *          new MAC address must have "aa:bb:cc:dd:ee:ff" format.
+ * @return  bool
+ *          true - New MAC address is set.
+ *          false - New MAC address set failed.
+ * @note    MAC address only can be set if the WiFI mode is set to SoftAP mode.
+ */
+bool WiFiClass::macAddress(char *_mac)
+{
+    // Create a string for the new MAC address.
+    AtCommandBuilder _cmd(_dataBuffer, sizeof(_dataBuffer));
+    _cmd.add("AT+CIPAPMAC=").addQuoted(_mac).end();
+
+    // Send AT Command. Return false if failed.
+    if (!sendAtCommand(_cmd))
+        return false;
+
+    // Wait for the response.
+    if (!getAtResponse(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE, 40ULL))
+        return false;
+
+    // Get the response. Try to find \r\n\OK\r\n. Return false if failed.
+    if (strstr(_dataBuffer, esp32AtCmdResponse) == NULL)
+        return false;
+
+    // Otherwise return true.
+    return true;
+}
+
+/**
+ * @brief   Methods enables complete WiFi config. Set LocalIP, GatewayIP, Subnet Mask and DNS with one call.
+ *          To keep original value of the one IP address, use INADDR_NONE as parameter.
+ *
+ * @param   IPAddress _staticIP
+ *          Set the local IP Address. To keep the default one, use INADDR_NONE.
+ * @param   IPAddress _gateway
+ *          Set the gateway IP Address. To keep the default one, use INADDR_NONE.
+ * @param   IPAddress _subnet
+ *          Set the sunbet mask. To keep the default one, use INADDR_NONE.
+ * @param   IPAddress _dns1
+ *          Set the Primary DNS IP Address. To keep the default one, use INADDR_NONE.
+ * @param   IPAddress _dns2
+ *          Set the Secondary DNS IP Address. To keep the default one, use INADDR_NONE.
+ * @return  bool
+ *          true - New IP config is set.
+ *          false - New IP config set failed.
+ */
+bool WiFiClass::config(IPAddress _staticIP, IPAddress _gateway, IPAddress _subnet, IPAddress _dns1, IPAddress _dns2)
+{
+    // Return value variable.
+    bool _retValue = true;
+
+    // First get the current settings since not all of above must be included.
+    if (_staticIP == INADDR_NONE)
+    {
+        _staticIP = ipAddressParse("ip");
+    }
+
+    if (_gateway == INADDR_NONE)
+    {
+        _gateway = ipAddressParse("gateway");
+    }
+
+    if (_subnet == INADDR_NONE)
+    {
+        _subnet = ipAddressParse("netmask");
+    }
+
+    if (_dns1 == INADDR_NONE)
+    {
+        _dns1 = dns(0);
+    }
+
+    if (_dns1 == INADDR_NONE)
+    {
+        _dns1 = dns(1);
+    }
+
+    // Now send modified data.
+    // Check if anything with the IP config have been modified. If so, send new settings.
+    if ((_staticIP != INADDR_NONE) || (_gateway != INADDR_NONE) || (_subnet != INADDR_NONE))
+    {
+        // Send the AT commands for the new IP config.
+        AtCommandBuilder _cmd(_dataBuffer, sizeof(_dataBuffer));
+        _cmd.add("AT+CIPSTA=").addQuotedIp(_staticIP).add(",").addQuotedIp(_gateway).add(",");
+        _cmd.addQuotedIp(_subnet).end();
+
+        // Send AT command and wait for the result. Set return value to false is setting IP has failed.
+        if (!execute(_cmd, 1000ULL))
+            _retValue = false;
+    }
+
+    // Check the same thing, but for DNS.
+    if ((_dns1 != INADDR_NONE) || (_dns2 != INADDR_NONE))
+    {
+        // Create AT command for the DNS settings.
+        AtCommandBuilder _cmd(_dataBuffer, sizeof(_dataBuffer));
+        _cmd.add("AT+CIPDNS=1,").addQuotedIp(_dns1).add(",").addQuotedIp(_dns2).end();
+
+        // Send AT command and wait for the result. Set return value to false is setting IP has failed.
+        if (!execute(_cmd, 1000ULL))
+            _retValue = false;
+    }
+
+    // Return true if everything went ok or false if something failed (IP config or DNS).
+    return _retValue;
+}
+
+/**
+ * @brief   Resolve the host name into the IP address using the ESP32 DNS (AT+CIPDOMAIN). Resolved
+ *          addresses are kept in the small DNS cache, so the same host is not resolved again until
+ *          its entry expires (see setDnsCacheTtl()). If the cache is full, least recently used
+ *          entry is replaced.
+ *
+ * @param   const char *_host
+ *          Host name (for example "example.com"). IP address in the string form is returned as is.
+ * @param   bool _useCache
+ *          true - Use the cached IP address if available (default).
+ *          false - Always ask the modem, cached entry will be refreshed.
+ * @return  IPAddress
+ *          Resolved IP address with Arduino IPAddress class. INADDR_NONE if failed.
+ */
+IPAddress WiFiClass::resolve(const char *_host, bool _useCache)
+{
+    // Variable for the resolved IP Address.
+    IPAddress _ip;
+
+    // Check for user mistake (null-pointer or host name that does not fit into the cache!).
+    if ((_host == NULL) || (strlen(_host) >= INKPLATE_ESP32_DNS_CACHE_HOST_LEN))
+        return INADDR_NONE;
+
+    // Nothing to resolve if the IP Address is already used.
+    if (_ip.fromString(_host))
+        return _ip;
+
+    // Try to find the host in the cache first.
+    if (_useCache)
+    {
+        int _cacheIndex = dnsCacheFind(_host);
+        if (_cacheIndex >= 0)
+        {
+            // Mark it as recently used and return cached IP Address.
+            _dnsCache[_cacheIndex].lastUsed = millis();
+            return IPAddress(_dnsCache[_cacheIndex].ip[0], _dnsCache[_cacheIndex].ip[1], _dnsCache[_cacheIndex].ip[2],
+                             _dnsCache[_cacheIndex].ip[3]);
+        }
+    }
+
+    // Not in the cache, ask the modem. Create the AT Command string.
+    AtCommandBuilder _cmd(_dataBuffer, sizeof(_dataBuffer));
+    _cmd.add(esp32AtResolveDomain).addQuoted(_host).end();
+
+    // Send AT command. Return invalid IP Address if failed.
+    if (!sendAtCommand(_cmd))
+        return INADDR_NONE;
+
+    // Wait for the response. DNS query can take some time.
+    if (!waitForAtResult(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE, 5000ULL))
+        return INADDR_NONE;
+
+    // Try to find the start of the response.
+    char *_responseStart = strstr(_dataBuffer, esp32AtResolveDomainResponse);
+    if (_responseStart == NULL)
+        return INADDR_NONE;
+
+    // Skip the response header and the quotes (newer ESP-AT firmware puts IP Address in quotes).
+    _responseStart += strlen(esp32AtResolveDomainResponse);
+    if (*_responseStart == '\"')
+        _responseStart++;
+
+    // Parse it! For some reason, STM32 can't parse %hhu so int and %d must be used.
+    int _ipAddress[4];
+    if (sscanf(_responseStart, "%d.%d.%d.%d", &_ipAddress[0], &_ipAddress[1], &_ipAddress[2], &_ipAddress[3]) != 4)
+        return INADDR_NONE;
+
+    _ip = IPAddress(_ipAddress[0], _ipAddress[1], _ipAddress[2], _ipAddress[3]);
+
+    // Save it into the cache for the next time.
+    dnsCacheStore(_host, _ip);
+
+    // Return resolved IP Address.
+    return _ip;
+}
+
+/**
+ * @brief   Set the time to live for the DNS cache entries.
+ *
+ * @param   unsigned long _ttl
+ *          Time to live in milliseconds. Use 0 to disable the DNS cache.
+ */
+void WiFiClass::setDnsCacheTtl(unsigned long _ttl)
+{
+    _dnsCacheTtl = _ttl;
+}
+
+/**
+ * @brief   Remove all entries from the DNS cache.
+ *
+ */
+void WiFiClass::clearDnsCache()
+{
+    for (int i = 0; i < INKPLATE_ESP32_DNS_CACHE_SIZE; i++)
+    {
+        _dnsCache[i].valid = false;
+    }
+}
+
+/**
+ * @brief   Enable or disable multiple connections (AT+CIPMUX). With multiple connections, up to
+ *          INKPLATE_ESP32_MAX_LINKS connections can be opened at the same time, each one on its
+ *          own link ID. It's enabled automatically with the first linkOpen().
+ *
+ * @param   bool _en
+ *          true - Enable multiple connections.
+ *          false - Single connection mode (all links must be closed).
+ * @return  bool
+ *          true - Command executed successfully.
+ *          false - Command failed.
+ */
+bool WiFiClass::multipleConnections(bool _en)
+{
+    // Create AT Command string.
+    AtCommandBuilder _cmd(_dataBuffer, sizeof(_dataBuffer));
+    _cmd.add(esp32AtMultipleConnections).addUInt(_en ? 1 : 0).end();
+
+    // Send AT Command and wait for the result. Return false if failed.
+    if (!execute(_cmd, 1000ULL))
+        return false;
+
+    // Save the new state, from now the incoming data must be checked for the "+IPD".
+    _linkMuxEnabled = _en;
+    _ipdState = INKPLATE_ESP32_IPD_STATE_SCAN;
+    _ipdHeaderLen = 0;
+
+    // Everything went ok? Return true!
+    return true;
+}
+
+/**
+ * @brief   Open a new connection on the free link ID. Host name is resolved with the DNS cache.
+ *
+ * @param   const char *_type
+ *          Type of the connection - "TCP", "UDP" or "SSL".
+ * @param   const char *_host
+ *          Host name or IP Address of the remote host.
+ * @param   uint16_t _port
+ *          Port of the remote host.
+ * @param   uint16_t _localPort
+ *          Local port (used only for UDP, 0 - let the modem choose one).
+ * @param   uint8_t _udpMode
+ *          UDP mode (used only with local port). 0 - Remote host is fixed, 1 - Remote host changes
+ *          once to the first one that sends the data, 2 - Remote host changes with every received
+ *          datagram.
+ * @param   const struct spiAtTlsConfigTypedef *_tls
+ *          TLS settings (used only for "SSL", NULL - no certificate check). Server name (SNI) is always set.
+ * @return  int
+ *          Link ID of the opened connection, -1 if failed.
+ */
+int WiFiClass::linkOpen(const char *_type, const char *_host, uint16_t _port, uint16_t _localPort, uint8_t _udpMode,
+                        const struct spiAtTlsConfigTypedef *_tls)
+{
+    // Link ID that will be used.
+    int _linkId = -1;
+
+    // Check for user mistake (null-pointer!).
+    if ((_type == NULL) || (_host == NULL))
+        return -1;
+
+    // Enable multiple connections first if needed.
+    if (!_linkMuxEnabled && !multipleConnections(true))
+        return -1;
+
+    // Find the free link ID.
+    for (int i = 0; i < INKPLATE_ESP32_MAX_LINKS; i++)
+    {
+        if (!_links[i].used)
+        {
+            _linkId = i;
+            break;
+        }
+    }
+
+    // No free link? Return error.
+    if (_linkId < 0)
+        return -1;
+
+    // TLS settings of the link must be set before the connection.
+    if ((strcmp(_type, "SSL") == 0) && !linkTlsSetup(_linkId, _host, _tls))
+        return -1;
+
+    // Try to get the IP Address of the host from the DNS cache. If failed, modem will resolve it. SSL keeps the
+    // host name, so the modem uses it for the server name and the certificate check.
+    IPAddress _ip = (strcmp(_type, "SSL") == 0) ? INADDR_NONE : resolve(_host);
+
+    // Create AT Command string. Use IP Address of the host if it's known.
+    AtCommandBuilder _cmd(_dataBuffer, sizeof(_dataBuffer));
+    _cmd.add(esp32AtLinkOpen).addUInt(_linkId).add(",").addQuoted(_type).add(",");
+    if (_ip != INADDR_NONE)
+    {
+        _cmd.addQuotedIp(_ip);
+    }
+    else
+    {
+        _cmd.addQuoted(_host);
+    }
+    _cmd.add(",").addUInt(_port);
+
+    // Add local port and mode for UDP if needed.
+    if (_localPort != 0)
+        _cmd.add(",").addUInt(_localPort).add(",").addUInt(_udpMode);
+    _cmd.end();
+
+    // Send AT Command and wait for the connection. It can take a while (especially for SSL). Data of the other
+    // links can come in between. Time of the connection (TCP and TLS handshake) is measured.
+    bool _demux = _ipdDemux;
+    _ipdDemux = true;
+    unsigned long _startTime = millis();
+    bool _retValue = sendAtCommand(_cmd) && waitForAtResult(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE, 10000ULL);
+    _ipdDemux = _demux;
+
+    // Return error if failed.
+    if (!_retValue)
+        return -1;
+
+    // Connected, link ID is now in use. UDP keeps the boundaries of the received datagrams.
+    linkReset(_linkId);
+    _links[_linkId].handshakeTime = millis() - _startTime;
+    _links[_linkId].used = true;
+    _links[_linkId].connected = true;
+    _links[_linkId].datagram = (strcmp(_type, "UDP") == 0);
+
+    // Return the link ID.
+    return _linkId;
+}
+
+/**
+ * @brief   Close the connection on the selected link ID. All data in the queues is discarded.
+ *
+ * @param   int _linkId
+ *          Link ID of the connection.
+ * @return  bool
+ *          true - Connection closed.
+ *          false - Command failed (link ID is released anyway).
+ */
+bool WiFiClass::linkClose(int _linkId)
+{
+    // Check for the valid link ID.
+    if ((_linkId < 0) || (_linkId >= INKPLATE_ESP32_MAX_LINKS))
+        return false;
+
+    // Return value variable.
+    bool _retValue = true;
+
+    // Only send close command if the remote side did not close the connection already.
+    if (_links[_linkId].connected)
+    {
+        bool _demux = _ipdDemux;
+        _ipdDemux = true;
+        AtCommandBuilder _cmd(_dataBuffer, sizeof(_dataBuffer));
+        _cmd.add(esp32AtLinkClose).addUInt(_linkId).end();
+        if (!sendAtCommand(_cmd) || !waitForAtResult(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE, 1000ULL))
+            _retValue = false;
+        _ipdDemux = _demux;
+    }
+
+    // Release the link ID.
+    linkReset(_linkId);
+
+    return _retValue;
+}
+
+/**
+ * @brief   Check if the connection on the selected link ID is still open.
+ *
+ * @param   int _linkId
+ *          Link ID of the connection.
+ * @return  bool
+ *          true - Connection is open.
+ *          false - Connection is closed (there still can be some data in the receive queue).
+ */
+bool WiFiClass::linkConnected(int _linkId)
+{
+    // Check for the valid link ID.
+    if ((_linkId < 0) || (_linkId >= INKPLATE_ESP32_MAX_LINKS))
+        return false;
+
+    return _links[_linkId].connected;
+}
+
+/**
+ * @brief   Get the number of bytes waiting in the receive queue of the link. It does not check for
+ *          the new data, use poll() for that.
+ *
+ * @param   int _linkId
+ *          Link ID of the connection.
+ * @return  int
+ *          Number of bytes available for read.
+ */
+int WiFiClass::linkAvailable(int _linkId)
+{
+    // Check for the valid link ID.
+    if ((_linkId < 0) || (_linkId >= INKPLATE_ESP32_MAX_LINKS))
+        return 0;
+
+    return _links[_linkId].rxCount;
+}
+
+/**
+ * @brief   Copy the data from the receive queue of the link into the user-defined buffer.
+ *
+ * @param   int _linkId
+ *          Link ID of the connection.
+ * @param   char *_buffer
+ *          Pointer to the user-defined buffer. If NULL is used, data is discarded.
+ * @param   uint16_t _len
+ *          Max. number of bytes that will be copied.
+ * @return  int
+ *          Actual number of bytes copied, -1 if link ID is not valid.
+ */
+int WiFiClass::linkRead(int _linkId, char *_buffer, uint16_t _len)
+{
+    // Check for the valid link ID.
+    if ((_linkId < 0) || (_linkId >= INKPLATE_ESP32_MAX_LINKS))
+        return -1;
+
+    struct spiAtLinkTypedef *_link = &_links[_linkId];
+
+    // Can't read more than it's available.
+    if (_len > _link->rxCount)
+        _len = _link->rxCount;
+
+    // Copy it byte by byte, since the ring buffer can wrap around.
+    for (uint16_t i = 0; i < _len; i++)
+    {
+        if (_buffer != NULL)
+            _buffer[i] = _link->rxBuffer[_link->rxTail];
+        _link->rxTail = (_link->rxTail + 1) % INKPLATE_ESP32_LINK_RX_BUFFER_SIZE;
+    }
+    _link->rxCount -= _len;
+
+    // Return the number of copied bytes.
+    return _len;
+}
+
+/**
+ * @brief   Put the data into the transmit queue of the link. Data is sent by poll() (or linkFlush()),
+ *          that takes turns between the links, so one link can't block the others. If the queue is
+ *          full, method will poll until there is enough space for all of the data (or until the modem does not
+ *          take any data for INKPLATE_ESP32_LINK_WRITE_TIMEOUT).
+ *
+ * @param   int _linkId
+ *          Link ID of the connection.
+ * @param   const char *_data
+ *          Pointer to the data.
+ * @param   uint16_t _len
+ *          Length of the data (in bytes).
+ * @return  int
+ *          Number of bytes written into the queue (less than _len if the link has been closed or the queue stayed
+ *          full), -1 if link ID is not valid or link is closed.
+ */
+int WiFiClass::linkWrite(int _linkId, const char *_data, uint16_t _len)
+{
+    // Check for the valid link ID.
+    if ((_linkId < 0) || (_linkId >= INKPLATE_ESP32_MAX_LINKS) || !_links[_linkId].connected)
+        return -1;
+
+    struct spiAtLinkTypedef *_link = &_links[_linkId];
+
+    // Number of bytes written into the queue.
+    uint16_t _written = 0;
+
+    // Time of the last progress of the full queue.
+    unsigned long _timer = millis();
+
+    while (_written < _len)
+    {
+        // Queue is full? Send something (from this or the other links) to make some space.
+        if (_link->txCount == INKPLATE_ESP32_LINK_TX_BUFFER_SIZE)
+        {
+            poll();
+
+            // Connection closed in the meantime? Stop.
+            if (!_link->connected)
+                break;
+
+            // Modem does not take the data (busy or error)? Stop after the timeout.
+            if (_link->txCount == INKPLATE_ESP32_LINK_TX_BUFFER_SIZE)
+            {
+                if ((unsigned long)(millis() - _timer) > INKPLATE_ESP32_LINK_WRITE_TIMEOUT)
+                    break;
+            }
+            else
+            {
+                _timer = millis();
+            }
+
+            continue;
+        }
+
+        // Add byte into the queue.
+        _link->txBuffer[_link->txHead] = _data[_written++];
+        _link->txHead = (_link->txHead + 1) % INKPLATE_ESP32_LINK_TX_BUFFER_SIZE;
+        _link->txCount++;
+    }
+
+    // Return the number of bytes in the queue.
+    return _written;
+}
+
+/**
+ * @brief   Send all the data from the transmit queue of the link.
+ *
+ * @param   int _linkId
+ *          Link ID of the connection.
+ * @param   unsigned long _timeout
+ *          Timeout value in milliseconds.
+ * @return  bool
+ *          true - All data has been sent.
+ *          false - Timeout occured or the connection has been closed.
+ */
+bool WiFiClass::linkFlush(int _linkId, unsigned long _timeout)
+{
+    // Check for the valid link ID.
+    if ((_linkId < 0) || (_linkId >= INKPLATE_ESP32_MAX_LINKS))
+        return false;
+
+    // Capture the time!
+    unsigned long _timeoutCounter = millis();
+
+    // Keep polling (other links also get their turn) until everything is sent.
+    while (_links[_linkId].txCount && _links[_linkId].connected)
+    {
+        if ((unsigned long)(millis() - _timeoutCounter) >= _timeout)
+            return false;
+
+        poll();
+    }
+
+    return (_links[_linkId].txCount == 0);
+}
+
+/**
+ * @brief   Send the data on the link right away, without the transmit queue. On the UDP link, each call
+ *          sends one datagram, optionally to the different remote host than the one used in linkOpen().
+ *
+ * @param   int _linkId
+ *          Link ID of the connection.
+ * @param   const char *_data
+ *          Pointer to the data.
+ * @param   uint16_t _len
+ *          Length of the data (in bytes).
+ * @param   const char *_host
+ *          Remote host (only for UDP). Use NULL for the host used in linkOpen().
+ * @param   uint16_t _port
+ *          Remote port (only for UDP, used with the remote host).
+ * @return  bool
+ *          true - Data has been sent.
+ *          false - Send failed.
+ */
+bool WiFiClass::linkSendTo(int _linkId, const char *_data, uint16_t _len, const char *_host, uint16_t _port)
+{
+    // Check for the valid link ID.
+    if ((_linkId < 0) || (_linkId >= INKPLATE_ESP32_MAX_LINKS) || !_links[_linkId].connected)
+        return false;
+
+    // Data can't be larger than one SPI packet.
+    if (_len > INKPLATE_ESP32_SPI_MAX_MESAGE_DATA_BUFFER)
+        return false;
+
+    // Check for the new data first, so modem is not busy with it.
+    poll();
+
+    return linkSend(_linkId, _data, _len, _host, _port);
+}
+
+/**
+ * @brief   Send the data gathered from the segments on the link right away, with one AT+CIPSEND (for example
+ *          the header and the body of the response, each from its own buffer, without copying them together).
+ *
+ * @param   int _linkId
+ *          Link ID of the connection.
+ * @param   const struct spiAtSegmentTypedef *_segments
+ *          Segments of the data, sent one after the other.
+ * @param   uint8_t _count
+ *          Number of the segments (max. INKPLATE_ESP32_SPI_MAX_SEGMENTS).
+ * @param   const char *_host
+ *          Remote host (only for UDP). Use NULL for the host used in linkOpen().
+ * @param   uint16_t _port
+ *          Remote port (only for UDP, used with the remote host).
+ * @return  bool
+ *          true - Data has been sent.
+ *          false - Send failed (or all segments together are larger than one SPI packet).
+ */
+bool WiFiClass::linkSendTo(int _linkId, const struct spiAtSegmentTypedef *_segments, uint8_t _count,
+                           const char *_host, uint16_t _port)
+{
+    // Check for the valid link ID and user mistake (null-pointer!).
+    if ((_linkId < 0) || (_linkId >= INKPLATE_ESP32_MAX_LINKS) || !_links[_linkId].connected || (_segments == NULL))
+        return false;
+
+    // Data can't be larger than one SPI packet.
+    uint32_t _len = 0;
+    for (uint8_t i = 0; i < _count; i++)
+        _len += _segments[i].len;
+    if (_len > INKPLATE_ESP32_SPI_MAX_MESAGE_DATA_BUFFER)
+        return false;
+
+    // Check for the new data first, so modem is not busy with it.
+    poll();
+
+    return linkSend(_linkId, _segments, _count, _host, _port);
+}
+
+/**
+ * @brief   Get the next received datagram on the UDP link. Datagram is removed from the datagram queue
+ *          and its data must be read with linkRead() (or discarded with linkRead(_linkId, NULL, len)).
+ *
+ * @param   int _linkId
+ *          Link ID of the connection.
+ * @return  int
+ *          Size of the next datagram in bytes, 0 if there is none.
+ */
+int WiFiClass::linkNextPacket(int _linkId)
+{
+    // Check for the valid link ID.
+    if ((_linkId < 0) || (_linkId >= INKPLATE_ESP32_MAX_LINKS))
+        return 0;
+
+    struct spiAtLinkTypedef *_link = &_links[_linkId];
+
+    // Nothing received?
+    if (_link->rxPacketCount == 0)
+        return 0;
+
+    // Remove it from the queue.
+    uint16_t _packetLen = _link->rxPacketLen[_link->rxPacketTail];
+    _link->rxPacketTail = (_link->rxPacketTail + 1) % INKPLATE_ESP32_LINK_MAX_PACKETS;
+    _link->rxPacketCount--;
+
+    return _packetLen;
+}
+
+/**
+ * @brief   Get the number of received bytes dropped because the receive queue of the link was full.
+ *
+ * @param   int _linkId
+ *          Link ID of the connection.
+ * @return  uint32_t
+ *          Number of dropped bytes.
+ */
+uint32_t WiFiClass::linkDropped(int _linkId)
+{
+    // Check for the valid link ID.
+    if ((_linkId < 0) || (_linkId >= INKPLATE_ESP32_MAX_LINKS))
+        return 0;
+
+    return _links[_linkId].rxDropped;
+}
+
+/**
+ * @brief   Get the time needed for opening the connection on the link (TCP and, for SSL, the TLS handshake).
+ *
+ * @param   int _linkId
+ *          Link ID of the connection.
+ * @return  unsigned long
+ *          Time in milliseconds.
+ */
+unsigned long WiFiClass::linkHandshakeTime(int _linkId)
+{
+    // Check for the valid link ID.
+    if ((_linkId < 0) || (_linkId >= INKPLATE_ESP32_MAX_LINKS))
+        return 0;
+
+    return _links[_linkId].handshakeTime;
+}
+
+/**
+ * @brief   Check if the connection on the link has been made by the remote host to the server (see serverBegin()).
+ *
+ * @param   int _linkId
+ *          Link ID of the connection.
+ * @return  bool
+ *          true - Connection to the server (close it with linkClose() when done).
+ *          false - Link is not used or it's the connection opened with linkOpen().
+ */
+bool WiFiClass::linkAccepted(int _linkId)
+{
+    // Check for the valid link ID.
+    if ((_linkId < 0) || (_linkId >= INKPLATE_ESP32_MAX_LINKS))
+        return false;
+
+    return _links[_linkId].used && _links[_linkId].accepted;
+}
+
+/**
+ * @brief   Get the session number of the link. It changes with each connection accepted by the server, so the
+ *          new connection can be told apart from the old one that used the same link ID (modem gives the link ID
+ *          of the closed connection to the next one).
+ *
+ * @param   int _linkId
+ *          Link ID of the connection.
+ * @return  uint8_t
+ *          Session number (0 if the link ID is not valid).
+ */
+uint8_t WiFiClass::linkSession(int _linkId)
+{
+    // Check for the valid link ID.
+    if ((_linkId < 0) || (_linkId >= INKPLATE_ESP32_MAX_LINKS))
+        return 0;
+
+    return _links[_linkId].session;
+}
+
+/**
+ * @brief   Start the TCP server. Multiple connections are enabled automatically. Each new connection takes
+ *          the link ID given by the modem, its data goes into the queue of that link (see linkAccepted()).
+ *
+ * @param   uint16_t _port
+ *          Port of the server.
+ * @param   uint16_t _timeout
+ *          Connection is closed by the modem if nothing is received for this time (in seconds, 0 - never).
+ * @return  bool
+ *          true - Server started.
+ *          false - Command failed.
+ */
+bool WiFiClass::serverBegin(uint16_t _port, uint16_t _timeout)
+{
+    // Server works only with multiple connections.
+    if (!_linkMuxEnabled && !multipleConnections(true))
+        return false;
+
+    // Start the server.
+    AtCommandBuilder _cmd(_dataBuffer, sizeof(_dataBuffer));
+    _cmd.add(esp32AtServer).add("1,").addUInt(_port).end();
+    if (!execute(_cmd, 1000ULL))
+        return false;
+
+    // Set the timeout of the connections.
+    _cmd.reset();
+    _cmd.add(esp32AtServerTimeout).addUInt(_timeout).end();
+    if (!execute(_cmd, 1000ULL))
+        return false;
+
+    // From now on, new connections are accepted.
+    _serverEnabled = true;
+
+    return true;
+}
+
+/**
+ * @brief   Stop the TCP server and close all of its connections.
+ *
+ * @return  bool
+ *          true - Server stopped.
+ *          false - Command failed (connections are released anyway).
+ */
+bool WiFiClass::serverEnd()
+{
+    // Stop accepting the new connections.
+    _serverEnabled = false;
+
+    // Stop the server and close its connections.
+    AtCommandBuilder _cmd(_dataBuffer, sizeof(_dataBuffer));
+    _cmd.add(esp32AtServer).add("0,1").end();
+    bool _retValue = execute(_cmd, 1000ULL);
+
+    // Release the link IDs of the server connections.
+    for (int i = 0; i < INKPLATE_ESP32_MAX_LINKS; i++)
+    {
+        if (_links[i].accepted)
+            linkReset(i);
+    }
+
+    return _retValue;
+}
+
+/**
+ * @brief   Service all the open links. First read all pending data from the modem (incoming data
+ *          goes into the receive queues), then send one chunk of data from the next link that has
+ *          something to send (round-robin). Call it often (from the loop()).
+ *
+ */
+void WiFiClass::poll()
+{
+    // Nothing to do in single connection mode.
+    if (!_linkMuxEnabled)
+        return;
+
+    // Read everything the modem has for us. Data is sorted into the link queues, anything else is not needed
+    // here.
+    bool _demux = _ipdDemux;
+    _ipdDemux = true;
+    uint32_t _offset = 0;
+    while (fetchFrame(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE, &_offset) == 1)
+        _offset = 0;
+
+    // Find the next link with the data for sending.
+    for (int i = 0; i < INKPLATE_ESP32_MAX_LINKS; i++)
+    {
+        int _linkId = (_linkTxIndex + i) % INKPLATE_ESP32_MAX_LINKS;
+        struct spiAtLinkTypedef *_link = &_links[_linkId];
+
+        if (!_link->connected || (_link->txCount == 0))
+            continue;
+
+        // Send one chunk. If it wraps around the end of the ring buffer, its two parts are sent as two
+        // segments of the same send.
+        uint16_t _chunkSize = _link->txCount;
+        if (_chunkSize > INKPLATE_ESP32_LINK_TX_CHUNK)
+            _chunkSize = INKPLATE_ESP32_LINK_TX_CHUNK;
+        uint16_t _firstPart = INKPLATE_ESP32_LINK_TX_BUFFER_SIZE - _link->txTail;
+        if (_firstPart > _chunkSize)
+            _firstPart = _chunkSize;
+        struct spiAtSegmentTypedef _chunk[2] = {{&_link->txBuffer[_link->txTail], _firstPart},
+                                                {&_link->txBuffer[0], (uint16_t)(_chunkSize - _firstPart)}};
+
+        // Remove it from the queue only if sent successfully. If not, it will be sent in next turn.
+        if (linkSend(_linkId, _chunk, (_firstPart == _chunkSize) ? 1 : 2))
+        {
+            _link->txTail = (_link->txTail + _chunkSize) % INKPLATE_ESP32_LINK_TX_BUFFER_SIZE;
+            _link->txCount -= _chunkSize;
+        }
+
+        // Next time start from the next link.
+        _linkTxIndex = (_linkId + 1) % INKPLATE_ESP32_MAX_LINKS;
+        break;
+    }
+
+    _ipdDemux = _demux;
+}
+
+/**
+ * @brief   Wait for the ESP32 handshake pin to trigger master request using digitalRead()
+ *          (polling). This funciton is not used anymore.
+ *
+ * @param   uint32_t _timeoutValue
+ *          Timeout value until the request from the ESP32 happens in milliseconds.
+ * @param   _validState
+ *          Is the trigger state for the handshake pin HIGH or LOW.
+ * @return  bool
+ *          true - Handshake pin trigger detected.
+ *          false - Timeout, no handshake trigger detected.
+ */
+bool WiFiClass::waitForHandshakePin(uint32_t _timeoutValue, bool _validState)
+{
+    // Variable for the timeout. Also capture the current state.
+    unsigned long _timeout = millis();
+
+    // Read the current state of the handshake pin.
+    bool _handshakePinState = digitalRead(_handshakePin);
+
+    // Check if the handshake pin is already set.
+    if (_handshakePinState == _validState)
+        return true;
+
+    // If not, wait for the valid pin state.
+    do
+    {
+        // Read the new state of the pin.
+        _handshakePinState = digitalRead(_handshakePin);
+
+        // Wait a little bit.
+        delay(1);
+    } while (((unsigned long)(millis() - _timeout) < _timeoutValue) && (_handshakePinState != _validState));
+
+    // Check the state of the timeout. If timeout occured, return false.
+    if ((millis() - _timeout) >= _timeoutValue)
+        return false;
+
+    // Otherwise return true.
+    return true;
+}
+
+/**
+ * @brief   Wait for the ESP32 handshake pin to trigger master request using interrutps.
+ *
+ * @param   uint32_t _timeoutValue
+ *          Timeout value until the request from the ESP32 happens in milliseconds.
+ * @return  bool
+ *          true - Handshake pin trigger detected.
+ *          false - Timeout, no handshake trigger detected.
+ */
+bool WiFiClass::waitForHandshakePinInt(uint32_t _timeoutValue)
+{
+    // First, clear the flag status.
+    _esp32HandshakePinFlag = false;
+
+    // In the replay, modem "sends" the handshake if the trace has the status request next.
+    if (_replayData != NULL)
+        _esp32HandshakePinFlag = spiReplayHandshake();
+
+    // Variable for the timeout. Also capture the current state.
+    unsigned long _timeout = millis();
+
+    // Wait for the rising edge in Handshake pin.
+    while (((unsigned long)(millis() - _timeout) < _timeoutValue) && (!_esp32HandshakePinFlag))
+        ;
+
+    // Clear the flag.
+    _esp32HandshakePinFlag = false;
+
+    // Check the state of the timeout. If timeout occured, return false.
+    if ((millis() - _timeout) >= _timeoutValue)
+        return false;
+
+    // Otherwise return true.
+    return true;
+}
+
+/**
+ * @brief   Get ESP32 slave status. It is used right after the ESP32 sends handshake (ESP32 issues
+ *          request from the master to read the data from the ESP32).
+ *
+ * @param   uint16_t _len
+ *          Number of bytes requested waiting to be read by thje master from the ESP32.
+ * @param   uint8_t *_seq
+ *          Pointer to the variable where the sequence number will be stored (optional, NULL if not used).
+ * @return  uint8_t
+ *          Return slave status (INKPLATE_ESP32_SPI_SLAVE_STATUS_READABLE or
+ *          INKPLATE_ESP32_SPI_SLAVE_STATUS_WRITEABLE), 0 if the status is not valid.
+ * @note    Status is read again (up to INKPLATE_ESP32_SPI_RETRIES times) if it does not make sense. Sequence
+ *          number of the readable frame is checked here (see spiSequenceCheck()).
+ */
+uint8_t WiFiClass::requestSlaveStatus(uint16_t *_len, uint8_t *_seq)
+{
+    // Make a union/struct for data part of the SPI Command.
+    union spiAtCommandsSlaveStatusTypedef _slaveStatus;
+
+    // SPI Command Packet.
+    struct spiAtCommandTypedef _spiCommand = {
+        .cmd = INKPLATE_ESP32_SPI_CMD_REQ_SLAVE_INFO,
+        .addr = 0x04,
+        .dummy = 0x00,
+        .data = (uint8_t *)&(_slaveStatus.bytes),
+    };
+
+    uint32_t _spiPacketLen = sizeof(_slaveStatus.bytes);
+
+    // Reading the status does not change anything on the modem, so it can be read again if it's corrupted.
+    bool _valid = false;
+    for (int i = 0; (i <= INKPLATE_ESP32_SPI_RETRIES) && !_valid; i++)
+    {
+        // Count the retries.
+        if (i != 0)
+            _spiStats.retries++;
+
+        _slaveStatus.elements.status = 0;
+        _slaveStatus.elements.sequence = 0;
+        _slaveStatus.elements.length = 0;
+
+        // Transfer the packet!
+        transferSpiPacket(&_spiCommand, _spiPacketLen);
+
+        // Check if the status makes sense, drop the SPI clock if there are too many errors.
+        _valid = spiLinkCheck(_slaveStatus.elements.status, _slaveStatus.elements.length);
+    }
+
+    // Give up.
+    if (!_valid)
+        return 0;
+
+    // Check the sequence number of the frame that is going to be read.
+    _spiFrameDuplicated = false;
+    if (_slaveStatus.elements.status == INKPLATE_ESP32_SPI_SLAVE_STATUS_READABLE)
+        spiSequenceCheck(_slaveStatus.elements.sequence);
+
+    // Save the length and the sequence number if possible.
+    if (_len != NULL)
+        *_len = _slaveStatus.elements.length;
+    if (_seq != NULL)
+        *_seq = _slaveStatus.elements.sequence;
+
+    // Return the slave status.
+    return _slaveStatus.elements.status;
+}
+
+/**
+ * @brief   Send data to the ESP32 and at the same time receive new data from ESP32.
+ *
+ * @param   spiAtCommandTypedef *_spiPacket
+ *          Pointer to the spiAtCommandTypedef to describe data packet.
+ * @param   uint16_t _spiDataLen
+ *          length of the data part only, excluding spiAtCommandTypedef (in bytes).
+ */
+void WiFiClass::transferSpiPacket(spiAtCommandTypedef *_spiPacket, uint16_t _spiDataLen)
+{
+    // Status and data read get the data from the modem, everything else sends the data to the modem.
+    uint8_t _direction = ((_spiPacket->cmd == INKPLATE_ESP32_SPI_CMD_REQ_SLAVE_INFO) ||
+                          (_spiPacket->cmd == INKPLATE_ESP32_SPI_CMD_MASTER_READ_DATA))
+                             ? INKPLATE_ESP32_SPI_TRACE_DIR_RX
+                             : INKPLATE_ESP32_SPI_TRACE_DIR_TX;
+
+    // Take the packet from the trace instead of the modem if the replay is used.
+    if (_replayData != NULL)
+    {
+        spiReplayPacket(_spiPacket, _spiDataLen, _direction);
+        return;
+    }
+
+    // Capture the start of the transfer for the statistics.
+    uint32_t _startTime = esp32SpiTimestamp();
+    uint32_t _traceTime = micros();
+
+    // Data sent to the modem is overwritten by the transfer, so it must be recorded before.
+    if (_traceRecording && (_direction == INKPLATE_ESP32_SPI_TRACE_DIR_TX))
+        spiTraceRecord(_spiPacket, _spiDataLen, _direction, _traceTime);
+
+    // Get the SPI STM32 HAL Typedef Handle.
+    SPI_HandleTypeDef *_spiHandle = _spi->getHandle();
+
+    // Activate ESP32 SPI lines by pulling CS pin to low.
+    HAL_GPIO_WritePin(_csPort, _csPinMask, GPIO_PIN_RESET);
+
+    // Send everything, but the data.
+    _spi->beginTransaction(_esp32AtSpiSettings);
+    _spi->transfer(_spiPacket->cmd);
+    _spi->transfer(_spiPacket->addr);
+    _spi->transfer(_spiPacket->dummy);
+
+    // SPI.transfer(_spiPacket->data, _spiDataLen);
+    HAL_SPI_TransmitReceive(_spiHandle, (uint8_t *)_spiPacket->data, (uint8_t *)_spiPacket->data, _spiDataLen,
+                            HAL_MAX_DELAY);
+    _spi->endTransaction();
+
+    // Disable ESP32 SPI lines by pulling CS pin to high.
+    HAL_GPIO_WritePin(_csPort, _csPinMask, GPIO_PIN_SET);
+
+    // Update the statistics.
+    spiStatsUpdate(_spiPacket->cmd, _spiDataLen, esp32SpiTimestamp() - _startTime);
+
+    // Record the data received from the modem.
+    if (_traceRecording && (_direction == INKPLATE_ESP32_SPI_TRACE_DIR_RX))
+        spiTraceRecord(_spiPacket, _spiDataLen, _direction, _traceTime);
+}
+
+/**
+ * @brief   Method only sends SPI data to the ESP32.
+ *
+ * @param   spiAtCommandTypedef *_spiPacket
+ *          Pointer to the spiAtCommandTypedef to describe data packet.
+ * @param   uint16_t _spiDataLen
+ *          length of the data part only, excluding spiAtCommandTypedef (in bytes).
+ * @param   const struct spiAtSegmentTypedef *_segments
+ *          Segments with the data (NULL - data is in the packet). They are sent one after the other in the same
+ *          SPI packet, their lengths must add up to the _spiDataLen.
+ * @param   uint8_t _segmentCount
+ *          Number of the segments.
+ */
+void WiFiClass::sendSpiPacket(spiAtCommandTypedef *_spiPacket, uint16_t _spiDataLen,
+                              const struct spiAtSegmentTypedef *_segments, uint8_t _segmentCount)
+{
+    // Take the packet from the trace instead of the modem if the replay is used.
+    if (_replayData != NULL)
+    {
+        spiReplayPacket(_spiPacket, _spiDataLen, INKPLATE_ESP32_SPI_TRACE_DIR_TX, _segments, _segmentCount);
+        return;
+    }
+
+    // Record the packet if the trace is used.
+    if (_traceRecording)
+        spiTraceRecord(_spiPacket, _spiDataLen, INKPLATE_ESP32_SPI_TRACE_DIR_TX, micros(), _segments,
+                       _segmentCount);
+
+    // Capture the start of the transfer for the statistics.
+    uint32_t _startTime = esp32SpiTimestamp();
+
+    // Get the SPI STM32 HAL Typedef Handle.
+    SPI_HandleTypeDef *_spiHandle = _spi->getHandle();
+
+    // Pack ESP32 SPI Packer Header data.
+    uint8_t _esp32SpiHeader[] = {_spiPacket->cmd, _spiPacket->addr, _spiPacket->dummy};
+
+    // Activate ESP32 SPI lines by pulling CS pin to low.
+    HAL_GPIO_WritePin(_csPort, _csPinMask, GPIO_PIN_RESET);
+
+    // Send everything, but the data.
+    _spi->beginTransaction(_esp32AtSpiSettings);
+    HAL_SPI_Transmit(_spiHandle, _esp32SpiHeader, sizeof(_esp32SpiHeader) / sizeof(uint8_t), HAL_MAX_DELAY);
+
+    // Send data. Segments go one after the other, CS stays low, so the modem gets them as one packet.
+    if (_segments == NULL)
+    {
+        HAL_SPI_Transmit(_spiHandle, _spiPacket->data, _spiDataLen, HAL_MAX_DELAY);
+    }
+    else
+    {
+        for (uint8_t i = 0; i < _segmentCount; i++)
+        {
+            if (_segments[i].len != 0)
+                HAL_SPI_Transmit(_spiHandle, (uint8_t *)_segments[i].data, _segments[i].len, HAL_MAX_DELAY);
+        }
+    }
+    _spi->endTransaction();
+
+    // Disable ESP32 SPI lines by pulling CS pin to high.
+    HAL_GPIO_WritePin(_csPort, _csPinMask, GPIO_PIN_SET);
+
+    // Update the statistics.
+    spiStatsUpdate(_spiPacket->cmd, _spiDataLen, esp32SpiTimestamp() - _startTime);
+}
+
+/**
+ * @brief   Helper method for checking the slave status. Status must be readable or writeable and the length
+ *          of the data to read must fit into one SPI packet. If too many errors occur in a row, SPI clock
+ *          drops one step (see INKPLATE_ESP32_SPI_CLOCK_STEPS).
+ *
+ * @param   uint8_t _status
+ *          Slave status.
+ * @param   uint16_t _len
+ *          Length from the slave status.
+ * @return  bool
+ *          true - Status is valid.
+ *          false - Status is not valid (link error).
+ */
+bool WiFiClass::spiLinkCheck(uint8_t _status, uint16_t _len)
+{
+    // Check the status.
+    bool _valid = (_status == INKPLATE_ESP32_SPI_SLAVE_STATUS_WRITEABLE) ||
+                  ((_status == INKPLATE_ESP32_SPI_SLAVE_STATUS_READABLE) && (_len != 0) &&
+                   (_len <= INKPLATE_ESP32_SPI_MAX_MESAGE_DATA_BUFFER));
+
+    if (_valid)
+    {
+        _spiLinkErrorsInRow = 0;
+        return true;
+    }
+
+    _spiLinkErrors++;
+    _spiLinkErrorsInRow++;
+
+    // Too many errors? Drop the clock to the next lower step. SPI settings can't be changed from the ISR, the
+    // foreground drops the clock the next time it locks the SPI.
+    if (_spiLinkErrorsInRow >= INKPLATE_ESP32_SPI_ERROR_THRESHOLD)
+    {
+        _spiLinkErrorsInRow = 0;
+        if (_spiBackground)
+            _spiClockDropPending = true;
+        else
+            spiClockDrop();
+    }
+
+    return false;
+}
+
+/**
+ * @brief   Helper method for dropping the SPI clock to the next lower step (if there is one).
+ *
+ */
+void WiFiClass::spiClockDrop()
+{
+    for (int i = _esp32SpiClockStepsCount - 1; i >= 0; i--)
+    {
+        if (_esp32SpiClockSteps[i] < _spiClock)
+        {
+            setSpiClock(_esp32SpiClockSteps[i]);
+            break;
+        }
+    }
+}
+
+/**
+ * @brief   Helper method for checking the sequence number of the readable frame. Each frame from the modem
+ *          has the next sequence number (wraps around after 255). Skipped numbers are counted as lost frames,
+ *          the same number twice is a duplicated frame (it must still be read, but it's dropped, see
+ *          readFrame()). Modem starts from 1 after the restart.
+ *
+ * @param   uint8_t _seq
+ *          Sequence number from the slave status.
+ */
+void WiFiClass::spiSequenceCheck(uint8_t _seq)
+{
+    // First frame after the reset, nothing to compare with.
+    if (!_spiRxSeqValid)
+    {
+        _spiRxSeqValid = true;
+        _spiRxSeq = _seq;
+        return;
+    }
+
+    // Check the sequence number.
+    uint8_t _expected = _spiRxSeq + 1;
+    if (_seq == _spiRxSeq)
+    {
+        // Same frame again.
+        _spiStats.framesDuplicated++;
+        _spiFrameDuplicated = true;
+        return;
+    }
+    else if ((_seq == 1) && (_expected != 1))
+    {
+        // Modem restarted, start from the beginning.
+        _spiStats.seqResyncs++;
+    }
+    else if (_seq != _expected)
+    {
+        // Some frames have been skipped.
+        _spiStats.framesLost += (uint8_t)(_seq - _expected);
+    }
+
+    // Resync to the modem.
+    _spiRxSeq = _seq;
+}
+
+/**
+ * @brief   Helper method for reading one frame from the modem (slave status must be readable). If the frame
+ *          does not fit into the buffer, it's dropped and counted as the RX overflow. Duplicated frames are
+ *          dropped as well. Incoming data of the links is moved into their queues.
+ *
+ * @param   char *_buffer
+ *          Where to store the frame.
+ * @param   uint32_t _bufferFree
+ *          Free space in the buffer (in bytes, counting the null-terminating char).
+ * @param   uint16_t _len
+ *          Length of the frame (from the slave status).
+ * @return  uint16_t
+ *          Number of bytes stored into the buffer.
+ */
+uint16_t WiFiClass::readFrame(char *_buffer, uint32_t _bufferFree, uint16_t _len)
+{
+    // Check if there is enough free memory in the buffer.
+    if (_len >= _bufferFree)
+    {
+        _spiStats.rxOverflows++;
+        _spiStats.rxDroppedBytes += _len;
+        _spiRxOverflow = true;
+        return 0;
+    }
+
+    // Read the data.
+    dataRead(_buffer, _len);
+
+    // Drop it if it's the same frame as the last one.
+    if (_spiFrameDuplicated)
+        return 0;
+
+    // Move incoming data of the links into their queues.
+    if (ipdDemuxActive())
+        _len = demuxIpd(_buffer, _len, _bufferFree);
+
+    return _len;
+}
+
+/**
+ * @brief   Helper method for checking if there is a frame to read (read in the background or signaled by the
+ *          handshake pin).
+ *
+ * @return  bool
+ *          true - Frame (or the handshake) is waiting.
+ *          false - Nothing new from the modem.
+ */
+bool WiFiClass::rxPending()
+{
+    return _esp32HandshakePinFlag || (_rxRingTail != _rxRingHead);
+}
+
+/**
+ * @brief   Helper method for getting the next frame from the modem. Frames read in the background come first
+ *          (they are older), then the frame signaled by the handshake pin is read. Duplicated frames and the
+ *          link data are handled the same way as in readFrame(). Frame that does not fit into the free space
+ *          is handled by the overflow policy (see setOverflowPolicy()).
+ *
+ * @param   char *_buffer
+ *          Buffer for the response.
+ * @param   uint32_t _bufferLen
+ *          Size of the buffer (in bytes, counting the null-terminating char).
+ * @param   uint32_t *_offset
+ *          Pointer to the length of the response in the buffer so far (it's moved by the stored frame, it goes
+ *          back to zero if the response is spilled to the sink).
+ * @param   bool _hold
+ *          Caller frees the space in the buffer, so the frame can be held back by the backpressure policy
+ *          (only if it fits into the empty buffer). Otherwise it's dropped.
+ * @return  int8_t
+ *          1 - Frame received (it can be empty if it has been dropped).
+ *          0 - Modem is not readable (stale handshake).
+ *          -1 - Nothing new from the modem (or the frame is held back until there is room for it).
+ */
+int8_t WiFiClass::fetchFrame(char *_buffer, uint32_t _bufferLen, uint32_t *_offset, bool _hold)
+{
+    uint16_t _frameLen;
+
+    // Ring, status and the data must not be touched by the background reception in the meantime (it also keeps
+    // the statistics away from the ISR).
+    spiLock();
+
+    // Frame from the receive ring?
+    uint32_t _tail = _rxRingTail;
+    bool _fromRing = (_tail != _rxRingHead);
+    if (_fromRing)
+    {
+        // Go to the beginning if the frame did not fit at the end of the ring (marked with 0xFFFF length).
+        if (((_rxRingSize - _tail) < 2) || ((_rxRing[_tail] == 0xFF) && (_rxRing[_tail + 1] == 0xFF)))
+            _tail = 0;
+
+        _frameLen = _rxRing[_tail] | (_rxRing[_tail + 1] << 8);
+    }
+    else
+    {
+        // Frame from the modem?
+        if (!_esp32HandshakePinFlag)
+        {
+            spiUnlock();
+            return -1;
+        }
+
+        // Check the slave status, if must be INKPLATE_ESP32_SPI_SLAVE_STATUS_READABLE. Status of the held frame
+        // has already been read.
+        if (_rxHeldLen == 0)
+        {
+            uint16_t _responseLen = 0;
+            if (requestSlaveStatus(&_responseLen) != INKPLATE_ESP32_SPI_SLAVE_STATUS_READABLE)
+            {
+                _esp32HandshakePinFlag = false;
+                spiUnlock();
+                return 0;
+            }
+            _rxHeldLen = _responseLen;
+            _rxHeldDuplicated = _spiFrameDuplicated;
+        }
+        _frameLen = _rxHeldLen;
+    }
+
+    // Frame does not fit into the free space?
+    if (_frameLen >= (_bufferLen - *_offset))
+    {
+        // Leave it where it is (modem or ring) until there is room for it. Only the caller that frees the space
+        // can wait, anyone else would wait until the timeout.
+        if ((_overflowPolicy == INKPLATE_ESP32_OVERFLOW_BACKPRESSURE) && _hold && (_frameLen < _bufferLen))
+        {
+            spiUnlock();
+            return -1;
+        }
+
+        // Give the response so far to the sink and start from the beginning of the buffer.
+        if ((_overflowPolicy == INKPLATE_ESP32_OVERFLOW_SINK) && (_overflowSink != NULL) && (*_offset != 0))
+        {
+            _overflowSink(_buffer, *_offset);
+            _spiStats.rxSpilledBytes += *_offset;
+            *_offset = 0;
+        }
+    }
+
+    uint16_t _stored = 0;
+    if (_fromRing)
+    {
+        // Check if there is enough free memory in the buffer.
+        if (_frameLen >= (_bufferLen - *_offset))
+        {
+            _spiStats.rxOverflows++;
+            _spiStats.rxDroppedBytes += _frameLen;
+            _spiRxOverflow = true;
+        }
+        else
+        {
+            memcpy(_buffer + *_offset, &_rxRing[_tail + 2], _frameLen);
+
+            // Move incoming data of the links into their queues.
+            _stored = ipdDemuxActive() ? demuxIpd(_buffer + *_offset, _frameLen, _bufferLen - *_offset) : _frameLen;
+        }
+
+        // Free it for the ISR.
+        _tail += _frameLen + 2;
+        _rxRingTail = (_tail >= _rxRingSize) ? 0 : _tail;
+    }
+    else
+    {
+        // Read the frame.
+        _spiFrameDuplicated = _rxHeldDuplicated;
+        _stored = readFrame(_buffer + *_offset, _bufferLen - *_offset, _frameLen);
+        _rxHeldLen = 0;
+
+        // Clear the flag before the read done, modem can signal the next frame right after it.
+        _esp32HandshakePinFlag = false;
+
+        // Send read done.
+        dataReadEnd();
+    }
+
+    spiUnlock();
+
+    *_offset += _stored;
+
+    return 1;
+}
+
+/**
+ * @brief   Helper method for reading the frame into the receive ring (called from the handshake ISR). Ring must
+ *          have room for the largest frame, since the length is not known before the slave status is read and
+ *          the status can't be read again later (sequence number would be counted twice). Only the ring, the
+ *          flags and the counters are changed here, anything else (SPI clock drop) is left to the foreground.
+ *
+ * @return  bool
+ *          true - Frame read (or dropped as the duplicated one).
+ *          false - No room in the ring or the modem is not readable, foreground must handle it.
+ */
+bool WiFiClass::backgroundRead()
+{
+    // Room needed for the largest frame with the length.
+    uint32_t _needed = INKPLATE_ESP32_SPI_MAX_MESAGE_DATA_BUFFER + 2;
+    uint32_t _head = _rxRingHead;
+    uint32_t _tail = _rxRingTail;
+    uint32_t _pos;
+
+    // Find the continuous free space. One byte always stays free, so the full ring is not seen as the empty one.
+    if (_head >= _tail)
+    {
+        if ((_rxRingSize - _head - ((_tail == 0) ? 1 : 0)) >= _needed)
+        {
+            _pos = _head;
+        }
+        else if (_tail > _needed)
+        {
+            // Continue from the beginning, mark the end (if there is room for the mark).
+            if ((_rxRingSize - _head) >= 2)
+            {
+                _rxRing[_head] = 0xFF;
+                _rxRing[_head + 1] = 0xFF;
+            }
+            _pos = 0;
+        }
+        else
+        {
+            _spiStats.rxDeferred++;
+            return false;
+        }
+    }
+    else if ((_tail - _head - 1) >= _needed)
+    {
+        _pos = _head;
+    }
+    else
+    {
+        _spiStats.rxDeferred++;
+        return false;
+    }
+
+    // Check the slave status, if must be INKPLATE_ESP32_SPI_SLAVE_STATUS_READABLE.
+    _spiBackground = true;
+    uint16_t _len = 0;
+    if (requestSlaveStatus(&_len) != INKPLATE_ESP32_SPI_SLAVE_STATUS_READABLE)
+    {
+        _spiBackground = false;
+        return false;
+    }
+
+    // Read the data right into the ring.
+    dataRead((char *)&_rxRing[_pos + 2], _len);
+    dataReadEnd();
+    _spiBackground = false;
+
+    // Drop it if it's the same frame as the last one.
+    if (_spiFrameDuplicated)
+        return true;
+
+    // Let the foreground have it.
+    _rxRing[_pos] = _len & 0xFF;
+    _rxRing[_pos + 1] = _len >> 8;
+    _head = _pos + _len + 2;
+    _rxRingHead = (_head >= _rxRingSize) ? 0 : _head;
+    _spiStats.rxBackgroundFrames++;
+
+    return true;
+}
+
+/**
+ * @brief   Helper method for locking the SPI for the foreground (background reception leaves the frames to the
+ *          foreground until it's unlocked). Locks can be nested.
+ *
+ */
+void WiFiClass::spiLock()
+{
+    _spiLock = _spiLock + 1;
+
+    // Clock drop requested by the background reception (ISR can't run now).
+    if (_spiClockDropPending)
+    {
+        _spiClockDropPending = false;
+        spiClockDrop();
+    }
+}
+
+/**
+ * @brief   Helper method for unlocking the SPI (see spiLock()).
+ *
+ */
+void WiFiClass::spiUnlock()
+{
+    _spiLock = _spiLock - 1;
+}
+
+/**
+ * @brief   Helper method for resetting the sequence numbers (modem has been restarted).
+ *
+ */
+void WiFiClass::resetSequence()
+{
+    _spiTxSeq = 0;
+    _spiRxSeq = 0;
+    _spiRxSeqValid = false;
+    _spiFrameDuplicated = false;
+}
+
+/**
+ * @brief   Helper method for sending the AT command once and classifying the result.
+ *
+ * @param   const char *_atCommand
+ *          AT command with CRLF at the end.
+ * @param   unsigned long _timeout
+ *          Max. time to wait for the result (in milliseconds).
+ * @param   const char *_expected
+ *          Result code that means success.
+ * @return  uint8_t
+ *          Result of the command (INKPLATE_ESP32_AT_RESULT_xxx).
+ */
+uint8_t WiFiClass::executeOnce(const char *_atCommand, unsigned long _timeout, const char *_expected)
+{
+    // Any SPI error from now is the protocol error.
+    uint32_t _errors = spiErrorCount();
+
+    // Modem did not accept the command.
+    if (!sendAtCommand((char *)_atCommand))
+        return (spiErrorCount() != _errors) ? INKPLATE_ESP32_AT_RESULT_PROTOCOL : INKPLATE_ESP32_AT_RESULT_TIMEOUT;
+
+    // Wait for the result.
+    if (waitForAtResult(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE, _timeout, _expected))
+        return INKPLATE_ESP32_AT_RESULT_OK;
+
+    // Find out why it failed.
+    if (_spiRxOverflow || (spiErrorCount() != _errors))
+        return INKPLATE_ESP32_AT_RESULT_PROTOCOL;
+    if (strstr(_dataBuffer, esp32AtBusyResponse) != NULL)
+        return INKPLATE_ESP32_AT_RESULT_BUSY;
+    if ((strstr(_dataBuffer, "ERROR\r\n") != NULL) || (strstr(_dataBuffer, "FAIL\r\n") != NULL))
+        return INKPLATE_ESP32_AT_RESULT_ERROR;
+
+    return INKPLATE_ESP32_AT_RESULT_TIMEOUT;
+}
+
+/**
+ * @brief   Helper method for getting the number of all SPI errors so far (link errors, lost and duplicated
+ *          frames, sequence resyncs and RX overflows).
+ *
+ * @return  uint32_t
+ *          Number of SPI errors.
+ */
+uint32_t WiFiClass::spiErrorCount()
+{
+    // Counters are also updated by the background reception.
+    spiLock();
+    uint32_t _errors = _spiLinkErrors + _spiStats.framesLost + _spiStats.framesDuplicated + _spiStats.seqResyncs +
+                       _spiStats.rxOverflows;
+    spiUnlock();
+
+    return _errors;
+}
+
+/**
+ * @brief   Helper method for updating the SPI statistics after each SPI packet.
+ *
+ * @param   uint8_t _cmd
+ *          ESP32 SPI command of the packet.
+ * @param   uint16_t _spiDataLen
+ *          length of the data part of the packet (in bytes).
+ * @param   uint32_t _cycles
+ *          Time spent in the transfer (CPU cycles or microseconds, see spiAtStatsTypedef).
+ */
+void WiFiClass::spiStatsUpdate(uint8_t _cmd, uint16_t _spiDataLen, uint32_t _cycles)
+{
+    _spiStats.packets++;
+
+    // Sort it by the direction of the data.
+    if (_cmd == INKPLATE_ESP32_SPI_CMD_MASTER_SEND)
+    {
+        _spiStats.txBytes += _spiDataLen;
+        _spiStats.txCycles += _cycles;
+    }
+    else if (_cmd == INKPLATE_ESP32_SPI_CMD_MASTER_READ_DATA)
+    {
+        _spiStats.rxBytes += _spiDataLen;
+        _spiStats.rxCycles += _cycles;
+    }
+    else
+    {
+        _spiStats.controlCycles += _cycles;
+    }
+}
+
+/**
+ * @brief   Helper method for adding the SPI packet to the trace. If there is no space in the trace,
+ *          the oldest records are removed.
+ *
+ * @param   spiAtCommandTypedef *_spiPacket
+ *          Pointer to the spiAtCommandTypedef to describe data packet.
+ * @param   uint16_t _spiDataLen
+ *          length of the data part only, excluding spiAtCommandTypedef (in bytes).
+ * @param   uint8_t _direction
+ *          INKPLATE_ESP32_SPI_TRACE_DIR_TX or INKPLATE_ESP32_SPI_TRACE_DIR_RX.
+ * @param   uint32_t _timestamp
+ *          Start of the SPI packet (in microseconds).
+ * @param   const struct spiAtSegmentTypedef *_segments
+ *          Segments with the data of the packet (NULL - data is in the packet).
+ * @param   uint8_t _segmentCount
+ *          Number of the segments.
+ */
+void WiFiClass::spiTraceRecord(spiAtCommandTypedef *_spiPacket, uint16_t _spiDataLen, uint8_t _direction,
+                               uint32_t _timestamp, const struct spiAtSegmentTypedef *_segments,
+                               uint8_t _segmentCount)
+{
+    // Captured part of the payload.
+    bool _hasData = (_spiPacket->data != NULL) || (_segments != NULL);
+    uint16_t _captureLen = (_spiDataLen < _traceCapture) ? _spiDataLen : _traceCapture;
+    if (!_hasData)
+        _captureLen = 0;
+    uint32_t _recordLen = INKPLATE_ESP32_SPI_TRACE_HEADER_SIZE + _captureLen;
+
+    // Record can't fit even in the empty trace? Drop it.
+    if (_recordLen > _traceSize)
+    {
+        _traceDropped++;
+        return;
+    }
+
+    // Remove the oldest records until there is enough space.
+    while ((_traceSize - _traceCount) < _recordLen)
+    {
+        // Captured length of the oldest record is at offset 5.
+        uint16_t _oldLen = _traceBuffer[(_traceTail + 5) % _traceSize] |
+                           (_traceBuffer[(_traceTail + 6) % _traceSize] << 8);
+        uint32_t _oldRecordLen = INKPLATE_ESP32_SPI_TRACE_HEADER_SIZE + _oldLen;
+        _traceTail = (_traceTail + _oldRecordLen) % _traceSize;
+        _traceCount -= _oldRecordLen;
+        _traceDropped++;
+    }
+
+    // Make the record header.
+    uint16_t _crc = 0xFFFF;
+    if (_segments != NULL)
+        _crc = esp32SpiSegmentsCrc(_segments, _segmentCount);
+    else if (_spiPacket->data != NULL)
+        _crc = esp32SpiTraceCrc(_spiPacket->data, _spiDataLen);
+    uint8_t _header[INKPLATE_ESP32_SPI_TRACE_HEADER_SIZE] = {
+        _spiPacket->cmd,
+        _spiPacket->addr,
+        _direction,
+        (uint8_t)(_spiDataLen & 0xFF),
+        (uint8_t)(_spiDataLen >> 8),
+        (uint8_t)(_captureLen & 0xFF),
+        (uint8_t)(_captureLen >> 8),
+        (uint8_t)(_crc & 0xFF),
+        (uint8_t)(_crc >> 8),
+        (uint8_t)(_timestamp & 0xFF),
+        (uint8_t)((_timestamp >> 8) & 0xFF),
+        (uint8_t)((_timestamp >> 16) & 0xFF),
+        (uint8_t)(_timestamp >> 24),
+    };
 
-    // Otherwise return true.
-    return true;
+    // Store the header and the captured payload.
+    spiTraceWrite(_header, sizeof(_header));
+    if ((_captureLen != 0) && (_segments == NULL))
+        spiTraceWrite(_spiPacket->data, _captureLen);
+
+    // Captured payload of the gathered data is taken from the segments.
+    for (uint8_t i = 0; (i < _segmentCount) && (_segments != NULL) && (_captureLen != 0); i++)
+    {
+        uint16_t _part = (_segments[i].len < _captureLen) ? _segments[i].len : _captureLen;
+        spiTraceWrite((const uint8_t *)_segments[i].data, _part);
+        _captureLen -= _part;
+    }
 }
 
 /**
- * @brief   Get ESP32 slave status. It is used right after the ESP32 sends handshake (ESP32 issues
- *          request from the master to read the data from the ESP32).
+ * @brief   Helper method for writing the data into the trace ring buffer (there must be enough space).
  *
+ * @param   const uint8_t *_data
+ *          Data to write.
  * @param   uint16_t _len
- *          Number of bytes requested waiting to be read by thje master from the ESP32.
- * @return  uint8_t
- *          Return slave status (INKPLATE_ESP32_SPI_SLAVE_STATUS_READABLE or
- *          INKPLATE_ESP32_SPI_SLAVE_STATUS_WRITEABLE).
+ *          Length of the data (in bytes).
  */
-uint8_t WiFiClass::requestSlaveStatus(uint16_t *_len)
+void WiFiClass::spiTraceWrite(const uint8_t *_data, uint16_t _len)
 {
-    // Make a union/struct for data part of the SPI Command.
-    union spiAtCommandsSlaveStatusTypedef _slaveStatus;
-    _slaveStatus.elements.status = 0;
-    _slaveStatus.elements.sequence = 0;
-    _slaveStatus.elements.length = 0;
-
-    // SPI Command Packet.
-    struct spiAtCommandTypedef _spiCommand = {
-        .cmd = INKPLATE_ESP32_SPI_CMD_REQ_SLAVE_INFO,
-        .addr = 0x04,
-        .dummy = 0x00,
-        .data = (uint8_t *)&(_slaveStatus.bytes),
-    };
+    // Copy it in two parts if it wraps around the end of the buffer.
+    uint32_t _firstPart = _traceSize - _traceHead;
+    if (_firstPart > _len)
+        _firstPart = _len;
 
-    uint32_t _spiPacketLen = sizeof(_slaveStatus.bytes);
-
-    // Transfer the packet!
-    transferSpiPacket(&_spiCommand, _spiPacketLen);
-
-    // Save the length if possible.
-    if (_len != NULL)
-        *_len = _slaveStatus.elements.length;
+    memcpy(_traceBuffer + _traceHead, _data, _firstPart);
+    memcpy(_traceBuffer, _data + _firstPart, _len - _firstPart);
 
-    // Return the slave status.
-    return _slaveStatus.elements.status;
+    _traceHead = (_traceHead + _len) % _traceSize;
+    _traceCount += _len;
 }
 
 /**
- * @brief   Send data to the ESP32 and at the same time receive new data from ESP32.
+ * @brief   Helper method for replaying one SPI packet from the trace instead of the SPI transfer.
  *
  * @param   spiAtCommandTypedef *_spiPacket
  *          Pointer to the spiAtCommandTypedef to describe data packet.
  * @param   uint16_t _spiDataLen
  *          length of the data part only, excluding spiAtCommandTypedef (in bytes).
+ * @param   uint8_t _direction
+ *          INKPLATE_ESP32_SPI_TRACE_DIR_TX or INKPLATE_ESP32_SPI_TRACE_DIR_RX.
+ * @param   const struct spiAtSegmentTypedef *_segments
+ *          Segments with the data of the sent packet (NULL - data is in the packet).
+ * @param   uint8_t _segmentCount
+ *          Number of the segments.
  */
-void WiFiClass::transferSpiPacket(spiAtCommandTypedef *_spiPacket, uint16_t _spiDataLen)
+void WiFiClass::spiReplayPacket(spiAtCommandTypedef *_spiPacket, uint16_t _spiDataLen, uint8_t _direction,
+                                const struct spiAtSegmentTypedef *_segments, uint8_t _segmentCount)
 {
-    // Get the SPI STM32 HAL Typedef Handle.
-    SPI_HandleTypeDef *_spiHandle = SPI.getHandle();
+    // Modem "does not respond" if the replay can't continue.
+    if ((_spiPacket->data != NULL) && (_direction == INKPLATE_ESP32_SPI_TRACE_DIR_RX))
+        memset(_spiPacket->data, 0, _spiDataLen);
 
-    // Activate ESP32 SPI lines by pulling CS pin to low.
-    HAL_GPIO_WritePin(GPIOF, GPIO_PIN_6, GPIO_PIN_RESET);
+    // End of the trace? Stop the replay.
+    if ((_replayPos + INKPLATE_ESP32_SPI_TRACE_HEADER_SIZE) > _replayLen)
+    {
+        spiReplayStop();
+        return;
+    }
 
-    // Send everything, but the data.
-    SPI.beginTransaction(_esp32AtSpiSettings);
-    SPI.transfer(_spiPacket->cmd);
-    SPI.transfer(_spiPacket->addr);
-    SPI.transfer(_spiPacket->dummy);
+    // Parse the record header.
+    const uint8_t *_record = _replayData + _replayPos;
+    uint16_t _len = _record[3] | (_record[4] << 8);
+    uint16_t _captureLen = _record[5] | (_record[6] << 8);
+    uint16_t _crc = _record[7] | (_record[8] << 8);
+    uint32_t _stamp = _record[9] | (_record[10] << 8) | ((uint32_t)_record[11] << 16) | ((uint32_t)_record[12] << 24);
 
-    // SPI.transfer(_spiPacket->data, _spiDataLen);
-    HAL_SPI_TransmitReceive(_spiHandle, (uint8_t *)_spiPacket->data, (uint8_t *)_spiPacket->data, _spiDataLen,
-                            HAL_MAX_DELAY);
-    SPI.endTransaction();
+    // Check if the application does the same thing as in the trace. If not, replay can't continue.
+    if ((_record[0] != _spiPacket->cmd) || (_record[2] != _direction) || (_len != _spiDataLen) ||
+        ((_replayPos + INKPLATE_ESP32_SPI_TRACE_HEADER_SIZE + _captureLen) > _replayLen))
+    {
+        _replayMismatches++;
+        spiReplayStop();
+        return;
+    }
 
-    // Disable ESP32 SPI lines by pulling CS pin to high.
-    HAL_GPIO_WritePin(GPIOF, GPIO_PIN_6, GPIO_PIN_SET);
+    // Keep the recorded timing if needed.
+    if (_replayRealTime)
+    {
+        while ((uint32_t)(micros() - _replayLastTime) < (uint32_t)(_stamp - _replayLastStamp))
+            ;
+    }
+    _replayLastStamp = _stamp;
+    _replayLastTime = micros();
+
+    if (_direction == INKPLATE_ESP32_SPI_TRACE_DIR_RX)
+    {
+        // Data from the modem is taken from the trace.
+        if (_spiPacket->data != NULL)
+            memcpy(_spiPacket->data, _record + INKPLATE_ESP32_SPI_TRACE_HEADER_SIZE, _captureLen);
+    }
+    else
+    {
+        // Data sent to the modem must be the same as in the trace.
+        if ((_segments != NULL) && (esp32SpiSegmentsCrc(_segments, _segmentCount) != _crc))
+            _replayMismatches++;
+        else if ((_segments == NULL) && (_spiPacket->data != NULL) &&
+                 (esp32SpiTraceCrc(_spiPacket->data, _spiDataLen) != _crc))
+            _replayMismatches++;
+    }
+
+    // Go to the next record and generate the handshake if the modem has something to read.
+    _replayPos += INKPLATE_ESP32_SPI_TRACE_HEADER_SIZE + _captureLen;
+    _esp32HandshakePinFlag = spiReplayHandshake();
 }
 
 /**
- * @brief   Method only sends SPI data to the ESP32.
+ * @brief   Helper method that checks if the next record in the replay is the status request (modem
+ *          requested it with the handshake when the trace was recorded).
  *
- * @param   spiAtCommandTypedef *_spiPacket
- *          Pointer to the spiAtCommandTypedef to describe data packet.
- * @param   uint16_t _spiDataLen
- *          length of the data part only, excluding spiAtCommandTypedef (in bytes).
+ * @return  bool
+ *          true - Next record is the status request.
+ *          false - It's not or the replay has ended.
  */
-void WiFiClass::sendSpiPacket(spiAtCommandTypedef *_spiPacket, uint16_t _spiDataLen)
+bool WiFiClass::spiReplayHandshake()
 {
-    // Get the SPI STM32 HAL Typedef Handle.
-    SPI_HandleTypeDef *_spiHandle = SPI.getHandle();
-
-    // Pack ESP32 SPI Packer Header data.
-    uint8_t _esp32SpiHeader[] = {_spiPacket->cmd, _spiPacket->addr, _spiPacket->dummy};
-
-    // Activate ESP32 SPI lines by pulling CS pin to low.
-    HAL_GPIO_WritePin(GPIOF, GPIO_PIN_6, GPIO_PIN_RESET);
-
-    // Send everything, but the data.
-    SPI.beginTransaction(_esp32AtSpiSettings);
-    HAL_SPI_Transmit(_spiHandle, _esp32SpiHeader, sizeof(_esp32SpiHeader) / sizeof(uint8_t), HAL_MAX_DELAY);
-
-    // Send data.
-    HAL_SPI_Transmit(_spiHandle, _spiPacket->data, _spiDataLen, HAL_MAX_DELAY);
-    SPI.endTransaction();
+    if ((_replayData == NULL) || ((_replayPos + INKPLATE_ESP32_SPI_TRACE_HEADER_SIZE) > _replayLen))
+        return false;
 
-    // Disable ESP32 SPI lines by pulling CS pin to high.
-    HAL_GPIO_WritePin(GPIOF, GPIO_PIN_6, GPIO_PIN_SET);
+    return (_replayData[_replayPos] == INKPLATE_ESP32_SPI_CMD_REQ_SLAVE_INFO);
 }
 
 /**
- * @brief   Send data to the ESP32.
+ * @brief   Send data to the ESP32. Data is gathered from the segments straight into the SPI packets (max. 4092
+ *          bytes each), without copying it.
  *
- * @param   char *_dataBuffer
- *          Pointer to the data buffer.
- * @param   uint32_t _len
- *          length of the data (in bytes).
+ * @param   const struct spiAtSegmentTypedef *_segments
+ *          Segments of the data.
+ * @param   uint8_t _count
+ *          Number of the segments (max. INKPLATE_ESP32_SPI_MAX_SEGMENTS).
  * @return  bool
  *          true - Data sent successfully.
  */
-bool WiFiClass::dataSend(char *_dataBuffer, uint32_t _len)
+bool WiFiClass::dataSend(const struct spiAtSegmentTypedef *_segments, uint8_t _count)
 {
     // Before sending data:
     // 1. Make a request for data send
     // 2. Read and check slave status - It should return with INKPLATE_ESP32_SPI_SLAVE_STATUS_WRITEABLE.
 
-    // Calculate the number of chunks to send, since the max is 4092 bytes.
-    uint16_t _chunks = _len / INKPLATE_ESP32_SPI_MAX_MESAGE_DATA_BUFFER;
-    uint16_t _lastChunk = _chunks ? _len % INKPLATE_ESP32_SPI_MAX_MESAGE_DATA_BUFFER : _len;
-
-    // Address offset for the data packet.
-    uint32_t _dataPacketAddrOffset = 0;
-
-    // Create an data packet for data send.
+    // Create an data packet for data send. Data comes from the segments.
     struct spiAtCommandTypedef _spiDataSend = {
-        .cmd = INKPLATE_ESP32_SPI_CMD_MASTER_SEND, .addr = 0x00, .dummy = 0x00, .data = (uint8_t *)(_dataBuffer)};
+        .cmd = INKPLATE_ESP32_SPI_CMD_MASTER_SEND, .addr = 0x00, .dummy = 0x00, .data = NULL};
 
-    // Go trough the chunks.
-    while (_chunks--)
-    {
-        // Calculate the chunk size.
-        uint16_t _chunkSize = _chunks != 0 ? INKPLATE_ESP32_SPI_MAX_MESAGE_DATA_BUFFER : _lastChunk;
+    // Segments of one SPI packet (parts of the segments of the data) and the position in the data.
+    struct spiAtSegmentTypedef _packet[INKPLATE_ESP32_SPI_MAX_SEGMENTS];
+    uint8_t _segment = 0;
+    uint16_t _segmentOffset = 0;
 
-        // Transfer the data!
-        sendSpiPacket(&_spiDataSend, _chunkSize);
+    // Send at least one packet (even the empty one).
+    do
+    {
+        uint16_t _packetLen = 0;
+        uint8_t _packetCount = 0;
 
-        // Update the address position.
-        _dataPacketAddrOffset += _chunkSize;
+        // Fill the packet with the next parts of the segments.
+        while ((_segment < _count) && (_packetLen < INKPLATE_ESP32_SPI_MAX_MESAGE_DATA_BUFFER))
+        {
+            uint16_t _part = _segments[_segment].len - _segmentOffset;
+            if (_part > (INKPLATE_ESP32_SPI_MAX_MESAGE_DATA_BUFFER - _packetLen))
+                _part = INKPLATE_ESP32_SPI_MAX_MESAGE_DATA_BUFFER - _packetLen;
 
-        // Update the SPI ESP32 packer header.
-        _spiDataSend.data = (uint8_t *)(_dataBuffer + _chunkSize);
+            if (_part != 0)
+            {
+                _packet[_packetCount].data = (const uint8_t *)_segments[_segment].data + _segmentOffset;
+                _packet[_packetCount].len = _part;
+                _packetCount++;
+                _packetLen += _part;
+            }
 
-        // Data end cmd? Don't know...Needs to be checked!
-    }
+            // Go to the next segment when this one is done.
+            _segmentOffset += _part;
+            if (_segmentOffset == _segments[_segment].len)
+            {
+                _segment++;
+                _segmentOffset = 0;
+            }
+        }
 
-    // Write the last one chunk (or the only one if the _len < 4092).
-    sendSpiPacket(&_spiDataSend, _lastChunk);
+        // Transfer the data!
+        sendSpiPacket(&_spiDataSend, _packetLen, _packet, _packetCount);
+    } while (_segment < _count);
 
     // Return true for success.
     return true;
@@ -1210,13 +4160,35 @@ bool WiFiClass::dataSendRequest(uint16_t _len, uint8_t _seqNumber)
  * @note    Timeout for the reponse is 5 seconds.
  */
 bool WiFiClass::isModemReady()
+{
+    // Modem has just started, sequence numbers start from the beginning. Frames read in the background are
+    // not valid anymore and "ready" must be read here.
+    spiLock();
+    resetSequence();
+    _rxRingTail = _rxRingHead;
+    _rxHeldLen = 0;
+    bool _ready = isModemReadyMessage();
+    spiUnlock();
+
+    return _ready;
+}
+
+/**
+ * @brief   Helper method for isModemReady(). Waits for the "ready" message from the modem.
+ *
+ * @return  bool
+ *          true - ESP32 sent "ready".
+ *          false - ESP32 did not respond with "ready" message.
+ */
+bool WiFiClass::isModemReadyMessage()
 {
     if (waitForHandshakePinInt(5000ULL))
     {
         // Check for the request, since the Handshake pin is high.
         // Also get the data length.
         uint16_t _dataLen = 0;
-        if (requestSlaveStatus(&_dataLen) == INKPLATE_ESP32_SPI_SLAVE_STATUS_READABLE)
+        if ((requestSlaveStatus(&_dataLen) == INKPLATE_ESP32_SPI_SLAVE_STATUS_READABLE) &&
+            (_dataLen < INKPLATE_ESP32_AT_CMD_BUFFER_SIZE))
         {
             // Ok, now try to read the data. First fill the ESP32 read packet
             dataRead(_dataBuffer, _dataLen);
@@ -1264,13 +4236,14 @@ bool WiFiClass::isModemReady()
 bool WiFiClass::wiFiModemInit(bool _status)
 {
     // Create a AT Commands String depending on the WiFi Initialization status.
-    sprintf(_dataBuffer, "AT+CWINIT=%d\r\n", _status);
+    AtCommandBuilder _cmd(_dataBuffer, sizeof(_dataBuffer));
+    _cmd.add("AT+CWINIT=").addUInt(_status ? 1 : 0).end();
 
     // Send AT command to the modem.
-    sendAtCommand(_dataBuffer);
+    sendAtCommand(_cmd);
 
     // Wait for the response.
-    if (!getAtResponse(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE, 250ULL))
+    if (!getAtResponseAdaptive(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE, INKPLATE_ESP32_TIMEOUT_INIT))
         return false;
 
     // Parse it. Check for the OK string.
@@ -1302,7 +4275,7 @@ bool WiFiClass::parseFoundNetworkData(int8_t _ssidNumber, int8_t *_lastUsedSsidN
         return true;
 
     // If not, check for the SSID number.
-    if (_ssidNumber > _foundWiFiAp)
+    if ((_ssidNumber < 0) || (_ssidNumber >= _foundWiFiAp))
         return false;
 
     // Try to parse it!
@@ -1365,5 +4338,503 @@ IPAddress WiFiClass::ipAddressParse(char *_ipAddressType)
     return IPAddress(_ipAddress[0], _ipAddress[1], _ipAddress[2], _ipAddress[3]);
 }
 
+/**
+ * @brief   Helper method for finding the host in the DNS cache. Expired entries are invalidated.
+ *
+ * @param   const char *_host
+ *          Host name.
+ * @return  int
+ *          Index of the valid cache entry for the host, -1 if not found.
+ */
+int WiFiClass::dnsCacheFind(const char *_host)
+{
+    for (int i = 0; i < INKPLATE_ESP32_DNS_CACHE_SIZE; i++)
+    {
+        // Skip empty entries and other hosts.
+        if (!_dnsCache[i].valid || (strcmp(_dnsCache[i].host, _host) != 0))
+            continue;
+
+        // Found it, but check if it's still valid. If not, remove it from the cache.
+        if ((unsigned long)(millis() - _dnsCache[i].resolvedAt) >= _dnsCacheTtl)
+        {
+            _dnsCache[i].valid = false;
+            return -1;
+        }
+
+        return i;
+    }
+
+    // Host is not in the cache.
+    return -1;
+}
+
+/**
+ * @brief   Helper method for storing the resolved host into the DNS cache. If the host is already
+ *          in the cache, entry is refreshed. Otherwise, free or least recently used entry is used.
+ *
+ * @param   const char *_host
+ *          Host name.
+ * @param   IPAddress _ip
+ *          Resolved IP Address of the host.
+ */
+void WiFiClass::dnsCacheStore(const char *_host, IPAddress _ip)
+{
+    // Index of the entry that will be used.
+    int _index = -1;
+
+    // Same host already in the cache? Refresh its entry.
+    for (int i = 0; i < INKPLATE_ESP32_DNS_CACHE_SIZE; i++)
+    {
+        if (_dnsCache[i].valid && (strcmp(_dnsCache[i].host, _host) == 0))
+        {
+            _index = i;
+            break;
+        }
+    }
+
+    // Otherwise use the free entry or the least recently used one.
+    if (_index < 0)
+    {
+        _index = 0;
+        for (int i = 0; i < INKPLATE_ESP32_DNS_CACHE_SIZE; i++)
+        {
+            if (!_dnsCache[i].valid)
+            {
+                _index = i;
+                break;
+            }
+
+            if ((long)(_dnsCache[i].lastUsed - _dnsCache[_index].lastUsed) < 0)
+                _index = i;
+        }
+    }
+
+    // Fill the entry.
+    strncpy(_dnsCache[_index].host, _host, INKPLATE_ESP32_DNS_CACHE_HOST_LEN - 1);
+    _dnsCache[_index].host[INKPLATE_ESP32_DNS_CACHE_HOST_LEN - 1] = '\0';
+    for (int i = 0; i < 4; i++)
+    {
+        _dnsCache[_index].ip[i] = _ip[i];
+    }
+    _dnsCache[_index].resolvedAt = millis();
+    _dnsCache[_index].lastUsed = _dnsCache[_index].resolvedAt;
+    _dnsCache[_index].valid = true;
+}
+
+/**
+ * @brief   Helper method that removes incoming link data ("+IPD,<link ID>,<len>:<data>") from the
+ *          received packet and moves it into the receive queue of the link. Everything else stays in
+ *          the packet. Parser keeps its state between the packets, since the data can be split into
+ *          multiple SPI packets. It also checks for the "<link ID>,CLOSED" message.
+ *
+ * @param   char *_data
+ *          Pointer to the received packet. It will be overwritten with the data without "+IPD".
+ * @param   uint16_t _len
+ *          Length of the received packet (in bytes).
+ * @param   uint32_t _size
+ *          Size of the buffer of the packet (in bytes, counting the null-terminating char).
+ * @return  uint16_t
+ *          New length of the packet.
+ */
+uint16_t WiFiClass::demuxIpd(char *_data, uint16_t _len, uint32_t _size)
+{
+    // Write position for the data that stays in the packet.
+    uint16_t _out = 0;
+
+    // Start of the "+IPD," at the end of the previous packet goes in front of this one, so it's checked again
+    // with the rest of it (and put back into the text if it's not the "+IPD,").
+    if ((_ipdState == INKPLATE_ESP32_IPD_STATE_SCAN) && (_ipdHeaderLen != 0))
+    {
+        if (((uint32_t)_len + _ipdHeaderLen) < _size)
+        {
+            memmove(_data + _ipdHeaderLen, _data, _len);
+            memcpy(_data, _ipdHeader, _ipdHeaderLen);
+            _len += _ipdHeaderLen;
+        }
+        else
+        {
+            _spiStats.rxDroppedBytes += _ipdHeaderLen;
+            _spiRxOverflow = true;
+        }
+        _ipdHeaderLen = 0;
+    }
+
+    for (uint16_t i = 0; i < _len; i++)
+    {
+        char _c = _data[i];
+
+        switch (_ipdState)
+        {
+        case INKPLATE_ESP32_IPD_STATE_SCAN:
+            // Still matches the "+IPD,"?
+            if (_c == esp32AtLinkIpd[_ipdHeaderLen])
+            {
+                _ipdHeader[_ipdHeaderLen++] = _c;
+
+                // Found it, now get the link ID and the length.
+                if (_ipdHeaderLen == (sizeof(esp32AtLinkIpd) - 1))
+                {
+                    _ipdState = INKPLATE_ESP32_IPD_STATE_HEADER;
+                    _ipdHeaderLen = 0;
+                }
+            }
+            else
+            {
+                // False alarm, put back what was kept (it's always from this packet).
+                for (uint8_t j = 0; j < _ipdHeaderLen; j++)
+                    _data[_out++] = _ipdHeader[j];
+                _ipdHeaderLen = 0;
+
+                // It can be the start of the new "+IPD,".
+                if (_c == esp32AtLinkIpd[0])
+                {
+                    _ipdHeader[_ipdHeaderLen++] = _c;
+                }
+                else
+                {
+                    _data[_out++] = _c;
+                }
+            }
+            break;
+
+        case INKPLATE_ESP32_IPD_STATE_HEADER:
+            if (_c == ':')
+            {
+                // End of the header. Parse it.
+                int _linkId = 0;
+                int _ipdLen = 0;
+                _ipdHeader[_ipdHeaderLen] = '\0';
+                _ipdHeaderLen = 0;
+
+                if ((sscanf(_ipdHeader, "%d,%d", &_linkId, &_ipdLen) == 2) && (_linkId >= 0) &&
+                    (_linkId < INKPLATE_ESP32_MAX_LINKS) && (_ipdLen > 0))
+                {
+                    struct spiAtLinkTypedef *_link = &_links[_linkId];
+
+                    // Data on the unknown link (or on the closed one that has not been released yet) is the new
+                    // connection to the server ("CONNECT" could be missed).
+                    if ((!_link->used || (_link->accepted && !_link->connected)) && _serverEnabled)
+                        linkAccept(_linkId);
+
+                    _ipdLinkId = _linkId;
+                    _ipdRemaining = _ipdLen;
+                    _ipdState = INKPLATE_ESP32_IPD_STATE_PAYLOAD;
+                    _ipdDiscard = !_link->used;
+
+                    // Datagram is kept only if it fits completely, otherwise it's dropped as a whole.
+                    if (_link->used && _link->datagram)
+                    {
+                        if ((_link->rxPacketCount == INKPLATE_ESP32_LINK_MAX_PACKETS) ||
+                            (_ipdLen > (INKPLATE_ESP32_LINK_RX_BUFFER_SIZE - _link->rxCount)))
+                        {
+                            _link->rxDropped += _ipdLen;
+                            _ipdDiscard = true;
+                        }
+                        else
+                        {
+                            _link->rxPacketLen[_link->rxPacketHead] = _ipdLen;
+                            _link->rxPacketHead = (_link->rxPacketHead + 1) % INKPLATE_ESP32_LINK_MAX_PACKETS;
+                            _link->rxPacketCount++;
+                        }
+                    }
+                }
+                else
+                {
+                    _ipdState = INKPLATE_ESP32_IPD_STATE_SCAN;
+                }
+            }
+            else if (_ipdHeaderLen < (sizeof(_ipdHeader) - 1))
+            {
+                _ipdHeader[_ipdHeaderLen++] = _c;
+            }
+            else
+            {
+                // Header too long, something is wrong. Start over.
+                _ipdState = INKPLATE_ESP32_IPD_STATE_SCAN;
+                _ipdHeaderLen = 0;
+            }
+            break;
+
+        case INKPLATE_ESP32_IPD_STATE_PAYLOAD:
+        {
+            // Move as much data as possible from this packet at once.
+            uint16_t _chunkSize = _len - i;
+            if (_chunkSize > _ipdRemaining)
+                _chunkSize = _ipdRemaining;
+
+            if (!_ipdDiscard)
+                linkRxWrite(_ipdLinkId, _data + i, _chunkSize);
+
+            _ipdRemaining -= _chunkSize;
+            i += _chunkSize - 1;
+
+            // All data received? Look for the next one.
+            if (_ipdRemaining == 0)
+                _ipdState = INKPLATE_ESP32_IPD_STATE_SCAN;
+            break;
+        }
+        }
+    }
+
+    // Check for closed connections and new connections to the server in the rest of the packet.
+    linkEventScan(_data, _out);
+
+    // Return the new length.
+    return _out;
+}
+
+/**
+ * @brief   Helper method for checking if the received packet must go trough the "+IPD" parser. It's used only on
+ *          the link data path (poll() and the link commands), so the responses of the other commands (for
+ *          example the HTTP data in the pass-trough mode) are never changed. Data of the "+IPD" that is
+ *          already started is always moved into the link queue.
+ *
+ * @return  bool
+ *          true - Use the parser.
+ *          false - Packet stays as it is.
+ */
+bool WiFiClass::ipdDemuxActive()
+{
+    return _linkMuxEnabled &&
+           (_ipdDemux || (_ipdState != INKPLATE_ESP32_IPD_STATE_SCAN) || (_ipdHeaderLen != 0));
+}
+
+/**
+ * @brief   Helper method for checking the text of the received packets for the link events ("<link ID>,CLOSED"
+ *          and "<link ID>,CONNECT"). End of the text is kept, so the events split between the packets are found
+ *          too.
+ *
+ * @param   const char *_text
+ *          Text of the packet (without the link data).
+ * @param   uint16_t _len
+ *          Length of the text (in bytes).
+ */
+void WiFiClass::linkEventScan(const char *_text, uint16_t _len)
+{
+    uint8_t _closedLen = sizeof(esp32AtLinkClosed) - 1;
+    uint8_t _connectLen = sizeof(esp32AtLinkConnect) - 1;
+
+    for (uint16_t i = 0; i < _len; i++)
+    {
+        // Keep the last chars (enough for the longest event with the link ID).
+        if (_linkEventLen == sizeof(_linkEventTail))
+        {
+            memmove(_linkEventTail, _linkEventTail + 1, sizeof(_linkEventTail) - 1);
+            _linkEventLen--;
+        }
+        _linkEventTail[_linkEventLen++] = _text[i];
+
+        // Events end with the new line.
+        if (_text[i] != '\n')
+            continue;
+
+        if ((_linkEventLen > _closedLen) &&
+            (memcmp(_linkEventTail + _linkEventLen - _closedLen, esp32AtLinkClosed, _closedLen) == 0))
+        {
+            int _linkId = _linkEventTail[_linkEventLen - _closedLen - 1] - '0';
+            if ((_linkId >= 0) && (_linkId < INKPLATE_ESP32_MAX_LINKS))
+                _links[_linkId].connected = false;
+        }
+        else if ((_linkEventLen > _connectLen) &&
+                 (memcmp(_linkEventTail + _linkEventLen - _connectLen, esp32AtLinkConnect, _connectLen) == 0))
+        {
+            // Modem gives the link ID of the closed connection to the new one, even if it has not been released
+            // here yet. Data of the old connection is dropped, the new one starts from the empty queues.
+            int _linkId = _linkEventTail[_linkEventLen - _connectLen - 1] - '0';
+            if ((_linkId >= 0) && (_linkId < INKPLATE_ESP32_MAX_LINKS) && _serverEnabled &&
+                (!_links[_linkId].used || (_links[_linkId].accepted && !_links[_linkId].connected)))
+                linkAccept(_linkId);
+        }
+    }
+}
+
+/**
+ * @brief   Helper method for adding received data into the receive queue of the link. If the queue is
+ *          full, the rest of the data is dropped (and counted).
+ *
+ * @param   int _linkId
+ *          Link ID of the connection.
+ * @param   const char *_data
+ *          Pointer to the received data.
+ * @param   uint16_t _len
+ *          Length of the received data (in bytes).
+ */
+void WiFiClass::linkRxWrite(int _linkId, const char *_data, uint16_t _len)
+{
+    struct spiAtLinkTypedef *_link = &_links[_linkId];
+
+    for (uint16_t i = 0; i < _len; i++)
+    {
+        // No more space? Drop the rest.
+        if (_link->rxCount == INKPLATE_ESP32_LINK_RX_BUFFER_SIZE)
+        {
+            _link->rxDropped += _len - i;
+            break;
+        }
+
+        _link->rxBuffer[_link->rxHead] = _data[i];
+        _link->rxHead = (_link->rxHead + 1) % INKPLATE_ESP32_LINK_RX_BUFFER_SIZE;
+        _link->rxCount++;
+    }
+}
+
+/**
+ * @brief   Helper method for sending the data on the link (AT+CIPSEND). Waits for the prompt, sends the
+ *          data and waits for the "SEND OK".
+ *
+ * @param   int _linkId
+ *          Link ID of the connection.
+ * @param   const char *_data
+ *          Pointer to the data.
+ * @param   uint16_t _len
+ *          Length of the data (in bytes).
+ * @param   const char *_host
+ *          Remote host (only for UDP). Use NULL for the default one.
+ * @param   uint16_t _port
+ *          Remote port (only for UDP, used with the remote host).
+ * @return  bool
+ *          true - Data has been sent.
+ *          false - Send failed.
+ */
+bool WiFiClass::linkSend(int _linkId, const char *_data, uint16_t _len, const char *_host, uint16_t _port)
+{
+    // Data in one piece is one segment.
+    struct spiAtSegmentTypedef _segment = {_data, _len};
+
+    return linkSend(_linkId, &_segment, 1, _host, _port);
+}
+
+/**
+ * @brief   Helper method for sending the data gathered from the segments on the link (one AT+CIPSEND for all
+ *          of them). Waits for the prompt, sends the data and waits for the "SEND OK".
+ *
+ * @param   int _linkId
+ *          Link ID of the connection.
+ * @param   const struct spiAtSegmentTypedef *_segments
+ *          Segments of the data.
+ * @param   uint8_t _count
+ *          Number of the segments (max. INKPLATE_ESP32_SPI_MAX_SEGMENTS).
+ * @param   const char *_host
+ *          Remote host (only for UDP). Use NULL for the default one.
+ * @param   uint16_t _port
+ *          Remote port (only for UDP, used with the remote host).
+ * @return  bool
+ *          true - Data has been sent.
+ *          false - Send failed.
+ */
+bool WiFiClass::linkSend(int _linkId, const struct spiAtSegmentTypedef *_segments, uint8_t _count,
+                         const char *_host, uint16_t _port)
+{
+    // Check for user mistake (null-pointer!).
+    if ((_segments == NULL) || (_count == 0) || (_count > INKPLATE_ESP32_SPI_MAX_SEGMENTS))
+        return false;
+
+    // Length of all segments together.
+    uint32_t _len = 0;
+    for (uint8_t i = 0; i < _count; i++)
+        _len += _segments[i].len;
+
+    // Create AT Command string. Add remote host and port for UDP if needed.
+    AtCommandBuilder _cmd(_dataBuffer, sizeof(_dataBuffer));
+    _cmd.add(esp32AtLinkSend).addUInt(_linkId).add(",").addUInt(_len);
+    if (_host != NULL)
+        _cmd.add(",").addQuoted(_host).add(",").addUInt(_port);
+    _cmd.end();
+
+    // Data of the other links can come in between, so it goes into their queues.
+    bool _demux = _ipdDemux;
+    _ipdDemux = true;
+
+    // Send the command, wait for the prompt, send the data itself and wait for it to be sent.
+    bool _retValue = sendAtCommand(_cmd) &&
+                     waitForAtResult(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE, 1000ULL, esp32AtLinkSendPrompt) &&
+                     sendAtData(_segments, _count) &&
+                     waitForAtResult(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE, 5000ULL, esp32AtLinkSendOk);
+
+    _ipdDemux = _demux;
+
+    return _retValue;
+}
+
+/**
+ * @brief   Helper method for releasing the link ID and clearing its queues.
+ *
+ * @param   int _linkId
+ *          Link ID of the connection.
+ */
+void WiFiClass::linkReset(int _linkId)
+{
+    struct spiAtLinkTypedef *_link = &_links[_linkId];
+
+    _link->used = false;
+    _link->connected = false;
+    _link->rxHead = 0;
+    _link->rxTail = 0;
+    _link->rxCount = 0;
+    _link->rxDropped = 0;
+    _link->datagram = false;
+    _link->rxPacketHead = 0;
+    _link->rxPacketTail = 0;
+    _link->rxPacketCount = 0;
+    _link->txHead = 0;
+    _link->txTail = 0;
+    _link->txCount = 0;
+    _link->handshakeTime = 0;
+    _link->accepted = false;
+}
+
+/**
+ * @brief   Helper method for taking the link ID of the new connection to the server.
+ *
+ * @param   int _linkId
+ *          Link ID of the connection.
+ */
+void WiFiClass::linkAccept(int _linkId)
+{
+    linkReset(_linkId);
+    _links[_linkId].used = true;
+    _links[_linkId].connected = true;
+    _links[_linkId].accepted = true;
+    _links[_linkId].session++;
+}
+
+/**
+ * @brief   Helper method for setting the TLS settings of the SSL link before the connection. Settings stay on the
+ *          link in the modem, so they are set every time (link can be used by other host in the meantime).
+ *
+ * @param   int _linkId
+ *          Link ID of the connection.
+ * @param   const char *_host
+ *          Host name or IP Address of the remote host (used as the server name if not set in the TLS settings).
+ * @param   const struct spiAtTlsConfigTypedef *_tls
+ *          TLS settings (NULL - no certificate check).
+ * @return  bool
+ *          true - Settings applied.
+ *          false - Command failed.
+ */
+bool WiFiClass::linkTlsSetup(int _linkId, const char *_host, const struct spiAtTlsConfigTypedef *_tls)
+{
+    // Set the authentication mode. Certificates are needed only if something is checked.
+    AtCommandBuilder _cmd(_dataBuffer, sizeof(_dataBuffer));
+    uint8_t _authMode = (_tls != NULL) ? _tls->authMode : INKPLATE_ESP32_TLS_AUTH_NONE;
+    _cmd.add(esp32AtLinkSslConfig).addUInt(_linkId).add(",").addUInt(_authMode);
+    if (_authMode != INKPLATE_ESP32_TLS_AUTH_NONE)
+        _cmd.add(",").addUInt(_tls->pkiNumber).add(",").addUInt(_tls->caNumber);
+    _cmd.end();
+
+    if (!execute(_cmd, 1000ULL))
+        return false;
+
+    // Set the server name. IP Address is not a valid server name, so there is nothing to send.
+    const char *_sni = ((_tls != NULL) && (_tls->sni != NULL)) ? _tls->sni : _host;
+    if (_sni[strspn(_sni, "0123456789.")] == '\0')
+        return true;
+
+    _cmd.reset();
+    _cmd.add(esp32AtLinkSslSni).addUInt(_linkId).add(",").addQuoted(_sni).end();
+
+    return execute(_cmd, 1000ULL);
+}
+
 // Decalre WiFi class to be globally available and visable.
 WiFiClass WiFi;
\ No newline at end of file
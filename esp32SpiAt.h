@@ -17,11 +17,48 @@
 // Include file with all AT Commands.
 #include "esp32SpiAtAllCommands.h"
 
+// Include AT command builder (used instead of sprintf for the AT commands with parameters).
+#include "esp32SpiAtCommandBuilder.h"
+
+// Include C++20 coroutine support (only available with -std=gnu++20).
+#include "esp32SpiAtCoroutine.h"
+
+// Modem class and the default modem object, so the clients can be bound to the modem (default is WiFi).
+class WiFiClass;
+extern WiFiClass WiFi;
+
+// Include pipelined executor for the batches of AT commands.
+#include "esp32SpiAtPipeline.h"
+
 // Include HTTP class for ESP32 AT Commands.
 #include "esp32SpiAtHttp.h"
 
-// Data buffer for AT Commands (in bytes).
-#define INKPLATE_ESP32_AT_CMD_BUFFER_SIZE 8192ULL
+// Include verified download into the storage (over HTTP).
+#include "esp32SpiAtDownload.h"
+
+// Include streaming image decoder (BMP and PNG from WiFiClient into the framebuffer).
+#include "esp32SpiAtImage.h"
+
+// Include HTTP server on the TCP server of the modem.
+#include "esp32SpiAtServer.h"
+
+// Include TCP/SSL socket class for ESP32 AT Commands.
+#include "esp32SpiAtSocket.h"
+
+// Include UDP class for ESP32 AT Commands.
+#include "esp32SpiAtUdp.h"
+
+// Include MQTT class for ESP32 AT Commands.
+#include "esp32SpiAtMqtt.h"
+
+// Include WebSocket client for ESP32 AT Commands.
+#include "esp32SpiAtWebSocket.h"
+
+// Include SNTP time class for ESP32 AT Commands.
+#include "esp32SpiAtTime.h"
+
+// Include I/O task for the thread-safe mode (only with INKPLATE_ESP32_THREAD_SAFE).
+#include "esp32SpiAtIoTask.h"
 
 // GPIO pin for the ESP32 Power Supply Switch.
 #define INKPLATE_ESP32_PWR_SWITCH_PIN PG9
@@ -33,23 +70,73 @@
 #define INKPLATE_ESP32_CS_PIN        PF6
 #define INKPLATE_ESP32_HANDSHAKE_PIN PA15
 
+// Sink for the part of the response that does not fit into the buffer (see WiFiClass::setOverflowPolicy()).
+typedef void (*spiAtOverflowSink)(const char *_data, uint32_t _len);
+
 // Create class for the AT commands over SPI
 
 class WiFiClass
 {
   public:
     WiFiClass();
+    WiFiClass(SPIClass &_spiBus, uint32_t _csPin, uint32_t _handshakePin, uint32_t _pwrPin, uint32_t _misoPin,
+              uint32_t _mosiPin, uint32_t _sckPin);
 
     // Public ESP32-C3 system functions.
     bool init();
     bool power(bool _en);
     bool sendAtCommand(char *_atCommand);
+    bool sendAtCommand(AtCommandBuilder &_atCommand);
+    bool sendAtData(const char *_data, uint16_t _len);
+    bool sendAtData(const struct spiAtSegmentTypedef *_segments, uint8_t _count);
     bool getAtResponse(char *_response, uint32_t _bufferLen, unsigned long _timeout);
     bool getSimpleAtResponse(char *_response, uint32_t _bufferLen, unsigned long _timeout, uint16_t *_rxLen = NULL);
+    bool waitForAtResult(char *_response, uint32_t _bufferLen, unsigned long _timeout,
+                         const char *_expected = esp32AtCmdResponseOK);
+    int8_t pollAtResult(char *_response, uint32_t _bufferLen, uint32_t *_offset,
+                        const char *_expected = esp32AtCmdResponseOK, bool _hold = true);
+    int8_t pollFrame(char *_buffer, uint32_t _bufferLen, uint16_t *_len);
     bool modemPing();
     bool systemRestore();
     bool storeSettingsInNVM(bool _store);
     char *getDataBuffer();
+    void setSpiClock(uint32_t _clock);
+    uint32_t getSpiClock();
+    bool spiSelfTest(uint8_t _rounds = INKPLATE_ESP32_SPI_SELF_TEST_ROUNDS);
+    uint32_t spiAutoTune(uint32_t _maxClock = INKPLATE_ESP32_SPI_MAX_CLOCK);
+    uint32_t spiLinkErrors();
+    const struct spiAtStatsTypedef *getSpiStats();
+    void clearSpiStats();
+    void spiTraceStart(uint8_t *_buffer, uint32_t _size, uint16_t _maxCapture = INKPLATE_ESP32_SPI_TRACE_CAPTURE);
+    void spiTraceStop();
+    uint32_t spiTraceAvailable();
+    uint32_t spiTraceRead(uint8_t *_buffer, uint32_t _len);
+    uint32_t spiTraceDropped();
+    bool spiReplayStart(const uint8_t *_trace, uint32_t _len, bool _realTime = false);
+    void spiReplayStop();
+    bool spiReplayActive();
+    uint32_t spiReplayMismatches();
+    bool backgroundRxStart(uint8_t *_buffer, uint32_t _size);
+    void backgroundRxStop();
+    bool setOverflowPolicy(uint8_t _policy, spiAtOverflowSink _sink = NULL);
+
+    // Public command supervisor functions (retry with backoff and modem recovery).
+    bool execute(const char *_atCommand, unsigned long _timeout, const char *_expected = esp32AtCmdResponseOK);
+    bool execute(AtCommandBuilder &_atCommand, unsigned long _timeout, const char *_expected = esp32AtCmdResponseOK);
+    uint8_t lastResult();
+    bool resync();
+    bool recover();
+    const struct spiAtSupervisorStatsTypedef *getSupervisorStats();
+    void clearSupervisorStats();
+
+    // Public adaptive timeout functions (timeouts learned from the measured latency of each command type).
+    unsigned long timeout(uint8_t _type);
+    bool getTimeout(uint8_t _type, struct spiAtTimeoutTypedef *_timeout);
+    bool setTimeout(uint8_t _type, unsigned long _timeout);
+    void resetTimeouts();
+    bool getAtResponseAdaptive(char *_response, uint32_t _bufferLen, uint8_t _type, bool _responseExpected = true);
+    bool getSimpleAtResponseAdaptive(char *_response, uint32_t _bufferLen, uint8_t _type, uint16_t *_rxLen = NULL,
+                                     bool _responseExpected = true);
 
     // Public ESP32 WiFi Functions.
     bool setMode(uint8_t _wifiMode);
@@ -69,37 +156,238 @@ class WiFiClass
     bool config(IPAddress _staticIP = INADDR_NONE, IPAddress _gateway = INADDR_NONE, IPAddress _subnet = INADDR_NONE,
                 IPAddress _dns1 = INADDR_NONE, IPAddress _dns2 = INADDR_NONE);
 
+    // Public ESP32 DNS functions.
+    IPAddress resolve(const char *_host, bool _useCache = true);
+    void setDnsCacheTtl(unsigned long _ttl);
+    void clearDnsCache();
+
+    // Public ESP32 multiple connections (link ID) functions.
+    bool multipleConnections(bool _en);
+    int linkOpen(const char *_type, const char *_host, uint16_t _port, uint16_t _localPort = 0,
+                 uint8_t _udpMode = 0, const struct spiAtTlsConfigTypedef *_tls = NULL);
+    bool linkClose(int _linkId);
+    bool linkConnected(int _linkId);
+    int linkAvailable(int _linkId);
+    int linkRead(int _linkId, char *_buffer, uint16_t _len);
+    int linkWrite(int _linkId, const char *_data, uint16_t _len);
+    bool linkFlush(int _linkId, unsigned long _timeout);
+    bool linkSendTo(int _linkId, const char *_data, uint16_t _len, const char *_host = NULL, uint16_t _port = 0);
+    bool linkSendTo(int _linkId, const struct spiAtSegmentTypedef *_segments, uint8_t _count, const char *_host = NULL,
+                    uint16_t _port = 0);
+    int linkNextPacket(int _linkId);
+    uint32_t linkDropped(int _linkId);
+    unsigned long linkHandshakeTime(int _linkId);
+    bool linkAccepted(int _linkId);
+    uint8_t linkSession(int _linkId);
+    bool serverBegin(uint16_t _port, uint16_t _timeout);
+    bool serverEnd();
+    void poll();
+
+#ifdef INKPLATE_ESP32_COROUTINES
+    // Public awaitable functions (co_await).
+    AtCommandAwaitable command(const char *_atCommand, unsigned long _timeout,
+                               const char *_expected = esp32AtCmdResponseOK);
+    AtCommandAwaitable command(AtCommandBuilder &_atCommand, unsigned long _timeout,
+                               const char *_expected = esp32AtCmdResponseOK);
+    AtFrameAwaitable frame(char *_buffer, uint32_t _bufferLen, unsigned long _timeout, const void *_owner = NULL);
+    AtLockAwaitable lock(const void *_owner);
+
+    // Only one await (or the task that took the modem with lock()) at the time can use the modem. Tasks release
+    // the modem with awaitUnlock(), otherwise it's used only by the awaitables.
+    bool awaitLock(const void *_owner);
+    void awaitUnlock(const void *_owner);
+#endif
+
+    // Called from the handshake ISR of this modem, do not call it directly.
+    void handshakeInterrupt();
+
   private:
     // ESP32 SPI Communication Protocol methods.
     bool waitForHandshakePin(uint32_t _timeoutValue, bool _validState = HIGH);
     bool waitForHandshakePinInt(uint32_t _timeoutValue);
-    uint8_t requestSlaveStatus(uint16_t *_len = NULL);
-    bool dataSend(char *_dataBuffer, uint32_t _len);
+    uint8_t requestSlaveStatus(uint16_t *_len = NULL, uint8_t *_seq = NULL);
+    bool dataSend(const struct spiAtSegmentTypedef *_segments, uint8_t _count);
     bool dataSendEnd();
     bool dataRead(char *_dataBuffer, uint16_t _len);
     bool dataReadEnd();
     bool dataSendRequest(uint16_t _len, uint8_t _seqNumber);
     void transferSpiPacket(spiAtCommandTypedef *_spiPacket, uint16_t _spiPacketLen);
-    void sendSpiPacket(spiAtCommandTypedef *_spiPacket, uint16_t _spiDataLen);
+    void sendSpiPacket(spiAtCommandTypedef *_spiPacket, uint16_t _spiDataLen,
+                       const struct spiAtSegmentTypedef *_segments = NULL, uint8_t _segmentCount = 0);
+    void spiStatsUpdate(uint8_t _cmd, uint16_t _spiDataLen, uint32_t _cycles);
+    bool spiLinkCheck(uint8_t _status, uint16_t _len);
+    void spiClockDrop();
+    void spiSequenceCheck(uint8_t _seq);
+    uint16_t readFrame(char *_buffer, uint32_t _bufferFree, uint16_t _len);
+    void resetSequence();
+    bool rxPending();
+    int8_t fetchFrame(char *_buffer, uint32_t _bufferLen, uint32_t *_offset, bool _hold = false);
+    bool backgroundRead();
+    IRQn_Type handshakeIrq();
+    void spiLock();
+    void spiUnlock();
+    uint8_t executeOnce(const char *_atCommand, unsigned long _timeout, const char *_expected);
+    uint32_t spiErrorCount();
+    void spiTraceRecord(spiAtCommandTypedef *_spiPacket, uint16_t _spiDataLen, uint8_t _direction,
+                        uint32_t _timestamp, const struct spiAtSegmentTypedef *_segments = NULL,
+                        uint8_t _segmentCount = 0);
+    void spiTraceWrite(const uint8_t *_data, uint16_t _len);
+    void spiReplayPacket(spiAtCommandTypedef *_spiPacket, uint16_t _spiDataLen, uint8_t _direction,
+                         const struct spiAtSegmentTypedef *_segments = NULL, uint8_t _segmentCount = 0);
+    bool spiReplayHandshake();
     // End of ESP32 SPI Communication Protocol methods.
 
     // Modem related methods.
     bool isModemReady();
+    bool isModemReadyMessage();
     bool wiFiModemInit(bool _status);
+    void timeoutSample(uint8_t _type, unsigned long _latency);
+    void timeoutExpired(uint8_t _type);
     bool parseFoundNetworkData(int8_t _ssidNumber, int8_t *_lastUsedSsidNumber, struct spiAtWiFiScanTypedef *_scanData);
     IPAddress ipAddressParse(char *_ipAddressType);
 
+    // DNS cache related methods.
+    int dnsCacheFind(const char *_host);
+    void dnsCacheStore(const char *_host, IPAddress _ip);
+
+    // Multiple connections related methods.
+    bool ipdDemuxActive();
+    uint16_t demuxIpd(char *_data, uint16_t _len, uint32_t _size);
+    void linkEventScan(const char *_text, uint16_t _len);
+    void linkRxWrite(int _linkId, const char *_data, uint16_t _len);
+    bool linkSend(int _linkId, const char *_data, uint16_t _len, const char *_host = NULL, uint16_t _port = 0);
+    bool linkSend(int _linkId, const struct spiAtSegmentTypedef *_segments, uint8_t _count, const char *_host = NULL,
+                  uint16_t _port = 0);
+    void linkReset(int _linkId);
+    void linkAccept(int _linkId);
+    bool linkTlsSetup(int _linkId, const char *_host, const struct spiAtTlsConfigTypedef *_tls);
+
+    // SPI bus and pins of this modem. Port and mask of the CS pin are used for the fast HAL access.
+    SPIClass *_spi;
+    uint32_t _csPin;
+    uint32_t _handshakePin;
+    uint32_t _pwrPin;
+    uint32_t _misoPin;
+    uint32_t _mosiPin;
+    uint32_t _sckPin;
+    GPIO_TypeDef *_csPort = NULL;
+    uint32_t _csPinMask = 0;
+
+    // SPI Settings for ESP32. Use SPI MODE0, MSBFIRST data transfet with approx. SPI clock rate of 20MHz.
+    SPISettings _esp32AtSpiSettings;
+    uint32_t _spiClock = INKPLATE_ESP32_SPI_CLOCK;
+
+    // Link errors (total and in a row) for the SPI clock fallback.
+    uint32_t _spiLinkErrors = 0;
+    uint8_t _spiLinkErrorsInRow = 0;
+
+    // Sequence numbers of the last sent (master) and received (slave) frame, duplicated frame flag and RX overflow
+    // flag of the current response.
+    uint8_t _spiTxSeq = 0;
+    uint8_t _spiRxSeq = 0;
+    bool _spiRxSeqValid = false;
+    bool _spiFrameDuplicated = false;
+    bool _spiRxOverflow = false;
+
+    // Command supervisor. Result of the last command, recovery flag (no recovery inside the recovery) and
+    // statistics.
+    uint8_t _lastResult = INKPLATE_ESP32_AT_RESULT_OK;
+    bool _recovering = false;
+    struct spiAtSupervisorStatsTypedef _supervisorStats;
+
+    // Adaptive timeouts of all command types, the longest gap between the parts of the last response read with
+    // getAtResponse() (in milliseconds) and if anything has been received at all.
+    struct spiAtTimeoutTypedef _timeouts[INKPLATE_ESP32_TIMEOUT_TYPES];
+    unsigned long _lastResponseGap = 0;
+    bool _lastResponseReceived = false;
+
+    // Session restored after the modem power cycle (WiFi mode and the last network used with begin()).
+    uint8_t _sessionMode = 0xFF;
+    char _sessionSsid[33] = {0};
+    char _sessionPass[65] = {0};
+
+    // Statistics of the SPI data path and the copy given to the user (see getSpiStats()).
+    struct spiAtStatsTypedef _spiStats;
+    struct spiAtStatsTypedef _spiStatsCopy;
+
+    // SPI trace recorder (ring buffer of the records, oldest ones are overwritten) and replay of the trace.
+    bool _traceRecording = false;
+    uint8_t *_traceBuffer = NULL;
+    uint32_t _traceSize = 0;
+    uint32_t _traceHead = 0;
+    uint32_t _traceTail = 0;
+    uint32_t _traceCount = 0;
+    uint32_t _traceDropped = 0;
+    uint16_t _traceCapture = 0;
+    const uint8_t *_replayData = NULL;
+    uint32_t _replayLen = 0;
+    uint32_t _replayPos = 0;
+    bool _replayRealTime = false;
+    uint32_t _replayLastStamp = 0;
+    uint32_t _replayLastTime = 0;
+    uint32_t _replayMismatches = 0;
+
+    // Flag for the handshake for the ESP32 (set from the ISR) and index of the ISR trampoline of this modem.
+    volatile bool _esp32HandshakePinFlag = false;
+
+    // Receive ring of the background reception (frames with 2 byte length, written by the ISR, read by the
+    // foreground) and the SPI lock (foreground transfer in progress, ISR must not use the SPI).
+    uint8_t *volatile _rxRing = NULL;
+    uint32_t _rxRingSize = 0;
+    volatile uint32_t _rxRingHead = 0;
+    volatile uint32_t _rxRingTail = 0;
+    volatile uint8_t _spiLock = 0;
+
+    // Frame is being read by the ISR, clock drop requested by it and the priority of the handshake interrupt
+    // before the background reception.
+    volatile bool _spiBackground = false;
+    volatile bool _spiClockDropPending = false;
+    uint32_t _handshakeIrqPriority = 0;
+
+    // Overflow policy, its sink and the frame held back by the backpressure (its status has already been read).
+    uint8_t _overflowPolicy = INKPLATE_ESP32_OVERFLOW_DROP;
+    spiAtOverflowSink _overflowSink = NULL;
+    uint16_t _rxHeldLen = 0;
+    bool _rxHeldDuplicated = false;
+    int8_t _modemIndex = -1;
+
     // Data buffer for the ESP32 SPI commands.
     char _dataBuffer[INKPLATE_ESP32_AT_CMD_BUFFER_SIZE];
 
     // Variables for WiFi Scan.
-    int16_t _startApindex[40];
+    int16_t _startApindex[INKPLATE_ESP32_MAX_SCAN_AP];
     uint8_t _foundWiFiAp = 0;
     int8_t _lastUsedSsid = -1;
     struct spiAtWiFiScanTypedef _lastUsedSsidData;
     char _invalidMac[18] = {"00:00:00:00:00:00"};
     // Array for storing parsed MAC address.
     char _esp32MacAddress[19];
+
+    // DNS cache for resolved host names (LRU replacement) and its time to live in milliseconds.
+    struct spiAtDnsCacheEntryTypedef _dnsCache[INKPLATE_ESP32_DNS_CACHE_SIZE];
+    unsigned long _dnsCacheTtl = INKPLATE_ESP32_DNS_CACHE_TTL;
+
+    // Multiple connections. Data queues for each link ID, server state (new connections are accepted), round-robin
+    // index for sending and state of the "+IPD" parser (incoming data can be split between SPI packets). Parser is
+    // used only on the link data path (see ipdDemuxActive()), the end of the text is kept for the link events.
+    struct spiAtLinkTypedef _links[INKPLATE_ESP32_MAX_LINKS];
+    bool _linkMuxEnabled = false;
+    bool _serverEnabled = false;
+    uint8_t _linkTxIndex = 0;
+    uint8_t _ipdState = INKPLATE_ESP32_IPD_STATE_SCAN;
+    char _ipdHeader[24];
+    uint8_t _ipdHeaderLen = 0;
+    int8_t _ipdLinkId = -1;
+    uint16_t _ipdRemaining = 0;
+    bool _ipdDiscard = false;
+    bool _ipdDemux = false;
+    char _linkEventTail[11];
+    uint8_t _linkEventLen = 0;
+
+#ifdef INKPLATE_ESP32_COROUTINES
+    // Await (or task) that is using the modem right now (responses and the data buffer are not shared).
+    const void *_awaitOwner = NULL;
+#endif
 };
 
 // For easier user usage of the WiFi functionallity.
@@ -10,6 +10,15 @@ static const char esp32AtCmdResponseOK[] = "\r\nOK\r\n";
 static const char esp32AtCmdResponseError[] = "\r\n\r\nERROR\r\n";
 static const char esp32AtCmdSystemRestore[] = "AT+RESTORE\r\n";
 static const char esp32AtCmdEscapeChar[] = {0x1B, 0x0D, 0x0A};
+// Enable and disable the echo of the AT commands (used by the SPI self test).
+static const char esp32AtEchoOn[] = "ATE1\r\n";
+static const char esp32AtEchoOff[] = "ATE0\r\n";
+// Modem is still busy with the previous command ("busy p..." or "busy s...").
+static const char esp32AtBusyResponse[] = "busy ";
+// Data pattern for the SPI self test (sent as an unknown AT command, the echo must be the same).
+static const char esp32AtSelfTestPattern[] = "U*3f~!Zev0U*3f~!Zev0U*3f~!Zev0U*3f~!Zev0U*3f~!Zev0U*3f~!Zev0";
+// Response on the unknown AT command.
+static const char esp32AtResponseError[] = "ERROR\r\n";
 
 // ESP32 WiFi Commands
 // ESP32 AT Command to disconnect from the AP.
@@ -24,5 +33,72 @@ static const char esp32AtWiFiGetIP[] = "AT+CIPSTA?\r\n";
 static const char esp32AtWiFiGetMac[] = "AT+CIPAPMAC?\r\n";
 
 // TCP/TP AT Commands.
+// Commands with parameters are only prefixes, parameters are added with the AtCommandBuilder.
 static const char esp32AtGetDns[] = "AT+CIPDNS?\r\n";
+// Resolve the host name into the IP address.
+static const char esp32AtResolveDomain[] = "AT+CIPDOMAIN=";
+// Response on the DNS resolve request.
+static const char esp32AtResolveDomainResponse[] = "+CIPDOMAIN:";
+// Enable or disable multiple connections.
+static const char esp32AtMultipleConnections[] = "AT+CIPMUX=";
+// Open TCP/UDP/SSL connection on the selected link ID.
+static const char esp32AtLinkOpen[] = "AT+CIPSTART=";
+// Set the TLS authentication mode and the certificates of the selected SSL link.
+static const char esp32AtLinkSslConfig[] = "AT+CIPSSLCCONF=";
+// Set the server name (SNI) of the selected SSL link.
+static const char esp32AtLinkSslSni[] = "AT+CIPSSLCSNI=";
+// Close the connection on the selected link ID.
+static const char esp32AtLinkClose[] = "AT+CIPCLOSE=";
+// Send the data on the selected link ID (optionally to the selected remote host for UDP).
+static const char esp32AtLinkSend[] = "AT+CIPSEND=";
+// Prompt for the data after send command.
+static const char esp32AtLinkSendPrompt[] = ">";
+// Response after the data has been sent.
+static const char esp32AtLinkSendOk[] = "SEND OK\r\n";
+// Start of the incoming data from the link.
+static const char esp32AtLinkIpd[] = "+IPD,";
+// Link closed notification.
+static const char esp32AtLinkClosed[] = ",CLOSED\r\n";
+// Link connected notification (new connection to the server).
+static const char esp32AtLinkConnect[] = ",CONNECT\r\n";
+// Start or stop the TCP server (on the selected port).
+static const char esp32AtServer[] = "AT+CIPSERVER=";
+// Set the timeout of the TCP server connections (in seconds).
+static const char esp32AtServerTimeout[] = "AT+CIPSTO=";
+
+// SNTP AT Commands.
+// Enable SNTP in UTC with one or two NTP servers.
+static const char esp32AtSntpConfig[] = "AT+CIPSNTPCFG=1,0,";
+// Get the SNTP time.
+static const char esp32AtSntpTime[] = "AT+CIPSNTPTIME?\r\n";
+// Response on the SNTP time request.
+static const char esp32AtSntpTimeResponse[] = "+CIPSNTPTIME:";
+
+// MQTT AT Commands. ESP-AT supports only one MQTT connection (link ID 0).
+// Set MQTT user configuration.
+static const char esp32AtMqttUserCfg[] = "AT+MQTTUSERCFG=0,";
+// Set MQTT connection configuration (keep alive and clean session).
+static const char esp32AtMqttConnCfg[] = "AT+MQTTCONNCFG=0,";
+// Connect to the MQTT broker.
+static const char esp32AtMqttConnect[] = "AT+MQTTCONN=0,";
+// Publish short text message.
+static const char esp32AtMqttPublish[] = "AT+MQTTPUB=0,";
+// Publish raw (binary or long) message.
+static const char esp32AtMqttPublishRaw[] = "AT+MQTTPUBRAW=0,";
+// Subscribe to the topic.
+static const char esp32AtMqttSubscribe[] = "AT+MQTTSUB=0,";
+// Unsubscribe from the topic.
+static const char esp32AtMqttUnsubscribe[] = "AT+MQTTUNSUB=0,";
+// Close the MQTT connection.
+static const char esp32AtMqttClean[] = "AT+MQTTCLEAN=0\r\n";
+// Message received on the subscribed topic.
+static const char esp32AtMqttSubRecv[] = "+MQTTSUBRECV:";
+// Raw message published.
+static const char esp32AtMqttPubOk[] = "+MQTTPUB:OK";
+// Raw message publish failed.
+static const char esp32AtMqttPubFail[] = "+MQTTPUB:FAIL";
+// Connected to the MQTT broker.
+static const char esp32AtMqttConnected[] = "+MQTTCONNECTED:";
+// Disconnected from the MQTT broker.
+static const char esp32AtMqttDisconnected[] = "+MQTTDISCONNECTED:";
 #endif
\ No newline at end of file
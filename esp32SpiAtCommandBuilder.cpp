@@ -0,0 +1,259 @@
+// Include main header file.
+#include "esp32SpiAtCommandBuilder.h"
+
+/**
+ * @brief   Construct a new AtCommandBuilder object.
+ *
+ * @param   char *_buffer
+ *          Buffer where the command will be built (usually TX buffer for the SPI).
+ * @param   uint16_t _size
+ *          Size of the buffer in bytes (one byte is used for the null-terminating char).
+ */
+AtCommandBuilder::AtCommandBuilder(char *_buffer, uint16_t _size)
+{
+    this->_buffer = _buffer;
+    this->_size = _size;
+
+    // Start with the empty string.
+    if (_size)
+        _buffer[0] = '\0';
+}
+
+/**
+ * @brief   Add the data of the known length to the command.
+ *
+ * @param   const char *_data
+ *          Pointer to the data.
+ * @param   uint16_t _len
+ *          Length of the data (in bytes).
+ * @return  AtCommandBuilder&
+ *          Reference to this builder, so calls can be chained.
+ */
+AtCommandBuilder &AtCommandBuilder::addRaw(const char *_data, uint16_t _len)
+{
+    // Check if it fits (keep one byte for the null-terminating char).
+    if ((_overflow) || ((uint32_t)this->_len + _len >= _size))
+    {
+        _overflow = true;
+        return *this;
+    }
+
+    memcpy(_buffer + this->_len, _data, _len);
+    this->_len += _len;
+    _buffer[this->_len] = '\0';
+
+    return *this;
+}
+
+/**
+ * @brief   Add one char to the command.
+ *
+ * @param   char _c
+ *          Char to add.
+ * @return  AtCommandBuilder&
+ *          Reference to this builder.
+ */
+AtCommandBuilder &AtCommandBuilder::addChar(char _c)
+{
+    return addRaw(&_c, 1);
+}
+
+/**
+ * @brief   Add the signed integer number (in decimal) to the command.
+ *
+ * @param   int32_t _value
+ *          Number to add.
+ * @return  AtCommandBuilder&
+ *          Reference to this builder.
+ */
+AtCommandBuilder &AtCommandBuilder::addInt(int32_t _value)
+{
+    // Add the sign first if needed.
+    if (_value < 0)
+    {
+        addChar('-');
+        return addUInt((uint32_t)(-(_value + 1)) + 1);
+    }
+
+    return addUInt(_value);
+}
+
+/**
+ * @brief   Add the unsigned integer number (in decimal) to the command.
+ *
+ * @param   uint32_t _value
+ *          Number to add.
+ * @return  AtCommandBuilder&
+ *          Reference to this builder.
+ */
+AtCommandBuilder &AtCommandBuilder::addUInt(uint32_t _value)
+{
+    // Max. 10 digits for 32 bit number. Digits are calculated from the end.
+    char _digits[10];
+    uint8_t _pos = sizeof(_digits);
+
+    do
+    {
+        _digits[--_pos] = '0' + (_value % 10);
+        _value /= 10;
+    } while (_value);
+
+    return addRaw(_digits + _pos, sizeof(_digits) - _pos);
+}
+
+/**
+ * @brief   Add the IP Address (a.b.c.d) to the command.
+ *
+ * @param   IPAddress _ip
+ *          IP Address to add.
+ * @return  AtCommandBuilder&
+ *          Reference to this builder.
+ */
+AtCommandBuilder &AtCommandBuilder::addIp(IPAddress _ip)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        if (i)
+            addChar('.');
+
+        addUInt(_ip[i]);
+    }
+
+    return *this;
+}
+
+/**
+ * @brief   Add the IP Address in quotes ("a.b.c.d") to the command.
+ *
+ * @param   IPAddress _ip
+ *          IP Address to add.
+ * @return  AtCommandBuilder&
+ *          Reference to this builder.
+ */
+AtCommandBuilder &AtCommandBuilder::addQuotedIp(IPAddress _ip)
+{
+    addChar('\"');
+    addIp(_ip);
+    return addChar('\"');
+}
+
+/**
+ * @brief   Add the string to the command with AT escaping - '"', ',' and '\' get the backslash in front of
+ *          them, so they can be used in the SSID, password, topic, etc.
+ *
+ * @param   const char *_text
+ *          Pointer to the string.
+ * @param   uint16_t _len
+ *          Length of the string (in bytes).
+ * @return  AtCommandBuilder&
+ *          Reference to this builder.
+ */
+AtCommandBuilder &AtCommandBuilder::addEscaped(const char *_text, uint16_t _len)
+{
+    // Copy chars that do not need escaping in one go.
+    uint16_t _start = 0;
+
+    for (uint16_t i = 0; i < _len; i++)
+    {
+        if ((_text[i] == '\"') || (_text[i] == ',') || (_text[i] == '\\'))
+        {
+            addRaw(_text + _start, i - _start);
+            addChar('\\');
+            _start = i;
+        }
+    }
+
+    // Add the rest of the string.
+    return addRaw(_text + _start, _len - _start);
+}
+
+/**
+ * @brief   Add the null-terminated string in quotes with AT escaping.
+ *
+ * @param   const char *_text
+ *          Pointer to the string.
+ * @return  AtCommandBuilder&
+ *          Reference to this builder.
+ */
+AtCommandBuilder &AtCommandBuilder::addQuoted(const char *_text)
+{
+    // Empty string if null-pointer is used.
+    if (_text == NULL)
+        _text = "";
+
+    return addQuoted(_text, strlen(_text));
+}
+
+/**
+ * @brief   Add the string of the known length in quotes with AT escaping.
+ *
+ * @param   const char *_text
+ *          Pointer to the string.
+ * @param   uint16_t _len
+ *          Length of the string (in bytes).
+ * @return  AtCommandBuilder&
+ *          Reference to this builder.
+ */
+AtCommandBuilder &AtCommandBuilder::addQuoted(const char *_text, uint16_t _len)
+{
+    addChar('\"');
+    addEscaped(_text, _len);
+    return addChar('\"');
+}
+
+/**
+ * @brief   Finish the command (add CRLF at the end).
+ *
+ * @return  AtCommandBuilder&
+ *          Reference to this builder.
+ */
+AtCommandBuilder &AtCommandBuilder::end()
+{
+    return add("\r\n");
+}
+
+/**
+ * @brief   Get the pointer to the built command (it's null-terminated).
+ *
+ * @return  char*
+ *          Pointer to the command.
+ */
+char *AtCommandBuilder::c_str()
+{
+    return _buffer;
+}
+
+/**
+ * @brief   Get the length of the built command.
+ *
+ * @return  uint16_t
+ *          Length of the command (in bytes, without the null-terminating char).
+ */
+uint16_t AtCommandBuilder::length()
+{
+    return _len;
+}
+
+/**
+ * @brief   Check if the command could not fit into the buffer.
+ *
+ * @return  bool
+ *          true - Buffer is too small, command is not complete and must not be sent.
+ *          false - Command is ok.
+ */
+bool AtCommandBuilder::overflow()
+{
+    return _overflow;
+}
+
+/**
+ * @brief   Start building a new command in the same buffer.
+ *
+ */
+void AtCommandBuilder::reset()
+{
+    _len = 0;
+    _overflow = false;
+    if (_size)
+        _buffer[0] = '\0';
+}
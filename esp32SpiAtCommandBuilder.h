@@ -0,0 +1,53 @@
+// Add headerguard do prevent multiple include.
+#ifndef __ESP32_SPI_AT_COMMAND_BUILDER_H__
+#define __ESP32_SPI_AT_COMMAND_BUILDER_H__
+
+// Include main Arduino header file.
+#include <Arduino.h>
+
+// include Arduino Library for the IP Adresses.
+#include <IPAddress.h>
+
+// Class for building AT commands directly in the TX buffer without sprintf(). Constant parts of the
+// command are string literals, so their length is known at compile time and they are just copied. Numbers
+// and IP Addresses are formatted with simple integer formatters and strings in quotes are escaped for the
+// AT command parser. Length of the command is always known, so it can be sent without strlen().
+//
+// Example: AtCommandBuilder _cmd(_dataBuffer, sizeof(_dataBuffer));
+//          _cmd.add("AT+CWJAP=").addQuoted(_ssid).add(",").addQuoted(_pass).end();
+class AtCommandBuilder
+{
+  public:
+    AtCommandBuilder(char *_buffer, uint16_t _size);
+
+    // Add the string constant (string literal or const char array from esp32SpiAtAllCommands.h). Length is
+    // taken from the array size, so do not use it with the buffers, use addRaw() or addQuoted() instead.
+    template <size_t N> AtCommandBuilder &add(const char (&_text)[N])
+    {
+        return addRaw(_text, N - 1);
+    }
+
+    AtCommandBuilder &addRaw(const char *_data, uint16_t _len);
+    AtCommandBuilder &addChar(char _c);
+    AtCommandBuilder &addInt(int32_t _value);
+    AtCommandBuilder &addUInt(uint32_t _value);
+    AtCommandBuilder &addIp(IPAddress _ip);
+    AtCommandBuilder &addQuotedIp(IPAddress _ip);
+    AtCommandBuilder &addEscaped(const char *_text, uint16_t _len);
+    AtCommandBuilder &addQuoted(const char *_text);
+    AtCommandBuilder &addQuoted(const char *_text, uint16_t _len);
+    AtCommandBuilder &end();
+
+    char *c_str();
+    uint16_t length();
+    bool overflow();
+    void reset();
+
+  private:
+    char *_buffer;
+    uint16_t _size;
+    uint16_t _len = 0;
+    bool _overflow = false;
+};
+
+#endif
@@ -0,0 +1,577 @@
+// Include main header file.
+#include "esp32SpiAt.h"
+
+#ifdef INKPLATE_ESP32_COROUTINES
+
+// Static pool for the coroutine frames and the flags of the used ones.
+alignas(8) static uint8_t _atFramePool[INKPLATE_ESP32_CO_MAX_FRAMES][INKPLATE_ESP32_CO_FRAME_SIZE];
+static bool _atFrameUsed[INKPLATE_ESP32_CO_MAX_FRAMES] = {false};
+
+/**
+ * @brief   Get the free coroutine frame from the static pool.
+ *
+ * @param   size_t _size
+ *          Size of the coroutine frame (in bytes).
+ * @return  void*
+ *          Pointer to the frame, NULL if the frame is too large or there is no free frame.
+ */
+void *atFrameAlloc(size_t _size) noexcept
+{
+    // Frame must fit into the pool.
+    if (_size > INKPLATE_ESP32_CO_FRAME_SIZE)
+        return NULL;
+
+    // Find the free one.
+    for (int i = 0; i < INKPLATE_ESP32_CO_MAX_FRAMES; i++)
+    {
+        if (!_atFrameUsed[i])
+        {
+            _atFrameUsed[i] = true;
+            return _atFramePool[i];
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief   Return the coroutine frame into the static pool.
+ *
+ * @param   void *_ptr
+ *          Pointer to the frame.
+ */
+void atFrameFree(void *_ptr) noexcept
+{
+    for (int i = 0; i < INKPLATE_ESP32_CO_MAX_FRAMES; i++)
+    {
+        if (_ptr == _atFramePool[i])
+            _atFrameUsed[i] = false;
+    }
+}
+
+/**
+ * @brief   Check if the await is already done (it's polled once before the coroutine is suspended). If the
+ *          executor has no room for one more await, it fails right away without being started (nothing is sent
+ *          to the modem), so the coroutine never blocks.
+ *
+ * @return  bool
+ *          true - Done (or failed), no need to suspend.
+ *          false - Not done yet.
+ */
+bool AtAwaitable::await_ready()
+{
+    if (!AtScheduler.hasRoom())
+        return true;
+
+    return poll();
+}
+
+/**
+ * @brief   Suspend the coroutine until the await is done. Room in the executor is checked in await_ready(),
+ *          but if it's full anyway, the await is not started and the coroutine continues with its result.
+ *
+ * @param   std::coroutine_handle<> _caller
+ *          Coroutine waiting for this await.
+ * @return  bool
+ *          true - Coroutine is suspended.
+ *          false - Continue.
+ */
+bool AtAwaitable::await_suspend(std::coroutine_handle<> _caller)
+{
+    _handle = _caller;
+
+    return AtScheduler.wait(this);
+}
+
+/**
+ * @brief   Construct a new AtTask object for the coroutine.
+ *
+ * @param   std::coroutine_handle<promise_type> _coroutine
+ *          Coroutine handle.
+ */
+AtTask::AtTask(std::coroutine_handle<promise_type> _coroutine)
+{
+    _handle = _coroutine;
+}
+
+/**
+ * @brief   Move the task (only one AtTask object owns the coroutine).
+ *
+ * @param   AtTask &&_other
+ *          Task to move from.
+ */
+AtTask::AtTask(AtTask &&_other) noexcept
+{
+    _handle = _other._handle;
+    _other._handle = nullptr;
+}
+
+/**
+ * @brief   Move the task (only one AtTask object owns the coroutine).
+ *
+ * @param   AtTask &&_other
+ *          Task to move from.
+ * @return  AtTask&
+ *          This task.
+ */
+AtTask &AtTask::operator=(AtTask &&_other) noexcept
+{
+    if (&_other != this)
+    {
+        if (_handle)
+            _handle.destroy();
+
+        _handle = _other._handle;
+        _other._handle = nullptr;
+    }
+
+    return *this;
+}
+
+/**
+ * @brief   Destroy the AtTask object and its coroutine frame.
+ *
+ */
+AtTask::~AtTask()
+{
+    if (_handle)
+        _handle.destroy();
+}
+
+/**
+ * @brief   Check if the coroutine has been started (there was a free frame for it).
+ *
+ * @return  bool
+ *          true - Task is valid.
+ *          false - No frame for the coroutine.
+ */
+bool AtTask::valid()
+{
+    return (bool)_handle;
+}
+
+/**
+ * @brief   Check if the task is done.
+ *
+ * @return  bool
+ *          true - Task is done (or it's not valid).
+ *          false - Task is still running.
+ */
+bool AtTask::done()
+{
+    return !_handle || _handle.done();
+}
+
+/**
+ * @brief   Get the result of the task (co_return value).
+ *
+ * @return  bool
+ *          Result of the task, false if it's not done yet or not valid.
+ */
+bool AtTask::result()
+{
+    return done() && _handle && _handle.promise()._result;
+}
+
+/**
+ * @brief   Give the ownership of the coroutine to someone else (the executor).
+ *
+ * @return  std::coroutine_handle<AtTask::promise_type>
+ *          Coroutine handle.
+ */
+std::coroutine_handle<AtTask::promise_type> AtTask::release()
+{
+    std::coroutine_handle<promise_type> _coroutine = _handle;
+    _handle = nullptr;
+
+    return _coroutine;
+}
+
+/**
+ * @brief   Check if the task needs to be started (tasks without the frame are done right away).
+ *
+ * @return  bool
+ *          true - Nothing to wait for.
+ *          false - Start the task.
+ */
+bool AtTask::await_ready()
+{
+    return done();
+}
+
+/**
+ * @brief   Start the task, awaiting coroutine continues when the task is done.
+ *
+ * @param   std::coroutine_handle<> _caller
+ *          Awaiting coroutine.
+ * @return  std::coroutine_handle<>
+ *          Coroutine to run next (this task).
+ */
+std::coroutine_handle<> AtTask::await_suspend(std::coroutine_handle<> _caller)
+{
+    _handle.promise()._continuation = _caller;
+
+    return _handle;
+}
+
+/**
+ * @brief   Result of the co_await on the task.
+ *
+ * @return  bool
+ *          Result of the task.
+ */
+bool AtTask::await_resume()
+{
+    return result();
+}
+
+/**
+ * @brief   Start the top level task. Executor owns it from now on and destroys it when it's done.
+ *
+ * @param   AtTask &&_task
+ *          Task to start.
+ * @return  bool
+ *          true - Task started.
+ *          false - Task is not valid (no frame) or there is no room for it.
+ */
+bool AtExecutor::spawn(AtTask &&_task)
+{
+    // Check the task.
+    if (!_task.valid())
+        return false;
+
+    // Find the free slot.
+    for (int i = 0; i < INKPLATE_ESP32_CO_MAX_TASKS; i++)
+    {
+        if (!_tasks[i])
+        {
+            // Take it and run it until the first await.
+            _tasks[i] = _task.release();
+            _tasks[i].resume();
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief   Poll all waiting awaits and continue the coroutines that can go on. Finished top level tasks are
+ *          destroyed. Call it often (from the loop()), it never blocks.
+ *
+ */
+void AtExecutor::run()
+{
+    // Continue the coroutines with the finished awaits. Await is part of the coroutine frame, so do not
+    // touch it after the coroutine has been resumed.
+    for (int i = 0; i < INKPLATE_ESP32_CO_MAX_WAITING; i++)
+    {
+        AtAwaitable *_awaitable = _waiting[i];
+
+        if ((_awaitable != NULL) && _awaitable->poll())
+        {
+            _waiting[i] = NULL;
+            _awaitable->_handle.resume();
+        }
+    }
+
+    // Release the finished tasks.
+    for (int i = 0; i < INKPLATE_ESP32_CO_MAX_TASKS; i++)
+    {
+        if (_tasks[i] && _tasks[i].done())
+        {
+            _tasks[i].destroy();
+            _tasks[i] = nullptr;
+        }
+    }
+}
+
+/**
+ * @brief   Check if there is anything left to do.
+ *
+ * @return  bool
+ *          true - All tasks are done.
+ *          false - Some tasks are still running.
+ */
+bool AtExecutor::idle()
+{
+    for (int i = 0; i < INKPLATE_ESP32_CO_MAX_TASKS; i++)
+    {
+        if (_tasks[i])
+            return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief   Helper method for checking if there is room for one more await in the waiting list.
+ *
+ * @return  bool
+ *          true - There is room.
+ *          false - Waiting list is full.
+ */
+bool AtExecutor::hasRoom()
+{
+    for (int i = 0; i < INKPLATE_ESP32_CO_MAX_WAITING; i++)
+    {
+        if (_waiting[i] == NULL)
+            return true;
+    }
+
+    return false;
+}
+
+/**
+ * @brief   Helper method for adding the await to the waiting list.
+ *
+ * @param   AtAwaitable *_awaitable
+ *          Await to wait for.
+ * @return  bool
+ *          true - Added.
+ *          false - Waiting list is full.
+ */
+bool AtExecutor::wait(AtAwaitable *_awaitable)
+{
+    for (int i = 0; i < INKPLATE_ESP32_CO_MAX_WAITING; i++)
+    {
+        if (_waiting[i] == NULL)
+        {
+            _waiting[i] = _awaitable;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief   Construct a new AtCommandAwaitable object. Command is sent on the first poll.
+ *
+ * @param   WiFiClass *_wifiModem
+ *          Modem used for the command.
+ * @param   const char *_atCommand
+ *          AT command with CRLF at the end (NULL - await fails right away).
+ * @param   unsigned long _timeout
+ *          Max. time to wait for the result (in milliseconds).
+ * @param   const char *_expected
+ *          Result code that means success.
+ */
+AtCommandAwaitable::AtCommandAwaitable(WiFiClass *_wifiModem, const char *_atCommand, unsigned long _timeout,
+                                       const char *_expected)
+{
+    _modem = _wifiModem;
+    _command = _atCommand;
+    _timeoutValue = _timeout;
+    _expectedResult = _expected;
+}
+
+/**
+ * @brief   Send the command (first time the modem is free) and check for the result. Modem is used only by this
+ *          await until it's done.
+ *
+ * @return  bool
+ *          true - Result received, failed or timeout.
+ *          false - Still waiting.
+ */
+bool AtCommandAwaitable::poll()
+{
+    // Wait for the other awaits on this modem to finish.
+    if (!_modem->awaitLock(this))
+        return false;
+
+    // Send the command first.
+    if (!_sent)
+    {
+        _sent = true;
+        _startTime = millis();
+
+        if ((_command == NULL) || !_modem->sendAtCommand((char *)_command))
+        {
+            _modem->awaitUnlock(this);
+            return true;
+        }
+    }
+
+    // Check for the result.
+    int8_t _ret = _modem->pollAtResult(_modem->getDataBuffer(), INKPLATE_ESP32_AT_CMD_BUFFER_SIZE, &_offset,
+                                       _expectedResult, false);
+    if (_ret >= 0)
+        _result = (_ret == 1);
+
+    // Done (result or timeout)? Let the next await use the modem.
+    if ((_ret >= 0) || ((unsigned long)(millis() - _startTime) >= _timeoutValue))
+    {
+        _modem->awaitUnlock(this);
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * @brief   Result of the co_await on the AT command.
+ *
+ * @return  bool
+ *          true - Expected result code received (response is in the data buffer).
+ *          false - Command failed or timeout.
+ */
+bool AtCommandAwaitable::await_resume()
+{
+    return _result;
+}
+
+/**
+ * @brief   Construct a new AtFrameAwaitable object.
+ *
+ * @param   WiFiClass *_wifiModem
+ *          Modem used.
+ * @param   char *_buffer
+ *          Where to store the data.
+ * @param   uint32_t _bufferLen
+ *          Size of the buffer (in bytes, counting the null-terminating char).
+ * @param   unsigned long _timeout
+ *          Max. time to wait for the data (in milliseconds).
+ * @param   const void *_owner
+ *          Owner of the lock already held by the task (see WiFiClass::lock()), NULL if the await takes the
+ *          modem by itself.
+ */
+AtFrameAwaitable::AtFrameAwaitable(WiFiClass *_wifiModem, char *_buffer, uint32_t _bufferLen,
+                                   unsigned long _timeout, const void *_owner)
+{
+    _modem = _wifiModem;
+    _frameBuffer = _buffer;
+    _frameBufferLen = _bufferLen;
+    _timeoutValue = _timeout;
+    _startTime = millis();
+    _lockOwner = _owner;
+}
+
+/**
+ * @brief   Check for the data from the modem (only if no other await is using it).
+ *
+ * @return  bool
+ *          true - Data received, failed or timeout.
+ *          false - Still waiting.
+ */
+bool AtFrameAwaitable::poll()
+{
+    // Timeout also counts while the other awaits are using the modem.
+    bool _timeout = ((unsigned long)(millis() - _startTime) >= _timeoutValue);
+
+    // Wait for the other awaits on this modem to finish.
+    const void *_owner = (_lockOwner != NULL) ? _lockOwner : this;
+    if (!_modem->awaitLock(_owner))
+        return _timeout;
+
+    uint16_t _len = 0;
+    int8_t _ret = _modem->pollFrame(_frameBuffer, _frameBufferLen, &_len);
+    if (_ret >= 0)
+        _result = (_ret == 1) ? _len : -1;
+
+    // Done (data or timeout)? Let the next await use the modem (unless the task keeps it).
+    if ((_ret >= 0) || _timeout)
+    {
+        if (_lockOwner == NULL)
+            _modem->awaitUnlock(this);
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * @brief   Result of the co_await on the data from the modem.
+ *
+ * @return  int
+ *          Number of received bytes, -1 if failed or timeout.
+ */
+int AtFrameAwaitable::await_resume()
+{
+    return _result;
+}
+
+/**
+ * @brief   Construct a new AtLockAwaitable object.
+ *
+ * @param   WiFiClass *_wifiModem
+ *          Modem used.
+ * @param   const void *_owner
+ *          Task (or the object it runs for) that takes the modem.
+ */
+AtLockAwaitable::AtLockAwaitable(WiFiClass *_wifiModem, const void *_owner)
+{
+    _modem = _wifiModem;
+    _lockOwner = _owner;
+}
+
+/**
+ * @brief   Try to take the modem.
+ *
+ * @return  bool
+ *          true - Modem is taken by the owner.
+ *          false - Still used by another await or task.
+ */
+bool AtLockAwaitable::poll()
+{
+    return _modem->awaitLock(_lockOwner);
+}
+
+/**
+ * @brief   Nothing to return from the lock, the modem is taken until awaitUnlock() is called.
+ *
+ */
+void AtLockAwaitable::await_resume()
+{
+}
+
+/**
+ * @brief   Construct a new AtSleepAwaitable object.
+ *
+ * @param   unsigned long _ms
+ *          Time to wait (in milliseconds).
+ */
+AtSleepAwaitable::AtSleepAwaitable(unsigned long _ms)
+{
+    _startTime = millis();
+    _duration = _ms;
+}
+
+/**
+ * @brief   Check if the time has passed.
+ *
+ * @return  bool
+ *          true - Time has passed.
+ *          false - Still waiting.
+ */
+bool AtSleepAwaitable::poll()
+{
+    return ((unsigned long)(millis() - _startTime) >= _duration);
+}
+
+/**
+ * @brief   Nothing to return from the sleep.
+ *
+ */
+void AtSleepAwaitable::await_resume()
+{
+}
+
+/**
+ * @brief   Wait without blocking other tasks (co_await atSleep(100)).
+ *
+ * @param   unsigned long _ms
+ *          Time to wait (in milliseconds).
+ * @return  AtSleepAwaitable
+ *          Await for the time to pass.
+ */
+AtSleepAwaitable atSleep(unsigned long _ms)
+{
+    return AtSleepAwaitable(_ms);
+}
+
+// Declare default executor to be globally available.
+AtExecutor AtScheduler;
+
+#endif
@@ -0,0 +1,240 @@
+// Add headerguard do prevent multiple include.
+#ifndef __ESP32_SPI_AT_COROUTINE_H__
+#define __ESP32_SPI_AT_COROUTINE_H__
+
+// Include main Arduino header file.
+#include <Arduino.h>
+
+// Coroutines need C++20 (build with -std=gnu++20). Without it, nothing from this file is available.
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#define INKPLATE_ESP32_COROUTINES
+#endif
+#endif
+
+#ifdef INKPLATE_ESP32_COROUTINES
+
+// Include C++20 coroutine support.
+#include <coroutine>
+
+// Coroutine frames are taken from the static pool, not from the heap. Number of frames (coroutines started and
+// not finished yet, including the nested ones) and max. size of one frame (in bytes). Coroutine that does not
+// fit into the pool is not started (its result is false).
+#ifndef INKPLATE_ESP32_CO_MAX_FRAMES
+#define INKPLATE_ESP32_CO_MAX_FRAMES 6
+#endif
+#ifndef INKPLATE_ESP32_CO_FRAME_SIZE
+#define INKPLATE_ESP32_CO_FRAME_SIZE 256
+#endif
+
+// Max. number of top level tasks and max. number of awaits waiting at the same time.
+#ifndef INKPLATE_ESP32_CO_MAX_TASKS
+#define INKPLATE_ESP32_CO_MAX_TASKS 4
+#endif
+#ifndef INKPLATE_ESP32_CO_MAX_WAITING
+#define INKPLATE_ESP32_CO_MAX_WAITING 8
+#endif
+
+// Modem class (awaitables only keep the pointer to it).
+class WiFiClass;
+
+// Static pool for the coroutine frames.
+void *atFrameAlloc(size_t _size) noexcept;
+void atFrameFree(void *_ptr) noexcept;
+
+// Base class of everything the executor can wait for. poll() is called from the executor (AtExecutor::run())
+// and must not block, it returns true when the await is done. If the waiting list is full, the await fails
+// right away (command and frame awaits give false/-1, sleep ends at once).
+class AtAwaitable
+{
+  public:
+    virtual bool poll() = 0;
+    bool await_ready();
+    bool await_suspend(std::coroutine_handle<> _caller);
+
+  protected:
+    friend class AtExecutor;
+
+    // Coroutine waiting for this await.
+    std::coroutine_handle<> _handle;
+};
+
+// Coroutine type of the AT tasks. Task starts when it's awaited (co_await) or spawned (AtExecutor::spawn())
+// and its result is bool (co_return true or false).
+class AtTask
+{
+  public:
+    struct promise_type;
+
+    // Resumes the awaiting coroutine when the task is done.
+    struct FinalAwaiter
+    {
+        bool await_ready() noexcept
+        {
+            return false;
+        }
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> _finished) noexcept
+        {
+            std::coroutine_handle<> _continuation = _finished.promise()._continuation;
+            return _continuation ? _continuation : std::noop_coroutine();
+        }
+        void await_resume() noexcept
+        {
+        }
+    };
+
+    struct promise_type
+    {
+        bool _result = false;
+        std::coroutine_handle<> _continuation;
+
+        AtTask get_return_object()
+        {
+            return AtTask(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        static AtTask get_return_object_on_allocation_failure()
+        {
+            return AtTask();
+        }
+        std::suspend_always initial_suspend() noexcept
+        {
+            return {};
+        }
+        FinalAwaiter final_suspend() noexcept
+        {
+            return {};
+        }
+        void return_value(bool _value)
+        {
+            _result = _value;
+        }
+        void unhandled_exception()
+        {
+        }
+        static void *operator new(size_t _size) noexcept
+        {
+            return atFrameAlloc(_size);
+        }
+        static void operator delete(void *_ptr) noexcept
+        {
+            atFrameFree(_ptr);
+        }
+    };
+
+    AtTask() = default;
+    AtTask(AtTask &&_other) noexcept;
+    AtTask &operator=(AtTask &&_other) noexcept;
+    AtTask(const AtTask &) = delete;
+    AtTask &operator=(const AtTask &) = delete;
+    ~AtTask();
+
+    bool valid();
+    bool done();
+    bool result();
+    std::coroutine_handle<promise_type> release();
+
+    // Awaiting the task starts it and continues when it's done.
+    bool await_ready();
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> _caller);
+    bool await_resume();
+
+  private:
+    explicit AtTask(std::coroutine_handle<promise_type> _coroutine);
+
+    std::coroutine_handle<promise_type> _handle;
+};
+
+// Single threaded executor for the AT tasks. Call run() from the loop().
+class AtExecutor
+{
+  public:
+    bool spawn(AtTask &&_task);
+    void run();
+    bool idle();
+
+  private:
+    friend class AtAwaitable;
+
+    bool hasRoom();
+    bool wait(AtAwaitable *_awaitable);
+
+    // Top level tasks and awaits waiting to be done.
+    std::coroutine_handle<AtTask::promise_type> _tasks[INKPLATE_ESP32_CO_MAX_TASKS];
+    AtAwaitable *_waiting[INKPLATE_ESP32_CO_MAX_WAITING] = {NULL};
+};
+
+// Await for the result of the AT command (see WiFiClass::command()). Result of the await is bool. Command and
+// frame awaits on the same modem go one after another (see WiFiClass::awaitLock()).
+class AtCommandAwaitable : public AtAwaitable
+{
+  public:
+    AtCommandAwaitable(WiFiClass *_wifiModem, const char *_atCommand, unsigned long _timeout, const char *_expected);
+    bool poll() override;
+    bool await_resume();
+
+  private:
+    WiFiClass *_modem;
+    const char *_command;
+    unsigned long _timeoutValue;
+    const char *_expectedResult;
+    unsigned long _startTime = 0;
+    uint32_t _offset = 0;
+    bool _sent = false;
+    bool _result = false;
+};
+
+// Await for the next data packet from the modem (see WiFiClass::frame()). Result of the await is the number of
+// received bytes, -1 if failed. If the owner is given, the await runs under the lock the task already holds
+// (see WiFiClass::lock()) and leaves it taken.
+class AtFrameAwaitable : public AtAwaitable
+{
+  public:
+    AtFrameAwaitable(WiFiClass *_wifiModem, char *_buffer, uint32_t _bufferLen, unsigned long _timeout,
+                     const void *_owner);
+    bool poll() override;
+    int await_resume();
+
+  private:
+    WiFiClass *_modem;
+    char *_frameBuffer;
+    uint32_t _frameBufferLen;
+    unsigned long _timeoutValue;
+    unsigned long _startTime;
+    const void *_lockOwner;
+    int _result = -1;
+};
+
+// Await for the modem to be free, then keep it for the task (see WiFiClass::lock()).
+class AtLockAwaitable : public AtAwaitable
+{
+  public:
+    AtLockAwaitable(WiFiClass *_wifiModem, const void *_owner);
+    bool poll() override;
+    void await_resume();
+
+  private:
+    WiFiClass *_modem;
+    const void *_lockOwner;
+};
+
+// Await for the time to pass (see atSleep()).
+class AtSleepAwaitable : public AtAwaitable
+{
+  public:
+    AtSleepAwaitable(unsigned long _ms);
+    bool poll() override;
+    void await_resume();
+
+  private:
+    unsigned long _startTime;
+    unsigned long _duration;
+};
+
+AtSleepAwaitable atSleep(unsigned long _ms);
+
+// Default executor.
+extern AtExecutor AtScheduler;
+
+#endif
+
+#endif
@@ -0,0 +1,242 @@
+// Include main header file.
+#include "esp32SpiAt.h"
+
+/**
+ * @brief Construct a new WiFiDownload object - for the verified download into the storage.
+ *
+ * @param   WiFiClass &_wifiModem
+ *          Modem used by this object (default is WiFi, use other WiFiClass object for additional modems).
+ */
+WiFiDownload::WiFiDownload(WiFiClass &_wifiModem)
+{
+    // Bind it to the modem.
+    _modem = &_wifiModem;
+
+    memset(_digest, 0, sizeof(_digest));
+}
+
+/**
+ * @brief   Download the file into the storage. Data is hashed while it's written. Sink is committed only if the
+ *          modem did not report the error (see WiFiClient::failed()), the whole file arrived (if the server
+ *          reported the size) and the digest matches, otherwise it's aborted. Without the size and the digest,
+ *          there is no way to tell the whole file from the cut one, so it's not committed unless
+ *          allowUnverified() is used.
+ *
+ * @param   const char *_url
+ *          URL of the file.
+ * @param   DownloadSink &_sink
+ *          Storage for the file.
+ * @param   const char *_sha256
+ *          Expected SHA-256 of the file as the hex string (64 chars, any case). NULL - do not verify it (digest is
+ *          still calculated, see digest()).
+ * @return  bool
+ *          true - File downloaded, verified and committed.
+ *          false - Download failed, nothing is committed (see lastError()).
+ */
+bool WiFiDownload::run(const char *_url, DownloadSink &_sink, const char *_sha256)
+{
+    // Capture the time!
+    unsigned long _startTime = millis();
+
+    _bytes = 0;
+
+    // Connect to the host, first chunk is already in the buffer.
+    WiFiClient _client(*_modem);
+    if (!_client.connect(_url))
+    {
+        // Message filter could already be enabled.
+        _client.end();
+        _lastError = INKPLATE_ESP32_DOWNLOAD_CONNECT;
+        _elapsed = millis() - _startTime;
+        return false;
+    }
+
+    // Move all data into the storage. HTTP filter must be disabled in any case.
+    bool _transferred = transfer(_client, _sink);
+    _client.end();
+
+    // Check the result, the size and the digest. Nothing is committed on any failure.
+    if (_transferred && _client.failed())
+    {
+        _lastError = INKPLATE_ESP32_DOWNLOAD_HTTP;
+        _transferred = false;
+    }
+    else if (_transferred && (_client.size() > 0) && (_client.timedOut() || (_bytes != (uint32_t)_client.size())))
+    {
+        _lastError = INKPLATE_ESP32_DOWNLOAD_SIZE;
+        _transferred = false;
+    }
+    else if (_transferred && (_sha256 != NULL) && !digestMatches(_sha256))
+    {
+        _lastError = INKPLATE_ESP32_DOWNLOAD_DIGEST;
+        _transferred = false;
+    }
+    else if (_transferred && (_client.size() <= 0) && (_sha256 == NULL) && !_allowUnverified)
+    {
+        _lastError = INKPLATE_ESP32_DOWNLOAD_UNVERIFIED;
+        _transferred = false;
+    }
+
+    if (!_transferred)
+    {
+        _sink.abort();
+    }
+    else if (!_sink.commit())
+    {
+        _lastError = INKPLATE_ESP32_DOWNLOAD_STORAGE;
+        _transferred = false;
+    }
+    else
+    {
+        _lastError = INKPLATE_ESP32_DOWNLOAD_OK;
+    }
+
+    _elapsed = millis() - _startTime;
+
+    return _transferred;
+}
+
+/**
+ * @brief   Allow the commit of the data that can't be verified (server did not report the size and no digest
+ *          is given to run()). Data may be cut by the timeout in that case. It's not allowed by default.
+ *
+ * @param   bool _en
+ *          true - Commit the data if the modem did not report the error.
+ *          false - Do not commit the data that can't be verified.
+ */
+void WiFiDownload::allowUnverified(bool _en)
+{
+    _allowUnverified = _en;
+}
+
+/**
+ * @brief   Get the result of the last download.
+ *
+ * @return  uint8_t
+ *          INKPLATE_ESP32_DOWNLOAD_OK - File committed.
+ *          INKPLATE_ESP32_DOWNLOAD_CONNECT - Connection to the host failed.
+ *          INKPLATE_ESP32_DOWNLOAD_STORAGE - Sink failed (begin, write or commit).
+ *          INKPLATE_ESP32_DOWNLOAD_SIZE - Transfer ended before the whole file arrived.
+ *          INKPLATE_ESP32_DOWNLOAD_DIGEST - Digest does not match.
+ *          INKPLATE_ESP32_DOWNLOAD_HTTP - Request failed (error status or the connection failed).
+ *          INKPLATE_ESP32_DOWNLOAD_UNVERIFIED - No size and no digest to verify the data (see allowUnverified()).
+ */
+uint8_t WiFiDownload::lastError()
+{
+    return _lastError;
+}
+
+/**
+ * @brief   Get the number of bytes written to the sink by the last download.
+ *
+ * @return  uint32_t
+ *          Number of bytes.
+ */
+uint32_t WiFiDownload::bytes()
+{
+    return _bytes;
+}
+
+/**
+ * @brief   Get the duration of the last download (connection, transfer and the commit).
+ *
+ * @return  unsigned long
+ *          Time in milliseconds.
+ */
+unsigned long WiFiDownload::elapsed()
+{
+    return _elapsed;
+}
+
+/**
+ * @brief   Get the SHA-256 of the data received by the last download.
+ *
+ * @param   uint8_t *_digestOut
+ *          Where to store the digest (INKPLATE_ESP32_SHA256_LEN bytes).
+ */
+void WiFiDownload::digest(uint8_t *_digestOut)
+{
+    memcpy(_digestOut, _digest, INKPLATE_ESP32_SHA256_LEN);
+}
+
+/**
+ * @brief   Helper method for moving all data from the client into the sink. Each chunk is hashed and written
+ *          straight from the modem buffer.
+ *
+ * @param   WiFiClient &_client
+ *          Connected client (first chunk is already in the buffer).
+ * @param   DownloadSink &_sink
+ *          Storage for the file.
+ * @return  bool
+ *          true - Transfer ended (size is checked by the caller).
+ *          false - Sink failed.
+ */
+bool WiFiDownload::transfer(WiFiClient &_client, DownloadSink &_sink)
+{
+    Sha256 _sha;
+    uint32_t _size = _client.size() > 0 ? _client.size() : 0;
+
+    // Let the sink prepare the room for it.
+    if (!_sink.begin(_size))
+    {
+        _lastError = INKPLATE_ESP32_DOWNLOAD_STORAGE;
+        return false;
+    }
+
+    // Stop as soon as the whole file is here if the size is known, otherwise at the first timeout.
+    while (((_size == 0) || (_bytes < _size)) && _client.available())
+    {
+        uint16_t _len;
+        const char *_data = _client.chunk(&_len);
+
+        // Hash it and write it while it's still in the cache.
+        _sha.update(_data, _len);
+        if (!_sink.write((const uint8_t *)_data, _len))
+        {
+            _lastError = INKPLATE_ESP32_DOWNLOAD_STORAGE;
+            return false;
+        }
+
+        _client.consume(_len);
+        _bytes += _len;
+    }
+
+    _sha.finish(_digest);
+
+    return true;
+}
+
+/**
+ * @brief   Helper method for comparing the calculated digest with the expected one.
+ *
+ * @param   const char *_sha256
+ *          Expected digest as the hex string.
+ * @return  bool
+ *          true - Digest matches.
+ *          false - Digest does not match or the string is not valid.
+ */
+bool WiFiDownload::digestMatches(const char *_sha256)
+{
+    for (int i = 0; i < (INKPLATE_ESP32_SHA256_LEN * 2); i++)
+    {
+        // Get the value of the hex digit (string that is too short ends here with '\0').
+        char _c = _sha256[i];
+        uint8_t _nibble;
+        if ((_c >= '0') && (_c <= '9'))
+            _nibble = _c - '0';
+        else if ((_c >= 'a') && (_c <= 'f'))
+            _nibble = _c - 'a' + 10;
+        else if ((_c >= 'A') && (_c <= 'F'))
+            _nibble = _c - 'A' + 10;
+        else
+            return false;
+
+        // Compare it with the high or the low nibble of the byte.
+        uint8_t _expected = (i & 1) ? (_digest[i / 2] & 0x0F) : (_digest[i / 2] >> 4);
+        if (_nibble != _expected)
+            return false;
+    }
+
+    // Nothing may follow the digest.
+    return (_sha256[INKPLATE_ESP32_SHA256_LEN * 2] == '\0');
+}
@@ -0,0 +1,75 @@
+// Add headerguard do prevent multiple include.
+#ifndef __ESP32_SPI_AT_DOWNLOAD_H__
+#define __ESP32_SPI_AT_DOWNLOAD_H__
+
+// Include main Arduino header file.
+#include <Arduino.h>
+
+// Include main ESP32-C3 AT SPI library.
+#include "esp32SpiAt.h"
+
+// Include SHA-256 used for the verification of the download.
+#include "esp32SpiAtSha256.h"
+
+// Result of the download (see WiFiDownload::lastError()).
+#define INKPLATE_ESP32_DOWNLOAD_OK         0
+#define INKPLATE_ESP32_DOWNLOAD_CONNECT    1
+#define INKPLATE_ESP32_DOWNLOAD_STORAGE    2
+#define INKPLATE_ESP32_DOWNLOAD_SIZE       3
+#define INKPLATE_ESP32_DOWNLOAD_DIGEST     4
+#define INKPLATE_ESP32_DOWNLOAD_HTTP       5
+#define INKPLATE_ESP32_DOWNLOAD_UNVERIFIED 6
+
+// Storage for the download. Data is written as it arrives, but it must not be visible under the final name
+// (or marked as valid) until commit(), so the old copy stays in place if the download fails. For files, write
+// into the temporary file and rename it in commit(), delete it in abort().
+class DownloadSink
+{
+  public:
+    virtual ~DownloadSink()
+    {
+    }
+
+    // Start the new download (size in bytes, 0 - size is not known). Return false if there is no room for it.
+    virtual bool begin(uint32_t _size) = 0;
+
+    // Write the next chunk of the data. Return false if the storage failed.
+    virtual bool write(const uint8_t *_data, uint16_t _len) = 0;
+
+    // Download is complete and verified, make it the valid copy. Return false if that failed.
+    virtual bool commit() = 0;
+
+    // Download failed, drop the written data.
+    virtual void abort() = 0;
+};
+
+// Class for downloading the file over HTTP straight into the storage. Each chunk is hashed and written right from
+// the modem buffer as it arrives (no extra copy, no second pass for the verification), digest is checked at the
+// end of the transfer and the data is committed only if it matches.
+class WiFiDownload
+{
+  public:
+    WiFiDownload(WiFiClass &_wifiModem = WiFi);
+    bool run(const char *_url, DownloadSink &_sink, const char *_sha256 = NULL);
+    void allowUnverified(bool _en);
+    uint8_t lastError();
+    uint32_t bytes();
+    unsigned long elapsed();
+    void digest(uint8_t *_digestOut);
+
+  private:
+    bool transfer(WiFiClient &_client, DownloadSink &_sink);
+    bool digestMatches(const char *_sha256);
+
+    // Modem used by this object and if the data can be committed without the size and the digest.
+    WiFiClass *_modem;
+    bool _allowUnverified = false;
+
+    // Result of the last download, number of bytes written, time needed and the calculated digest.
+    uint8_t _lastError = INKPLATE_ESP32_DOWNLOAD_OK;
+    uint32_t _bytes = 0;
+    unsigned long _elapsed = 0;
+    uint8_t _digest[INKPLATE_ESP32_SHA256_LEN];
+};
+
+#endif
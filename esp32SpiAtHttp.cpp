@@ -5,11 +5,19 @@
 /**
  * @brief Construct a WiFiClient constructor - for HTTP.
  *
+ * @param   WiFiClass &_wifiModem
+ *          Modem used by this object (default is WiFi, use other WiFiClass object for additional modems).
  */
-WiFiClient::WiFiClient()
+WiFiClient::WiFiClient(WiFiClass &_wifiModem)
 {
+    // Bind it to the modem.
+    _modem = &_wifiModem;
+
     // Get the RX Buffer Data Buffer pointer from the WiFi library.
-    _dataBuffer = WiFi.getDataBuffer();
+    _dataBuffer = _modem->getDataBuffer();
+
+    // No host header has been added yet.
+    _hostHeader[0] = '\0';
 }
 
 /**
@@ -30,92 +38,215 @@ bool WiFiClient::connect(const char *_url)
     // Set data len to zero. And also file size.
     _bufferLen = 0;
     _fileSize = 0;
+    _received = 0;
+    _timedOut = false;
+    _failed = false;
 
-    // Set the URL since HTTPCGET has limitations on the URL size and on characters.
-    // Escape char must be sent at the end!
-    sprintf(_dataBuffer, "AT+HTTPURLCFG=%d\r\n", strlen(_url));
-    if (!WiFi.sendAtCommand(_dataBuffer))
-        return false;
-    if (!WiFi.getAtResponse(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE, 20ULL))
-        return false;
-    if (!WiFi.sendAtCommand((char*)_url));
-        ;
-    if (!WiFi.getAtResponse(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE, 20ULL))
-        return false;
-    if (!WiFi.sendAtCommand((char *)esp32AtCmdEscapeChar))
-        ;
-    if (!WiFi.getAtResponse(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE, 20ULL))
-        return false;
-
-    // First set the message filter to set the modem in pass-trough mode.
-    // Remove the header and "enter" at the end.
-    if (!WiFi.sendAtCommand("AT+SYSMSGFILTERCFG=1,18,3\r\n"))
-        return false;
-    if (!WiFi.getAtResponse(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE, 20ULL))
-        return false;
-    if (!WiFi.sendAtCommand("^+HTTPCGET:[0-9]*,\r\n$"))
-        return false;
-    if (!WiFi.getAtResponse(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE, 20ULL))
-        return false;
-    if (!WiFi.sendAtCommand((char *)esp32AtCmdEscapeChar))
-        ;
-    if (!WiFi.getAtResponse(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE, 20ULL))
-        return false;
-
-    // Remove "OK" at the end.
-    if (!WiFi.sendAtCommand("AT+SYSMSGFILTERCFG=1,0,7\r\n"))
-        return false;
-    if (!WiFi.getAtResponse(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE, 20ULL))
-        return false;
-    if (!WiFi.sendAtCommand("\r\nOK\r\n$"))
-        return false;
-    if (!WiFi.getAtResponse(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE, 20ULL))
+    // Set the URL, message filter and turn off the echo.
+    if (!setup(_url))
         return false;
 
-    // Enable the message filter.
-    if (!WiFi.sendAtCommand("AT+SYSMSGFILTER=1\r\n"))
-        return false;
-    if (!WiFi.getAtResponse(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE, 20ULL))
-        return false;
-
-    // Turn the Echo off.
-    if (!WiFi.sendAtCommand("ATE0\r\n"))
-        return false;
-    if (!WiFi.getAtResponse(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE, 20ULL))
-        return false;
-
-    // Try to get the file size. This also serves as connection to the client.
-    _fileSize = getFileSize((char *)_url, 30000ULL);
+    // Try to get the file size. This also serves as connection to the client (its own connection and the TLS
+    // handshake, so it's measured as the handshake time).
+    unsigned long _startTime = millis();
+    if (_useFileSize)
+    {
+        _fileSize = getFileSize((char *)_url, 30000ULL);
+        _handshakeTime = millis() - _startTime;
+        _startTime = millis();
+    }
 
     // Try to connect to the host. Return false if failed.
-    sprintf(_dataBuffer, "AT+HTTPCGET=\"\",4096,4096,10000\r\n", _url);
-    if (!WiFi.sendAtCommand(_dataBuffer))
+    if (!_modem->sendAtCommand("AT+HTTPCGET=\"\",4096,4096,10000\r\n"))
         return false;
 
     // // Wait for the response. Echo from sent command.
-    // if (!WiFi.getSimpleAtResponse(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE, 10ULL)) return false;
+    // if (!_modem->getSimpleAtResponse(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE, 10ULL)) return false;
 
-    // Wait for the first data chunk. If timeout occured, return false.
+    // Wait for the first data chunk. If timeout occured, return false. Without the file size request, the
+    // connection is made here, so the time up to the first data is the handshake time.
     uint16_t _len = 0;
-    if (!WiFi.getSimpleAtResponse(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE, 5000ULL, &_len))
+    if (!_modem->getSimpleAtResponseAdaptive(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE,
+                                              INKPLATE_ESP32_TIMEOUT_FIRST_DATA, &_len))
         return false;
+    if (!_useFileSize)
+        _handshakeTime = millis() - _startTime;
 
     // Check for the "ERROR". If error is found, return false.
     // if (strstr(_dataBuffer, esp32AtCmdResponseError) != NULL) return false;
 
     // if (!cleanHttpGetResponse(_dataBuffer, &_bufferLen)) return false;
+    resultCheck(_len);
     _bufferLen += _len;
+    _received += _len;
     _currentPos = _dataBuffer;
 
     return true;
 }
 
+#ifdef INKPLATE_ESP32_COROUTINES
+/**
+ * @brief   Same as connect(), but the long waits (file size and the first data chunk) do not block, so other
+ *          tasks run in the meantime (co_await client.connectAsync(url)). Short setup of the message filter is
+ *          still done at once. Modem is kept for the whole sequence, so the commands of the other tasks do not
+ *          take its responses.
+ *
+ * @param   const char* _url
+ *          URL of the client (it must stay valid until the task is done).
+ * @return  AtTask
+ *          Task with the result (true - connected, first chunk of data already received, false - failed).
+ */
+AtTask WiFiClient::connectAsync(const char *_url)
+{
+    // Set data len to zero. And also file size.
+    _bufferLen = 0;
+    _fileSize = 0;
+    _received = 0;
+    _timedOut = false;
+    _failed = false;
+
+    // Wait for the other tasks to finish with the modem and keep it until the first data chunk arrives.
+    co_await _modem->lock(this);
+
+    // Set the URL, message filter and turn off the echo.
+    if (!setup(_url))
+    {
+        _modem->awaitUnlock(this);
+        co_return false;
+    }
+
+    // Try to get the file size. This also serves as connection to the client.
+    unsigned long _startTime = millis();
+    if (_useFileSize && _modem->sendAtCommand("AT+HTTPGETSIZE=\"\"\r\n"))
+    {
+        if (co_await _modem->frame(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE, 30000UL, this) >= 0)
+            _fileSize = parseFileSize();
+        _handshakeTime = millis() - _startTime;
+
+        // Wait a little bit. Otherwise modem fires "busy" message.
+        co_await atSleep(10);
+        _startTime = millis();
+    }
+
+    // Try to connect to the host. Return false if failed.
+    if (!_modem->sendAtCommand("AT+HTTPCGET=\"\",4096,4096,10000\r\n"))
+    {
+        _modem->awaitUnlock(this);
+        co_return false;
+    }
+
+    // Wait for the first data chunk. If timeout occured, return false.
+    int _len = co_await _modem->frame(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE,
+                                      _modem->timeout(INKPLATE_ESP32_TIMEOUT_FIRST_DATA), this);
+    _modem->awaitUnlock(this);
+    if (_len < 0)
+        co_return false;
+    if (!_useFileSize)
+        _handshakeTime = millis() - _startTime;
+
+    resultCheck(_len);
+    _bufferLen = _len;
+    _received = _len;
+    _currentPos = _dataBuffer;
+
+    co_return true;
+}
+
+/**
+ * @brief   Wait for the next chunk of data without blocking (co_await client.readChunk()). Nothing is done if
+ *          there is still some data in the buffer. Use read() to get the data.
+ *
+ * @param   unsigned long _timeout
+ *          Max. time to wait for the new data (in milliseconds).
+ * @return  AtTask
+ *          Task with the result (true - data available, false - timeout, no more data).
+ */
+AtTask WiFiClient::readChunk(unsigned long _timeout)
+{
+    // Data from the last chunk is not read yet.
+    if (_bufferLen != 0)
+        co_return true;
+
+    // Wait for the new data. Timeout before the end of the file (or if the size is not known) is not the end
+    // of the data, see timedOut().
+    int _len = co_await _modem->frame(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE, _timeout);
+    if (_len <= 0)
+    {
+        if ((_fileSize == 0) || (_received < _fileSize))
+            _timedOut = true;
+        co_return false;
+    }
+
+    resultCheck(_len);
+    _bufferLen = _len;
+    _received += _len;
+    _currentPos = _dataBuffer;
+
+    co_return true;
+}
+#endif
+
+/**
+ * @brief   Helper method for setting the URL and the message filter (pass-trough mode) and for turning off
+ *          the echo before the HTTP GET.
+ *
+ * @param   const char* _url
+ *          URL of the client.
+ * @return  bool
+ *          true - Modem is ready for the HTTP GET.
+ *          false - Some command failed.
+ */
+bool WiFiClient::setup(const char *_url)
+{
+    // For plain HTTP, connect to the IP Address from the DNS cache, so modem does not have to
+    // resolve the same host on every request. If it fails, just use the URL as it is.
+    char _resolvedUrl[INKPLATE_ESP32_HTTP_MAX_URL_LEN];
+    if (_useDnsCache && resolveUrl(_url, _resolvedUrl, sizeof(_resolvedUrl)))
+        _url = _resolvedUrl;
+    else if ((_hostHeader[0] != '\0') && !replaceHostHeader(""))
+        return false;
+
+    // All steps go as one batch, each one right after the previous one is done. Steps without a reliable
+    // result code (data after the prompt and the commands sent while the filter is being set) still wait for
+    // the modem to go quiet.
+    AtPipeline _batch(*_modem);
+
+    // Set the URL since HTTPCGET has limitations on the URL size and on characters.
+    // Escape char must be sent at the end!
+    AtCommandBuilder _cmd(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE);
+    _cmd.add("AT+HTTPURLCFG=").addUInt(strlen(_url)).end();
+    _batch.add(_cmd, esp32AtLinkSendPrompt);
+    _batch.add(_url, NULL);
+    _batch.addRaw(esp32AtCmdEscapeChar, sizeof(esp32AtCmdEscapeChar), NULL);
+
+    // First set the message filter to set the modem in pass-trough mode.
+    // Remove the header and "enter" at the end.
+    _batch.add("AT+SYSMSGFILTERCFG=1,18,3\r\n", esp32AtLinkSendPrompt);
+    _batch.add("^+HTTPCGET:[0-9]*,\r\n$", NULL);
+    _batch.addRaw(esp32AtCmdEscapeChar, sizeof(esp32AtCmdEscapeChar), NULL);
+
+    // Remove "OK" at the end.
+    _batch.add("AT+SYSMSGFILTERCFG=1,0,7\r\n", esp32AtLinkSendPrompt);
+    _batch.add("\r\nOK\r\n$", NULL);
+
+    // Enable the message filter.
+    _batch.add("AT+SYSMSGFILTER=1\r\n", NULL);
+
+    // Turn the Echo off.
+    _batch.add("ATE0\r\n", NULL);
+
+    // Send all of them.
+    return _batch.run(INKPLATE_ESP32_PIPELINE_TIMEOUT);
+}
+
 /**
  * @brief   Method returns available bytes to read (and also checks for the new data).
  *
  * @param   bool _blocking
  *          Checking for new data can be done with blocking method. If blocking method is used,
- *          available will wait until new arrives (or timeout occurs after 2.5 seconds). If
+ *          available will wait until new arrives (or the adaptive timeout occurs, 2.5 seconds by default,
+ *          see INKPLATE_ESP32_TIMEOUT_AVAILABLE). Timeout before the whole file has been received (or if the
+ *          file size is not known) is not the end of the data, check timedOut(). If
  *          non-blocking method is used, it's up to the user to ensure timeout and data receive
  *          end event.
  * @return  int
@@ -129,24 +260,38 @@ int WiFiClient::available(bool _blocking)
         // Calculate the timeout value for new data. If blocking method is enabled,
         // use longer timeout value. Otherwise, use shorter timeout value (but in this case user
         // must create some kind of mechanism to know when all data has been received).
-        uint16_t _timeoutValue = _blocking ? 2500ULL : 20UL;
+        // Blocking timeout is learned from the gaps between the chunks (never below the default one).
+        bool _newData;
 
         // Set variable for data chunk size to zero.
         uint16_t _len = 0;
 
         // Try to get new data. If new data is available, update the size and current pointer for the data.
-        if (WiFi.getSimpleAtResponse(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE, _timeoutValue, &_len))
+        if (_blocking)
+            _newData = _modem->getSimpleAtResponseAdaptive(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE,
+                                                           INKPLATE_ESP32_TIMEOUT_AVAILABLE, &_len, false);
+        else
+            _newData = _modem->getSimpleAtResponse(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE, 20UL, &_len);
+
+        if (_newData)
         {
             // if (strstr(_dataBuffer, esp32AtCmdResponseError) == NULL)
             //{
             // uint16_t _len = 0;
             // if (cleanHttpGetResponse(_dataBuffer, &_len))
             //{
+            resultCheck(_len);
             _bufferLen += _len;
+            _received += _len;
             _currentPos = _dataBuffer;
             //}
             //}
         }
+        else if (_blocking && ((_fileSize == 0) || (_received < _fileSize)))
+        {
+            // No data in time, but the file is not complete (or its size is unknown). Data may be cut.
+            _timedOut = true;
+        }
     }
 
     // Return the current buffer size.
@@ -214,6 +359,39 @@ char WiFiClient::read()
     return _c;
 }
 
+/**
+ * @brief   Get the received data without copying it (call available() first). Data stays in the modem buffer,
+ *          so it's valid only until the next available() or the next command. Use consume() when done with it.
+ *
+ * @param   uint16_t *_len
+ *          Where to store the number of bytes available at the returned pointer.
+ * @return  const char*
+ *          Pointer to the data, NULL if there is no data in the buffer.
+ */
+const char *WiFiClient::chunk(uint16_t *_len)
+{
+    *_len = _bufferLen;
+
+    return (_bufferLen != 0) ? _currentPos : NULL;
+}
+
+/**
+ * @brief   Drop the data from the buffer without copying it (same as read(), but without the copy).
+ *
+ * @param   uint16_t _len
+ *          Number of bytes to drop (cut to the number of bytes in the buffer).
+ */
+void WiFiClient::consume(uint16_t _len)
+{
+    // Can't drop more than there is.
+    if (_len > _bufferLen)
+        _len = _bufferLen;
+
+    // Update the variables for offset and data length.
+    _bufferLen -= _len;
+    _currentPos += _len;
+}
+
 /**
  * @brief   End HTTP transfer. Disable all message filters enabled in WiFi::connect() and
  *          turn on echo on commands (in other words, set everything back to normal).
@@ -224,30 +402,25 @@ char WiFiClient::read()
  */
 bool WiFiClient::end()
 {
+    // All steps go as one batch. Result codes can still be filtered until the filter is disabled.
+    AtPipeline _batch(*_modem);
+
     // Clear all message filters used in http get.
-    if (!WiFi.sendAtCommand("AT+SYSMSGFILTERCFG=0\r\n"))
-        return false;
-    if (!WiFi.getAtResponse(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE, 20ULL))
-        return false;
+    _batch.add("AT+SYSMSGFILTERCFG=0\r\n", NULL);
 
     // Disable the filter.
-    if (!WiFi.sendAtCommand("AT+SYSMSGFILTER=0\r\n"))
-        return false;
-    if (!WiFi.getAtResponse(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE, 20ULL))
-        return false;
+    _batch.add("AT+SYSMSGFILTER=0\r\n", NULL);
 
     // Turn on echo back.
-    // Turn the Echo off.
-    if (!WiFi.sendAtCommand("ATE1\r\n"))
-        return false;
-    if (!WiFi.getAtResponse(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE, 20ULL))
-        return false;
+    _batch.add("ATE1\r\n");
 
-    // Clear all HTTP headers.
-    if (!addHeader(NULL)) return false;
+    // Clear all HTTP headers (host header included).
+    _batch.add("AT+HTTPCHEAD=0\r\n");
+    _hostHeader[0] = '\0';
+    _userHeadersLen = 0;
 
-    // Everything went ok? Return true for success.
-    return true;
+    // Send all of them. Everything went ok? Return true for success.
+    return _batch.run(INKPLATE_ESP32_PIPELINE_TIMEOUT);
 }
 
 /**
@@ -262,33 +435,269 @@ int WiFiClient::size()
     return _fileSize;
 }
 
+/**
+ * @brief   Add the header to the HTTP requests (until end() or addHeader(NULL)). Headers are kept (see
+ *          INKPLATE_ESP32_HTTP_HEADERS_LEN), so they stay when the host header is replaced.
+ *
+ * @param   char *_header
+ *          Header line without CRLF (NULL - clear all headers).
+ * @return  bool
+ *          true - Header added (or all cleared).
+ *          false - No room for the header or the command failed.
+ */
 bool WiFiClient::addHeader(char *_header)
 {
     // Check if the _header is equal to NULL. If so,
     // clear all the headers.
     if (_header == NULL)
     {
-        if (!WiFi.sendAtCommand("AT+HTTPCHEAD=0\r\n"));
-        if (!WiFi.getAtResponse(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE, 40ULL)) return false;
+        _hostHeader[0] = '\0';
+        _userHeadersLen = 0;
+        if (!_modem->sendAtCommand("AT+HTTPCHEAD=0\r\n")) return false;
+        if (!_modem->getAtResponseAdaptive(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE,
+                                           INKPLATE_ESP32_TIMEOUT_SHORT))
+            return false;
     }
     else
     {
+        // Check if it can be kept, otherwise it would be lost with the next host header.
+        uint16_t _len = strlen(_header) + 1;
+        if ((_userHeadersLen + _len) > sizeof(_userHeaders))
+            return false;
+
         // Otherwise, add header to the HTTP request.
-        sprintf(_dataBuffer, "AT+HTTPCHEAD=%d\r\n", strlen(_header));
+        if (!sendHeader(_header))
+            return false;
+
+        memcpy(_userHeaders + _userHeadersLen, _header, _len);
+        _userHeadersLen += _len;
+    }
+
+    // Everything went ok? Return true!
+    return true;
+}
 
-        // Send the command and the HTTP header size. 
-        if (!WiFi.sendAtCommand(_dataBuffer)) return false;
-        if (!WiFi.getAtResponse(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE, 40ULL)) return false;
+/**
+ * @brief   Helper method for adding one header to the HTTP requests on the modem (AT+HTTPCHEAD).
+ *
+ * @param   const char *_header
+ *          Header line without CRLF.
+ * @return  bool
+ *          true - Header added.
+ *          false - Command failed.
+ */
+bool WiFiClient::sendHeader(const char *_header)
+{
+    AtCommandBuilder _cmd(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE);
+    _cmd.add("AT+HTTPCHEAD=").addUInt(strlen(_header)).end();
 
-        // Send the header itself.
-        if (!WiFi.sendAtCommand(_header)) return false;
-        if (!WiFi.getAtResponse(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE, 40ULL)) return false;
+    // Send the command and the HTTP header size. 
+    if (!_modem->sendAtCommand(_cmd)) return false;
+    if (!_modem->getAtResponseAdaptive(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE,
+                                       INKPLATE_ESP32_TIMEOUT_SHORT))
+        return false;
+
+    // Send the header itself.
+    if (!_modem->sendAtCommand((char *)_header)) return false;
+    if (!_modem->getAtResponseAdaptive(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE,
+                                       INKPLATE_ESP32_TIMEOUT_SHORT))
+        return false;
+
+    // Send escape char to end the AT command.
+    if (!_modem->sendAtData(esp32AtCmdEscapeChar, sizeof(esp32AtCmdEscapeChar))) return false;
+    if (!_modem->getAtResponseAdaptive(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE,
+                                       INKPLATE_ESP32_TIMEOUT_SHORT))
+        return false;
+
+    return true;
+}
 
-        // Send escape char to end the AT command.
-        if (!WiFi.sendAtCommand((char *)esp32AtCmdEscapeChar))
-        if (!WiFi.getAtResponse(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE, 40ULL)) return false;
+/**
+ * @brief   Helper method for replacing the host header. Modem can only clear all headers, so the headers of the
+ *          user are added again after the old host header is gone.
+ *
+ * @param   const char *_header
+ *          New host header ("" - none).
+ * @return  bool
+ *          true - Host header replaced.
+ *          false - Command failed (headers may be missing, host header is cleared).
+ */
+bool WiFiClient::replaceHostHeader(const char *_header)
+{
+    // Nothing to remove? Just add the new one.
+    if (_hostHeader[0] != '\0')
+    {
+        _hostHeader[0] = '\0';
+        if (!_modem->sendAtCommand("AT+HTTPCHEAD=0\r\n")) return false;
+        if (!_modem->getAtResponseAdaptive(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE,
+                                           INKPLATE_ESP32_TIMEOUT_SHORT))
+            return false;
+
+        // Headers of the user again.
+        for (uint16_t _pos = 0; _pos < _userHeadersLen; _pos += strlen(_userHeaders + _pos) + 1)
+        {
+            if (!sendHeader(_userHeaders + _pos))
+                return false;
+        }
     }
 
+    // Add the new one.
+    if ((_header[0] != '\0') && !sendHeader(_header))
+        return false;
+
+    strcpy(_hostHeader, _header);
+
+    return true;
+}
+
+/**
+ * @brief   Enable or disable using the DNS cache (WiFiClass::resolve()) for plain HTTP requests.
+ *          It's enabled by default. HTTPS requests always use the host name, since it's needed for
+ *          the certificate check.
+ *
+ * @param   bool _en
+ *          true - Connect to the cached IP Address of the host.
+ *          false - Let the modem resolve the host name on every request.
+ */
+void WiFiClient::useDnsCache(bool _en)
+{
+    _useDnsCache = _en;
+}
+
+/**
+ * @brief   Enable or disable the file size request in connect(). It's enabled by default. ESP-AT opens a new
+ *          connection for each HTTP command, so the size request costs one more TLS handshake on HTTPS. Disable
+ *          it if the size is not needed (size() returns 0).
+ *
+ * @param   bool _en
+ *          true - Get the file size before the data.
+ *          false - Get only the data (one connection per request).
+ */
+void WiFiClient::useFileSize(bool _en)
+{
+    _useFileSize = _en;
+}
+
+/**
+ * @brief   Get the time needed for the connection to the host by the last connect() (DNS, TCP, TLS handshake and
+ *          the first response of the server), so it can be told apart from the transfer time.
+ *
+ * @return  unsigned long
+ *          Time in milliseconds.
+ */
+unsigned long WiFiClient::handshakeTime()
+{
+    return _handshakeTime;
+}
+
+/**
+ * @brief   Check if the data stopped before the end of the file. Blocking available() (or readChunk()) ran into
+ *          the timeout before the file size reported by the server has been received, or the file size is not
+ *          known, so there is no way to tell the end of the data from the pause of the server.
+ *
+ * @return  bool
+ *          true - Data may be cut, do not use it as complete.
+ *          false - All data of the file has been received (or no timeout so far).
+ */
+bool WiFiClient::timedOut()
+{
+    return _timedOut;
+}
+
+/**
+ * @brief   Check if the modem reported that the request failed. Message filter removes only "OK" at the end of
+ *          the data, so "ERROR" comes through as the last part of the data. ESP-AT ends the request this way if
+ *          the server responded with the error status (4xx, 5xx, the error page may still come before it) or
+ *          the connection failed.
+ *
+ * @return  bool
+ *          true - Request failed, data is not the requested file.
+ *          false - No error reported so far.
+ */
+bool WiFiClient::failed()
+{
+    return _failed;
+}
+
+/**
+ * @brief   Helper method for checking the received chunk for the "ERROR" at its end (see failed()).
+ *
+ * @param   uint16_t _len
+ *          Length of the chunk in the data buffer.
+ */
+void WiFiClient::resultCheck(uint16_t _len)
+{
+    uint16_t _errorLen = sizeof(esp32AtResponseError) - 1;
+
+    if ((_len >= _errorLen) && (memcmp(_dataBuffer + _len - _errorLen, esp32AtResponseError, _errorLen) == 0))
+        _failed = true;
+}
+
+/**
+ * @brief   Replace the host name in the plain HTTP URL with its IP Address from the DNS cache and
+ *          add the "Host:" header (once per request, with the port if the URL has one), so the server still knows
+ *          which host is requested.
+ *
+ * @param   const char *_url
+ *          URL of the client.
+ * @param   char *_resolvedUrl
+ *          Buffer where the URL with the IP Address will be stored.
+ * @param   uint16_t _resolvedUrlLen
+ *          Size of the buffer for the new URL (in bytes, counting the null-terminating char).
+ * @return  bool
+ *          true - URL with the IP Address is stored in the buffer.
+ *          false - URL can't be resolved (HTTPS, IP Address already used, DNS failed, URL too long).
+ */
+bool WiFiClient::resolveUrl(const char *_url, char *_resolvedUrl, uint16_t _resolvedUrlLen)
+{
+    // Only plain HTTP can be used.
+    if (strncmp(_url, "http://", 7) != 0)
+        return false;
+
+    // Find the end of the host name (port, path, query or end of the URL).
+    const char *_hostStart = _url + 7;
+    size_t _hostLen = strcspn(_hostStart, ":/?#");
+
+    // Check if the host name can fit into the DNS cache.
+    if ((_hostLen == 0) || (_hostLen >= INKPLATE_ESP32_DNS_CACHE_HOST_LEN))
+        return false;
+
+    // Copy the host name.
+    char _host[INKPLATE_ESP32_DNS_CACHE_HOST_LEN];
+    memcpy(_host, _hostStart, _hostLen);
+    _host[_hostLen] = '\0';
+
+    // No need to do anything if the IP Address is already used.
+    IPAddress _ip;
+    if (_ip.fromString(_host))
+        return false;
+
+    // Get the IP Address (from the cache if possible).
+    _ip = _modem->resolve(_host);
+    if (_ip == INADDR_NONE)
+        return false;
+
+    // Make a new URL. Check if it fits into the buffer.
+    AtCommandBuilder _newUrl(_resolvedUrl, _resolvedUrlLen);
+    _newUrl.add("http://").addIp(_ip).addRaw(_hostStart + _hostLen, strlen(_hostStart + _hostLen));
+    if (_newUrl.overflow())
+        return false;
+
+    // Add the host header (with the port, if it's not the default one), since the request is now sent to the IP
+    // Address. Header set by AT+HTTPCHEAD overrides the default one.
+    const char *_portStart = _hostStart + _hostLen;
+    size_t _portLen = (*_portStart == ':') ? strcspn(_portStart, "/?#") : 0;
+    char _newHostHeader[sizeof(_hostHeader)];
+    AtCommandBuilder _header(_newHostHeader, sizeof(_newHostHeader));
+    _header.add("Host: ").addRaw(_host, _hostLen).addRaw(_portStart, _portLen);
+    if (_header.overflow())
+        return false;
+
+    // Headers stay until end(), so add it only once per request. Different host needs the new host header (the
+    // headers of the user stay).
+    if ((strcmp(_newHostHeader, _hostHeader) != 0) && !replaceHostHeader(_newHostHeader))
+        return false;
+
     // Everything went ok? Return true!
     return true;
 }
@@ -306,22 +715,31 @@ bool WiFiClient::addHeader(char *_header)
  */
 int WiFiClient::getFileSize(char *_url, uint32_t _timeout)
 {
-    int _size = 0;
-
-    // Make a AT commands for the file size.
-    sprintf(_dataBuffer, "AT+HTTPGETSIZE=\"\"\r\n", _url);
-
-    // Send a AT commnds to the modem. Return 0 if failed.
-    if (!WiFi.sendAtCommand(_dataBuffer))
+    // Send a AT commnds for the file size to the modem (URL is already set). Return 0 if failed.
+    if (!_modem->sendAtCommand("AT+HTTPGETSIZE=\"\"\r\n"))
         return 0;
 
     // Try to get the response. Return 0 if failed.
-    if (!WiFi.getSimpleAtResponse(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE, _timeout))
+    if (!_modem->getSimpleAtResponse(_dataBuffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE, _timeout))
         return 0;
 
     // Wait a little bit. Otherwise modem fires "busy" message.
     delay(10);
 
+    // Parse the reponse.
+    return parseFileSize();
+}
+
+/**
+ * @brief   Helper method for parsing the file size from the AT+HTTPGETSIZE response in the data buffer.
+ *
+ * @return  int
+ *          File size (in bytes). If zero, failed to get the file size.
+ */
+int WiFiClient::parseFileSize()
+{
+    int _size = 0;
+
     // Parse the reponse. Return 0 if something failed.
     if (strstr(_dataBuffer, "+HTTPGETSIZE:"))
     {
@@ -8,27 +8,72 @@
 // Include main ESP32-C3 AT SPI library.
 #include "esp32SpiAt.h"
 
+// Max. length of the URL with the host name replaced by the IP address from the DNS cache.
+#ifndef INKPLATE_ESP32_HTTP_MAX_URL_LEN
+#define INKPLATE_ESP32_HTTP_MAX_URL_LEN 256
+#endif
+
+// Room for the headers added with addHeader() (in bytes, with the null-terminating char of each one). They are
+// kept, so they can be set again when the host header has to be replaced.
+#ifndef INKPLATE_ESP32_HTTP_HEADERS_LEN
+#define INKPLATE_ESP32_HTTP_HEADERS_LEN 512
+#endif
+
 // Class for HTTP over SPI AT commands.
 class WiFiClient
 {
   public:
-    WiFiClient();
+    WiFiClient(WiFiClass &_wifiModem = WiFi);
     bool connect(const char *_url);
     int available(bool _blocking = true);
     uint16_t read(char *_buffer, uint16_t _len);
     char read();
+    const char *chunk(uint16_t *_len);
+    void consume(uint16_t _len);
     bool end();
     int size();
     bool addHeader(char *_header);
+    void useDnsCache(bool _en);
+    void useFileSize(bool _en);
+    unsigned long handshakeTime();
+    bool timedOut();
+    bool failed();
+
+#ifdef INKPLATE_ESP32_COROUTINES
+    // Public awaitable functions (co_await).
+    AtTask connectAsync(const char *_url);
+    AtTask readChunk(unsigned long _timeout = 2500UL);
+#endif
 
   private:
+    // Modem used by this object.
+    WiFiClass *_modem;
+
+    bool setup(const char *_url);
+    int parseFileSize();
+    void resultCheck(uint16_t _len);
     int cleanHttpGetResponse(char *_buffer, uint16_t *_len);
     int getFileSize(char *_url, uint32_t _timeout);
+    bool resolveUrl(const char *_url, char *_resolvedUrl, uint16_t _resolvedUrlLen);
+    bool sendHeader(const char *_header);
+    bool replaceHostHeader(const char *_header);
 
     uint16_t _bufferLen = 0;
     char *_currentPos = NULL;
     char *_dataBuffer = NULL;
     uint32_t _fileSize = 0;
+    uint32_t _received = 0;
+    bool _timedOut = false;
+    bool _failed = false;
+    bool _useDnsCache = true;
+    bool _useFileSize = true;
+    unsigned long _handshakeTime = 0;
+
+    // Host header added for the request sent to the IP Address from the DNS cache (empty - none) and the headers
+    // of the user (one after another, each one with the null-terminating char).
+    char _hostHeader[INKPLATE_ESP32_DNS_CACHE_HOST_LEN + 16];
+    char _userHeaders[INKPLATE_ESP32_HTTP_HEADERS_LEN];
+    uint16_t _userHeadersLen = 0;
 };
 
 #endif
\ No newline at end of file
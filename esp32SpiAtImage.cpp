@@ -0,0 +1,1238 @@
+// Include main header file.
+#include "esp32SpiAt.h"
+
+// Base lengths and distances of the deflate length and distance codes and the number of their extra bits.
+static const uint16_t _inflateLengthBase[29] = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                                31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const uint8_t _inflateLengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                                2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const uint16_t _inflateDistBase[30] = {1,    2,    3,    4,    5,    7,     9,     13,    17,  25,
+                                              33,   49,   65,   97,   129,  193,   257,   385,   513, 769,
+                                              1025, 1537, 2049, 3073, 4097, 6145,  8193,  12289, 16385, 24577};
+static const uint8_t _inflateDistExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6,
+                                              6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+// Order of the code length code lengths in the dynamic block header.
+static const uint8_t _inflateCodeOrder[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+// Helper functions for reading the multi-byte values from the headers.
+static inline uint16_t imageLe16(const uint8_t *_p)
+{
+    return (uint16_t)_p[0] | ((uint16_t)_p[1] << 8);
+}
+
+static inline uint32_t imageLe32(const uint8_t *_p)
+{
+    return (uint32_t)_p[0] | ((uint32_t)_p[1] << 8) | ((uint32_t)_p[2] << 16) | ((uint32_t)_p[3] << 24);
+}
+
+static inline uint32_t imageBe32(const uint8_t *_p)
+{
+    return ((uint32_t)_p[0] << 24) | ((uint32_t)_p[1] << 16) | ((uint32_t)_p[2] << 8) | (uint32_t)_p[3];
+}
+
+// Helper functions for the conversion into 8 bit grayscale (alpha is blended over the white background).
+static inline uint8_t imageGray(uint8_t _r, uint8_t _g, uint8_t _b)
+{
+    return (uint8_t)((((uint16_t)_r * 77) + ((uint16_t)_g * 150) + ((uint16_t)_b * 29)) >> 8);
+}
+
+static inline uint8_t imageBlend(uint8_t _gray, uint8_t _alpha)
+{
+    return (uint8_t)((((uint16_t)_gray * _alpha) + (255 * (uint16_t)(255 - _alpha)) + 127) / 255);
+}
+
+/**
+ * @brief Construct a new ImageDecoder object - for decoding the images into the framebuffer.
+ *
+ * @param   uint8_t *_workBuffer
+ *          Work buffer for the rows and the inflate window (see esp32SpiAtImage.h for the needed size).
+ * @param   uint32_t _workBufferSize
+ *          Size of the work buffer (in bytes).
+ */
+ImageDecoder::ImageDecoder(uint8_t *_workBuffer, uint32_t _workBufferSize)
+{
+    _work = _workBuffer;
+    _workSize = (_workBuffer != NULL) ? _workBufferSize : 0;
+}
+
+/**
+ * @brief   Decode the image from the client (call it right after connect()). Each row goes into the framebuffer
+ *          (and to the row callback, if set) as soon as it's decoded, so the image is drawn while the rest of it
+ *          is still arriving. Parts of the image outside the framebuffer are cut.
+ *
+ * @param   WiFiClient &_client
+ *          Connected client.
+ * @param   struct spiAtFramebufferTypedef *_framebuffer
+ *          Framebuffer of the display (NULL - use only the row callback).
+ * @param   int16_t _x
+ *          X position of the upper left corner of the image in the framebuffer.
+ * @param   int16_t _y
+ *          Y position of the upper left corner of the image in the framebuffer.
+ * @return  bool
+ *          true - Image decoded.
+ *          false - Decode failed (see lastError()), rows decoded so far are already in the framebuffer.
+ */
+bool ImageDecoder::decode(WiFiClient &_client, struct spiAtFramebufferTypedef *_framebuffer, int16_t _x, int16_t _y)
+{
+    // Capture the time!
+    unsigned long _startTime = millis();
+
+    // Set the source and the output.
+    _source = &_client;
+    _in = NULL;
+    _inLen = 0;
+    _waitTime = 0;
+    _target = _framebuffer;
+    _targetX = _x;
+    _targetY = _y;
+    _width = 0;
+    _height = 0;
+    _lastError = INKPLATE_ESP32_IMAGE_OK;
+
+    // Format is known from the first two bytes.
+    bool _decoded;
+    uint8_t _magic[2];
+    if (!readBytes(_magic, sizeof(_magic)))
+        _decoded = false;
+    else if ((_magic[0] == 'B') && (_magic[1] == 'M'))
+        _decoded = decodeBmp();
+    else if ((_magic[0] == 0x89) && (_magic[1] == 'P'))
+        _decoded = decodePng();
+    else
+        _decoded = fail(INKPLATE_ESP32_IMAGE_FORMAT);
+
+    _elapsed = millis() - _startTime;
+
+    return _decoded;
+}
+
+/**
+ * @brief   Set the callback for the decoded rows (for drawing the image in some other way than into the
+ *          framebuffer, or for drawing something over it).
+ *
+ * @param   imageRowCallback _callback
+ *          Callback function (NULL - no callback).
+ */
+void ImageDecoder::onRow(imageRowCallback _callback)
+{
+    _rowCallback = _callback;
+}
+
+/**
+ * @brief   Get the result of the last decode.
+ *
+ * @return  uint8_t
+ *          INKPLATE_ESP32_IMAGE_OK - Image decoded.
+ *          INKPLATE_ESP32_IMAGE_TRUNCATED - Data ended before the end of the image.
+ *          INKPLATE_ESP32_IMAGE_FORMAT - Format (or its variant) is not supported.
+ *          INKPLATE_ESP32_IMAGE_CORRUPT - Image data is not valid.
+ *          INKPLATE_ESP32_IMAGE_MEMORY - Work buffer is too small for the image.
+ */
+uint8_t ImageDecoder::lastError()
+{
+    return _lastError;
+}
+
+/**
+ * @brief   Get the width of the last image.
+ *
+ * @return  uint16_t
+ *          Width in pixels (0 if the header has not been decoded).
+ */
+uint16_t ImageDecoder::width()
+{
+    return _width;
+}
+
+/**
+ * @brief   Get the height of the last image.
+ *
+ * @return  uint16_t
+ *          Height in pixels (0 if the header has not been decoded).
+ */
+uint16_t ImageDecoder::height()
+{
+    return _height;
+}
+
+/**
+ * @brief   Get the duration of the last decode (including the time spent waiting for the data).
+ *
+ * @return  unsigned long
+ *          Time in milliseconds.
+ */
+unsigned long ImageDecoder::elapsed()
+{
+    return _elapsed;
+}
+
+/**
+ * @brief   Get the time the last decode spent waiting for the data. The rest of elapsed() is the decode itself.
+ *
+ * @return  unsigned long
+ *          Time in milliseconds.
+ */
+unsigned long ImageDecoder::waitTime()
+{
+    return _waitTime;
+}
+
+/**
+ * @brief   Helper method for getting the next chunk of the data from the client (without copying it).
+ *
+ * @return  bool
+ *          true - New data is available.
+ *          false - No more data.
+ */
+bool ImageDecoder::nextChunk()
+{
+    // Wait for the new data (until the adaptive timeout of the client).
+    unsigned long _startTime = millis();
+    int _available = _source->available();
+    _waitTime += millis() - _startTime;
+
+    if (_available <= 0)
+        return fail(INKPLATE_ESP32_IMAGE_TRUNCATED);
+
+    // Take all of it. It stays in the modem buffer until the next available().
+    _in = (const uint8_t *)_source->chunk(&_inLen);
+    _source->consume(_inLen);
+
+    return true;
+}
+
+/**
+ * @brief   Helper method for reading one byte of the image.
+ *
+ * @param   uint8_t *_c
+ *          Where to store the byte.
+ * @return  bool
+ *          true - Byte read.
+ *          false - No more data.
+ */
+bool ImageDecoder::readByte(uint8_t *_c)
+{
+    if ((_inLen == 0) && !nextChunk())
+        return false;
+
+    *_c = *(_in++);
+    _inLen--;
+
+    return true;
+}
+
+/**
+ * @brief   Helper method for reading more bytes of the image.
+ *
+ * @param   uint8_t *_buffer
+ *          Where to store the bytes.
+ * @param   uint32_t _len
+ *          Number of bytes.
+ * @return  bool
+ *          true - Bytes read.
+ *          false - No more data.
+ */
+bool ImageDecoder::readBytes(uint8_t *_buffer, uint32_t _len)
+{
+    while (_len != 0)
+    {
+        if ((_inLen == 0) && !nextChunk())
+            return false;
+
+        uint16_t _copy = (_len < _inLen) ? _len : _inLen;
+        memcpy(_buffer, _in, _copy);
+        _buffer += _copy;
+        _in += _copy;
+        _inLen -= _copy;
+        _len -= _copy;
+    }
+
+    return true;
+}
+
+/**
+ * @brief   Helper method for skipping the bytes of the image.
+ *
+ * @param   uint32_t _len
+ *          Number of bytes.
+ * @return  bool
+ *          true - Bytes skipped.
+ *          false - No more data.
+ */
+bool ImageDecoder::skipBytes(uint32_t _len)
+{
+    while (_len != 0)
+    {
+        if ((_inLen == 0) && !nextChunk())
+            return false;
+
+        uint16_t _skip = (_len < _inLen) ? _len : _inLen;
+        _in += _skip;
+        _inLen -= _skip;
+        _len -= _skip;
+    }
+
+    return true;
+}
+
+/**
+ * @brief   Helper method for setting the error of the decode (only the first one is kept).
+ *
+ * @param   uint8_t _error
+ *          Error (one of INKPLATE_ESP32_IMAGE_...).
+ * @return  bool
+ *          Always false.
+ */
+bool ImageDecoder::fail(uint8_t _error)
+{
+    if (_lastError == INKPLATE_ESP32_IMAGE_OK)
+        _lastError = _error;
+
+    return false;
+}
+
+/**
+ * @brief   Helper method for decoding the BMP image ("BM" is already read).
+ *
+ * @return  bool
+ *          true - Image decoded.
+ *          false - Decode failed.
+ */
+bool ImageDecoder::decodeBmp()
+{
+    uint8_t _header[40];
+
+    // Rest of the file header (file size, reserved and the offset of the pixel data) and the size of the DIB
+    // header.
+    if (!readBytes(_header, 16))
+        return false;
+    uint32_t _dataOffset = imageLe32(&_header[8]);
+    uint32_t _dibSize = imageLe32(&_header[12]);
+    if ((_dibSize != 12) && (_dibSize < 40))
+        return fail(INKPLATE_ESP32_IMAGE_FORMAT);
+
+    // DIB header (only the fields of the BITMAPINFOHEADER are used, rest of the newer headers is skipped).
+    uint32_t _dibRead = (_dibSize == 12) ? 12 : 40;
+    if (!readBytes(&_header[4], _dibRead - 4) || !skipBytes(_dibSize - _dibRead))
+        return false;
+
+    int32_t _w;
+    int32_t _h;
+    uint32_t _compression = 0;
+    uint32_t _colors = 0;
+    if (_dibSize == 12)
+    {
+        _w = imageLe16(&_header[4]);
+        _h = (int16_t)imageLe16(&_header[6]);
+        _bmpBpp = imageLe16(&_header[10]);
+    }
+    else
+    {
+        _w = (int32_t)imageLe32(&_header[4]);
+        _h = (int32_t)imageLe32(&_header[8]);
+        _bmpBpp = imageLe16(&_header[14]);
+        _compression = imageLe32(&_header[16]);
+        _colors = imageLe32(&_header[32]);
+    }
+
+    // Negative height means the rows go from the top.
+    _bmpTopDown = (_h < 0);
+    if (_bmpTopDown)
+        _h = -_h;
+
+    // Only uncompressed images are supported.
+    if ((_w <= 0) || (_w > 65535) || (_h == 0) || (_h > 65535))
+        return fail(INKPLATE_ESP32_IMAGE_CORRUPT);
+    if ((_compression != 0) || ((_bmpBpp != 1) && (_bmpBpp != 4) && (_bmpBpp != 8) && (_bmpBpp != 16) &&
+                                (_bmpBpp != 24) && (_bmpBpp != 32)))
+        return fail(INKPLATE_ESP32_IMAGE_FORMAT);
+    _width = _w;
+    _height = _h;
+
+    // Palette (stored as the gray value). BITMAPCOREHEADER has 3 bytes per color.
+    uint32_t _pos = 14 + _dibSize;
+    memset(_palette, 0, sizeof(_palette));
+    if (_bmpBpp <= 8)
+    {
+        uint32_t _entries = (_colors != 0) ? _colors : (1UL << _bmpBpp);
+        uint8_t _entrySize = (_dibSize == 12) ? 3 : 4;
+        if (_entries > 256)
+            return fail(INKPLATE_ESP32_IMAGE_CORRUPT);
+
+        for (uint32_t i = 0; i < _entries; i++)
+        {
+            uint8_t _color[4];
+            if (!readBytes(_color, _entrySize))
+                return false;
+            _palette[i] = imageGray(_color[2], _color[1], _color[0]);
+        }
+        _pos += _entries * _entrySize;
+    }
+
+    // Go to the pixel data.
+    if (_dataOffset < _pos)
+        return fail(INKPLATE_ESP32_IMAGE_CORRUPT);
+    if (!skipBytes(_dataOffset - _pos))
+        return false;
+
+    // Rows are padded to 4 bytes. Raw row and the gray row must fit into the work buffer.
+    _rowBytes = ((((uint32_t)_width * _bmpBpp) + 31) / 32) * 4;
+    if ((_rowBytes + _width) > _workSize)
+        return fail(INKPLATE_ESP32_IMAGE_MEMORY);
+    _row = _work;
+    _grayRow = _work + _rowBytes;
+
+    // Decode row by row, as they arrive.
+    for (uint32_t i = 0; i < _height; i++)
+    {
+        if (!readBytes(_row, _rowBytes))
+            return false;
+
+        bmpRow(_row);
+        putRow(_bmpTopDown ? i : (_height - 1 - i));
+    }
+
+    return true;
+}
+
+/**
+ * @brief   Helper method for converting the raw BMP row into the gray row.
+ *
+ * @param   const uint8_t *_raw
+ *          Raw row.
+ */
+void ImageDecoder::bmpRow(const uint8_t *_raw)
+{
+    for (uint32_t i = 0; i < _width; i++)
+    {
+        uint8_t _gray;
+
+        switch (_bmpBpp)
+        {
+        case 1:
+            _gray = _palette[(_raw[i >> 3] >> (7 - (i & 7))) & 0x01];
+            break;
+        case 4:
+            _gray = _palette[(_raw[i >> 1] >> ((i & 1) ? 0 : 4)) & 0x0F];
+            break;
+        case 8:
+            _gray = _palette[_raw[i]];
+            break;
+        case 16: {
+            // 5 bits per color (X1R5G5B5).
+            uint16_t _pixel = imageLe16(&_raw[i * 2]);
+            uint8_t _r = (_pixel >> 10) & 0x1F;
+            uint8_t _g = (_pixel >> 5) & 0x1F;
+            uint8_t _b = _pixel & 0x1F;
+            _gray = imageGray((_r << 3) | (_r >> 2), (_g << 3) | (_g >> 2), (_b << 3) | (_b >> 2));
+            break;
+        }
+        case 24:
+            _gray = imageGray(_raw[(i * 3) + 2], _raw[(i * 3) + 1], _raw[i * 3]);
+            break;
+        default:
+            // Fourth byte of the uncompressed 32 bit BMP is not used.
+            _gray = imageGray(_raw[(i * 4) + 2], _raw[(i * 4) + 1], _raw[i * 4]);
+            break;
+        }
+
+        _grayRow[i] = _gray;
+    }
+}
+
+/**
+ * @brief   Helper method for decoding the PNG image (0x89 and "P" are already read).
+ *
+ * @return  bool
+ *          true - Image decoded.
+ *          false - Decode failed.
+ */
+bool ImageDecoder::decodePng()
+{
+    static const uint8_t _signature[6] = {'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A};
+    uint8_t _chunk[8];
+
+    // Rest of the signature.
+    if (!readBytes(_chunk, sizeof(_signature)))
+        return false;
+    if (memcmp(_chunk, _signature, sizeof(_signature)) != 0)
+        return fail(INKPLATE_ESP32_IMAGE_FORMAT);
+
+    // Palette is opaque unless tRNS says otherwise.
+    memset(_palette, 0, sizeof(_palette));
+    memset(_paletteAlpha, 255, sizeof(_paletteAlpha));
+
+    // Go through the chunks up to the image data (CRC of each chunk is skipped).
+    while (true)
+    {
+        if (!readBytes(_chunk, sizeof(_chunk)))
+            return false;
+        uint32_t _len = imageBe32(_chunk);
+
+        if (memcmp(&_chunk[4], "IHDR", 4) == 0)
+        {
+            if (!pngHeader(_len) || !skipBytes(4))
+                return false;
+        }
+        else if (memcmp(&_chunk[4], "PLTE", 4) == 0)
+        {
+            if (!pngPalette(_len, false) || !skipBytes(4))
+                return false;
+        }
+        else if ((memcmp(&_chunk[4], "tRNS", 4) == 0) && (_pngColorType == 3))
+        {
+            if (!pngPalette(_len, true) || !skipBytes(4))
+                return false;
+        }
+        else if (memcmp(&_chunk[4], "IDAT", 4) == 0)
+        {
+            // Image data can't come before the header.
+            if (_width == 0)
+                return fail(INKPLATE_ESP32_IMAGE_CORRUPT);
+            _idatLen = _len;
+            break;
+        }
+        else if (memcmp(&_chunk[4], "IEND", 4) == 0)
+        {
+            return fail(INKPLATE_ESP32_IMAGE_CORRUPT);
+        }
+        else
+        {
+            // Skip other chunks.
+            if (!skipBytes(_len + 4))
+                return false;
+        }
+    }
+
+    // Decompress the image data, rows are decoded as they come out.
+    if (!inflate())
+        return false;
+
+    // All rows must be there.
+    if (_rowY != _height)
+        return fail(INKPLATE_ESP32_IMAGE_CORRUPT);
+
+    // Skip the rest of the image data (Adler-32) and everything else up to the end of the file.
+    if (!skipBytes(_idatLen + 4))
+        return false;
+    while (true)
+    {
+        if (!readBytes(_chunk, sizeof(_chunk)))
+            return false;
+        if (!skipBytes(imageBe32(_chunk) + 4))
+            return false;
+        if (memcmp(&_chunk[4], "IEND", 4) == 0)
+            return true;
+    }
+}
+
+/**
+ * @brief   Helper method for reading the PNG header (IHDR chunk).
+ *
+ * @param   uint32_t _len
+ *          Length of the chunk.
+ * @return  bool
+ *          true - Header is valid and supported.
+ *          false - Header is not valid, format is not supported or there is no more data.
+ */
+bool ImageDecoder::pngHeader(uint32_t _len)
+{
+    uint8_t _header[13];
+
+    if (_len != sizeof(_header))
+        return fail(INKPLATE_ESP32_IMAGE_CORRUPT);
+    if (!readBytes(_header, sizeof(_header)))
+        return false;
+
+    uint32_t _w = imageBe32(&_header[0]);
+    uint32_t _h = imageBe32(&_header[4]);
+    _pngDepth = _header[8];
+    _pngColorType = _header[9];
+    if ((_w == 0) || (_w > 65535) || (_h == 0) || (_h > 65535) || (_header[10] != 0) || (_header[11] != 0))
+        return fail(INKPLATE_ESP32_IMAGE_CORRUPT);
+
+    // Interlaced images can't be drawn row by row.
+    if (_header[12] != 0)
+        return fail(INKPLATE_ESP32_IMAGE_FORMAT);
+
+    // Check the bit depth of the color type and get the number of channels.
+    uint8_t _channels;
+    bool _depthValid;
+    switch (_pngColorType)
+    {
+    case 0:
+        _channels = 1;
+        _depthValid = (_pngDepth == 1) || (_pngDepth == 2) || (_pngDepth == 4) || (_pngDepth == 8) ||
+                      (_pngDepth == 16);
+        break;
+    case 3:
+        _channels = 1;
+        _depthValid = (_pngDepth == 1) || (_pngDepth == 2) || (_pngDepth == 4) || (_pngDepth == 8);
+        break;
+    case 2:
+    case 4:
+    case 6:
+        _channels = (_pngColorType == 2) ? 3 : ((_pngColorType == 4) ? 2 : 4);
+        _depthValid = (_pngDepth == 8) || (_pngDepth == 16);
+        break;
+    default:
+        return fail(INKPLATE_ESP32_IMAGE_CORRUPT);
+    }
+    if (!_depthValid)
+        return fail(INKPLATE_ESP32_IMAGE_CORRUPT);
+
+    // Bytes per pixel (for the filters, at least 1) and per row (with the filter type byte).
+    uint32_t _bitsPerPixel = (uint32_t)_channels * _pngDepth;
+    _pngBpp = (_bitsPerPixel < 8) ? 1 : (_bitsPerPixel / 8);
+    _rowBytes = 1 + ((_w * _bitsPerPixel) + 7) / 8;
+    _width = _w;
+    _height = _h;
+
+    return true;
+}
+
+/**
+ * @brief   Helper method for reading the PNG palette (PLTE chunk) or its transparency (tRNS chunk).
+ *
+ * @param   uint32_t _len
+ *          Length of the chunk.
+ * @param   bool _alpha
+ *          true - tRNS chunk.
+ *          false - PLTE chunk.
+ * @return  bool
+ *          true - Palette read.
+ *          false - Palette is not valid or there is no more data.
+ */
+bool ImageDecoder::pngPalette(uint32_t _len, bool _alpha)
+{
+    uint32_t _entries = _alpha ? _len : (_len / 3);
+    if ((_entries > 256) || (!_alpha && ((_len % 3) != 0)))
+        return fail(INKPLATE_ESP32_IMAGE_CORRUPT);
+
+    for (uint32_t i = 0; i < _entries; i++)
+    {
+        uint8_t _color[3];
+
+        if (_alpha)
+        {
+            if (!readByte(&_paletteAlpha[i]))
+                return false;
+        }
+        else
+        {
+            if (!readBytes(_color, sizeof(_color)))
+                return false;
+            _palette[i] = imageGray(_color[0], _color[1], _color[2]);
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief   Helper method for reading the next byte of the compressed image data. Data can be split into more IDAT
+ *          chunks, one right after the other.
+ *
+ * @param   uint8_t *_c
+ *          Where to store the byte.
+ * @return  bool
+ *          true - Byte read.
+ *          false - No more image data.
+ */
+bool ImageDecoder::pngIdatByte(uint8_t *_c)
+{
+    while (_idatLen == 0)
+    {
+        // CRC of the previous chunk, length and type of the next one.
+        uint8_t _chunk[12];
+        if (!readBytes(_chunk, sizeof(_chunk)))
+            return false;
+        if (memcmp(&_chunk[8], "IDAT", 4) != 0)
+            return fail(INKPLATE_ESP32_IMAGE_CORRUPT);
+
+        _idatLen = imageBe32(&_chunk[4]);
+    }
+
+    _idatLen--;
+
+    return readByte(_c);
+}
+
+/**
+ * @brief   Helper method for the decompressed byte. It goes into the inflate window and into the current row.
+ *
+ * @param   uint8_t _c
+ *          Decompressed byte.
+ * @return  bool
+ *          true - Byte stored.
+ *          false - Row is not valid.
+ */
+bool ImageDecoder::pngOutput(uint8_t _c)
+{
+    // Keep it for the back references.
+    _window[_windowPos] = _c;
+    _windowPos = (_windowPos + 1) & _windowMask;
+    if (_windowFill <= _windowMask)
+        _windowFill++;
+
+    // Anything after the last row is ignored.
+    if (_rowY >= _height)
+        return true;
+
+    _row[_rowPos++] = _c;
+    if (_rowPos == _rowBytes)
+    {
+        _rowPos = 0;
+        return pngRow();
+    }
+
+    return true;
+}
+
+/**
+ * @brief   Helper method for the complete PNG row. It's unfiltered, converted into the gray row and drawn.
+ *
+ * @return  bool
+ *          true - Row drawn.
+ *          false - Filter type is not valid.
+ */
+bool ImageDecoder::pngRow()
+{
+    uint8_t *_cur = _row + 1;
+    const uint8_t *_prev = _prevRow + 1;
+    uint32_t _n = _rowBytes - 1;
+    uint8_t _bpp = _pngBpp;
+
+    // Undo the filter. Pixels before the first one and the row before the first one are zeros.
+    switch (_row[0])
+    {
+    case 0:
+        break;
+    case 1:
+        for (uint32_t i = _bpp; i < _n; i++)
+            _cur[i] += _cur[i - _bpp];
+        break;
+    case 2:
+        for (uint32_t i = 0; i < _n; i++)
+            _cur[i] += _prev[i];
+        break;
+    case 3:
+        for (uint32_t i = 0; i < _n; i++)
+            _cur[i] += (((i >= _bpp) ? _cur[i - _bpp] : 0) + _prev[i]) >> 1;
+        break;
+    case 4:
+        for (uint32_t i = 0; i < _n; i++)
+        {
+            int16_t _a = (i >= _bpp) ? _cur[i - _bpp] : 0;
+            int16_t _b = _prev[i];
+            int16_t _c = (i >= _bpp) ? _prev[i - _bpp] : 0;
+            int16_t _pa = abs(_b - _c);
+            int16_t _pb = abs(_a - _c);
+            int16_t _pc = abs(_a + _b - _c - _c);
+            _cur[i] += ((_pa <= _pb) && (_pa <= _pc)) ? _a : ((_pb <= _pc) ? _b : _c);
+        }
+        break;
+    default:
+        return fail(INKPLATE_ESP32_IMAGE_CORRUPT);
+    }
+
+    // Convert it into the gray row. Only the high byte of 16 bit samples is used.
+    uint8_t _step = (_pngDepth == 16) ? 2 : 1;
+    for (uint32_t i = 0; i < _width; i++)
+    {
+        uint8_t _gray;
+
+        switch (_pngColorType)
+        {
+        case 0:
+            if (_pngDepth >= 8)
+                _gray = _cur[i * _step];
+            else
+                _gray = pngSample(_cur, i, _pngDepth) * (255 / ((1 << _pngDepth) - 1));
+            break;
+        case 2:
+            _gray = imageGray(_cur[i * 3 * _step], _cur[((i * 3) + 1) * _step], _cur[((i * 3) + 2) * _step]);
+            break;
+        case 3: {
+            uint8_t _index = (_pngDepth == 8) ? _cur[i] : pngSample(_cur, i, _pngDepth);
+            _gray = imageBlend(_palette[_index], _paletteAlpha[_index]);
+            break;
+        }
+        case 4:
+            _gray = imageBlend(_cur[i * 2 * _step], _cur[((i * 2) + 1) * _step]);
+            break;
+        default:
+            _gray = imageGray(_cur[i * 4 * _step], _cur[((i * 4) + 1) * _step], _cur[((i * 4) + 2) * _step]);
+            _gray = imageBlend(_gray, _cur[((i * 4) + 3) * _step]);
+            break;
+        }
+
+        _grayRow[i] = _gray;
+    }
+
+    putRow(_rowY++);
+
+    // This row is the previous one for the next row.
+    uint8_t *_swap = _prevRow;
+    _prevRow = _row;
+    _row = _swap;
+
+    return true;
+}
+
+/**
+ * @brief   Helper method for getting the sample smaller than one byte from the PNG row.
+ *
+ * @param   const uint8_t *_raw
+ *          Unfiltered row (without the filter type byte).
+ * @param   uint32_t _index
+ *          Index of the pixel.
+ * @param   uint8_t _depth
+ *          Bit depth (1, 2 or 4).
+ * @return  uint8_t
+ *          Sample.
+ */
+uint8_t ImageDecoder::pngSample(const uint8_t *_raw, uint32_t _index, uint8_t _depth)
+{
+    uint32_t _bit = _index * _depth;
+    uint8_t _shift = 8 - _depth - (_bit & 7);
+
+    return (_raw[_bit >> 3] >> _shift) & ((1 << _depth) - 1);
+}
+
+/**
+ * @brief   Helper method for decompressing the PNG image data (zlib stream). Output goes byte by byte to
+ *          pngOutput(), so only the window and two rows are kept in the RAM.
+ *
+ * @return  bool
+ *          true - Data decompressed.
+ *          false - Data is not valid, work buffer is too small or there is no more data.
+ */
+bool ImageDecoder::inflate()
+{
+    // zlib header. Only deflate without the preset dictionary is allowed.
+    uint8_t _cmf;
+    uint8_t _flg;
+    if (!pngIdatByte(&_cmf) || !pngIdatByte(&_flg))
+        return false;
+    if (((_cmf & 0x0F) != 8) || ((_cmf >> 4) > 7) || ((((uint16_t)_cmf << 8) | _flg) % 31) || (_flg & 0x20))
+        return fail(INKPLATE_ESP32_IMAGE_CORRUPT);
+
+    // Window size is set by the encoder, everything must fit into the work buffer.
+    uint32_t _windowSize = 1UL << ((_cmf >> 4) + 8);
+    if ((_windowSize + (_rowBytes * 2) + _width) > _workSize)
+        return fail(INKPLATE_ESP32_IMAGE_MEMORY);
+    _window = _work;
+    _windowMask = _windowSize - 1;
+    _windowPos = 0;
+    _windowFill = 0;
+    _row = _work + _windowSize;
+    _prevRow = _row + _rowBytes;
+    _grayRow = _prevRow + _rowBytes;
+    memset(_prevRow, 0, _rowBytes);
+    _rowPos = 0;
+    _rowY = 0;
+    _bitBuffer = 0;
+    _bitCount = 0;
+
+    // Go through the blocks.
+    uint32_t _final;
+    do
+    {
+        uint32_t _type;
+        if (!inflateBits(1, &_final) || !inflateBits(2, &_type))
+            return false;
+
+        bool _blockDone;
+        if (_type == 0)
+            _blockDone = inflateStored();
+        else if (_type == 1)
+            _blockDone = inflateFixed() && inflateCodes();
+        else if (_type == 2)
+            _blockDone = inflateDynamic() && inflateCodes();
+        else
+            _blockDone = fail(INKPLATE_ESP32_IMAGE_CORRUPT);
+
+        if (!_blockDone)
+            return false;
+    } while (!_final);
+
+    return true;
+}
+
+/**
+ * @brief   Helper method for reading the bits of the compressed data (LSB first).
+ *
+ * @param   uint8_t _n
+ *          Number of bits (up to 13).
+ * @param   uint32_t *_value
+ *          Where to store the bits.
+ * @return  bool
+ *          true - Bits read.
+ *          false - No more data.
+ */
+bool ImageDecoder::inflateBits(uint8_t _n, uint32_t *_value)
+{
+    uint32_t _bits = _bitBuffer;
+
+    while (_bitCount < _n)
+    {
+        uint8_t _c;
+        if (!pngIdatByte(&_c))
+            return false;
+
+        _bits |= (uint32_t)_c << _bitCount;
+        _bitCount += 8;
+    }
+
+    _bitBuffer = _bits >> _n;
+    _bitCount -= _n;
+    *_value = _bits & ((1UL << _n) - 1);
+
+    return true;
+}
+
+/**
+ * @brief   Helper method for the stored (not compressed) block.
+ *
+ * @return  bool
+ *          true - Block done.
+ *          false - Block is not valid or there is no more data.
+ */
+bool ImageDecoder::inflateStored()
+{
+    // Block starts at the byte boundary.
+    _bitBuffer = 0;
+    _bitCount = 0;
+
+    // Length and its complement.
+    uint8_t _header[4];
+    for (int i = 0; i < 4; i++)
+    {
+        if (!pngIdatByte(&_header[i]))
+            return false;
+    }
+    uint16_t _len = imageLe16(&_header[0]);
+    if (_len != (uint16_t)~imageLe16(&_header[2]))
+        return fail(INKPLATE_ESP32_IMAGE_CORRUPT);
+
+    while (_len--)
+    {
+        uint8_t _c;
+        if (!pngIdatByte(&_c) || !pngOutput(_c))
+            return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief   Helper method for setting up the fixed codes of the block.
+ *
+ * @return  bool
+ *          Always true.
+ */
+bool ImageDecoder::inflateFixed()
+{
+    uint8_t _lengths[288];
+
+    for (int i = 0; i < 288; i++)
+        _lengths[i] = (i < 144) ? 8 : ((i < 256) ? 9 : ((i < 280) ? 7 : 8));
+    huffmanBuild(&_litLen, _lengths, 288);
+
+    memset(_lengths, 5, 30);
+    huffmanBuild(&_dist, _lengths, 30);
+
+    return true;
+}
+
+/**
+ * @brief   Helper method for reading the codes of the dynamic block.
+ *
+ * @return  bool
+ *          true - Codes are ready.
+ *          false - Codes are not valid or there is no more data.
+ */
+bool ImageDecoder::inflateDynamic()
+{
+    uint8_t _lengths[286 + 30];
+    uint32_t _nLen;
+    uint32_t _nDist;
+    uint32_t _nCode;
+
+    // Number of the literal/length, distance and code length codes.
+    if (!inflateBits(5, &_nLen) || !inflateBits(5, &_nDist) || !inflateBits(4, &_nCode))
+        return false;
+    _nLen += 257;
+    _nDist += 1;
+    _nCode += 4;
+    if ((_nLen > 286) || (_nDist > 30))
+        return fail(INKPLATE_ESP32_IMAGE_CORRUPT);
+
+    // Code length codes (distance code is used for them, it's not needed yet).
+    for (uint8_t i = 0; i < 19; i++)
+    {
+        uint32_t _len = 0;
+        if ((i < _nCode) && !inflateBits(3, &_len))
+            return false;
+        _lengths[_inflateCodeOrder[i]] = _len;
+    }
+    if (!huffmanBuild(&_dist, _lengths, 19))
+        return false;
+
+    // Lengths of the literal/length and distance codes.
+    uint16_t _index = 0;
+    while (_index < (_nLen + _nDist))
+    {
+        uint16_t _symbol;
+        if (!inflateSymbol(&_dist, &_symbol))
+            return false;
+
+        if (_symbol < 16)
+        {
+            _lengths[_index++] = _symbol;
+            continue;
+        }
+
+        // Repeat the previous length or zero.
+        uint8_t _len = 0;
+        uint32_t _repeat;
+        bool _bitsRead;
+        if (_symbol == 16)
+        {
+            if (_index == 0)
+                return fail(INKPLATE_ESP32_IMAGE_CORRUPT);
+            _len = _lengths[_index - 1];
+            _bitsRead = inflateBits(2, &_repeat);
+            _repeat += 3;
+        }
+        else if (_symbol == 17)
+        {
+            _bitsRead = inflateBits(3, &_repeat);
+            _repeat += 3;
+        }
+        else
+        {
+            _bitsRead = inflateBits(7, &_repeat);
+            _repeat += 11;
+        }
+
+        if (!_bitsRead)
+            return false;
+        if ((_index + _repeat) > (_nLen + _nDist))
+            return fail(INKPLATE_ESP32_IMAGE_CORRUPT);
+
+        while (_repeat--)
+            _lengths[_index++] = _len;
+    }
+
+    // End of block code must be there.
+    if (_lengths[256] == 0)
+        return fail(INKPLATE_ESP32_IMAGE_CORRUPT);
+
+    return huffmanBuild(&_litLen, _lengths, _nLen) && huffmanBuild(&_dist, &_lengths[_nLen], _nDist);
+}
+
+/**
+ * @brief   Helper method for decompressing the block with the current codes.
+ *
+ * @return  bool
+ *          true - Block done.
+ *          false - Data is not valid or there is no more data.
+ */
+bool ImageDecoder::inflateCodes()
+{
+    while (true)
+    {
+        uint16_t _symbol;
+        if (!inflateSymbol(&_litLen, &_symbol))
+            return false;
+
+        // Literal.
+        if (_symbol < 256)
+        {
+            if (!pngOutput(_symbol))
+                return false;
+            continue;
+        }
+
+        // End of the block.
+        if (_symbol == 256)
+            return true;
+
+        // Length and distance of the back reference.
+        _symbol -= 257;
+        if (_symbol >= 29)
+            return fail(INKPLATE_ESP32_IMAGE_CORRUPT);
+
+        uint32_t _extra;
+        if (!inflateBits(_inflateLengthExtra[_symbol], &_extra))
+            return false;
+        uint32_t _len = _inflateLengthBase[_symbol] + _extra;
+
+        if (!inflateSymbol(&_dist, &_symbol))
+            return false;
+        if (_symbol >= 30)
+            return fail(INKPLATE_ESP32_IMAGE_CORRUPT);
+        if (!inflateBits(_inflateDistExtra[_symbol], &_extra))
+            return false;
+        uint32_t _distance = _inflateDistBase[_symbol] + _extra;
+        if (_distance > _windowFill)
+            return fail(INKPLATE_ESP32_IMAGE_CORRUPT);
+
+        // Copy it from the window.
+        while (_len--)
+        {
+            if (!pngOutput(_window[(_windowPos - _distance) & _windowMask]))
+                return false;
+        }
+    }
+}
+
+/**
+ * @brief   Helper method for decoding one symbol with the canonical Huffman code (bit by bit, codes of each
+ *          length are consecutive numbers).
+ *
+ * @param   struct imageHuffmanTypedef *_huffman
+ *          Code.
+ * @param   uint16_t *_symbol
+ *          Where to store the symbol.
+ * @return  bool
+ *          true - Symbol decoded.
+ *          false - Code is not valid or there is no more data.
+ */
+bool ImageDecoder::inflateSymbol(struct imageHuffmanTypedef *_huffman, uint16_t *_symbol)
+{
+    int32_t _code = 0;
+    int32_t _first = 0;
+    int32_t _index = 0;
+
+    for (uint8_t _len = 1; _len < 16; _len++)
+    {
+        // Next bit of the code.
+        if (_bitCount == 0)
+        {
+            uint8_t _c;
+            if (!pngIdatByte(&_c))
+                return false;
+            _bitBuffer = _c;
+            _bitCount = 8;
+        }
+        _code |= _bitBuffer & 1;
+        _bitBuffer >>= 1;
+        _bitCount--;
+
+        // Is it one of the codes of this length?
+        int32_t _count = _huffman->count[_len];
+        if ((_code - _count) < _first)
+        {
+            *_symbol = _huffman->symbol[_index + (_code - _first)];
+            return true;
+        }
+
+        _index += _count;
+        _first = (_first + _count) << 1;
+        _code <<= 1;
+    }
+
+    return fail(INKPLATE_ESP32_IMAGE_CORRUPT);
+}
+
+/**
+ * @brief   Helper method for making the canonical Huffman code from the code lengths.
+ *
+ * @param   struct imageHuffmanTypedef *_huffman
+ *          Where to store the code.
+ * @param   const uint8_t *_lengths
+ *          Code length of each symbol (0 - symbol is not used).
+ * @param   uint16_t _n
+ *          Number of symbols.
+ * @return  bool
+ *          true - Code is ready.
+ *          false - There are too many codes of some length.
+ */
+bool ImageDecoder::huffmanBuild(struct imageHuffmanTypedef *_huffman, const uint8_t *_lengths, uint16_t _n)
+{
+    // Number of codes of each length.
+    memset(_huffman->count, 0, sizeof(_huffman->count));
+    for (uint16_t i = 0; i < _n; i++)
+        _huffman->count[_lengths[i]]++;
+
+    // Check if there are not too many of them.
+    int32_t _left = 1;
+    for (uint8_t _len = 1; _len < 16; _len++)
+    {
+        _left = (_left << 1) - _huffman->count[_len];
+        if (_left < 0)
+            return fail(INKPLATE_ESP32_IMAGE_CORRUPT);
+    }
+
+    // Sort the symbols by the code.
+    uint16_t _offset[16];
+    _offset[1] = 0;
+    for (uint8_t _len = 1; _len < 15; _len++)
+        _offset[_len + 1] = _offset[_len] + _huffman->count[_len];
+    for (uint16_t i = 0; i < _n; i++)
+    {
+        if (_lengths[i] != 0)
+            _huffman->symbol[_offset[_lengths[i]]++] = i;
+    }
+
+    return true;
+}
+
+/**
+ * @brief   Helper method for drawing the gray row into the framebuffer (and giving it to the row callback).
+ *
+ * @param   int32_t _imageRow
+ *          Row of the image.
+ */
+void ImageDecoder::putRow(int32_t _imageRow)
+{
+    int32_t _y = (int32_t)_targetY + _imageRow;
+
+    if (_rowCallback != NULL)
+        _rowCallback(_targetX, _y, _grayRow, _width);
+
+    // Cut everything outside the framebuffer.
+    if ((_target == NULL) || (_target->buffer == NULL) || (_y < 0) || (_y >= _target->height))
+        return;
+
+    int32_t _start = (_targetX < 0) ? -_targetX : 0;
+    int32_t _end = _width;
+    if (((int32_t)_targetX + _end) > _target->width)
+        _end = (int32_t)_target->width - _targetX;
+
+    uint8_t *_line = _target->buffer + ((uint32_t)_y * _target->stride);
+
+    switch (_target->format)
+    {
+    case INKPLATE_ESP32_FB_GRAY8:
+        for (int32_t i = _start; i < _end; i++)
+            _line[_targetX + i] = _grayRow[i];
+        break;
+    case INKPLATE_ESP32_FB_GRAY4:
+        for (int32_t i = _start; i < _end; i++)
+        {
+            uint32_t _x = _targetX + i;
+            uint8_t *_pixel = &_line[_x >> 1];
+            if (_x & 1)
+                *_pixel = (*_pixel & 0xF0) | (_grayRow[i] >> 4);
+            else
+                *_pixel = (*_pixel & 0x0F) | (_grayRow[i] & 0xF0);
+        }
+        break;
+    case INKPLATE_ESP32_FB_MONO1:
+        for (int32_t i = _start; i < _end; i++)
+        {
+            uint32_t _x = _targetX + i;
+            uint8_t _mask = 0x80 >> (_x & 7);
+            if (_grayRow[i] < 128)
+                _line[_x >> 3] |= _mask;
+            else
+                _line[_x >> 3] &= ~_mask;
+        }
+        break;
+    }
+}
@@ -0,0 +1,149 @@
+// Add headerguard do prevent multiple include.
+#ifndef __ESP32_SPI_AT_IMAGE_H__
+#define __ESP32_SPI_AT_IMAGE_H__
+
+// Include main Arduino header file.
+#include <Arduino.h>
+
+// Include main ESP32-C3 AT SPI library.
+#include "esp32SpiAt.h"
+
+// Result of the image decode (see ImageDecoder::lastError()).
+#define INKPLATE_ESP32_IMAGE_OK        0
+#define INKPLATE_ESP32_IMAGE_TRUNCATED 1
+#define INKPLATE_ESP32_IMAGE_FORMAT    2
+#define INKPLATE_ESP32_IMAGE_CORRUPT   3
+#define INKPLATE_ESP32_IMAGE_MEMORY    4
+
+// Pixel formats of the framebuffer. GRAY8 - one byte per pixel (0 - black, 255 - white). GRAY4 - two pixels per
+// byte, first one in the high nibble (0 - black, 15 - white). MONO1 - eight pixels per byte, first one in the MSB
+// (bit set - black, for pixels darker than the middle gray).
+#define INKPLATE_ESP32_FB_GRAY8 0
+#define INKPLATE_ESP32_FB_GRAY4 1
+#define INKPLATE_ESP32_FB_MONO1 2
+
+// Used for describing the display framebuffer (stride is the length of one line in bytes).
+struct spiAtFramebufferTypedef
+{
+    uint8_t *buffer;
+    uint16_t width;
+    uint16_t height;
+    uint32_t stride;
+    uint8_t format;
+};
+
+// Typedef for the callback that gets each decoded row (8 bit grayscale, position is the position on the display).
+typedef void (*imageRowCallback)(int16_t _x, int16_t _y, const uint8_t *_row, uint16_t _width);
+
+// Class for decoding the image straight from the WiFiClient data into the framebuffer, one row at a time, while
+// the rest of the image is still arriving. Supported formats are BMP (1, 4, 8, 16, 24 and 32 bits per pixel,
+// uncompressed) and PNG (all color types and bit depths, not interlaced).
+// Work buffer holds the rows (and the inflate window for PNG, usually 32k), so RAM use does not depend on the image
+// height. BMP needs (width * 5) + 4 bytes, PNG needs 32770 + (width * 17) bytes in the worst case (16 bit RGBA).
+class ImageDecoder
+{
+  public:
+    ImageDecoder(uint8_t *_workBuffer, uint32_t _workBufferSize);
+    bool decode(WiFiClient &_client, struct spiAtFramebufferTypedef *_framebuffer, int16_t _x = 0, int16_t _y = 0);
+    void onRow(imageRowCallback _callback);
+    uint8_t lastError();
+    uint16_t width();
+    uint16_t height();
+    unsigned long elapsed();
+    unsigned long waitTime();
+
+  private:
+    // Canonical Huffman code (number of codes of each length and the symbols ordered by the code).
+    struct imageHuffmanTypedef
+    {
+        uint16_t count[16];
+        uint16_t symbol[288];
+    };
+
+    // Data source.
+    bool nextChunk();
+    bool readByte(uint8_t *_c);
+    bool readBytes(uint8_t *_buffer, uint32_t _len);
+    bool skipBytes(uint32_t _len);
+    bool fail(uint8_t _error);
+
+    // BMP.
+    bool decodeBmp();
+    void bmpRow(const uint8_t *_raw);
+
+    // PNG.
+    bool decodePng();
+    bool pngHeader(uint32_t _len);
+    bool pngPalette(uint32_t _len, bool _alpha);
+    bool pngIdatByte(uint8_t *_c);
+    bool pngOutput(uint8_t _c);
+    bool pngRow();
+    uint8_t pngSample(const uint8_t *_raw, uint32_t _index, uint8_t _depth);
+
+    // Inflate (RFC 1950 and RFC 1951).
+    bool inflate();
+    bool inflateBits(uint8_t _n, uint32_t *_value);
+    bool inflateStored();
+    bool inflateFixed();
+    bool inflateCodes();
+    bool inflateDynamic();
+    bool inflateSymbol(struct imageHuffmanTypedef *_huffman, uint16_t *_symbol);
+    bool huffmanBuild(struct imageHuffmanTypedef *_huffman, const uint8_t *_lengths, uint16_t _n);
+
+    // Output.
+    void putRow(int32_t _imageRow);
+
+    // Work buffer for the rows (and the inflate window).
+    uint8_t *_work;
+    uint32_t _workSize;
+
+    // Data source, its current chunk and the time spent waiting for it.
+    WiFiClient *_source = NULL;
+    const uint8_t *_in = NULL;
+    uint16_t _inLen = 0;
+    unsigned long _waitTime = 0;
+
+    // Output (framebuffer and its position, row callback).
+    struct spiAtFramebufferTypedef *_target = NULL;
+    int16_t _targetX = 0;
+    int16_t _targetY = 0;
+    imageRowCallback _rowCallback = NULL;
+
+    // Image, its palette (as 8 bit gray and alpha) and the row buffers.
+    uint16_t _width = 0;
+    uint16_t _height = 0;
+    uint8_t _palette[256];
+    uint8_t _paletteAlpha[256];
+    uint8_t *_row = NULL;
+    uint8_t *_prevRow = NULL;
+    uint8_t *_grayRow = NULL;
+    uint32_t _rowBytes = 0;
+    uint32_t _rowPos = 0;
+    uint32_t _rowY = 0;
+
+    // BMP pixel format.
+    uint16_t _bmpBpp = 0;
+    bool _bmpTopDown = false;
+
+    // PNG pixel format and the remaining bytes of the current IDAT chunk.
+    uint8_t _pngDepth = 0;
+    uint8_t _pngColorType = 0;
+    uint8_t _pngBpp = 0;
+    uint32_t _idatLen = 0;
+
+    // Inflate state (bit buffer, window and the codes of the current block).
+    uint32_t _bitBuffer = 0;
+    uint8_t _bitCount = 0;
+    uint8_t *_window = NULL;
+    uint32_t _windowMask = 0;
+    uint32_t _windowPos = 0;
+    uint32_t _windowFill = 0;
+    struct imageHuffmanTypedef _litLen;
+    struct imageHuffmanTypedef _dist;
+
+    // Result of the last decode and the time needed for it.
+    uint8_t _lastError = INKPLATE_ESP32_IMAGE_OK;
+    unsigned long _elapsed = 0;
+};
+
+#endif
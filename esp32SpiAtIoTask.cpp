@@ -0,0 +1,390 @@
+// Include main header file.
+#include "esp32SpiAt.h"
+
+#ifdef INKPLATE_ESP32_THREAD_SAFE
+
+// Queue index is masked, so the queue size must be the power of 2.
+static_assert((INKPLATE_ESP32_IO_QUEUE_SIZE & (INKPLATE_ESP32_IO_QUEUE_SIZE - 1)) == 0,
+              "INKPLATE_ESP32_IO_QUEUE_SIZE must be the power of 2");
+
+/**
+ * @brief Construct a new WiFiIoTask object - I/O task of the thread-safe mode.
+ *
+ * @param   WiFiClass &_wifiModem
+ *          Modem used by this object (default is WiFi, use other WiFiClass object for additional modems).
+ */
+WiFiIoTask::WiFiIoTask(WiFiClass &_wifiModem)
+{
+    // Bind it to the modem.
+    _modem = &_wifiModem;
+
+    // Each cell is free for the producer with the same position.
+    for (uint32_t i = 0; i < INKPLATE_ESP32_IO_QUEUE_SIZE; i++)
+    {
+        _queue[i].sequence.store(i, std::memory_order_relaxed);
+        _queue[i].request = NULL;
+    }
+    _enqueuePos.store(0, std::memory_order_relaxed);
+    _dequeuePos.store(0, std::memory_order_relaxed);
+    _runRequest.store(NULL, std::memory_order_relaxed);
+
+    // Start with the empty statistics.
+    clearStats();
+}
+
+/**
+ * @brief   Submit the request to the I/O task (any task can call it). It does not wait for the completion, use
+ *          wait() for that.
+ *
+ * @param   struct spiAtRequestTypedef *_request
+ *          Request (command, expected result, timeout and the response buffer must be set).
+ * @return  bool
+ *          true - Request is in the queue.
+ *          false - Queue is full or the request is not valid.
+ */
+bool WiFiIoTask::submit(struct spiAtRequestTypedef *_request)
+{
+    // Check for user mistake (null-pointer!).
+    if ((_request == NULL) || (_request->command == NULL))
+        return false;
+
+    // Prepare the request.
+    _request->result = false;
+    _request->resultClass = INKPLATE_ESP32_AT_RESULT_OK;
+    _request->submitTime = micros();
+    _request->state.store(INKPLATE_ESP32_IO_REQ_PENDING, std::memory_order_relaxed);
+
+    // Put it into the queue.
+    if (!push(_request))
+    {
+        _queueFull.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    _submitted.fetch_add(1, std::memory_order_relaxed);
+
+    // Remember the max. queue depth. Positions are read separately while other tasks move them, so the difference
+    // is only an estimate - keep it within the queue size.
+    uint32_t _dequeued = _dequeuePos.load(std::memory_order_acquire);
+    int32_t _depth = (int32_t)(_enqueuePos.load(std::memory_order_acquire) - _dequeued);
+    if (_depth < 0)
+        _depth = 0;
+    if (_depth > INKPLATE_ESP32_IO_QUEUE_SIZE)
+        _depth = INKPLATE_ESP32_IO_QUEUE_SIZE;
+    statsMax(_maxDepth, _depth);
+
+    return true;
+}
+
+/**
+ * @brief   Wait for the completion of the submitted request. Other tasks run in the meantime (see
+ *          INKPLATE_ESP32_IO_YIELD). If the timeout expires before the I/O task takes the request, the
+ *          request is cancelled (it's not executed) and it returns after the I/O task releases it, since the
+ *          queue still points to it. If the I/O task runs the request for longer than the run timeout, the
+ *          request is abandoned - the I/O task finishes the command, but it does not touch the request (or
+ *          the response buffer) anymore. Abandon is decided on the running slot of the I/O task, not on the
+ *          request, so the request can go out of scope right after it returns.
+ *
+ * @param   struct spiAtRequestTypedef *_request
+ *          Submitted request.
+ * @param   unsigned long _timeout
+ *          Max. time to wait for the I/O task to take the request (in milliseconds).
+ * @param   unsigned long _runTimeout
+ *          Max. time to wait for the I/O task to finish the request once it's running (in milliseconds).
+ * @return  bool
+ *          true - Request is done, result is in the request.
+ *          false - Request cancelled or abandoned.
+ */
+bool WiFiIoTask::wait(struct spiAtRequestTypedef *_request, unsigned long _timeout, unsigned long _runTimeout)
+{
+    // Capture the time!
+    unsigned long _timeoutCounter = millis();
+    unsigned long _runStart = 0;
+    bool _running = false;
+    bool _cancelledRequest = false;
+    uint8_t _state;
+
+    while ((_state = _request->state.load(std::memory_order_acquire)) != INKPLATE_ESP32_IO_REQ_DONE)
+    {
+        if ((_state == INKPLATE_ESP32_IO_REQ_PENDING) &&
+            ((unsigned long)(millis() - _timeoutCounter) >= _timeout))
+        {
+            // Try to cancel it if it's still in the queue.
+            _cancelledRequest = _request->state.compare_exchange_strong(
+                _state, INKPLATE_ESP32_IO_REQ_CANCELLED, std::memory_order_acq_rel);
+        }
+        else if (_state == INKPLATE_ESP32_IO_REQ_RUNNING)
+        {
+            // Measure the run time from the moment the I/O task took it.
+            if (!_running)
+            {
+                _running = true;
+                _runStart = millis();
+            }
+
+            // Running too long? Leave it to the I/O task (fails if it's just completing it, then wait for the
+            // results).
+            struct spiAtRequestTypedef *_expectedRequest = _request;
+            if (((unsigned long)(millis() - _runStart) >= _runTimeout) &&
+                _runRequest.compare_exchange_strong(_expectedRequest, NULL, std::memory_order_acq_rel))
+            {
+                _request->state.store(INKPLATE_ESP32_IO_REQ_ABANDONED, std::memory_order_relaxed);
+                return false;
+            }
+        }
+
+        INKPLATE_ESP32_IO_YIELD();
+    }
+
+    return !_cancelledRequest;
+}
+
+/**
+ * @brief   Send the AT command through the I/O task and wait for the result (any task can call it). The I/O
+ *          task runs it under the supervision (see WiFiClass::execute()) and copies the response. If it runs
+ *          longer than INKPLATE_ESP32_IO_RUN_TIMEOUT, the request is abandoned.
+ *
+ * @param   const char *_atCommand
+ *          AT command with CRLF at the end (string constant, the abandoned request can still use it).
+ * @param   char *_response
+ *          Buffer for the response (NULL if not needed).
+ * @param   uint32_t _responseLen
+ *          Size of the response buffer (in bytes, counting the null-terminating char). Longer responses are
+ *          cut.
+ * @param   unsigned long _timeout
+ *          Max. time to wait for the result of the command (in milliseconds). The same time is allowed for
+ *          the request to wait in the queue.
+ * @param   const char *_expected
+ *          Result code that means success (default is "OK").
+ * @return  bool
+ *          true - Command executed successfully.
+ *          false - Command failed, queue is full or the request has been cancelled or abandoned.
+ */
+bool WiFiIoTask::request(const char *_atCommand, char *_response, uint32_t _responseLen, unsigned long _timeout,
+                         const char *_expected)
+{
+    // Make the request.
+    struct spiAtRequestTypedef _request;
+    _request.command = _atCommand;
+    _request.expected = _expected;
+    _request.timeout = _timeout;
+    _request.response = _response;
+    _request.responseLen = _responseLen;
+
+    // Submit it and wait for the result.
+    if (!submit(&_request))
+        return false;
+
+    if (!wait(&_request, _timeout))
+        return false;
+
+    return _request.result;
+}
+
+/**
+ * @brief   Run the next request from the queue. If the queue is empty, service the open links (see
+ *          WiFiClass::poll()). Only the I/O task calls it, over and over again.
+ *
+ * @return  bool
+ *          true - Request has been processed.
+ *          false - Queue was empty.
+ */
+bool WiFiIoTask::process()
+{
+    // Get the next request.
+    struct spiAtRequestTypedef *_request = pop();
+
+    if (_request == NULL)
+    {
+        // Nothing to do, keep the links going.
+        _modem->poll();
+        return false;
+    }
+
+    // Copy what is needed from the request, it can be abandoned while it's running.
+    const char *_command = _request->command;
+    const char *_expected = _request->expected;
+    unsigned long _timeout = _request->timeout;
+    char *_response = _request->response;
+    uint32_t _responseLen = _request->responseLen;
+    unsigned long _submitTime = _request->submitTime;
+
+    // Take it, unless it has been cancelled in the meantime. Running slot is set first, so the waiting task
+    // that sees the request running can abandon it.
+    _runRequest.store(_request, std::memory_order_release);
+    uint8_t _pending = INKPLATE_ESP32_IO_REQ_PENDING;
+    if (!_request->state.compare_exchange_strong(_pending, INKPLATE_ESP32_IO_REQ_RUNNING, std::memory_order_acq_rel))
+    {
+        // Release it, the waiting task can go on.
+        _runRequest.store(NULL, std::memory_order_relaxed);
+        _cancelled.fetch_add(1, std::memory_order_relaxed);
+        _request->state.store(INKPLATE_ESP32_IO_REQ_DONE, std::memory_order_release);
+        return true;
+    }
+
+    // Time spent in the queue.
+    unsigned long _startTime = micros();
+    uint32_t _waitTime = _startTime - _submitTime;
+    _totalWaitUs.fetch_add(_waitTime, std::memory_order_relaxed);
+    statsMax(_maxWaitUs, _waitTime);
+
+    // Run it.
+    bool _result = _modem->execute(_command, _timeout, _expected);
+
+    // Time needed for it.
+    uint32_t _serviceTime = micros() - _startTime;
+    _totalServiceUs.fetch_add(_serviceTime, std::memory_order_relaxed);
+    statsMax(_maxServiceUs, _serviceTime);
+    _completed.fetch_add(1, std::memory_order_relaxed);
+
+    // Abandoned by the waiting task (running slot already cleared)? Request may be out of scope, do not touch it.
+    // Otherwise the waiting task can't abandon it anymore and it waits for the results.
+    struct spiAtRequestTypedef *_expectedRequest = _request;
+    if (!_runRequest.compare_exchange_strong(_expectedRequest, NULL, std::memory_order_acq_rel))
+    {
+        _abandoned.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Save the result and copy the response.
+    _request->result = _result;
+    _request->resultClass = _modem->lastResult();
+    if ((_response != NULL) && (_responseLen != 0))
+    {
+        strncpy(_response, _modem->getDataBuffer(), _responseLen - 1);
+        _response[_responseLen - 1] = '\0';
+    }
+
+    // Done! Waiting task can go on (and the request can't be used from now on).
+    _request->state.store(INKPLATE_ESP32_IO_REQ_DONE, std::memory_order_release);
+
+    return true;
+}
+
+/**
+ * @brief   Get the statistics of the I/O task (copy, since they are updated from more tasks).
+ *
+ * @param   struct spiAtIoStatsTypedef *_stats
+ *          Where to store the statistics.
+ */
+void WiFiIoTask::getStats(struct spiAtIoStatsTypedef *_stats)
+{
+    _stats->submitted = _submitted.load(std::memory_order_relaxed);
+    _stats->completed = _completed.load(std::memory_order_relaxed);
+    _stats->cancelled = _cancelled.load(std::memory_order_relaxed);
+    _stats->abandoned = _abandoned.load(std::memory_order_relaxed);
+    _stats->queueFull = _queueFull.load(std::memory_order_relaxed);
+    _stats->contention = _contention.load(std::memory_order_relaxed);
+    _stats->maxDepth = _maxDepth.load(std::memory_order_relaxed);
+    _stats->totalWaitUs = _totalWaitUs.load(std::memory_order_relaxed);
+    _stats->maxWaitUs = _maxWaitUs.load(std::memory_order_relaxed);
+    _stats->totalServiceUs = _totalServiceUs.load(std::memory_order_relaxed);
+    _stats->maxServiceUs = _maxServiceUs.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief   Clear the statistics of the I/O task.
+ *
+ */
+void WiFiIoTask::clearStats()
+{
+    _submitted.store(0, std::memory_order_relaxed);
+    _completed.store(0, std::memory_order_relaxed);
+    _cancelled.store(0, std::memory_order_relaxed);
+    _abandoned.store(0, std::memory_order_relaxed);
+    _queueFull.store(0, std::memory_order_relaxed);
+    _contention.store(0, std::memory_order_relaxed);
+    _maxDepth.store(0, std::memory_order_relaxed);
+    _totalWaitUs.store(0, std::memory_order_relaxed);
+    _maxWaitUs.store(0, std::memory_order_relaxed);
+    _totalServiceUs.store(0, std::memory_order_relaxed);
+    _maxServiceUs.store(0, std::memory_order_relaxed);
+}
+
+/**
+ * @brief   Helper method for putting the request into the queue (any task).
+ *
+ * @param   struct spiAtRequestTypedef *_request
+ *          Request.
+ * @return  bool
+ *          true - Request is in the queue.
+ *          false - Queue is full.
+ */
+bool WiFiIoTask::push(struct spiAtRequestTypedef *_request)
+{
+    ioQueueCell *_cell;
+    uint32_t _pos = _enqueuePos.load(std::memory_order_relaxed);
+
+    while (true)
+    {
+        _cell = &_queue[_pos & (INKPLATE_ESP32_IO_QUEUE_SIZE - 1)];
+        int32_t _diff = (int32_t)(_cell->sequence.load(std::memory_order_acquire) - _pos);
+
+        if (_diff == 0)
+        {
+            // Cell is free, try to take it. Someone else may be faster.
+            if (_enqueuePos.compare_exchange_weak(_pos, _pos + 1, std::memory_order_relaxed))
+                break;
+
+            _contention.fetch_add(1, std::memory_order_relaxed);
+        }
+        else if (_diff < 0)
+        {
+            // Consumer did not free this cell yet, queue is full.
+            return false;
+        }
+        else
+        {
+            // Someone else already took this position.
+            _pos = _enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    // Write the request and let the consumer have it.
+    _cell->request = _request;
+    _cell->sequence.store(_pos + 1, std::memory_order_release);
+
+    return true;
+}
+
+/**
+ * @brief   Helper method for getting the next request from the queue (I/O task only).
+ *
+ * @return  struct spiAtRequestTypedef*
+ *          Request, NULL if the queue is empty.
+ */
+struct spiAtRequestTypedef *WiFiIoTask::pop()
+{
+    uint32_t _pos = _dequeuePos.load(std::memory_order_relaxed);
+    ioQueueCell *_cell = &_queue[_pos & (INKPLATE_ESP32_IO_QUEUE_SIZE - 1)];
+
+    // Cell must be written by the producer.
+    if ((int32_t)(_cell->sequence.load(std::memory_order_acquire) - (_pos + 1)) < 0)
+        return NULL;
+
+    // There is only one consumer, so the position can be simply moved.
+    struct spiAtRequestTypedef *_request = _cell->request;
+    _dequeuePos.store(_pos + 1, std::memory_order_relaxed);
+
+    // Free the cell for the producer one round later.
+    _cell->sequence.store(_pos + INKPLATE_ESP32_IO_QUEUE_SIZE, std::memory_order_release);
+
+    return _request;
+}
+
+/**
+ * @brief   Helper method for updating the max. value in the statistics (from more tasks).
+ *
+ * @param   std::atomic<uint32_t> &_max
+ *          Max. value.
+ * @param   uint32_t _value
+ *          New value.
+ */
+void WiFiIoTask::statsMax(std::atomic<uint32_t> &_max, uint32_t _value)
+{
+    uint32_t _current = _max.load(std::memory_order_relaxed);
+    while ((_value > _current) && !_max.compare_exchange_weak(_current, _value, std::memory_order_relaxed))
+        ;
+}
+
+#endif
@@ -0,0 +1,133 @@
+// Add headerguard do prevent multiple include.
+#ifndef __ESP32_SPI_AT_IO_TASK_H__
+#define __ESP32_SPI_AT_IO_TASK_H__
+
+// Include main Arduino header file.
+#include <Arduino.h>
+
+// Include main ESP32-C3 AT SPI library.
+#include "esp32SpiAt.h"
+
+// Thread-safe mode is optional, define INKPLATE_ESP32_THREAD_SAFE to use it. In this mode only one task (the I/O
+// task, it calls WiFiIoTask::process() in the loop) uses the modem. Other tasks must not call WiFiClass directly,
+// they submit the AT commands through the lock-free queue and wait for the completion.
+#ifdef INKPLATE_ESP32_THREAD_SAFE
+
+// Include atomic operations for the lock-free queue.
+#include <atomic>
+
+// Max. number of requests waiting in the queue (must be the power of 2).
+#ifndef INKPLATE_ESP32_IO_QUEUE_SIZE
+#define INKPLATE_ESP32_IO_QUEUE_SIZE 8
+#endif
+
+// Max. time the waiting task waits for the request that the I/O task is already running (in milliseconds). After
+// that, the request is abandoned - the I/O task finishes it, but it does not touch the request anymore (the
+// waiting task gives it up through the running slot of the I/O task, see WiFiIoTask::wait()).
+#ifndef INKPLATE_ESP32_IO_RUN_TIMEOUT
+#define INKPLATE_ESP32_IO_RUN_TIMEOUT 60000UL
+#endif
+
+// Called by the tasks waiting for the completion. Give the CPU to other tasks (taskYIELD() for FreeRTOS,
+// std::this_thread::yield() on Linux).
+#ifndef INKPLATE_ESP32_IO_YIELD
+#define INKPLATE_ESP32_IO_YIELD() yield()
+#endif
+
+// States of the request.
+#define INKPLATE_ESP32_IO_REQ_PENDING   0
+#define INKPLATE_ESP32_IO_REQ_RUNNING   1
+#define INKPLATE_ESP32_IO_REQ_DONE       2
+#define INKPLATE_ESP32_IO_REQ_CANCELLED  3
+#define INKPLATE_ESP32_IO_REQ_ABANDONED  4
+
+// AT command request. Command, expected result and the response buffer must stay valid until the request is done.
+// If the request can be abandoned (see WiFiIoTask::wait()), command and expected result must stay valid until
+// the I/O task is done with it (use the string constants).
+struct spiAtRequestTypedef
+{
+    const char *command;
+    const char *expected;
+    unsigned long timeout;
+    char *response;
+    uint32_t responseLen;
+    bool result;
+    uint8_t resultClass;
+    std::atomic<uint8_t> state;
+    unsigned long submitTime;
+};
+
+// Used for the I/O task statistics. Wait time is from the submit until the I/O task takes the request, service
+// time is the time the I/O task needs for it (in microseconds). Abandoned requests ran longer than the waiting
+// task was willing to wait (see WiFiIoTask::wait()). Contention is the number of the failed compare-and-swap
+// operations on the queue (more tasks submitting at the same time).
+struct spiAtIoStatsTypedef
+{
+    uint32_t submitted;
+    uint32_t completed;
+    uint32_t cancelled;
+    uint32_t abandoned;
+    uint32_t queueFull;
+    uint32_t contention;
+    uint32_t maxDepth;
+    uint32_t totalWaitUs;
+    uint32_t maxWaitUs;
+    uint32_t totalServiceUs;
+    uint32_t maxServiceUs;
+};
+
+// Class for the I/O task of the thread-safe mode.
+class WiFiIoTask
+{
+  public:
+    WiFiIoTask(WiFiClass &_wifiModem = WiFi);
+    bool submit(struct spiAtRequestTypedef *_request);
+    bool wait(struct spiAtRequestTypedef *_request, unsigned long _timeout,
+              unsigned long _runTimeout = INKPLATE_ESP32_IO_RUN_TIMEOUT);
+    bool request(const char *_atCommand, char *_response, uint32_t _responseLen, unsigned long _timeout,
+                 const char *_expected = esp32AtCmdResponseOK);
+    bool process();
+    void getStats(struct spiAtIoStatsTypedef *_stats);
+    void clearStats();
+
+  private:
+    // Modem used by this object.
+    WiFiClass *_modem;
+
+    bool push(struct spiAtRequestTypedef *_request);
+    struct spiAtRequestTypedef *pop();
+    void statsMax(std::atomic<uint32_t> &_max, uint32_t _value);
+
+    // Bounded lock-free queue (multiple producers, one consumer). Each cell has the sequence number, so the
+    // producers know if the cell is free and the consumer knows if the cell is already written.
+    struct ioQueueCell
+    {
+        std::atomic<uint32_t> sequence;
+        struct spiAtRequestTypedef *request;
+    };
+    ioQueueCell _queue[INKPLATE_ESP32_IO_QUEUE_SIZE];
+    std::atomic<uint32_t> _enqueuePos;
+    std::atomic<uint32_t> _dequeuePos;
+
+    // Request the I/O task is running right now. It belongs to the I/O task, so it stays valid when the
+    // request is abandoned. Whoever clears it first (I/O task when done, waiting task when abandoning it)
+    // decides if the results are written into the request.
+    std::atomic<struct spiAtRequestTypedef *> _runRequest;
+
+    // Statistics (updated from more tasks).
+    std::atomic<uint32_t> _submitted;
+    std::atomic<uint32_t> _completed;
+    std::atomic<uint32_t> _cancelled;
+    std::atomic<uint32_t> _abandoned;
+    std::atomic<uint32_t> _queueFull;
+    std::atomic<uint32_t> _contention;
+    std::atomic<uint32_t> _maxDepth;
+    std::atomic<uint32_t> _totalWaitUs;
+    std::atomic<uint32_t> _maxWaitUs;
+    std::atomic<uint32_t> _totalServiceUs;
+    std::atomic<uint32_t> _maxServiceUs;
+};
+
+#endif
+
+#endif
@@ -0,0 +1,781 @@
+// Include main header file.
+#include "esp32SpiAt.h"
+
+/**
+ * @brief Construct a new WiFiMQTT object - for MQTT.
+ *
+ * @param   WiFiClass &_wifiModem
+ *          Modem used by this object (default is WiFi, use other WiFiClass object for additional modems).
+ */
+WiFiMQTT::WiFiMQTT(WiFiClass &_wifiModem)
+{
+    // Bind it to the modem.
+    _modem = &_wifiModem;
+}
+
+/**
+ * @brief   Connect to the MQTT broker. WiFi must be connected first.
+ *
+ * @param   const char *_host
+ *          Host name or IP Address of the MQTT broker.
+ * @param   uint16_t _port
+ *          Port of the MQTT broker (usually 1883 or 8883 for TLS).
+ * @param   const char *_clientId
+ *          MQTT client ID.
+ * @param   const char *_user
+ *          User name (empty string if not used).
+ * @param   const char *_pass
+ *          Password (empty string if not used).
+ * @param   bool _tls
+ *          true - Use MQTT over TLS (server certificate is not verified).
+ *          false - Use MQTT over TCP.
+ * @param   uint16_t _keepAlive
+ *          Keep alive time in seconds.
+ * @return  bool
+ *          true - Connected to the broker.
+ *          false - Connection failed.
+ */
+bool WiFiMQTT::connect(const char *_host, uint16_t _port, const char *_clientId, const char *_user,
+                       const char *_pass, bool _tls, uint16_t _keepAlive)
+{
+    // Check for user mistake (null-pointer!).
+    if ((_host == NULL) || (_clientId == NULL) || (_user == NULL) || (_pass == NULL))
+        return false;
+
+    // Wait for the previous commands to finish.
+    if (!waitForResults(0, 5000ULL))
+        return false;
+
+    // Set the user config. Scheme 1 is MQTT over TCP, 2 is MQTT over TLS without certificate verify.
+    AtCommandBuilder _cmd(_modem->getDataBuffer(), INKPLATE_ESP32_AT_CMD_BUFFER_SIZE);
+    _cmd.add(esp32AtMqttUserCfg).addUInt(_tls ? 2 : 1).add(",").addQuoted(_clientId).add(",");
+    _cmd.addQuoted(_user).add(",").addQuoted(_pass).add(",0,0,\"\"").end();
+    if (!sendCommand(_cmd, 1000ULL))
+        return false;
+
+    // Set the keep alive.
+    _cmd.reset();
+    _cmd.add(esp32AtMqttConnCfg).addUInt(_keepAlive).add(",0,\"\",\"\",0,0").end();
+    if (!sendCommand(_cmd, 1000ULL))
+        return false;
+
+    // For TCP, use the IP Address from the DNS cache. TLS needs the host name.
+    IPAddress _ip = _tls ? INADDR_NONE : _modem->resolve(_host);
+
+    // Connect to the broker. It can take a while (especially with TLS).
+    _cmd.reset();
+    _cmd.add(esp32AtMqttConnect);
+    if (_ip != INADDR_NONE)
+    {
+        _cmd.addQuotedIp(_ip);
+    }
+    else
+    {
+        _cmd.addQuoted(_host);
+    }
+    _cmd.add(",").addUInt(_port).add(",0").end();
+    _connected = sendCommand(_cmd, 10000ULL);
+
+    return _connected;
+}
+
+/**
+ * @brief   Check if the client is still connected to the broker. It also processes received messages.
+ *
+ * @return  bool
+ *          true - Connected to the broker.
+ *          false - Not connected.
+ */
+bool WiFiMQTT::connected()
+{
+    // Check for the new events first.
+    loop();
+
+    return _connected;
+}
+
+/**
+ * @brief   Disconnect from the MQTT broker.
+ *
+ * @return  bool
+ *          true - Disconnected.
+ *          false - Command failed.
+ */
+bool WiFiMQTT::disconnect()
+{
+    // Wait for the pending publishes first.
+    waitForResults(0, 5000ULL);
+
+    // Close the connection.
+    AtCommandBuilder _cmd(_modem->getDataBuffer(), INKPLATE_ESP32_AT_CMD_BUFFER_SIZE);
+    _cmd.add(esp32AtMqttClean);
+    bool _retValue = sendCommand(_cmd, 1000ULL);
+
+    _connected = false;
+
+    return _retValue;
+}
+
+/**
+ * @brief   Publish the message. Method does not wait for the result of the publish - up to the publish
+ *          window (see setPublishWindow()) publish commands are sent to the modem before waiting for
+ *          their results, so the next message can be prepared while the modem is still busy. Use
+ *          flush() to wait for all the results and published()/failed() for the statistics.
+ *          Short text messages are sent with AT+MQTTPUB, binary or long ones with AT+MQTTPUBRAW.
+ *
+ * @param   const char *_topic
+ *          Topic of the message.
+ * @param   const uint8_t *_payload
+ *          Pointer to the message data.
+ * @param   uint16_t _len
+ *          Length of the message (in bytes).
+ * @param   uint8_t _qos
+ *          Quality of service (0 or 1).
+ * @param   bool _retain
+ *          Retain flag of the message.
+ * @return  bool
+ *          true - Message is sent to the modem.
+ *          false - Message is not sent (not connected, invalid QoS or modem not responding).
+ */
+bool WiFiMQTT::publish(const char *_topic, const uint8_t *_payload, uint16_t _len, uint8_t _qos, bool _retain)
+{
+    // Check for user mistake (null-pointer or QoS 2 which is not supported!).
+    if ((_topic == NULL) || (_payload == NULL) || (_qos > 1) || !_connected)
+        return false;
+
+    // Wait for the free place in the publish window. Publish refused with "busy" goes first, its copy must not be
+    // replaced by this one.
+    if (!waitForResults(_window - 1, 5000ULL) || (_resend && !waitForResults(0, 5000ULL)))
+        return false;
+
+    // Build the AT commands directly in the buffer for the AT commands.
+    AtCommandBuilder _cmd(_modem->getDataBuffer(), INKPLATE_ESP32_AT_CMD_BUFFER_SIZE);
+    uint16_t _topicLen = strlen(_topic);
+
+    // Check if the message can be sent as text (only printable chars and short enough).
+    bool _text = ((_topicLen + _len) < INKPLATE_ESP32_MQTT_MAX_CMD_LEN);
+    for (uint16_t i = 0; _text && (i < _len); i++)
+    {
+        if ((_payload[i] < 0x20) || (_payload[i] > 0x7E))
+            _text = false;
+    }
+
+    if (_text)
+    {
+        // Make AT+MQTTPUB=0,"<topic>","<data>",<qos>,<retain> command.
+        _cmd.add(esp32AtMqttPublish).addQuoted(_topic, _topicLen).add(",");
+        _cmd.addQuoted((const char *)_payload, _len).add(",").addUInt(_qos).add(",").addUInt(_retain ? 1 : 0).end();
+
+        // Send it without waiting for the result if it's not too long after escaping. Keep the copy of it, it's
+        // sent again if the modem is still busy with the previous one.
+        if (_cmd.length() < INKPLATE_ESP32_MQTT_MAX_CMD_LEN)
+        {
+            if (!_modem->sendAtCommand(_cmd))
+                return false;
+
+            pushPending(true);
+            memcpy(_lastCommand, _cmd.c_str(), _cmd.length());
+            _lastCommandLen = _cmd.length();
+            _retries = 0;
+            return true;
+        }
+    }
+
+    // Raw message. Modem must be free, since it sends the prompt for the data.
+    if (!waitForResults(0, 5000ULL))
+        return false;
+
+    // Make AT+MQTTPUBRAW=0,"<topic>",<len>,<qos>,<retain> command.
+    _cmd.reset();
+    _cmd.add(esp32AtMqttPublishRaw).addQuoted(_topic, _topicLen).add(",").addUInt(_len);
+    _cmd.add(",").addUInt(_qos).add(",").addUInt(_retain ? 1 : 0).end();
+
+    // Send the command and wait for the prompt.
+    _prompt = false;
+    if (!_modem->sendAtCommand(_cmd))
+        return false;
+    pushPending(false);
+    if (!waitForResults(0, 5000ULL, true))
+    {
+        _failed++;
+        return false;
+    }
+
+    // Now send the data, result comes later (+MQTTPUB:OK).
+    if (!_modem->sendAtData((const char *)_payload, _len))
+        return false;
+    pushPending(true);
+
+    return true;
+}
+
+/**
+ * @brief   Publish the text message (null-terminated string).
+ *
+ * @param   const char *_topic
+ *          Topic of the message.
+ * @param   const char *_payload
+ *          Message text.
+ * @param   uint8_t _qos
+ *          Quality of service (0 or 1).
+ * @param   bool _retain
+ *          Retain flag of the message.
+ * @return  bool
+ *          true - Message is sent to the modem.
+ *          false - Message is not sent.
+ */
+bool WiFiMQTT::publish(const char *_topic, const char *_payload, uint8_t _qos, bool _retain)
+{
+    // Check for user mistake (null-pointer!).
+    if (_payload == NULL)
+        return false;
+
+    return publish(_topic, (const uint8_t *)_payload, strlen(_payload), _qos, _retain);
+}
+
+/**
+ * @brief   Subscribe to the topic. Received messages are delivered to the callback set with onMessage().
+ *
+ * @param   const char *_topic
+ *          Topic (wildcards can be used).
+ * @param   uint8_t _qos
+ *          Quality of service (0 or 1).
+ * @return  bool
+ *          true - Subscribed.
+ *          false - Subscribe failed.
+ */
+bool WiFiMQTT::subscribe(const char *_topic, uint8_t _qos)
+{
+    // Check for user mistake (null-pointer or QoS 2 which is not supported!).
+    if ((_topic == NULL) || (_qos > 1))
+        return false;
+
+    // Wait for the previous commands to finish.
+    if (!waitForResults(0, 5000ULL))
+        return false;
+
+    AtCommandBuilder _cmd(_modem->getDataBuffer(), INKPLATE_ESP32_AT_CMD_BUFFER_SIZE);
+    _cmd.add(esp32AtMqttSubscribe).addQuoted(_topic).add(",").addUInt(_qos).end();
+
+    return sendCommand(_cmd, 5000ULL);
+}
+
+/**
+ * @brief   Unsubscribe from the topic.
+ *
+ * @param   const char *_topic
+ *          Topic used in subscribe().
+ * @return  bool
+ *          true - Unsubscribed.
+ *          false - Unsubscribe failed.
+ */
+bool WiFiMQTT::unsubscribe(const char *_topic)
+{
+    // Check for user mistake (null-pointer!).
+    if (_topic == NULL)
+        return false;
+
+    // Wait for the previous commands to finish.
+    if (!waitForResults(0, 5000ULL))
+        return false;
+
+    AtCommandBuilder _cmd(_modem->getDataBuffer(), INKPLATE_ESP32_AT_CMD_BUFFER_SIZE);
+    _cmd.add(esp32AtMqttUnsubscribe).addQuoted(_topic).end();
+
+    return sendCommand(_cmd, 5000ULL);
+}
+
+/**
+ * @brief   Set the callback for the messages received on the subscribed topics. Callback is called from
+ *          loop() (or any other method that reads data from the modem). Payload is null-terminated
+ *          for easier use with text messages, but it's only valid inside the callback.
+ *
+ * @param   mqttMessageCallback _callback
+ *          Pointer to the callback function.
+ */
+void WiFiMQTT::onMessage(mqttMessageCallback _callback)
+{
+    _messageCallback = _callback;
+}
+
+/**
+ * @brief   Set the number of publish commands that can be sent to the modem before waiting for their
+ *          results. Larger window gives more messages per second, but if the modem can't keep up, it
+ *          answers with "busy" and the window falls back to 1. Window is limited to
+ *          INKPLATE_ESP32_MQTT_MAX_PUB_WINDOW (1 by default, see esp32SpiAtMqtt.h).
+ *
+ * @param   uint8_t _size
+ *          Publish window (1 to INKPLATE_ESP32_MQTT_MAX_PUB_WINDOW).
+ */
+void WiFiMQTT::setPublishWindow(uint8_t _size)
+{
+    if (_size < 1)
+        _size = 1;
+    if (_size > INKPLATE_ESP32_MQTT_MAX_PUB_WINDOW)
+        _size = INKPLATE_ESP32_MQTT_MAX_PUB_WINDOW;
+
+    _window = _size;
+}
+
+/**
+ * @brief   Wait for the results of all the pending publishes.
+ *
+ * @param   unsigned long _timeout
+ *          Timeout value in milliseconds.
+ * @return  bool
+ *          true - All results received.
+ *          false - Timeout occured.
+ */
+bool WiFiMQTT::flush(unsigned long _timeout)
+{
+    return waitForResults(0, _timeout);
+}
+
+/**
+ * @brief   Process everything received from the modem (results, messages, connection events). Call it
+ *          often (from the loop()).
+ *
+ */
+void WiFiMQTT::loop()
+{
+    while (readModem())
+        ;
+
+    resendCommand();
+}
+
+/**
+ * @brief   Get the number of successfully published messages.
+ *
+ * @return  uint32_t
+ *          Number of messages.
+ */
+uint32_t WiFiMQTT::published()
+{
+    return _published;
+}
+
+/**
+ * @brief   Get the number of failed commands (publishes and others).
+ *
+ * @return  uint32_t
+ *          Number of failed commands.
+ */
+uint32_t WiFiMQTT::failed()
+{
+    return _failed;
+}
+
+/**
+ * @brief   Helper method for sending the command and waiting for its result. All previous commands
+ *          must be finished (see waitForResults()).
+ *
+ * @param   AtCommandBuilder &_command
+ *          AT Command (with CRLF at the end).
+ * @param   unsigned long _timeout
+ *          Timeout value in milliseconds.
+ * @return  bool
+ *          true - Modem returned "OK".
+ *          false - Modem returned "ERROR" or timeout occured.
+ */
+bool WiFiMQTT::sendCommand(AtCommandBuilder &_command, unsigned long _timeout)
+{
+    if (!_modem->sendAtCommand(_command))
+        return false;
+
+    pushPending(false);
+
+    if (!waitForResults(0, _timeout))
+        return false;
+
+    return _lastResult;
+}
+
+/**
+ * @brief   Helper method that reads data from the modem until the number of commands waiting for the
+ *          result drops to the selected value.
+ *
+ * @param   uint8_t _maxPending
+ *          Max. number of commands that can still wait for the result.
+ * @param   unsigned long _timeout
+ *          Timeout value in milliseconds.
+ * @param   bool _waitPrompt
+ *          Also wait for the data prompt (if the last command was successful).
+ * @return  bool
+ *          true - Done (or the last command failed while waiting for the prompt).
+ *          false - Timeout occured, pending commands are counted as failed.
+ */
+bool WiFiMQTT::waitForResults(uint8_t _maxPending, unsigned long _timeout, bool _waitPrompt)
+{
+    // Capture the time!
+    unsigned long _timeoutCounter = millis();
+
+    do
+    {
+        // Read everything available.
+        while (readModem())
+            ;
+
+        // Send the publish refused with "busy" again once the modem is done with the previous commands.
+        resendCommand();
+
+        // Waiting for the prompt, but command failed?
+        if (_waitPrompt && (_pending == 0) && !_lastResult)
+            return false;
+
+        // Done?
+        if ((_pending <= _maxPending) && (!_waitPrompt || _prompt))
+            return true;
+    } while ((unsigned long)(millis() - _timeoutCounter) < _timeout);
+
+    // Timeout, results are lost (and the publish waiting to be sent again as well).
+    _failed += _pending;
+    if (_resend)
+        _failed++;
+    _pending = 0;
+    _pendingPublish = 0;
+    _resend = false;
+
+    return false;
+}
+
+/**
+ * @brief   Helper method that reads one packet from the modem (if available) and processes it.
+ *
+ * @return  bool
+ *          true - Packet has been read.
+ *          false - No new data.
+ */
+bool WiFiMQTT::readModem()
+{
+    uint16_t _len = 0;
+    char *_buffer = _modem->getDataBuffer();
+
+    // Only check for the packet, do not wait for it.
+    if (!_modem->getSimpleAtResponse(_buffer, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE, 0, &_len))
+        return false;
+
+    // Not enough space? Leftover can't be processed anyway (message longer than the buffer), drop it.
+    if (_len > (INKPLATE_ESP32_MQTT_RX_BUFFER_SIZE - _rxLen))
+        _rxLen = 0;
+
+    // Still too large? Keep only the last part of it.
+    if (_len > INKPLATE_ESP32_MQTT_RX_BUFFER_SIZE)
+    {
+        _buffer += _len - INKPLATE_ESP32_MQTT_RX_BUFFER_SIZE;
+        _len = INKPLATE_ESP32_MQTT_RX_BUFFER_SIZE;
+    }
+
+    // Add it to the received data and process it.
+    memcpy(_rxBuffer + _rxLen, _buffer, _len);
+    _rxLen += _len;
+    processRx();
+
+    return true;
+}
+
+/**
+ * @brief   Helper method that processes received data - result codes, prompt, incoming messages and
+ *          connection events. Incomplete data stays in the buffer until the rest arrives.
+ *
+ */
+void WiFiMQTT::processRx()
+{
+    // Position of the first unprocessed char.
+    uint16_t _pos = 0;
+
+    while (_pos < _rxLen)
+    {
+        char *_line = _rxBuffer + _pos;
+        uint16_t _left = _rxLen - _pos;
+
+        // Skip empty lines.
+        if ((*_line == '\r') || (*_line == '\n'))
+        {
+            _pos++;
+            continue;
+        }
+
+        // Incoming message has its length, it can contain line endings.
+        if ((_left >= (sizeof(esp32AtMqttSubRecv) - 1)) &&
+            (memcmp(_line, esp32AtMqttSubRecv, sizeof(esp32AtMqttSubRecv) - 1) == 0))
+        {
+            int _consumed = handleMessage(_line, _left);
+
+            // Not complete yet? Wait for the rest.
+            if (_consumed == 0)
+                break;
+
+            // Invalid message? Skip the header only.
+            if (_consumed < 0)
+                _consumed = sizeof(esp32AtMqttSubRecv) - 1;
+
+            _pos += _consumed;
+            continue;
+        }
+
+        // Find the end of the line.
+        char *_lineEnd = (char *)memchr(_line, '\n', _left);
+        if (_lineEnd == NULL)
+        {
+            // Data prompt does not have the line ending.
+            if (*_line == '>')
+            {
+                _prompt = true;
+                _pos++;
+                continue;
+            }
+
+            // Wait for the rest of the line.
+            break;
+        }
+
+        uint16_t _lineLen = _lineEnd - _line + 1;
+        handleLine(_line, _lineLen);
+        _pos += _lineLen;
+    }
+
+    // Remove processed data from the buffer.
+    memmove(_rxBuffer, _rxBuffer + _pos, _rxLen - _pos);
+    _rxLen -= _pos;
+
+    // Buffer full and nothing can be processed? Drop it, otherwise it will block everything.
+    if (_rxLen == INKPLATE_ESP32_MQTT_RX_BUFFER_SIZE)
+        _rxLen = 0;
+}
+
+/**
+ * @brief   Helper method that handles one line received from the modem.
+ *
+ * @param   char *_line
+ *          Pointer to the start of the line.
+ * @param   uint16_t _len
+ *          Length of the line (with the line ending).
+ */
+void WiFiMQTT::handleLine(char *_line, uint16_t _len)
+{
+    if ((_len >= 3) && (memcmp(_line, "OK\r", 3) == 0))
+    {
+        commandResult(true);
+    }
+    else if ((_len >= 5) && (memcmp(_line, "ERROR", 5) == 0))
+    {
+        commandResult(false);
+    }
+    else if ((_len >= (sizeof(esp32AtMqttPubOk) - 1)) && (memcmp(_line, esp32AtMqttPubOk, sizeof(esp32AtMqttPubOk) - 1) == 0))
+    {
+        commandResult(true);
+    }
+    else if ((_len >= (sizeof(esp32AtMqttPubFail) - 1)) &&
+             (memcmp(_line, esp32AtMqttPubFail, sizeof(esp32AtMqttPubFail) - 1) == 0))
+    {
+        commandResult(false);
+    }
+    else if ((_len >= 4) && (memcmp(_line, "busy", 4) == 0))
+    {
+        // Modem is still busy with the previous command and refused the newest one. Stop pipelining.
+        commandBusy();
+        _window = 1;
+    }
+    else if ((_len >= (sizeof(esp32AtMqttConnected) - 1)) &&
+             (memcmp(_line, esp32AtMqttConnected, sizeof(esp32AtMqttConnected) - 1) == 0))
+    {
+        _connected = true;
+    }
+    else if ((_len >= (sizeof(esp32AtMqttDisconnected) - 1)) &&
+             (memcmp(_line, esp32AtMqttDisconnected, sizeof(esp32AtMqttDisconnected) - 1) == 0))
+    {
+        _connected = false;
+    }
+
+    // Everything else (echo, etc.) is ignored.
+}
+
+/**
+ * @brief   Helper method that parses incoming message (+MQTTSUBRECV:<LinkID>,"<topic>",<len>,<data>) and
+ *          calls the message callback.
+ *
+ * @param   char *_data
+ *          Pointer to the start of the message.
+ * @param   uint16_t _len
+ *          Number of received bytes from the start of the message.
+ * @return  int
+ *          Number of bytes used by the message, 0 if the message is not complete yet, -1 if the
+ *          message is invalid (or it can't fit into the buffer).
+ */
+int WiFiMQTT::handleMessage(char *_data, uint16_t _len)
+{
+    char *_end = _data + _len;
+    char *_p = _data + sizeof(esp32AtMqttSubRecv) - 1;
+
+    // Skip the link ID.
+    _p = (char *)memchr(_p, ',', _end - _p);
+    if (_p == NULL)
+        return 0;
+    _p++;
+
+    // Topic is in the quotes.
+    if (_p >= _end)
+        return 0;
+    if (*_p != '\"')
+        return -1;
+    char *_topicStart = ++_p;
+    char *_topicEnd = (char *)memchr(_p, '\"', _end - _p);
+    if (_topicEnd == NULL)
+        return ((_end - _topicStart) < INKPLATE_ESP32_MQTT_MAX_TOPIC_LEN) ? 0 : -1;
+    _p = _topicEnd + 1;
+
+    // Get the message length.
+    if (_p >= _end)
+        return 0;
+    if (*_p++ != ',')
+        return -1;
+    uint32_t _msgLen = 0;
+    while ((_p < _end) && isdigit(*_p))
+    {
+        _msgLen = (_msgLen * 10) + (*_p++ - '0');
+    }
+    if (_p >= _end)
+        return 0;
+    if (*_p++ != ',')
+        return -1;
+
+    // Message can't fit into the buffer?
+    if (((_p - _data) + _msgLen) > INKPLATE_ESP32_MQTT_RX_BUFFER_SIZE)
+        return -1;
+
+    // Wait for the rest of the message.
+    if ((uint32_t)(_end - _p) < _msgLen)
+        return 0;
+
+    // Copy the topic (it can be truncated).
+    char _topic[INKPLATE_ESP32_MQTT_MAX_TOPIC_LEN];
+    uint16_t _topicLen = _topicEnd - _topicStart;
+    if (_topicLen >= sizeof(_topic))
+        _topicLen = sizeof(_topic) - 1;
+    memcpy(_topic, _topicStart, _topicLen);
+    _topic[_topicLen] = '\0';
+
+    // Null-terminate the payload for the callback and restore the buffer after.
+    char _nextChar = _p[_msgLen];
+    _p[_msgLen] = '\0';
+    if (_messageCallback != NULL)
+        _messageCallback(_topic, _p, _msgLen);
+    _p[_msgLen] = _nextChar;
+
+    // Return the number of used bytes.
+    return (_p + _msgLen) - _data;
+}
+
+/**
+ * @brief   Helper method for the result of the oldest pending command.
+ *
+ * @param   bool _ok
+ *          true - Command succeeded.
+ *          false - Command failed.
+ */
+void WiFiMQTT::commandResult(bool _ok)
+{
+    // Unexpected result? Ignore it.
+    if (_pending == 0)
+        return;
+
+    // Check if the oldest pending command was the publish.
+    bool _publish = (_pendingPublish & 0x01);
+    _pendingPublish >>= 1;
+    _pending--;
+
+    // Save the result and update the statistics.
+    _lastResult = _ok;
+    if (!_ok)
+    {
+        _failed++;
+    }
+    else if (_publish)
+    {
+        _published++;
+    }
+}
+
+/**
+ * @brief   Helper method for the "busy" answer. It's given right away to the command sent while the modem is still
+ *          working on the previous one, so it belongs to the newest pending command. Publish sent without waiting
+ *          is sent again later (see resendCommand()), anything else fails.
+ *
+ */
+void WiFiMQTT::commandBusy()
+{
+    // Unexpected answer? Ignore it.
+    if (_pending == 0)
+        return;
+
+    // Remove the newest pending command.
+    _pending--;
+    bool _publish = (_pendingPublish >> _pending) & 0x01;
+    _pendingPublish &= ~(1 << _pending);
+
+    // Copy is already taken by the publish waiting to be sent again, this one is lost.
+    if (_resend)
+    {
+        _lastResult = false;
+        _failed++;
+        return;
+    }
+
+    // Keep the publish for sending it again if the copy of it is available.
+    if (_publish && (_lastCommandLen != 0) && (_retries < INKPLATE_ESP32_MQTT_BUSY_RETRIES))
+    {
+        _resend = true;
+        _retries++;
+        return;
+    }
+
+    // Lost, count it as failed.
+    _lastCommandLen = 0;
+    _lastResult = false;
+    _failed++;
+}
+
+/**
+ * @brief   Helper method that sends the publish refused with "busy" again, but only when there are no other
+ *          commands waiting for the result (modem is not busy anymore and the order of results is kept).
+ *
+ */
+void WiFiMQTT::resendCommand()
+{
+    if (!_resend || (_pending != 0))
+        return;
+
+    _resend = false;
+
+    // Send the copy of it. If it can't be sent, it's lost.
+    if (!_modem->sendAtData(_lastCommand, _lastCommandLen))
+    {
+        _lastCommandLen = 0;
+        _failed++;
+        return;
+    }
+
+    // It's the newest pending command again (copy stays for the next "busy").
+    uint16_t _len = _lastCommandLen;
+    pushPending(true);
+    _lastCommandLen = _len;
+}
+
+/**
+ * @brief   Helper method for adding the command into the list of commands waiting for the result.
+ *
+ * @param   bool _publish
+ *          true - Command is the publish.
+ *          false - Any other command.
+ */
+void WiFiMQTT::pushPending(bool _publish)
+{
+    if (_publish)
+        _pendingPublish |= (1 << _pending);
+
+    _pending++;
+
+    // Only the newest command can be sent again, copy is set by the caller.
+    _lastCommandLen = 0;
+}
@@ -0,0 +1,99 @@
+// Add headerguard do prevent multiple include.
+#ifndef __ESP32_SPI_AT_MQTT_H__
+#define __ESP32_SPI_AT_MQTT_H__
+
+// Include main Arduino header file.
+#include <Arduino.h>
+
+// Include main ESP32-C3 AT SPI library.
+#include "esp32SpiAt.h"
+
+// Size of the buffer for the data received from the modem (responses and incoming messages, in bytes).
+#ifndef INKPLATE_ESP32_MQTT_RX_BUFFER_SIZE
+#define INKPLATE_ESP32_MQTT_RX_BUFFER_SIZE 1024
+#endif
+
+// Max. length of the topic of the incoming message (counting the null-terminating char).
+#ifndef INKPLATE_ESP32_MQTT_MAX_TOPIC_LEN
+#define INKPLATE_ESP32_MQTT_MAX_TOPIC_LEN 128
+#endif
+
+// Max. number of publish commands sent to the modem without waiting for the result. ESP-AT answers "busy" to any
+// command sent while it's still working on the previous one and only one refused publish is kept for sending it
+// again, so anything above 1 may lose the publishes (they are counted in failed()).
+#ifndef INKPLATE_ESP32_MQTT_MAX_PUB_WINDOW
+#define INKPLATE_ESP32_MQTT_MAX_PUB_WINDOW 1
+#endif
+
+// Max. number of times the publish refused with "busy" is sent again.
+#ifndef INKPLATE_ESP32_MQTT_BUSY_RETRIES
+#define INKPLATE_ESP32_MQTT_BUSY_RETRIES 3
+#endif
+
+// ESP-AT limits the complete AT command length (AT+MQTTPUB), longer messages are sent with AT+MQTTPUBRAW.
+#define INKPLATE_ESP32_MQTT_MAX_CMD_LEN 256
+
+// Callback for the message received on the subscribed topic.
+typedef void (*mqttMessageCallback)(const char *_topic, const char *_payload, uint16_t _len);
+
+// Class for MQTT over SPI AT commands.
+class WiFiMQTT
+{
+  public:
+    WiFiMQTT(WiFiClass &_wifiModem = WiFi);
+    bool connect(const char *_host, uint16_t _port, const char *_clientId, const char *_user = "",
+                 const char *_pass = "", bool _tls = false, uint16_t _keepAlive = 120);
+    bool connected();
+    bool disconnect();
+    bool publish(const char *_topic, const uint8_t *_payload, uint16_t _len, uint8_t _qos = 0, bool _retain = false);
+    bool publish(const char *_topic, const char *_payload, uint8_t _qos = 0, bool _retain = false);
+    bool subscribe(const char *_topic, uint8_t _qos = 0);
+    bool unsubscribe(const char *_topic);
+    void onMessage(mqttMessageCallback _callback);
+    void setPublishWindow(uint8_t _size);
+    bool flush(unsigned long _timeout = 5000UL);
+    void loop();
+    uint32_t published();
+    uint32_t failed();
+
+  private:
+    // Modem used by this object.
+    WiFiClass *_modem;
+
+    bool sendCommand(AtCommandBuilder &_command, unsigned long _timeout);
+    bool waitForResults(uint8_t _maxPending, unsigned long _timeout, bool _waitPrompt = false);
+    bool readModem();
+    void processRx();
+    void handleLine(char *_line, uint16_t _len);
+    int handleMessage(char *_data, uint16_t _len);
+    void commandResult(bool _ok);
+    void commandBusy();
+    void resendCommand();
+    void pushPending(bool _publish);
+
+    // Buffer for the data received from the modem.
+    char _rxBuffer[INKPLATE_ESP32_MQTT_RX_BUFFER_SIZE + 1];
+    uint16_t _rxLen = 0;
+
+    // Number of commands waiting for the result (results arrive in order, bit N is set if the Nth
+    // one is the publish), publish window, result of the last one and the prompt flag.
+    uint8_t _pending = 0;
+    uint8_t _pendingPublish = 0;
+    uint8_t _window = 1;
+    bool _lastResult = false;
+    bool _prompt = false;
+
+    // Copy of the newest publish sent without waiting (sent again when the modem refuses it with "busy").
+    char _lastCommand[INKPLATE_ESP32_MQTT_MAX_CMD_LEN];
+    uint16_t _lastCommandLen = 0;
+    bool _resend = false;
+    uint8_t _retries = 0;
+
+    // Connection status, message callback and statistics.
+    bool _connected = false;
+    mqttMessageCallback _messageCallback = NULL;
+    uint32_t _published = 0;
+    uint32_t _failed = 0;
+};
+
+#endif
@@ -0,0 +1,215 @@
+// Include main header file.
+#include "esp32SpiAt.h"
+
+/**
+ * @brief Construct a new AtPipeline object - for the batch of AT commands.
+ *
+ * @param   WiFiClass &_wifiModem
+ *          Modem used by this object (default is WiFi, use other WiFiClass object for additional modems).
+ */
+AtPipeline::AtPipeline(WiFiClass &_wifiModem)
+{
+    // Bind it to the modem.
+    _modem = &_wifiModem;
+}
+
+/**
+ * @brief   Add the AT command to the batch. Command is not copied, it must stay valid until run() is done.
+ *
+ * @param   const char *_atCommand
+ *          AT command with CRLF at the end.
+ * @param   const char *_expected
+ *          Result code that means success (default is "OK", NULL - no result code, wait until the modem is
+ *          quiet).
+ * @return  bool
+ *          true - Command added.
+ *          false - Batch is full.
+ */
+bool AtPipeline::add(const char *_atCommand, const char *_expected)
+{
+    // Check for user mistake (null-pointer!).
+    if (_atCommand == NULL)
+    {
+        _overflow = true;
+        return false;
+    }
+
+    return addRaw(_atCommand, strlen(_atCommand), _expected);
+}
+
+/**
+ * @brief   Add the AT command made with the AtCommandBuilder to the batch. Command is copied (builder usually
+ *          uses the modem buffer, so it would be overwritten by the responses).
+ *
+ * @param   AtCommandBuilder &_atCommand
+ *          AT command made with the AtCommandBuilder (with CRLF at the end).
+ * @param   const char *_expected
+ *          Result code that means success (default is "OK", NULL - no result code).
+ * @return  bool
+ *          true - Command added.
+ *          false - Batch is full or the command is not complete.
+ */
+bool AtPipeline::add(AtCommandBuilder &_atCommand, const char *_expected)
+{
+    // Do not add incomplete commands.
+    if (_atCommand.overflow())
+    {
+        _overflow = true;
+        return false;
+    }
+
+    // Check if there is enough room for the copy.
+    uint16_t _len = _atCommand.length();
+    if ((_cmdBufferLen + _len) > sizeof(_cmdBuffer))
+    {
+        _overflow = true;
+        return false;
+    }
+
+    // Copy it.
+    char *_copy = &_cmdBuffer[_cmdBufferLen];
+    memcpy(_copy, _atCommand.c_str(), _len);
+    if (!addRaw(_copy, _len, _expected))
+        return false;
+    _cmdBufferLen += _len;
+
+    return true;
+}
+
+/**
+ * @brief   Add the raw data (data after the ">" prompt, escape chars etc.) to the batch. Data is not copied, it
+ *          must stay valid until run() is done.
+ *
+ * @param   const char *_data
+ *          Data to send.
+ * @param   uint16_t _len
+ *          Length of the data (in bytes).
+ * @param   const char *_expected
+ *          Result code that means success (default is "OK", NULL - no result code).
+ * @return  bool
+ *          true - Data added.
+ *          false - Batch is full.
+ */
+bool AtPipeline::addRaw(const char *_data, uint16_t _len, const char *_expected)
+{
+    // Check for user mistake (null-pointer!) and if there is room for it. Batch with the missing command must
+    // not run.
+    if ((_data == NULL) || (_count >= INKPLATE_ESP32_PIPELINE_MAX_CMDS))
+    {
+        _overflow = true;
+        return false;
+    }
+
+    _commands[_count].data = _data;
+    _commands[_count].len = _len;
+    _commands[_count].expected = _expected;
+    _count++;
+
+    return true;
+}
+
+/**
+ * @brief   Remove all commands from the batch.
+ *
+ */
+void AtPipeline::clear()
+{
+    _count = 0;
+    _cmdBufferLen = 0;
+    _failed = -1;
+    _overflow = false;
+}
+
+/**
+ * @brief   Send all commands from the batch. Each one is sent as soon as the previous one is done. Batch stops
+ *          on the first failed command ("ERROR", "FAIL", "busy", timeout or modem not ready), see failed().
+ *
+ * @param   unsigned long _timeout
+ *          Max. time to wait for the result of each command (in milliseconds).
+ * @return  bool
+ *          true - All commands executed successfully.
+ *          false - Some command failed (or did not fit into the batch).
+ */
+bool AtPipeline::run(unsigned long _timeout)
+{
+    // Capture the time!
+    unsigned long _startTime = millis();
+
+    // Get the buffer for the responses.
+    char *_response = _modem->getDataBuffer();
+
+    _failed = -1;
+
+    for (int i = 0; (i < _count) && !_overflow; i++)
+    {
+        struct pipelineCommand *_cmd = &_commands[i];
+
+        // Send it. Fail if the modem is not ready for it.
+        if (!_modem->sendAtData(_cmd->data, _cmd->len))
+        {
+            _failed = i;
+            break;
+        }
+
+        // Wait for the result code.
+        bool _ok;
+        if (_cmd->expected != NULL)
+        {
+            _ok = _modem->waitForAtResult(_response, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE, _timeout, _cmd->expected);
+        }
+        else
+        {
+            // No result code, wait until the modem is quiet. Only the error stops the batch.
+            _ok = _modem->getAtResponseAdaptive(_response, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE,
+                                                INKPLATE_ESP32_TIMEOUT_FILTER, false) &&
+                  (strstr(_response, "ERROR\r\n") == NULL);
+        }
+
+        if (!_ok)
+        {
+            _failed = i;
+            break;
+        }
+    }
+
+    // Command that did not fit counts as the failure of the first one after the batch.
+    if (_overflow && (_failed < 0))
+        _failed = _count;
+
+    _elapsed = millis() - _startTime;
+
+    return (_failed < 0);
+}
+
+/**
+ * @brief   Get the index of the first failed command of the last run.
+ *
+ * @return  int
+ *          Index of the command (in the order they have been added), -1 if all of them succeeded.
+ */
+int AtPipeline::failed()
+{
+    return _failed;
+}
+
+/**
+ * @brief   Get the number of commands in the batch.
+ *
+ * @return  uint8_t
+ *          Number of commands.
+ */
+uint8_t AtPipeline::count()
+{
+    return _count;
+}
+
+/**
+ * @brief   Get the duration of the last run.
+ *
+ * @return  unsigned long
+ *          Time in milliseconds.
+ */
+unsigned long AtPipeline::elapsed()
+{
+    return _elapsed;
+}
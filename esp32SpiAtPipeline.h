@@ -0,0 +1,65 @@
+// Add headerguard do prevent multiple include.
+#ifndef __ESP32_SPI_AT_PIPELINE_H__
+#define __ESP32_SPI_AT_PIPELINE_H__
+
+// Include main Arduino header file.
+#include <Arduino.h>
+
+// Include main ESP32-C3 AT SPI library.
+#include "esp32SpiAt.h"
+
+// Max. number of commands in one batch and size of the buffer for the commands made with the AtCommandBuilder
+// (in bytes, other commands are not copied).
+#ifndef INKPLATE_ESP32_PIPELINE_MAX_CMDS
+#define INKPLATE_ESP32_PIPELINE_MAX_CMDS 12
+#endif
+#ifndef INKPLATE_ESP32_PIPELINE_BUFFER_SIZE
+#define INKPLATE_ESP32_PIPELINE_BUFFER_SIZE 128
+#endif
+
+// Max. time to wait for the result of each command of the batch used by the library (in milliseconds).
+#ifndef INKPLATE_ESP32_PIPELINE_TIMEOUT
+#define INKPLATE_ESP32_PIPELINE_TIMEOUT 1000UL
+#endif
+
+// Class for sending the batch of AT commands. Next command is sent as soon as the result code of the previous
+// one arrives (ESP-AT runs one command at a time and answers "busy p..." to anything sent in the meantime), so
+// the batch takes only as long as the modem needs for it. Responses are matched to the commands in order and
+// the batch stops on the first failure.
+class AtPipeline
+{
+  public:
+    AtPipeline(WiFiClass &_wifiModem = WiFi);
+    bool add(const char *_atCommand, const char *_expected = esp32AtCmdResponseOK);
+    bool add(AtCommandBuilder &_atCommand, const char *_expected = esp32AtCmdResponseOK);
+    bool addRaw(const char *_data, uint16_t _len, const char *_expected = esp32AtCmdResponseOK);
+    void clear();
+    bool run(unsigned long _timeout = INKPLATE_ESP32_PIPELINE_TIMEOUT);
+    int failed();
+    uint8_t count();
+    unsigned long elapsed();
+
+  private:
+    // Modem used by this object.
+    WiFiClass *_modem;
+
+    // Commands in the batch (data, length and the expected result code, NULL - no result code, command is done
+    // when nothing arrives for the adaptive timeout INKPLATE_ESP32_TIMEOUT_FILTER).
+    struct pipelineCommand
+    {
+        const char *data;
+        uint16_t len;
+        const char *expected;
+    };
+    struct pipelineCommand _commands[INKPLATE_ESP32_PIPELINE_MAX_CMDS];
+    char _cmdBuffer[INKPLATE_ESP32_PIPELINE_BUFFER_SIZE];
+    uint16_t _cmdBufferLen = 0;
+    uint8_t _count = 0;
+
+    // Index of the first failed command, overflow flag (some command did not fit) and the time of the last run.
+    int _failed = -1;
+    bool _overflow = false;
+    unsigned long _elapsed = 0;
+};
+
+#endif
@@ -0,0 +1,504 @@
+// Include main header file.
+#include "esp32SpiAt.h"
+
+// Helper function for getting the reason phrase of the HTTP status code.
+static const char *httpReason(uint16_t _code)
+{
+    switch (_code)
+    {
+    case 200:
+        return "OK";
+    case 204:
+        return "No Content";
+    case 400:
+        return "Bad Request";
+    case 404:
+        return "Not Found";
+    case 405:
+        return "Method Not Allowed";
+    case 500:
+        return "Internal Server Error";
+    default:
+        return "Unknown";
+    }
+}
+
+/**
+ * @brief Construct a new WiFiHttpServer object - for the HTTP server.
+ *
+ * @param   WiFiClass &_wifiModem
+ *          Modem used by this object (default is WiFi, use other WiFiClass object for additional modems).
+ */
+WiFiHttpServer::WiFiHttpServer(WiFiClass &_wifiModem)
+{
+    // Bind it to the modem.
+    _modem = &_wifiModem;
+
+    // No connections yet.
+    for (int i = 0; i < INKPLATE_ESP32_MAX_LINKS; i++)
+        _connections[i].state = INKPLATE_ESP32_HTTP_REQ_IDLE;
+}
+
+/**
+ * @brief   Start the server. Call handle() often (from the loop()) after that.
+ *
+ * @param   uint16_t _port
+ *          Port of the server (default is 80).
+ * @return  bool
+ *          true - Server started.
+ *          false - Server failed to start.
+ */
+bool WiFiHttpServer::begin(uint16_t _port)
+{
+    for (int i = 0; i < INKPLATE_ESP32_MAX_LINKS; i++)
+        _connections[i].state = INKPLATE_ESP32_HTTP_REQ_IDLE;
+
+    return _modem->serverBegin(_port, INKPLATE_ESP32_HTTP_SERVER_TIMEOUT);
+}
+
+/**
+ * @brief   Stop the server and close all of its connections.
+ *
+ */
+void WiFiHttpServer::end()
+{
+    _modem->serverEnd();
+
+    for (int i = 0; i < INKPLATE_ESP32_MAX_LINKS; i++)
+        _connections[i].state = INKPLATE_ESP32_HTTP_REQ_IDLE;
+}
+
+/**
+ * @brief   Set the handler of the path. Cached response of the path (if any) is used for GET requests instead.
+ *
+ * @param   const char *_path
+ *          Path without the query (for example "/status"). It's not copied, it must stay valid.
+ * @param   httpRequestHandler _handler
+ *          Handler of the requests.
+ * @return  bool
+ *          true - Handler set.
+ *          false - There is no room for the new route.
+ */
+bool WiFiHttpServer::on(const char *_path, httpRequestHandler _handler)
+{
+    struct httpRouteTypedef *_route = findRoute(_path, true);
+    if (_route == NULL)
+        return false;
+
+    _route->handler = _handler;
+
+    return true;
+}
+
+/**
+ * @brief   Set the buffer for the cached responses.
+ *
+ * @param   uint8_t *_buffer
+ *          Buffer for the responses (header and body of each one).
+ * @param   uint32_t _size
+ *          Size of the buffer (in bytes).
+ */
+void WiFiHttpServer::setCache(uint8_t *_buffer, uint32_t _size)
+{
+    _cache = _buffer;
+    _cacheSize = (_buffer != NULL) ? _size : 0;
+    clearCache();
+}
+
+/**
+ * @brief   Build the response of the path into the cache. GET requests of the path get it as it is, without
+ *          calling the handler. Calling it again for the same path replaces the response, but the space of the old
+ *          one is freed only by clearCache().
+ *
+ * @param   const char *_path
+ *          Path without the query. It's not copied, it must stay valid.
+ * @param   const char *_contentType
+ *          Content type of the response (for example "text/html").
+ * @param   const char *_body
+ *          Body of the response (copied into the cache).
+ * @param   uint16_t _len
+ *          Length of the body (in bytes).
+ * @return  bool
+ *          true - Response cached.
+ *          false - There is no room for it in the cache (or for the new route), or it does not fit into one SPI
+ *          packet with the header.
+ */
+bool WiFiHttpServer::cache(const char *_path, const char *_contentType, const char *_body, uint16_t _len)
+{
+    // Check for user mistake (null-pointer!).
+    if ((_cache == NULL) || (_path == NULL) || (_contentType == NULL) || ((_body == NULL) && (_len != 0)))
+        return false;
+
+    // Build the header right into the cache.
+    char *_blob = (char *)_cache + _cacheUsed;
+    uint32_t _free = _cacheSize - _cacheUsed;
+    uint16_t _headerLen = buildHeader(_blob, (_free > 0xFFFF) ? 0xFFFF : _free, 200, _contentType, _len);
+    uint32_t _blobLen = (uint32_t)_headerLen + _len;
+    if ((_headerLen == 0) || (_blobLen > _free) || (_blobLen > INKPLATE_ESP32_SPI_MAX_MESAGE_DATA_BUFFER))
+        return false;
+
+    // Add the route only if the response fits.
+    struct httpRouteTypedef *_route = findRoute(_path, true);
+    if (_route == NULL)
+        return false;
+
+    memcpy(_blob + _headerLen, _body, _len);
+    _route->cacheOffset = _cacheUsed;
+    _route->cacheLen = _blobLen;
+    _cacheUsed += _blobLen;
+
+    return true;
+}
+
+/**
+ * @brief   Remove all responses from the cache (handlers stay).
+ *
+ */
+void WiFiHttpServer::clearCache()
+{
+    for (int i = 0; i < _routeCount; i++)
+        _routes[i].cacheLen = 0;
+
+    _cacheUsed = 0;
+}
+
+/**
+ * @brief   Send the response to the request (from the handler). Connection is closed after it.
+ *
+ * @param   int _linkId
+ *          Link ID of the request.
+ * @param   uint16_t _code
+ *          HTTP status code.
+ * @param   const char *_contentType
+ *          Content type of the response (for example "application/json").
+ * @param   const char *_body
+ *          Body of the response.
+ * @param   uint16_t _len
+ *          Length of the body (in bytes).
+ * @return  bool
+ *          true - Response sent.
+ *          false - Send failed.
+ */
+bool WiFiHttpServer::send(int _linkId, uint16_t _code, const char *_contentType, const char *_body, uint16_t _len)
+{
+    // Check for the valid link ID.
+    if ((_linkId < 0) || (_linkId >= INKPLATE_ESP32_MAX_LINKS))
+        return false;
+    _connections[_linkId].responded = true;
+
+    uint16_t _headerLen = buildHeader(_response, sizeof(_response), _code, _contentType, _len);
+    if (_headerLen == 0)
+        return false;
+
+    // Header and the first part of the body go together (as two segments, the body is not copied), the rest of
+    // the body goes in pieces of one SPI packet.
+    uint16_t _firstPart = INKPLATE_ESP32_SPI_MAX_MESAGE_DATA_BUFFER - _headerLen;
+    if (_firstPart > _len)
+        _firstPart = _len;
+    struct spiAtSegmentTypedef _segments[2] = {{_response, _headerLen}, {_body, _firstPart}};
+    if (!_modem->linkSendTo(_linkId, _segments, 2))
+        return false;
+    _body += _firstPart;
+    _len -= _firstPart;
+
+    while (_len != 0)
+    {
+        uint16_t _chunkSize = (_len > INKPLATE_ESP32_SPI_MAX_MESAGE_DATA_BUFFER) ? INKPLATE_ESP32_SPI_MAX_MESAGE_DATA_BUFFER
+                                                                                : _len;
+        if (!_modem->linkSendTo(_linkId, _body, _chunkSize))
+            return false;
+
+        _body += _chunkSize;
+        _len -= _chunkSize;
+    }
+
+    return true;
+}
+
+/**
+ * @brief   Service the server. Parse the data of the connections and answer the complete requests (one request
+ *          per connection). Call it often (from the loop()).
+ *
+ */
+void WiFiHttpServer::handle()
+{
+    // Get the new data and the new connections.
+    _modem->poll();
+
+    for (int i = 0; i < INKPLATE_ESP32_MAX_LINKS; i++)
+    {
+        struct httpConnectionTypedef *_conn = &_connections[i];
+
+        // Only the connections to the server.
+        if (!_modem->linkAccepted(i))
+        {
+            _conn->state = INKPLATE_ESP32_HTTP_REQ_IDLE;
+            continue;
+        }
+
+        // New connection, start with the request line. Link ID can also be taken by the new connection before
+        // the old one is released here (see WiFiClass::linkSession()).
+        uint8_t _session = _modem->linkSession(i);
+        if ((_conn->state == INKPLATE_ESP32_HTTP_REQ_IDLE) || (_conn->session != _session))
+        {
+            _conn->state = INKPLATE_ESP32_HTTP_REQ_LINE;
+            _conn->len = 0;
+            _conn->session = _session;
+        }
+
+        // Parse what has arrived so far.
+        char _data[64];
+        int _n;
+        while ((_conn->state < INKPLATE_ESP32_HTTP_REQ_DONE) && ((_n = _modem->linkRead(i, _data, sizeof(_data))) > 0))
+        {
+            for (int j = 0; (j < _n) && (_conn->state < INKPLATE_ESP32_HTTP_REQ_DONE); j++)
+                parse(_conn, _data[j]);
+        }
+
+        // Answer the request. Wait for the rest of it if the connection is still open.
+        if (_conn->state == INKPLATE_ESP32_HTTP_REQ_DONE)
+            dispatch(i, _conn);
+        else if (_conn->state == INKPLATE_ESP32_HTTP_REQ_ERROR)
+            send(i, 400, "text/plain", "Bad Request", 11);
+        else if (_modem->linkConnected(i))
+            continue;
+
+        // One request per connection. Do not close the new connection that took the link ID in the meantime.
+        if (_modem->linkSession(i) == _session)
+            _modem->linkClose(i);
+        _conn->state = INKPLATE_ESP32_HTTP_REQ_IDLE;
+    }
+}
+
+/**
+ * @brief   Get the number of answered requests.
+ *
+ * @return  uint32_t
+ *          Number of requests.
+ */
+uint32_t WiFiHttpServer::requests()
+{
+    return _requests;
+}
+
+/**
+ * @brief   Get the number of requests answered from the cache.
+ *
+ * @return  uint32_t
+ *          Number of requests.
+ */
+uint32_t WiFiHttpServer::cacheHits()
+{
+    return _cacheHits;
+}
+
+/**
+ * @brief   Helper method for finding the route of the path.
+ *
+ * @param   const char *_path
+ *          Path without the query.
+ * @param   bool _add
+ *          true - Add the new route if there is none.
+ * @return  struct httpRouteTypedef*
+ *          Route, NULL if there is none (or no room for the new one).
+ */
+struct WiFiHttpServer::httpRouteTypedef *WiFiHttpServer::findRoute(const char *_path, bool _add)
+{
+    // Check for user mistake (null-pointer!).
+    if (_path == NULL)
+        return NULL;
+
+    for (int i = 0; i < _routeCount; i++)
+    {
+        if (strcmp(_routes[i].path, _path) == 0)
+            return &_routes[i];
+    }
+
+    if (!_add || (_routeCount >= INKPLATE_ESP32_HTTP_SERVER_MAX_ROUTES))
+        return NULL;
+
+    struct httpRouteTypedef *_route = &_routes[_routeCount++];
+    _route->path = _path;
+    _route->handler = NULL;
+    _route->cacheOffset = 0;
+    _route->cacheLen = 0;
+
+    return _route;
+}
+
+/**
+ * @brief   Helper method for parsing the request, one char at a time (data of the request can arrive in any
+ *          number of pieces). Request line and the body are kept, headers are dropped except the
+ *          "Content-Length".
+ *
+ * @param   struct httpConnectionTypedef *_conn
+ *          Connection.
+ * @param   char _c
+ *          Next char of the request.
+ */
+void WiFiHttpServer::parse(struct httpConnectionTypedef *_conn, char _c)
+{
+    switch (_conn->state)
+    {
+    case INKPLATE_ESP32_HTTP_REQ_LINE:
+        if (_c == '\n')
+        {
+            // Request line is done, split it into the method and the path ("GET /path HTTP/1.1").
+            if ((_conn->len != 0) && (_conn->request[_conn->len - 1] == '\r'))
+                _conn->len--;
+            _conn->request[_conn->len] = '\0';
+
+            char *_path = strchr(_conn->request, ' ');
+            if ((_path == NULL) || (_path[1] != '/'))
+            {
+                _conn->state = INKPLATE_ESP32_HTTP_REQ_ERROR;
+                break;
+            }
+            *(_path++) = '\0';
+            char *_version = strchr(_path, ' ');
+            if (_version != NULL)
+                *_version = '\0';
+
+            // Body goes after the request line.
+            _conn->len++;
+            _conn->bodyStart = _conn->len;
+            _conn->bodyRemaining = 0;
+            _conn->headerLen = 0;
+            _conn->headerEmpty = true;
+            _conn->state = INKPLATE_ESP32_HTTP_REQ_HEADERS;
+        }
+        else if (_conn->len < (sizeof(_conn->request) - 1))
+        {
+            _conn->request[_conn->len++] = _c;
+        }
+        else
+        {
+            // Request line is too long.
+            _conn->state = INKPLATE_ESP32_HTTP_REQ_ERROR;
+        }
+        break;
+
+    case INKPLATE_ESP32_HTTP_REQ_HEADERS:
+        if (_c == '\n')
+        {
+            // Empty line ends the headers. Only the length of the body is needed from them.
+            if (_conn->headerEmpty)
+            {
+                _conn->state = (_conn->bodyRemaining != 0) ? INKPLATE_ESP32_HTTP_REQ_BODY : INKPLATE_ESP32_HTTP_REQ_DONE;
+            }
+            else
+            {
+                _conn->header[_conn->headerLen] = '\0';
+                if (strncasecmp(_conn->header, "Content-Length:", 15) == 0)
+                    _conn->bodyRemaining = strtoul(&_conn->header[15], NULL, 10);
+            }
+
+            _conn->headerLen = 0;
+            _conn->headerEmpty = true;
+        }
+        else if (_c != '\r')
+        {
+            _conn->headerEmpty = false;
+            if (_conn->headerLen < (sizeof(_conn->header) - 1))
+                _conn->header[_conn->headerLen++] = _c;
+        }
+        break;
+
+    case INKPLATE_ESP32_HTTP_REQ_BODY:
+        // Body that does not fit is cut.
+        if (_conn->len < (sizeof(_conn->request) - 1))
+            _conn->request[_conn->len++] = _c;
+
+        if (--_conn->bodyRemaining == 0)
+        {
+            _conn->request[_conn->len] = '\0';
+            _conn->state = INKPLATE_ESP32_HTTP_REQ_DONE;
+        }
+        break;
+    }
+}
+
+/**
+ * @brief   Helper method for answering the complete request (from the cache, by the handler or "404").
+ *
+ * @param   int _linkId
+ *          Link ID of the request.
+ * @param   struct httpConnectionTypedef *_conn
+ *          Connection with the parsed request.
+ */
+void WiFiHttpServer::dispatch(int _linkId, struct httpConnectionTypedef *_conn)
+{
+    struct spiAtHttpRequestTypedef _request;
+
+    // Method and path are one after the other, query is split from the path.
+    char *_path = _conn->request + strlen(_conn->request) + 1;
+    char *_query = strchr(_path, '?');
+    if (_query != NULL)
+        *(_query++) = '\0';
+    else
+        _query = _path + strlen(_path);
+
+    _request.linkId = _linkId;
+    _request.method = _conn->request;
+    _request.path = _path;
+    _request.query = _query;
+    _request.body = _conn->request + _conn->bodyStart;
+    _request.bodyLen = _conn->len - _conn->bodyStart;
+    _conn->request[_conn->len] = '\0';
+
+    _requests++;
+    _conn->responded = false;
+
+    struct httpRouteTypedef *_route = findRoute(_path, false);
+    if (_route == NULL)
+    {
+        send(_linkId, 404, "text/plain", "Not Found", 9);
+    }
+    else if ((_route->cacheLen != 0) && (strcmp(_request.method, "GET") == 0))
+    {
+        // Whole response is ready, one send.
+        _cacheHits++;
+        _modem->linkSendTo(_linkId, (const char *)_cache + _route->cacheOffset, _route->cacheLen);
+    }
+    else if (_route->handler != NULL)
+    {
+        _route->handler(*this, &_request);
+
+        if (!_conn->responded)
+            send(_linkId, 500, "text/plain", "No Response", 11);
+    }
+    else
+    {
+        send(_linkId, 405, "text/plain", "Method Not Allowed", 18);
+    }
+}
+
+/**
+ * @brief   Helper method for building the header of the response.
+ *
+ * @param   char *_buffer
+ *          Where to build the header.
+ * @param   uint16_t _size
+ *          Size of the buffer (in bytes).
+ * @param   uint16_t _code
+ *          HTTP status code.
+ * @param   const char *_contentType
+ *          Content type of the response.
+ * @param   uint16_t _len
+ *          Length of the body (in bytes).
+ * @return  uint16_t
+ *          Length of the header, 0 if it does not fit.
+ */
+uint16_t WiFiHttpServer::buildHeader(char *_buffer, uint16_t _size, uint16_t _code, const char *_contentType,
+                                     uint16_t _len)
+{
+    const char *_reason = httpReason(_code);
+
+    AtCommandBuilder _header(_buffer, _size);
+    _header.add("HTTP/1.1 ").addUInt(_code).addChar(' ').addRaw(_reason, strlen(_reason));
+    _header.add("\r\nContent-Type: ").addRaw(_contentType, strlen(_contentType));
+    _header.add("\r\nContent-Length: ").addUInt(_len);
+    _header.add("\r\nConnection: close\r\n\r\n");
+
+    return _header.overflow() ? 0 : _header.length();
+}
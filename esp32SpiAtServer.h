@@ -0,0 +1,122 @@
+// Add headerguard do prevent multiple include.
+#ifndef __ESP32_SPI_AT_SERVER_H__
+#define __ESP32_SPI_AT_SERVER_H__
+
+// Include main Arduino header file.
+#include <Arduino.h>
+
+// Include main ESP32-C3 AT SPI library.
+#include "esp32SpiAt.h"
+
+// Max. number of routes (paths with the handler or the cached response).
+#ifndef INKPLATE_ESP32_HTTP_SERVER_MAX_ROUTES
+#define INKPLATE_ESP32_HTTP_SERVER_MAX_ROUTES 8
+#endif
+
+// Size of the request buffer of each connection (request line and the body, headers are not kept).
+#ifndef INKPLATE_ESP32_HTTP_SERVER_REQUEST_SIZE
+#define INKPLATE_ESP32_HTTP_SERVER_REQUEST_SIZE 256
+#endif
+
+// Size of the buffer for the headers of the responses of the handlers (body is sent from the buffer of the handler).
+#ifndef INKPLATE_ESP32_HTTP_SERVER_RESPONSE_SIZE
+#define INKPLATE_ESP32_HTTP_SERVER_RESPONSE_SIZE 192
+#endif
+
+// Connection is closed by the modem if the request does not arrive in this time (in seconds).
+#ifndef INKPLATE_ESP32_HTTP_SERVER_TIMEOUT
+#define INKPLATE_ESP32_HTTP_SERVER_TIMEOUT 10
+#endif
+
+// States of the request parser.
+#define INKPLATE_ESP32_HTTP_REQ_IDLE    0
+#define INKPLATE_ESP32_HTTP_REQ_LINE    1
+#define INKPLATE_ESP32_HTTP_REQ_HEADERS 2
+#define INKPLATE_ESP32_HTTP_REQ_BODY    3
+#define INKPLATE_ESP32_HTTP_REQ_DONE    4
+#define INKPLATE_ESP32_HTTP_REQ_ERROR   5
+
+// Used for passing the request to the handler. Strings are valid only during the handler call.
+struct spiAtHttpRequestTypedef
+{
+    int linkId;
+    const char *method;
+    const char *path;
+    const char *query;
+    const char *body;
+    uint16_t bodyLen;
+};
+
+// Typedef for the request handler. It must answer with WiFiHttpServer::send() (otherwise "500" is sent).
+class WiFiHttpServer;
+typedef void (*httpRequestHandler)(WiFiHttpServer &_server, struct spiAtHttpRequestTypedef *_request);
+
+// Class for the HTTP server on the TCP server of the modem. Requests are parsed as their data arrives (any number
+// of connections at the same time, one request per connection) and routed to the handlers by the path. Static
+// responses can be cached - header and body are built once into the cache buffer and each request gets them with
+// a single AT+CIPSEND.
+class WiFiHttpServer
+{
+  public:
+    WiFiHttpServer(WiFiClass &_wifiModem = WiFi);
+    bool begin(uint16_t _port = 80);
+    void end();
+    bool on(const char *_path, httpRequestHandler _handler);
+    void setCache(uint8_t *_buffer, uint32_t _size);
+    bool cache(const char *_path, const char *_contentType, const char *_body, uint16_t _len);
+    void clearCache();
+    bool send(int _linkId, uint16_t _code, const char *_contentType, const char *_body, uint16_t _len);
+    void handle();
+    uint32_t requests();
+    uint32_t cacheHits();
+
+  private:
+    // Route (path must stay valid) with its handler and the cached response.
+    struct httpRouteTypedef
+    {
+        const char *path;
+        httpRequestHandler handler;
+        uint32_t cacheOffset;
+        uint16_t cacheLen;
+    };
+
+    // Request parser of one connection.
+    struct httpConnectionTypedef
+    {
+        uint8_t state;
+        char request[INKPLATE_ESP32_HTTP_SERVER_REQUEST_SIZE];
+        uint16_t len;
+        uint16_t bodyStart;
+        uint32_t bodyRemaining;
+        char header[24];
+        uint8_t headerLen;
+        bool headerEmpty;
+        bool responded;
+        uint8_t session;
+    };
+
+    struct httpRouteTypedef *findRoute(const char *_path, bool _add);
+    void parse(struct httpConnectionTypedef *_conn, char _c);
+    void dispatch(int _linkId, struct httpConnectionTypedef *_conn);
+    uint16_t buildHeader(char *_buffer, uint16_t _size, uint16_t _code, const char *_contentType, uint16_t _len);
+
+    // Modem used by this object.
+    WiFiClass *_modem;
+
+    // Routes, cache buffer and the request parsers of the connections.
+    struct httpRouteTypedef _routes[INKPLATE_ESP32_HTTP_SERVER_MAX_ROUTES];
+    uint8_t _routeCount = 0;
+    uint8_t *_cache = NULL;
+    uint32_t _cacheSize = 0;
+    uint32_t _cacheUsed = 0;
+    struct httpConnectionTypedef _connections[INKPLATE_ESP32_MAX_LINKS];
+
+    // Buffer for the headers of the responses of the handlers.
+    char _response[INKPLATE_ESP32_HTTP_SERVER_RESPONSE_SIZE];
+
+    // Statistics.
+    uint32_t _requests = 0;
+    uint32_t _cacheHits = 0;
+};
+
+#endif
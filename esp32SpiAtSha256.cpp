@@ -0,0 +1,191 @@
+// Include main header file.
+#include "esp32SpiAt.h"
+
+// SHA-256 round constants.
+static const uint32_t _sha256K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+// Rotate right.
+static inline uint32_t sha256Ror(uint32_t _x, uint8_t _n)
+{
+    return (_x >> _n) | (_x << (32 - _n));
+}
+
+/**
+ * @brief Construct a new Sha256 object - ready for the new hash.
+ *
+ */
+Sha256::Sha256()
+{
+    begin();
+}
+
+/**
+ * @brief   Start the new hash.
+ *
+ */
+void Sha256::begin()
+{
+    // Initial hash value.
+    _state[0] = 0x6a09e667;
+    _state[1] = 0xbb67ae85;
+    _state[2] = 0x3c6ef372;
+    _state[3] = 0xa54ff53a;
+    _state[4] = 0x510e527f;
+    _state[5] = 0x9b05688c;
+    _state[6] = 0x1f83d9ab;
+    _state[7] = 0x5be0cd19;
+
+    _byteCount = 0;
+    _blockLen = 0;
+}
+
+/**
+ * @brief   Add the data to the hash.
+ *
+ * @param   const void *_data
+ *          Data.
+ * @param   uint32_t _len
+ *          Length of the data (in bytes).
+ */
+void Sha256::update(const void *_data, uint32_t _len)
+{
+    const uint8_t *_bytes = (const uint8_t *)_data;
+    _byteCount += _len;
+
+    // Fill the partial block first.
+    if (_blockLen != 0)
+    {
+        uint32_t _copy = 64 - _blockLen;
+        if (_copy > _len)
+            _copy = _len;
+        memcpy(&_block[_blockLen], _bytes, _copy);
+        _blockLen += _copy;
+        _bytes += _copy;
+        _len -= _copy;
+
+        if (_blockLen < 64)
+            return;
+
+        transform(_block);
+        _blockLen = 0;
+    }
+
+    // Whole blocks are hashed right from the data.
+    while (_len >= 64)
+    {
+        transform(_bytes);
+        _bytes += 64;
+        _len -= 64;
+    }
+
+    // Keep the rest for the next time.
+    memcpy(_block, _bytes, _len);
+    _blockLen = _len;
+}
+
+/**
+ * @brief   Finish the hash (padding and length) and get the digest. Call begin() before the next hash.
+ *
+ * @param   uint8_t *_digest
+ *          Where to store the digest (INKPLATE_ESP32_SHA256_LEN bytes).
+ */
+void Sha256::finish(uint8_t *_digest)
+{
+    uint64_t _bitCount = _byteCount * 8;
+
+    // Padding, length must go into the last 8 bytes of the block.
+    _block[_blockLen++] = 0x80;
+    if (_blockLen > 56)
+    {
+        memset(&_block[_blockLen], 0, 64 - _blockLen);
+        transform(_block);
+        _blockLen = 0;
+    }
+    memset(&_block[_blockLen], 0, 56 - _blockLen);
+
+    // Length in bits, big endian.
+    for (int i = 0; i < 8; i++)
+    {
+        _block[63 - i] = (uint8_t)(_bitCount >> (i * 8));
+    }
+    transform(_block);
+
+    // Digest, big endian.
+    for (int i = 0; i < 8; i++)
+    {
+        _digest[(i * 4) + 0] = (uint8_t)(_state[i] >> 24);
+        _digest[(i * 4) + 1] = (uint8_t)(_state[i] >> 16);
+        _digest[(i * 4) + 2] = (uint8_t)(_state[i] >> 8);
+        _digest[(i * 4) + 3] = (uint8_t)(_state[i]);
+    }
+}
+
+/**
+ * @brief   Helper method for hashing one 64 byte block.
+ *
+ * @param   const uint8_t *_data
+ *          Block.
+ */
+void Sha256::transform(const uint8_t *_data)
+{
+    uint32_t _w[64];
+
+    // Message schedule.
+    for (int i = 0; i < 16; i++)
+    {
+        _w[i] = ((uint32_t)_data[i * 4] << 24) | ((uint32_t)_data[(i * 4) + 1] << 16) |
+                ((uint32_t)_data[(i * 4) + 2] << 8) | (uint32_t)_data[(i * 4) + 3];
+    }
+    for (int i = 16; i < 64; i++)
+    {
+        uint32_t _s0 = sha256Ror(_w[i - 15], 7) ^ sha256Ror(_w[i - 15], 18) ^ (_w[i - 15] >> 3);
+        uint32_t _s1 = sha256Ror(_w[i - 2], 17) ^ sha256Ror(_w[i - 2], 19) ^ (_w[i - 2] >> 10);
+        _w[i] = _w[i - 16] + _s0 + _w[i - 7] + _s1;
+    }
+
+    uint32_t _a = _state[0];
+    uint32_t _b = _state[1];
+    uint32_t _c = _state[2];
+    uint32_t _d = _state[3];
+    uint32_t _e = _state[4];
+    uint32_t _f = _state[5];
+    uint32_t _g = _state[6];
+    uint32_t _h = _state[7];
+
+    // Compression.
+    for (int i = 0; i < 64; i++)
+    {
+        uint32_t _s1 = sha256Ror(_e, 6) ^ sha256Ror(_e, 11) ^ sha256Ror(_e, 25);
+        uint32_t _ch = (_e & _f) ^ (~_e & _g);
+        uint32_t _t1 = _h + _s1 + _ch + _sha256K[i] + _w[i];
+        uint32_t _s0 = sha256Ror(_a, 2) ^ sha256Ror(_a, 13) ^ sha256Ror(_a, 22);
+        uint32_t _maj = (_a & _b) ^ (_a & _c) ^ (_b & _c);
+        uint32_t _t2 = _s0 + _maj;
+
+        _h = _g;
+        _g = _f;
+        _f = _e;
+        _e = _d + _t1;
+        _d = _c;
+        _c = _b;
+        _b = _a;
+        _a = _t1 + _t2;
+    }
+
+    _state[0] += _a;
+    _state[1] += _b;
+    _state[2] += _c;
+    _state[3] += _d;
+    _state[4] += _e;
+    _state[5] += _f;
+    _state[6] += _g;
+    _state[7] += _h;
+}
@@ -0,0 +1,30 @@
+// Add headerguard do prevent multiple include.
+#ifndef __ESP32_SPI_AT_SHA256_H__
+#define __ESP32_SPI_AT_SHA256_H__
+
+// Include main Arduino header file.
+#include <Arduino.h>
+
+// Length of the SHA-256 digest (in bytes).
+#define INKPLATE_ESP32_SHA256_LEN 32
+
+// Class for the incremental SHA-256 (FIPS 180-4). Data can be added in chunks of any size.
+class Sha256
+{
+  public:
+    Sha256();
+    void begin();
+    void update(const void *_data, uint32_t _len);
+    void finish(uint8_t *_digest);
+
+  private:
+    void transform(const uint8_t *_block);
+
+    // Hash state, number of bytes hashed so far and the partial block.
+    uint32_t _state[8];
+    uint64_t _byteCount = 0;
+    uint8_t _block[64];
+    uint8_t _blockLen = 0;
+};
+
+#endif
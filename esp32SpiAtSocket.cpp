@@ -0,0 +1,231 @@
+// Include main header file.
+#include "esp32SpiAt.h"
+
+/**
+ * @brief Construct a new WiFiSocket object - for TCP/SSL connections.
+ *
+ * @param   WiFiClass &_wifiModem
+ *          Modem used by this object (default is WiFi, use other WiFiClass object for additional modems).
+ */
+WiFiSocket::WiFiSocket(WiFiClass &_wifiModem)
+{
+    // Bind it to the modem.
+    _modem = &_wifiModem;
+
+    // There is no connection to use again.
+    _remoteHost[0] = '\0';
+}
+
+/**
+ * @brief   Open the TCP (or SSL) connection to the host. Multiple connections are enabled
+ *          automatically on the modem. If the connection to the same host is still open, it's used again
+ *          (no new handshake, see reused()). Data left unread from the previous request is discarded, so the
+ *          new response starts with its own data.
+ *
+ * @param   const char *_host
+ *          Host name or IP Address of the remote host.
+ * @param   uint16_t _port
+ *          Port of the remote host.
+ * @param   bool _ssl
+ *          true - Use SSL connection.
+ *          false - Use plain TCP connection.
+ * @return  bool
+ *          true - Connection established.
+ *          false - Connection failed (or there is no free link ID).
+ */
+bool WiFiSocket::connect(const char *_host, uint16_t _port, bool _ssl)
+{
+    // Check for user mistake (null-pointer!).
+    if (_host == NULL)
+        return false;
+
+    // Check for the closed connection first.
+    _modem->poll();
+
+    // Use the open connection again if it goes to the same host.
+    _reused = (_linkId >= 0) && _modem->linkConnected(_linkId) && (_port == _remotePort) &&
+              (_ssl == _remoteSsl) && (strcmp(_host, _remoteHost) == 0);
+    if (_reused)
+    {
+        // Drop what is left of the previous response.
+        _modem->linkRead(_linkId, NULL, _modem->linkAvailable(_linkId));
+        return true;
+    }
+
+    // Close previous connection first (if any).
+    stop();
+
+    // Try to open a new connection.
+    _linkId = _modem->linkOpen(_ssl ? "SSL" : "TCP", _host, _port, 0, 0, _tlsSet ? &_tls : NULL);
+    if (_linkId < 0)
+        return false;
+
+    // Remember where it goes. Host name that is too long is never matched again.
+    strncpy(_remoteHost, _host, sizeof(_remoteHost) - 1);
+    _remoteHost[sizeof(_remoteHost) - 1] = '\0';
+    if (strlen(_host) >= sizeof(_remoteHost))
+        _remoteHost[0] = '\0';
+    _remotePort = _port;
+    _remoteSsl = _ssl;
+
+    return true;
+}
+
+/**
+ * @brief   Check if the connection is still open or if there is still unread data.
+ *
+ * @return  bool
+ *          true - Connection is open or there is unread data.
+ *          false - Connection is closed.
+ */
+bool WiFiSocket::connected()
+{
+    // Check for the new data and events first.
+    _modem->poll();
+
+    return _modem->linkConnected(_linkId) || (_modem->linkAvailable(_linkId) > 0);
+}
+
+/**
+ * @brief   Method returns available bytes to read (and also checks for the new data).
+ *
+ * @return  int
+ *          Number of bytes available for read.
+ */
+int WiFiSocket::available()
+{
+    // Check for the new data (and send pending data).
+    _modem->poll();
+
+    return _modem->linkAvailable(_linkId);
+}
+
+/**
+ * @brief   Copy received data into the user-defined buffer.
+ *
+ * @param   char *_buffer
+ *          Pointer to the user-defined buffer.
+ * @param   uint16_t _len
+ *          Max. number of bytes that will be copied.
+ * @return  int
+ *          Actual number of bytes copied (-1 if socket is not connected).
+ */
+int WiFiSocket::read(char *_buffer, uint16_t _len)
+{
+    return _modem->linkRead(_linkId, _buffer, _len);
+}
+
+/**
+ * @brief   Read one byte from the received data.
+ *
+ * @return  int
+ *          One byte from the received data or -1 if there is no data.
+ */
+int WiFiSocket::read()
+{
+    char _c;
+
+    // Try to read one byte.
+    if (_modem->linkRead(_linkId, &_c, 1) != 1)
+        return -1;
+
+    return (uint8_t)_c;
+}
+
+/**
+ * @brief   Write the data to the connection. Data is queued and sent by the _modem->poll() in turns with
+ *          the other open connections. Use flush() to wait until everything is sent.
+ *
+ * @param   const char *_data
+ *          Pointer to the data.
+ * @param   uint16_t _len
+ *          Length of the data (in bytes).
+ * @return  int
+ *          Number of bytes queued for sending (-1 if socket is not connected).
+ */
+int WiFiSocket::write(const char *_data, uint16_t _len)
+{
+    return _modem->linkWrite(_linkId, _data, _len);
+}
+
+/**
+ * @brief   Wait until all written data has been sent.
+ *
+ * @param   unsigned long _timeout
+ *          Timeout value in milliseconds.
+ * @return  bool
+ *          true - All data has been sent.
+ *          false - Timeout occured or connection has been closed.
+ */
+bool WiFiSocket::flush(unsigned long _timeout)
+{
+    return _modem->linkFlush(_linkId, _timeout);
+}
+
+/**
+ * @brief   Close the connection and release the link ID. MUST be called when socket is not needed
+ *          anymore, since the number of link IDs is limited.
+ *
+ */
+void WiFiSocket::stop()
+{
+    // Nothing to do if the socket is not used.
+    if (_linkId < 0)
+        return;
+
+    // Close the connection.
+    _modem->linkClose(_linkId);
+    _linkId = -1;
+}
+
+/**
+ * @brief   Get the link ID used by this socket.
+ *
+ * @return  int
+ *          Link ID (0 to INKPLATE_ESP32_MAX_LINKS - 1), -1 if socket is not connected.
+ */
+int WiFiSocket::linkId()
+{
+    return _linkId;
+}
+
+/**
+ * @brief   Set the TLS settings used by the next SSL connect() (certificate check, server name).
+ *
+ * @param   const struct spiAtTlsConfigTypedef *_config
+ *          TLS settings (copied, but the SNI string must stay valid). NULL - no certificate check, host name
+ *          is the server name.
+ */
+void WiFiSocket::setTls(const struct spiAtTlsConfigTypedef *_config)
+{
+    _tlsSet = (_config != NULL);
+    if (_tlsSet)
+        _tls = *_config;
+
+    // New settings need the new handshake.
+    _remoteHost[0] = '\0';
+}
+
+/**
+ * @brief   Get the time needed for opening the connection by the last connect() (TCP and, for SSL, the TLS
+ *          handshake), so it can be told apart from the time of the request itself.
+ *
+ * @return  unsigned long
+ *          Time in milliseconds (0 if the open connection has been used again).
+ */
+unsigned long WiFiSocket::handshakeTime()
+{
+    return _reused ? 0 : _modem->linkHandshakeTime(_linkId);
+}
+
+/**
+ * @brief   Check if the last connect() used the open connection again.
+ *
+ * @return  bool
+ *          true - Open connection used again, there was no handshake.
+ *          false - New connection opened.
+ */
+bool WiFiSocket::reused()
+{
+    return _reused;
+}
@@ -0,0 +1,48 @@
+// Add headerguard do prevent multiple include.
+#ifndef __ESP32_SPI_AT_SOCKET_H__
+#define __ESP32_SPI_AT_SOCKET_H__
+
+// Include main Arduino header file.
+#include <Arduino.h>
+
+// Include main ESP32-C3 AT SPI library.
+#include "esp32SpiAt.h"
+
+// Class for TCP/SSL connection over SPI AT commands. Each object uses its own link ID, so multiple
+// connections can be open at the same time. Connection to the same host is kept open and used again by the next
+// connect(), so the TLS handshake is done only once for the consecutive requests.
+class WiFiSocket
+{
+  public:
+    WiFiSocket(WiFiClass &_wifiModem = WiFi);
+    bool connect(const char *_host, uint16_t _port, bool _ssl = false);
+    bool connected();
+    int available();
+    int read(char *_buffer, uint16_t _len);
+    int read();
+    int write(const char *_data, uint16_t _len);
+    bool flush(unsigned long _timeout = 5000UL);
+    void stop();
+    int linkId();
+    void setTls(const struct spiAtTlsConfigTypedef *_config);
+    unsigned long handshakeTime();
+    bool reused();
+
+  private:
+    // Modem used by this object.
+    WiFiClass *_modem;
+
+    int _linkId = -1;
+
+    // TLS settings for the SSL connections (used only if set).
+    struct spiAtTlsConfigTypedef _tls;
+    bool _tlsSet = false;
+
+    // Remote end of the open connection (for using it again) and the result of the last connect().
+    char _remoteHost[INKPLATE_ESP32_DNS_CACHE_HOST_LEN];
+    uint16_t _remotePort = 0;
+    bool _remoteSsl = false;
+    bool _reused = false;
+};
+
+#endif
@@ -0,0 +1,314 @@
+// Include main header file.
+#include "esp32SpiAt.h"
+
+/**
+ * @brief Construct a new WiFiTime object - for SNTP time.
+ *
+ * @param   WiFiClass &_wifiModem
+ *          Modem used by this object (default is WiFi, use other WiFiClass object for additional modems).
+ */
+WiFiTime::WiFiTime(WiFiClass &_wifiModem)
+{
+    // Bind it to the modem.
+    _modem = &_wifiModem;
+}
+
+/**
+ * @brief   Enable SNTP on the modem (in UTC) and sync the local clock. WiFi must be connected first.
+ *
+ * @param   const char *_server1
+ *          Primary NTP server.
+ * @param   const char *_server2
+ *          Secondary NTP server (optional, NULL if not used).
+ * @return  bool
+ *          true - SNTP enabled and time synced.
+ *          false - SNTP config failed or time is not available yet (try sync() later).
+ */
+bool WiFiTime::begin(const char *_server1, const char *_server2)
+{
+    // Check for user mistake (null-pointer!).
+    if (_server1 == NULL)
+        return false;
+
+    // Get the buffer for the AT commands.
+    char *_command = _modem->getDataBuffer();
+
+    // Make the AT Command. Add the secondary server if used.
+    AtCommandBuilder _cmd(_command, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE);
+    _cmd.add(esp32AtSntpConfig).addQuoted(_server1);
+    if (_server2 != NULL)
+        _cmd.add(",").addQuoted(_server2);
+    _cmd.end();
+
+    // Send AT Command. Return false if failed.
+    if (!_modem->sendAtCommand(_cmd))
+        return false;
+
+    // Wait for the response. Return false if failed.
+    if (!_modem->waitForAtResult(_command, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE, 1000ULL))
+        return false;
+
+    // Modem needs some time to get the time from the server.
+    return sync();
+}
+
+/**
+ * @brief   Get the time from the modem (AT+CIPSNTPTIME?) and sync the local clock. Difference to the local
+ *          time is slewed in, so the time never steps back. If the last drift sample started long enough
+ *          ago, drift of the local clock is measured as well.
+ *
+ * @param   unsigned long _timeout
+ *          How long to wait for the modem to get the time from the server (in milliseconds).
+ * @return  bool
+ *          true - Time synced.
+ *          false - Time is not available.
+ */
+bool WiFiTime::sync(unsigned long _timeout)
+{
+    // Capture the time!
+    unsigned long _timeoutCounter = millis();
+
+    // Time from the modem.
+    uint32_t _epoch = 0;
+
+    // Try until the modem has the valid time.
+    while (!querySntpTime(&_epoch))
+    {
+        if ((unsigned long)(millis() - _timeoutCounter) >= _timeout)
+            return false;
+
+        delay(500);
+    }
+
+    // Capture the local time of the sync. Modem time has the resolution of one second, so use the middle of it.
+    unsigned long _now = millis();
+    uint64_t _newEpochMs = ((uint64_t)_epoch * 1000ULL) + 500ULL;
+
+    // Measure the drift (how much faster or slower local clock is) if the drift sample started long enough
+    // ago. It's measured over the whole sample, not only since the last sync (syncs can be more often).
+    if (!_valid || (_newEpochMs <= _driftEpochMs))
+    {
+        _driftEpochMs = _newEpochMs;
+        _driftMillis = _now;
+    }
+    else if ((_newEpochMs - _driftEpochMs) >= INKPLATE_ESP32_SNTP_MIN_DRIFT_INTERVAL)
+    {
+        uint64_t _refElapsed = _newEpochMs - _driftEpochMs;
+        unsigned long _localElapsed = _now - _driftMillis;
+        int64_t _error = (int64_t)_localElapsed - (int64_t)_refElapsed;
+        int32_t _measured = (int32_t)((_error * 1000000LL) / (int64_t)_refElapsed);
+
+        // Ignore clearly wrong values (time on the server changed or sync failed).
+        if ((_measured <= INKPLATE_ESP32_SNTP_MAX_DRIFT) && (_measured >= -INKPLATE_ESP32_SNTP_MAX_DRIFT))
+        {
+            // Older samples count half once the window is full.
+            if (_driftRefSum >= INKPLATE_ESP32_SNTP_DRIFT_WINDOW)
+            {
+                _driftRefSum /= 2;
+                _driftLocalSum /= 2;
+            }
+
+            // Each sample is weighted by its interval (error of one second matters less on the longer one).
+            _driftRefSum += _refElapsed;
+            _driftLocalSum += _error;
+            _driftPpm = (int32_t)((_driftLocalSum * 1000000LL) / (int64_t)_driftRefSum);
+        }
+
+        // Start the next sample.
+        _driftEpochMs = _newEpochMs;
+        _driftMillis = _now;
+    }
+
+    // Difference of the local time to the new reference. It's removed slowly, unless it's too large.
+    int64_t _offset = _valid ? ((int64_t)epochMillis() - (int64_t)_newEpochMs) : 0;
+    if ((_offset > INKPLATE_ESP32_SNTP_MAX_SLEW) || (_offset < -INKPLATE_ESP32_SNTP_MAX_SLEW))
+        _offset = 0;
+
+    // Save the new reference.
+    _syncEpochMs = _newEpochMs;
+    _syncMillis = _now;
+    _slewOffset = _offset;
+    _valid = true;
+
+    return true;
+}
+
+/**
+ * @brief   Sync the time with the modem only if it's not valid yet or if the resync interval has passed.
+ *          Call it from the loop(), most of the time it does nothing.
+ *
+ * @return  bool
+ *          true - Time is valid.
+ *          false - Time is not valid.
+ */
+bool WiFiTime::update()
+{
+    // Resync if needed. Use short timeout, it will try again next time.
+    if (!_valid || ((unsigned long)(millis() - _syncMillis) >= _resyncInterval))
+        sync(1000UL);
+
+    return _valid;
+}
+
+/**
+ * @brief   Check if the time has been synced at least once.
+ *
+ * @return  bool
+ *          true - Time is valid.
+ *          false - Time is not synced yet.
+ */
+bool WiFiTime::valid()
+{
+    return _valid;
+}
+
+/**
+ * @brief   Get the current time (UTC) in seconds since 1.1.1970. It does not use the modem.
+ *
+ * @return  uint32_t
+ *          Unix time, 0 if the time is not synced yet.
+ */
+uint32_t WiFiTime::epoch()
+{
+    return epochMillis() / 1000ULL;
+}
+
+/**
+ * @brief   Get the current time (UTC) in milliseconds since 1.1.1970. It's calculated from the last sync
+ *          and millis(), corrected with the measured drift. It does not use the modem and it never goes
+ *          back. Time must be synced at least once in 49 days (millis() overflow).
+ *
+ * @return  uint64_t
+ *          Unix time in milliseconds, 0 if the time is not synced yet.
+ */
+uint64_t WiFiTime::epochMillis()
+{
+    // Time is not synced yet.
+    if (!_valid)
+        return 0;
+
+    // Time passed since the last sync, corrected with the drift.
+    unsigned long _elapsed = millis() - _syncMillis;
+    int64_t _correction = ((int64_t)_elapsed * _driftPpm) / 1000000LL;
+    int64_t _time = (int64_t)_syncEpochMs + _elapsed - _correction;
+
+    // Add what is left from the difference found at the sync.
+    int64_t _slewed = _elapsed / INKPLATE_ESP32_SNTP_SLEW_RATE;
+    if (_slewOffset > _slewed)
+    {
+        _time += _slewOffset - _slewed;
+    }
+    else if (_slewOffset < -_slewed)
+    {
+        _time += _slewOffset + _slewed;
+    }
+
+    // Never go back (large difference at the sync or the drift correction changed).
+    if ((uint64_t)_time < _lastEpochMs)
+        _time = _lastEpochMs;
+    _lastEpochMs = _time;
+
+    return _time;
+}
+
+/**
+ * @brief   Get the measured drift of the local clock.
+ *
+ * @return  int32_t
+ *          Drift in ppm (positive - local clock is fast, negative - local clock is slow).
+ */
+int32_t WiFiTime::drift()
+{
+    return _driftPpm;
+}
+
+/**
+ * @brief   Set how often update() syncs the time with the modem.
+ *
+ * @param   unsigned long _interval
+ *          Resync interval in milliseconds (less than 49 days).
+ */
+void WiFiTime::setResyncInterval(unsigned long _interval)
+{
+    _resyncInterval = _interval;
+}
+
+/**
+ * @brief   Helper method for getting the SNTP time from the modem (AT+CIPSNTPTIME?). Response is in the
+ *          "+CIPSNTPTIME:Thu Aug 04 14:48:05 2021" format.
+ *
+ * @param   uint32_t *_epoch
+ *          Pointer to the variable where the time (seconds since 1.1.1970) will be stored.
+ * @return  bool
+ *          true - Time received.
+ *          false - Command failed or modem did not get the time from the server yet.
+ */
+bool WiFiTime::querySntpTime(uint32_t *_epoch)
+{
+    // Get the buffer for the AT commands.
+    char *_response = _modem->getDataBuffer();
+
+    // Send AT Command. Return false if failed.
+    if (!_modem->sendAtCommand((char *)esp32AtSntpTime))
+        return false;
+
+    // Wait for the response. Return false if failed.
+    if (!_modem->waitForAtResult(_response, INKPLATE_ESP32_AT_CMD_BUFFER_SIZE, 1000ULL))
+        return false;
+
+    // Find the start of the response.
+    char *_responseStart = strstr(_response, esp32AtSntpTimeResponse);
+    if (_responseStart == NULL)
+        return false;
+
+    // Parse it.
+    char _month[4];
+    int _day, _hour, _minute, _second, _year;
+    if (sscanf(_responseStart + sizeof(esp32AtSntpTimeResponse) - 1, "%*s %3s %d %d:%d:%d %d", _month, &_day, &_hour,
+               &_minute, &_second, &_year) != 6)
+        return false;
+
+    // Modem returns 1970 until it gets the time from the server.
+    if (_year < 2020)
+        return false;
+
+    // Get the month number.
+    const char *_months = "JanFebMarAprMayJunJulAugSepOctNovDec";
+    const char *_monthPos = strstr(_months, _month);
+    if ((_monthPos == NULL) || ((_monthPos - _months) % 3))
+        return false;
+
+    // Calculate the Unix time.
+    *_epoch = (daysFromCivil(_year, ((_monthPos - _months) / 3) + 1, _day) * 86400UL) + (_hour * 3600UL) +
+              (_minute * 60UL) + _second;
+
+    return true;
+}
+
+/**
+ * @brief   Helper method for calculating the number of days since 1.1.1970 for the selected date.
+ *
+ * @param   int _year
+ *          Year (1970 or later).
+ * @param   int _month
+ *          Month (1 - 12).
+ * @param   int _day
+ *          Day of the month (1 - 31).
+ * @return  uint32_t
+ *          Number of days since 1.1.1970.
+ */
+uint32_t WiFiTime::daysFromCivil(int _year, int _month, int _day)
+{
+    // Count the year from March, so the leap day is at the end of the year.
+    if (_month <= 2)
+        _year--;
+
+    // Number of days in 400 years is always the same (146097).
+    int _era = _year / 400;
+    int _yearOfEra = _year - (_era * 400);
+    int _dayOfYear = ((153 * (_month + ((_month > 2) ? -3 : 9)) + 2) / 5) + _day - 1;
+    int _dayOfEra = (_yearOfEra * 365) + (_yearOfEra / 4) - (_yearOfEra / 100) + _dayOfYear;
+
+    // 719468 is the number of days from 1.3.0000 to 1.1.1970.
+    return (_era * 146097) + _dayOfEra - 719468;
+}
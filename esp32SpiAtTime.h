@@ -0,0 +1,81 @@
+// Add headerguard do prevent multiple include.
+#ifndef __ESP32_SPI_AT_TIME_H__
+#define __ESP32_SPI_AT_TIME_H__
+
+// Include main Arduino header file.
+#include <Arduino.h>
+
+// Include main ESP32-C3 AT SPI library.
+#include "esp32SpiAt.h"
+
+// How often the time is synced with the modem by update() (in milliseconds, 6 hours by default).
+#ifndef INKPLATE_ESP32_SNTP_RESYNC_INTERVAL
+#define INKPLATE_ESP32_SNTP_RESYNC_INTERVAL 21600000UL
+#endif
+
+// Min. time between two drift samples (in milliseconds, 6 hours by default). SNTP time from the modem has
+// the resolution of one second, so each sample has an error up to +/-1 s (+/-46 ppm over 6 hours).
+#ifndef INKPLATE_ESP32_SNTP_MIN_DRIFT_INTERVAL
+#define INKPLATE_ESP32_SNTP_MIN_DRIFT_INTERVAL 21600000UL
+#endif
+
+// Drift samples are weighted by their interval. Older samples count half once this much time is measured
+// (in milliseconds, 7 days by default), so the drift follows the slow changes (temperature, aging).
+#ifndef INKPLATE_ESP32_SNTP_DRIFT_WINDOW
+#define INKPLATE_ESP32_SNTP_DRIFT_WINDOW 604800000ULL
+#endif
+
+// Time difference found at the sync is removed slowly - 1 ms every this many milliseconds, so the time never
+// steps back. Larger differences (in milliseconds) are stepped forward at once (backward, time stands still).
+#ifndef INKPLATE_ESP32_SNTP_SLEW_RATE
+#define INKPLATE_ESP32_SNTP_SLEW_RATE 10
+#endif
+#ifndef INKPLATE_ESP32_SNTP_MAX_SLEW
+#define INKPLATE_ESP32_SNTP_MAX_SLEW 60000LL
+#endif
+
+// Max. drift of the local clock that is accepted (in ppm).
+#define INKPLATE_ESP32_SNTP_MAX_DRIFT 500L
+
+// Class for the wall clock time. Time is read from the modem (SNTP) only once in a while, between syncs
+// it's calculated from millis() with the drift correction, so reading the time never needs the AT command.
+class WiFiTime
+{
+  public:
+    WiFiTime(WiFiClass &_wifiModem = WiFi);
+    bool begin(const char *_server1 = "pool.ntp.org", const char *_server2 = NULL);
+    bool sync(unsigned long _timeout = 10000UL);
+    bool update();
+    bool valid();
+    uint32_t epoch();
+    uint64_t epochMillis();
+    int32_t drift();
+    void setResyncInterval(unsigned long _interval);
+
+  private:
+    // Modem used by this object.
+    WiFiClass *_modem;
+
+    bool querySntpTime(uint32_t *_epoch);
+    uint32_t daysFromCivil(int _year, int _month, int _day);
+
+    // Time (UTC, in milliseconds since epoch) at the moment of the last sync and millis() at that moment,
+    // difference to the local time at the sync that is still slewed in and the last returned time.
+    uint64_t _syncEpochMs = 0;
+    unsigned long _syncMillis = 0;
+    int64_t _slewOffset = 0;
+    uint64_t _lastEpochMs = 0;
+    bool _valid = false;
+
+    // Measured drift of the local clock in ppm (positive - local clock is fast). It's calculated from the sums
+    // of the measured intervals (local and reference) since the start of the current drift sample.
+    int32_t _driftPpm = 0;
+    uint64_t _driftRefSum = 0;
+    int64_t _driftLocalSum = 0;
+    uint64_t _driftEpochMs = 0;
+    unsigned long _driftMillis = 0;
+
+    unsigned long _resyncInterval = INKPLATE_ESP32_SNTP_RESYNC_INTERVAL;
+};
+
+#endif
@@ -0,0 +1,371 @@
+// Include main header file.
+#include "esp32SpiAt.h"
+
+// Every datagram must fit into the empty batch (it's copied there without any other check).
+static_assert(INKPLATE_ESP32_UDP_MAX_PACKET_SIZE <= INKPLATE_ESP32_UDP_BATCH_SIZE,
+              "INKPLATE_ESP32_UDP_MAX_PACKET_SIZE must not be larger than INKPLATE_ESP32_UDP_BATCH_SIZE");
+
+/**
+ * @brief Construct a new WiFiUDP object - for UDP datagrams.
+ *
+ * @param   WiFiClass &_wifiModem
+ *          Modem used by this object (default is WiFi, use other WiFiClass object for additional modems).
+ */
+WiFiUDP::WiFiUDP(WiFiClass &_wifiModem)
+{
+    // Bind it to the modem.
+    _modem = &_wifiModem;
+
+    // Clear the remote hosts.
+    _remoteHost[0] = '\0';
+    _batchHost[0] = '\0';
+}
+
+/**
+ * @brief   Set the local port for UDP. Since modem needs the remote host for the UDP link, link is
+ *          opened with the first beginPacket(), unless the remote host is also set here.
+ *
+ * @param   uint16_t _localUdpPort
+ *          Local UDP port (0 - let the modem choose one).
+ * @param   const char *_host
+ *          Remote host name or IP Address (optional). If used, link is opened right away, so the
+ *          datagrams can be received before anything is sent.
+ * @param   uint16_t _port
+ *          Remote port (used only with the remote host).
+ * @return  bool
+ *          true - UDP is ready.
+ *          false - Failed to open the UDP link.
+ */
+bool WiFiUDP::begin(uint16_t _localUdpPort, const char *_host, uint16_t _port)
+{
+    // Close the previous link (if any).
+    stop();
+
+    // Save the local port.
+    _localPort = _localUdpPort;
+
+    // Open the link now if the remote host is known. Remote host can change with every received datagram.
+    if (_host != NULL)
+    {
+        _linkId = _modem->linkOpen("UDP", _host, _port, _localPort, 2);
+        return (_linkId >= 0);
+    }
+
+    return true;
+}
+
+/**
+ * @brief   Start a new outgoing datagram.
+ *
+ * @param   const char *_host
+ *          Remote host name or IP Address.
+ * @param   uint16_t _port
+ *          Remote port.
+ * @return  bool
+ *          true - Datagram started.
+ *          false - Host name is too long.
+ */
+bool WiFiUDP::beginPacket(const char *_host, uint16_t _port)
+{
+    // Check for user mistake (null-pointer or too long host name!).
+    if ((_host == NULL) || (strlen(_host) >= sizeof(_remoteHost)))
+        return false;
+
+    // Save the remote host and start with the empty datagram.
+    strcpy(_remoteHost, _host);
+    _remotePort = _port;
+    _txLen = 0;
+
+    return true;
+}
+
+/**
+ * @brief   Add the data into the current datagram.
+ *
+ * @param   const char *_data
+ *          Pointer to the data.
+ * @param   uint16_t _len
+ *          Length of the data (in bytes).
+ * @return  int
+ *          Number of bytes added (datagram is limited to INKPLATE_ESP32_UDP_MAX_PACKET_SIZE).
+ */
+int WiFiUDP::write(const char *_data, uint16_t _len)
+{
+    // Add only what fits into the datagram.
+    if (_len > (INKPLATE_ESP32_UDP_MAX_PACKET_SIZE - _txLen))
+        _len = INKPLATE_ESP32_UDP_MAX_PACKET_SIZE - _txLen;
+
+    memcpy(_txPacket + _txLen, _data, _len);
+    _txLen += _len;
+
+    return _len;
+}
+
+/**
+ * @brief   Add one byte into the current datagram.
+ *
+ * @param   uint8_t _c
+ *          Byte to add.
+ * @return  int
+ *          1 - Byte added, 0 - Datagram is full.
+ */
+int WiFiUDP::write(uint8_t _c)
+{
+    return write((const char *)&_c, 1);
+}
+
+/**
+ * @brief   Finish the current datagram and send it. If batching is enabled, datagram is added into
+ *          the batch instead. Batch is sent when it's full, when the remote host changes or when the
+ *          oldest datagram in the batch waits longer than the max. batch delay.
+ *
+ * @return  bool
+ *          true - Datagram is sent (or added to the batch).
+ *          false - Send failed.
+ */
+bool WiFiUDP::endPacket()
+{
+    // Nothing to send?
+    if (_txLen == 0)
+        return true;
+
+    // Without batching, just send it.
+    if (!_batching)
+        return sendDatagram(_txPacket, _txLen, _remoteHost, _remotePort);
+
+    // Return value variable.
+    bool _retValue = true;
+
+    // Send the current batch first if the datagram goes to the other host or if there is no space for it.
+    if (_batchLen && ((strcmp(_batchHost, _remoteHost) != 0) || (_batchPort != _remotePort) ||
+                      ((_batchLen + 1 + _txLen) > INKPLATE_ESP32_UDP_BATCH_SIZE)))
+        _retValue &= sendBatch();
+
+    // Add the datagram into the batch. Separate it from the previous one.
+    if (_batchLen == 0)
+    {
+        strcpy(_batchHost, _remoteHost);
+        _batchPort = _remotePort;
+        _batchStart = millis();
+    }
+    else
+    {
+        _batchBuffer[_batchLen++] = _batchSeparator;
+    }
+    memcpy(_batchBuffer + _batchLen, _txPacket, _txLen);
+    _batchLen += _txLen;
+    _txLen = 0;
+
+    // Send the batch if it's waiting too long.
+    if ((unsigned long)(millis() - _batchStart) >= _batchMaxDelay)
+        _retValue &= sendBatch();
+
+    return _retValue;
+}
+
+/**
+ * @brief   Check for the next received datagram. Unread data of the previous datagram is discarded.
+ *          It also sends the batch if it's waiting too long.
+ *
+ * @return  int
+ *          Size of the received datagram in bytes, 0 if there is none.
+ */
+int WiFiUDP::parsePacket()
+{
+    // Send the old batch.
+    if (_batchLen && ((unsigned long)(millis() - _batchStart) >= _batchMaxDelay))
+        sendBatch();
+
+    // Link not opened yet? Nothing can be received.
+    if (_linkId < 0)
+        return 0;
+
+    // Discard the rest of the previous datagram.
+    if (_rxRemaining)
+        _modem->linkRead(_linkId, NULL, _rxRemaining);
+
+    // Check for the new data.
+    _modem->poll();
+
+    // Get the next datagram from the queue.
+    _rxRemaining = _modem->linkNextPacket(_linkId);
+
+    return _rxRemaining;
+}
+
+/**
+ * @brief   Get the number of unread bytes of the current datagram.
+ *
+ * @return  int
+ *          Number of bytes available for read.
+ */
+int WiFiUDP::available()
+{
+    return _rxRemaining;
+}
+
+/**
+ * @brief   Copy the data of the current datagram into the user-defined buffer.
+ *
+ * @param   char *_buffer
+ *          Pointer to the user-defined buffer.
+ * @param   uint16_t _len
+ *          Max. number of bytes that will be copied.
+ * @return  int
+ *          Actual number of bytes copied.
+ */
+int WiFiUDP::read(char *_buffer, uint16_t _len)
+{
+    // Don't read past the end of the datagram.
+    if (_len > _rxRemaining)
+        _len = _rxRemaining;
+
+    int _n = _modem->linkRead(_linkId, _buffer, _len);
+    if (_n <= 0)
+        return 0;
+
+    _rxRemaining -= _n;
+    return _n;
+}
+
+/**
+ * @brief   Read one byte of the current datagram.
+ *
+ * @return  int
+ *          One byte of the datagram or -1 if there is no more data.
+ */
+int WiFiUDP::read()
+{
+    char _c;
+
+    if (read(&_c, 1) != 1)
+        return -1;
+
+    return (uint8_t)_c;
+}
+
+/**
+ * @brief   Enable or disable coalescing of the small datagrams. With batching, multiple datagrams for
+ *          the same remote host are joined with the separator into one datagram, so one SPI transfer
+ *          (and one AT+CIPSEND) carries more data. Receiver must split them by the separator (for
+ *          example, line based telemetry protocols accept multiple lines in one datagram).
+ *
+ * @param   bool _en
+ *          true - Enable batching.
+ *          false - Disable batching (pending batch is sent).
+ * @param   unsigned long _maxDelay
+ *          Max. time in milliseconds the datagram can wait in the batch.
+ * @param   char _separator
+ *          Char used between datagrams in the batch.
+ */
+void WiFiUDP::setBatching(bool _en, unsigned long _maxDelay, char _separator)
+{
+    // Send what is already in the batch.
+    if (!_en)
+        sendBatch();
+
+    _batching = _en;
+    _batchMaxDelay = _maxDelay;
+    _batchSeparator = _separator;
+}
+
+/**
+ * @brief   Send the pending batch right away.
+ *
+ * @return  bool
+ *          true - Batch is sent (or there was nothing to send).
+ *          false - Send failed.
+ */
+bool WiFiUDP::flush()
+{
+    return sendBatch();
+}
+
+/**
+ * @brief   Send the pending batch, close the UDP link and release its link ID.
+ *
+ */
+void WiFiUDP::stop()
+{
+    // Send what is left in the batch.
+    sendBatch();
+
+    // Nothing else to do if the link is not opened.
+    if (_linkId < 0)
+        return;
+
+    _modem->linkClose(_linkId);
+    _linkId = -1;
+    _rxRemaining = 0;
+}
+
+/**
+ * @brief   Get the number of received bytes dropped because the datagram queue was full.
+ *
+ * @return  uint32_t
+ *          Number of dropped bytes (whole datagrams are dropped).
+ */
+uint32_t WiFiUDP::dropped()
+{
+    return _modem->linkDropped(_linkId);
+}
+
+/**
+ * @brief   Helper method for sending one datagram. Link is opened first if needed.
+ *
+ * @param   const char *_data
+ *          Pointer to the data.
+ * @param   uint16_t _len
+ *          Length of the data (in bytes).
+ * @param   const char *_host
+ *          Remote host name or IP Address.
+ * @param   uint16_t _port
+ *          Remote port.
+ * @return  bool
+ *          true - Datagram is sent.
+ *          false - Send failed.
+ */
+bool WiFiUDP::sendDatagram(const char *_data, uint16_t _len, const char *_host, uint16_t _port)
+{
+    // Open the link with this host as the default one. Remote host can change with every received datagram.
+    if (_linkId < 0)
+    {
+        _linkId = _modem->linkOpen("UDP", _host, _port, _localPort, 2);
+        if (_linkId < 0)
+            return false;
+    }
+
+    // Use the IP Address from the DNS cache if possible.
+    char _ipAddress[16];
+    IPAddress _ip = _modem->resolve(_host);
+    if (_ip != INADDR_NONE)
+    {
+        AtCommandBuilder _ipString(_ipAddress, sizeof(_ipAddress));
+        _ipString.addIp(_ip);
+        _host = _ipAddress;
+    }
+
+    // Send it to the selected remote host.
+    return _modem->linkSendTo(_linkId, _data, _len, _host, _port);
+}
+
+/**
+ * @brief   Helper method for sending the batch of datagrams.
+ *
+ * @return  bool
+ *          true - Batch is sent (or there was nothing to send).
+ *          false - Send failed (batch is discarded).
+ */
+bool WiFiUDP::sendBatch()
+{
+    // Nothing to send?
+    if (_batchLen == 0)
+        return true;
+
+    bool _retValue = sendDatagram(_batchBuffer, _batchLen, _batchHost, _batchPort);
+
+    // Start a new batch.
+    _batchLen = 0;
+
+    return _retValue;
+}
@@ -0,0 +1,68 @@
+// Add headerguard do prevent multiple include.
+#ifndef __ESP32_SPI_AT_UDP_H__
+#define __ESP32_SPI_AT_UDP_H__
+
+// Include main Arduino header file.
+#include <Arduino.h>
+
+// Include main ESP32-C3 AT SPI library.
+#include "esp32SpiAt.h"
+
+// Max. size of one outgoing datagram (in bytes).
+#ifndef INKPLATE_ESP32_UDP_MAX_PACKET_SIZE
+#define INKPLATE_ESP32_UDP_MAX_PACKET_SIZE 512
+#endif
+
+// Max. size of the batch of the coalesced datagrams (in bytes). Must not be smaller than the max. packet size.
+#ifndef INKPLATE_ESP32_UDP_BATCH_SIZE
+#define INKPLATE_ESP32_UDP_BATCH_SIZE 1024
+#endif
+
+// Class for UDP over SPI AT commands. It uses one link ID of the multiple connections.
+class WiFiUDP
+{
+  public:
+    WiFiUDP(WiFiClass &_wifiModem = WiFi);
+    bool begin(uint16_t _localUdpPort, const char *_host = NULL, uint16_t _port = 0);
+    bool beginPacket(const char *_host, uint16_t _port);
+    int write(const char *_data, uint16_t _len);
+    int write(uint8_t _c);
+    bool endPacket();
+    int parsePacket();
+    int available();
+    int read(char *_buffer, uint16_t _len);
+    int read();
+    void setBatching(bool _en, unsigned long _maxDelay = 1000UL, char _separator = '\n');
+    bool flush();
+    void stop();
+    uint32_t dropped();
+
+  private:
+    // Modem used by this object.
+    WiFiClass *_modem;
+
+    bool sendDatagram(const char *_data, uint16_t _len, const char *_host, uint16_t _port);
+    bool sendBatch();
+
+    int _linkId = -1;
+    uint16_t _localPort = 0;
+    uint16_t _rxRemaining = 0;
+
+    // Datagram that is currently being written.
+    char _txPacket[INKPLATE_ESP32_UDP_MAX_PACKET_SIZE];
+    uint16_t _txLen = 0;
+    char _remoteHost[INKPLATE_ESP32_DNS_CACHE_HOST_LEN];
+    uint16_t _remotePort = 0;
+
+    // Batch of the datagrams waiting to be sent in one AT+CIPSEND.
+    bool _batching = false;
+    char _batchSeparator = '\n';
+    unsigned long _batchMaxDelay = 1000UL;
+    unsigned long _batchStart = 0;
+    char _batchBuffer[INKPLATE_ESP32_UDP_BATCH_SIZE];
+    uint16_t _batchLen = 0;
+    char _batchHost[INKPLATE_ESP32_DNS_CACHE_HOST_LEN];
+    uint16_t _batchPort = 0;
+};
+
+#endif
@@ -0,0 +1,718 @@
+// Include main header file.
+#include "esp32SpiAt.h"
+
+// Added to the key of the client for the accept key of the server (RFC 6455).
+static const char wsGuid[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+// Hardware RNG of the STM32 for the masking key and the key of the handshake (they must not be predictable,
+// random() is never seeded).
+static RNG_HandleTypeDef wsRng;
+static bool wsRngReady = false;
+
+// Helper function for getting the random bytes from the hardware RNG. Returns false if the RNG does not work.
+static bool wsRandom(uint8_t *_data, uint8_t _len)
+{
+    // Start the RNG on the first use. It runs from HSI48 (default after the reset), turn it on if it's not on yet.
+    if (!wsRngReady)
+    {
+        __HAL_RCC_HSI48_ENABLE();
+        unsigned long _timer = millis();
+        while (!__HAL_RCC_GET_FLAG(RCC_FLAG_HSI48RDY))
+        {
+            if ((unsigned long)(millis() - _timer) > 10)
+                return false;
+        }
+
+        __HAL_RCC_RNG_CLK_ENABLE();
+        wsRng.Instance = RNG;
+        if (HAL_RNG_Init(&wsRng) != HAL_OK)
+            return false;
+        wsRngReady = true;
+    }
+
+    // Each number gives 4 bytes.
+    for (uint8_t i = 0; i < _len; i += 4)
+    {
+        uint32_t _value;
+        if (HAL_RNG_GenerateRandomNumber(&wsRng, &_value) != HAL_OK)
+            return false;
+
+        for (uint8_t j = 0; (j < 4) && ((i + j) < _len); j++)
+            _data[i + j] = (uint8_t)(_value >> (j * 8));
+    }
+
+    return true;
+}
+
+// Rotate left.
+static inline uint32_t wsRol(uint32_t _x, uint8_t _n)
+{
+    return (_x << _n) | (_x >> (32 - _n));
+}
+
+// Helper function for the SHA-1 of the short message (max. 119 bytes, used only for the accept key).
+static void wsSha1(const uint8_t *_data, uint8_t _len, uint8_t *_digest)
+{
+    uint32_t _h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+    uint8_t _blocks[128];
+
+    // Message, the end bit and the length in bits (one or two blocks).
+    uint8_t _blockCount = (_len < 56) ? 1 : 2;
+    memset(_blocks, 0, sizeof(_blocks));
+    memcpy(_blocks, _data, _len);
+    _blocks[_len] = 0x80;
+    _blocks[(_blockCount * 64) - 2] = (uint8_t)((_len * 8) >> 8);
+    _blocks[(_blockCount * 64) - 1] = (uint8_t)(_len * 8);
+
+    for (uint8_t b = 0; b < _blockCount; b++)
+    {
+        uint32_t _w[80];
+        for (int i = 0; i < 16; i++)
+        {
+            const uint8_t *_p = &_blocks[(b * 64) + (i * 4)];
+            _w[i] = ((uint32_t)_p[0] << 24) | ((uint32_t)_p[1] << 16) | ((uint32_t)_p[2] << 8) | _p[3];
+        }
+        for (int i = 16; i < 80; i++)
+            _w[i] = wsRol(_w[i - 3] ^ _w[i - 8] ^ _w[i - 14] ^ _w[i - 16], 1);
+
+        uint32_t _a = _h[0], _b = _h[1], _c = _h[2], _d = _h[3], _e = _h[4];
+        for (int i = 0; i < 80; i++)
+        {
+            uint32_t _f, _k;
+            if (i < 20)
+            {
+                _f = (_b & _c) | (~_b & _d);
+                _k = 0x5A827999;
+            }
+            else if (i < 40)
+            {
+                _f = _b ^ _c ^ _d;
+                _k = 0x6ED9EBA1;
+            }
+            else if (i < 60)
+            {
+                _f = (_b & _c) | (_b & _d) | (_c & _d);
+                _k = 0x8F1BBCDC;
+            }
+            else
+            {
+                _f = _b ^ _c ^ _d;
+                _k = 0xCA62C1D6;
+            }
+
+            uint32_t _t = wsRol(_a, 5) + _f + _e + _k + _w[i];
+            _e = _d;
+            _d = _c;
+            _c = wsRol(_b, 30);
+            _b = _a;
+            _a = _t;
+        }
+
+        _h[0] += _a;
+        _h[1] += _b;
+        _h[2] += _c;
+        _h[3] += _d;
+        _h[4] += _e;
+    }
+
+    for (int i = 0; i < 5; i++)
+    {
+        _digest[(i * 4) + 0] = (uint8_t)(_h[i] >> 24);
+        _digest[(i * 4) + 1] = (uint8_t)(_h[i] >> 16);
+        _digest[(i * 4) + 2] = (uint8_t)(_h[i] >> 8);
+        _digest[(i * 4) + 3] = (uint8_t)_h[i];
+    }
+}
+
+// Helper function for the Base64 encoding (output is null-terminated, ((_len + 2) / 3) * 4 chars long).
+static void wsBase64(const uint8_t *_data, uint8_t _len, char *_out)
+{
+    static const char _table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    for (uint8_t i = 0; i < _len; i += 3)
+    {
+        uint32_t _n = (uint32_t)_data[i] << 16;
+        if ((i + 1) < _len)
+            _n |= (uint32_t)_data[i + 1] << 8;
+        if ((i + 2) < _len)
+            _n |= _data[i + 2];
+
+        *(_out++) = _table[(_n >> 18) & 0x3F];
+        *(_out++) = _table[(_n >> 12) & 0x3F];
+        *(_out++) = ((i + 1) < _len) ? _table[(_n >> 6) & 0x3F] : '=';
+        *(_out++) = ((i + 2) < _len) ? _table[_n & 0x3F] : '=';
+    }
+
+    *_out = '\0';
+}
+
+/**
+ * @brief Construct a new WiFiWebSocket object - for the WebSocket client.
+ *
+ * @param   WiFiClass &_wifiModem
+ *          Modem used by this object (default is WiFi, use other WiFiClass object for additional modems).
+ */
+WiFiWebSocket::WiFiWebSocket(WiFiClass &_wifiModem)
+{
+    // Bind it to the modem.
+    _modem = &_wifiModem;
+}
+
+/**
+ * @brief   Open the connection to the WebSocket server (TCP or SSL connection and the HTTP upgrade). WiFi must be
+ *          connected first.
+ *
+ * @param   const char *_host
+ *          Host name or IP Address of the server.
+ * @param   uint16_t _port
+ *          Port of the server (usually 80 for "ws://" or 443 for "wss://").
+ * @param   const char *_path
+ *          Path of the WebSocket endpoint (for example "/updates").
+ * @param   bool _ssl
+ *          true - Use SSL connection ("wss://", see setTls()).
+ *          false - Use plain TCP connection ("ws://").
+ * @param   const char *_protocol
+ *          Subprotocol requested from the server (NULL - none).
+ * @return  bool
+ *          true - Connected, messages arrive from loop().
+ *          false - Connection or the handshake failed.
+ */
+bool WiFiWebSocket::connect(const char *_host, uint16_t _port, const char *_path, bool _ssl, const char *_protocol)
+{
+    // Check for user mistake (null-pointer!).
+    if ((_host == NULL) || (_path == NULL))
+        return false;
+
+    // Close previous connection first (if any).
+    stop();
+
+    // Open the connection.
+    _linkId = _modem->linkOpen(_ssl ? "SSL" : "TCP", _host, _port, 0, 0, _tlsSet ? &_tls : NULL);
+    if (_linkId < 0)
+        return false;
+
+    // Upgrade it to the WebSocket.
+    if (!handshake(_host, _port, _path, _protocol))
+    {
+        stop();
+        return false;
+    }
+
+    // Reset the frame parser.
+    _headerLen = 0;
+    _headerNeeded = 2;
+    _payloadRemaining = 0;
+    _messageLen = 0;
+    _messageOpcode = 0;
+    _controlLen = 0;
+
+    _connected = true;
+    _lastRx = millis();
+    _pingSent = false;
+
+    return true;
+}
+
+/**
+ * @brief   Check if the connection is still open. It also processes received messages.
+ *
+ * @return  bool
+ *          true - Connected.
+ *          false - Not connected (closed by either side or the ping has not been answered).
+ */
+bool WiFiWebSocket::connected()
+{
+    // Check for the new messages and events first.
+    loop();
+
+    return _connected;
+}
+
+/**
+ * @brief   Send the text message.
+ *
+ * @param   const char *_text
+ *          Text (UTF-8, null-terminated).
+ * @return  bool
+ *          true - Message sent.
+ *          false - Not connected or sending failed.
+ */
+bool WiFiWebSocket::sendText(const char *_text)
+{
+    // Check for user mistake (null-pointer!).
+    if (_text == NULL)
+        return false;
+
+    return send(INKPLATE_ESP32_WS_TEXT, (const uint8_t *)_text, strlen(_text));
+}
+
+/**
+ * @brief   Send the binary message.
+ *
+ * @param   const uint8_t *_data
+ *          Data.
+ * @param   uint16_t _len
+ *          Length of the data (in bytes).
+ * @return  bool
+ *          true - Message sent.
+ *          false - Not connected or sending failed.
+ */
+bool WiFiWebSocket::sendBinary(const uint8_t *_data, uint16_t _len)
+{
+    return send(INKPLATE_ESP32_WS_BINARY, _data, _len);
+}
+
+/**
+ * @brief   Send one frame (not fragmented). Payload is masked on the fly, data of the user is not changed.
+ *
+ * @param   uint8_t _opcode
+ *          Opcode of the frame (INKPLATE_ESP32_WS_TEXT, INKPLATE_ESP32_WS_BINARY, INKPLATE_ESP32_WS_PING...).
+ * @param   const uint8_t *_data
+ *          Payload.
+ * @param   uint16_t _len
+ *          Length of the payload (in bytes).
+ * @return  bool
+ *          true - Frame sent.
+ *          false - Not connected or sending failed. Connection is closed if only part of the frame has been queued
+ *          (the rest of the stream would not make sense to the server).
+ */
+bool WiFiWebSocket::send(uint8_t _opcode, const uint8_t *_data, uint16_t _len)
+{
+    // Check for user mistake (null-pointer!).
+    if (!_connected || ((_data == NULL) && (_len != 0)))
+        return false;
+
+    // Header with the length and the masking key (frames of the client must be masked).
+    uint8_t _frame[8];
+    uint8_t _frameLen = 0;
+    _frame[_frameLen++] = 0x80 | (_opcode & 0x0F);
+    if (_len < 126)
+    {
+        _frame[_frameLen++] = 0x80 | _len;
+    }
+    else
+    {
+        _frame[_frameLen++] = 0x80 | 126;
+        _frame[_frameLen++] = (uint8_t)(_len >> 8);
+        _frame[_frameLen++] = (uint8_t)_len;
+    }
+    uint8_t *_mask = &_frame[_frameLen];
+    if (!wsRandom(_mask, 4))
+        return false;
+    _frameLen += 4;
+
+    // Nothing queued yet, connection can still be used if it fails here.
+    int _written = _modem->linkWrite(_linkId, (const char *)_frame, _frameLen);
+    if (_written <= 0)
+        return false;
+    if (_written != _frameLen)
+    {
+        stop();
+        return false;
+    }
+
+    // Mask the payload in pieces.
+    char _chunk[64];
+    uint16_t _pos = 0;
+    while (_pos < _len)
+    {
+        int _n = 0;
+        while ((_n < (int)sizeof(_chunk)) && (_pos < _len))
+        {
+            _chunk[_n++] = _data[_pos] ^ _mask[_pos & 3];
+            _pos++;
+        }
+
+        // Part of the frame is already queued, the stream is broken if the rest does not fit.
+        if (_modem->linkWrite(_linkId, _chunk, _n) != _n)
+        {
+            stop();
+            return false;
+        }
+    }
+
+    // Send it now.
+    return _modem->linkFlush(_linkId, INKPLATE_ESP32_WS_TIMEOUT);
+}
+
+/**
+ * @brief   Set the callback for the received messages.
+ *
+ * @param   wsMessageCallback _callback
+ *          Callback function (NULL - messages are dropped).
+ */
+void WiFiWebSocket::onMessage(wsMessageCallback _callback)
+{
+    _messageCallback = _callback;
+}
+
+/**
+ * @brief   Set the TLS settings used by the next SSL connect() (certificate check, server name).
+ *
+ * @param   const struct spiAtTlsConfigTypedef *_config
+ *          TLS settings (copied, but the SNI string must stay valid). NULL - no certificate check, host name
+ *          is the server name.
+ */
+void WiFiWebSocket::setTls(const struct spiAtTlsConfigTypedef *_config)
+{
+    _tlsSet = (_config != NULL);
+    if (_tlsSet)
+        _tls = *_config;
+}
+
+/**
+ * @brief   Process the received frames (messages go to the callback, pings are answered) and keep the
+ *          connection alive. Call it often (from the loop()).
+ *
+ */
+void WiFiWebSocket::loop()
+{
+    // Nothing to do if not connected.
+    if (!_connected)
+        return;
+
+    // Get the new data.
+    _modem->poll();
+
+    // Parse what has arrived so far.
+    uint8_t _data[64];
+    int _n;
+    while (_connected && ((_n = _modem->linkRead(_linkId, (char *)_data, sizeof(_data))) > 0))
+    {
+        _lastRx = millis();
+        _pingSent = false;
+
+        for (int i = 0; (i < _n) && _connected; i++)
+            parse(_data[i]);
+    }
+
+    // Closed while parsing or by the remote host without the close frame?
+    if (!_connected || !_modem->linkConnected(_linkId))
+    {
+        stop();
+        return;
+    }
+
+    // Ping the server if it has been quiet for too long, drop the connection if there is no answer.
+    if (INKPLATE_ESP32_WS_PING_INTERVAL != 0)
+    {
+        if (!_pingSent && ((unsigned long)(millis() - _lastRx) > INKPLATE_ESP32_WS_PING_INTERVAL))
+        {
+            _pingSent = true;
+            _pingTime = millis();
+            send(INKPLATE_ESP32_WS_PING, NULL, 0);
+        }
+        else if (_pingSent && ((unsigned long)(millis() - _pingTime) > INKPLATE_ESP32_WS_TIMEOUT))
+        {
+            stop();
+        }
+    }
+}
+
+/**
+ * @brief   Close the connection (close frame with the status code, then the link is closed).
+ *
+ * @param   uint16_t _code
+ *          Status code (1000 - normal closure).
+ */
+void WiFiWebSocket::close(uint16_t _code)
+{
+    if (_connected)
+    {
+        uint8_t _payload[2] = {(uint8_t)(_code >> 8), (uint8_t)_code};
+        send(INKPLATE_ESP32_WS_CLOSE, _payload, sizeof(_payload));
+    }
+
+    stop();
+}
+
+/**
+ * @brief   Get the number of received messages.
+ *
+ * @return  uint32_t
+ *          Number of messages.
+ */
+uint32_t WiFiWebSocket::messages()
+{
+    return _messages;
+}
+
+/**
+ * @brief   Helper method for the HTTP upgrade of the open connection.
+ *
+ * @param   const char *_host
+ *          Host name or IP Address of the server.
+ * @param   uint16_t _port
+ *          Port of the server.
+ * @param   const char *_path
+ *          Path of the WebSocket endpoint.
+ * @param   const char *_protocol
+ *          Subprotocol (NULL - none).
+ * @return  bool
+ *          true - Server accepted the upgrade.
+ *          false - Upgrade failed.
+ */
+bool WiFiWebSocket::handshake(const char *_host, uint16_t _port, const char *_path, const char *_protocol)
+{
+    // Random key of the client.
+    uint8_t _nonce[16];
+    if (!wsRandom(_nonce, sizeof(_nonce)))
+        return false;
+    char _key[25];
+    wsBase64(_nonce, sizeof(_nonce), _key);
+
+    // Build the upgrade request (message buffer is not used yet).
+    AtCommandBuilder _request((char *)_message, sizeof(_message));
+    _request.add("GET ").addRaw(_path, strlen(_path)).add(" HTTP/1.1\r\nHost: ").addRaw(_host, strlen(_host));
+    if ((_port != 80) && (_port != 443))
+        _request.addChar(':').addUInt(_port);
+    _request.add("\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Key: ").addRaw(_key, 24);
+    _request.add("\r\nSec-WebSocket-Version: 13\r\n");
+    if (_protocol != NULL)
+        _request.add("Sec-WebSocket-Protocol: ").addRaw(_protocol, strlen(_protocol)).add("\r\n");
+    _request.add("\r\n");
+    if (_request.overflow())
+        return false;
+
+    // Send it.
+    if ((_modem->linkWrite(_linkId, _request.c_str(), _request.length()) != _request.length()) ||
+        !_modem->linkFlush(_linkId, INKPLATE_ESP32_WS_TIMEOUT))
+        return false;
+
+    // Accept key expected from the server - Base64 of the SHA-1 of the key and the GUID.
+    uint8_t _hashInput[24 + sizeof(wsGuid) - 1];
+    memcpy(_hashInput, _key, 24);
+    memcpy(_hashInput + 24, wsGuid, sizeof(wsGuid) - 1);
+    uint8_t _digest[20];
+    wsSha1(_hashInput, sizeof(_hashInput), _digest);
+    char _accept[29];
+    wsBase64(_digest, sizeof(_digest), _accept);
+
+    // Status line must be "101 Switching Protocols".
+    char *_line = (char *)_message;
+    if (!readLine(_line, sizeof(_message), INKPLATE_ESP32_WS_TIMEOUT) || (strncmp(_line, "HTTP/1.1 101", 12) != 0))
+        return false;
+
+    // Check the accept key in the headers (until the empty line).
+    bool _accepted = false;
+    while (readLine(_line, sizeof(_message), INKPLATE_ESP32_WS_TIMEOUT))
+    {
+        if (_line[0] == '\0')
+            return _accepted;
+
+        if (strncasecmp(_line, "Sec-WebSocket-Accept:", 21) == 0)
+        {
+            char *_value = _line + 21;
+            while (*_value == ' ')
+                _value++;
+            _accepted = (strcmp(_value, _accept) == 0);
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief   Helper method for reading one line of the HTTP response (without "\r\n"). Only the line is read, data
+ *          after the headers stays in the queue of the link.
+ *
+ * @param   char *_line
+ *          Buffer for the line (longer lines are cut).
+ * @param   uint16_t _size
+ *          Size of the buffer (in bytes).
+ * @param   unsigned long _timeout
+ *          Timeout value in milliseconds.
+ * @return  bool
+ *          true - Line has been read.
+ *          false - Timeout occured or the connection has been closed.
+ */
+bool WiFiWebSocket::readLine(char *_line, uint16_t _size, unsigned long _timeout)
+{
+    uint16_t _len = 0;
+    unsigned long _timer = millis();
+
+    while ((unsigned long)(millis() - _timer) < _timeout)
+    {
+        char _c;
+        if (_modem->linkRead(_linkId, &_c, 1) != 1)
+        {
+            // Nothing more is going to arrive?
+            if (!_modem->linkConnected(_linkId))
+                return false;
+
+            _modem->poll();
+            continue;
+        }
+
+        if (_c == '\n')
+        {
+            _line[_len] = '\0';
+            return true;
+        }
+
+        if ((_c != '\r') && (_len < (_size - 1)))
+            _line[_len++] = _c;
+    }
+
+    return false;
+}
+
+/**
+ * @brief   Helper method for parsing the received frames, one byte at a time (frames can arrive in any number of
+ *          pieces).
+ *
+ * @param   uint8_t _c
+ *          Next byte from the server.
+ */
+void WiFiWebSocket::parse(uint8_t _c)
+{
+    // Payload of the current frame.
+    if (_headerLen == _headerNeeded)
+    {
+        if (_opcode & 0x08)
+        {
+            _control[_controlLen++] = _c;
+        }
+        else
+        {
+            _message[_messageLen++] = _c;
+        }
+
+        if (--_payloadRemaining == 0)
+            frame();
+        return;
+    }
+
+    // Header of the frame. Its length is known from the second byte.
+    _header[_headerLen++] = _c;
+    if (_headerLen == 2)
+    {
+        uint8_t _len7 = _header[1] & 0x7F;
+        _headerNeeded = 2 + ((_len7 == 126) ? 2 : ((_len7 == 127) ? 8 : 0)) + ((_header[1] & 0x80) ? 4 : 0);
+    }
+    if (_headerLen < _headerNeeded)
+        return;
+
+    // Frames of the server must not be masked, reserved opcodes are not allowed.
+    _fin = (_header[0] & 0x80) != 0;
+    _opcode = _header[0] & 0x0F;
+    if ((_header[1] & 0x80) || ((_opcode > INKPLATE_ESP32_WS_BINARY) && (_opcode < INKPLATE_ESP32_WS_CLOSE)) ||
+        (_opcode > INKPLATE_ESP32_WS_PONG))
+    {
+        close(1002);
+        return;
+    }
+
+    // Length of the payload (64 bit length is accepted only if it fits into 32 bits).
+    uint8_t _len7 = _header[1] & 0x7F;
+    uint32_t _payloadLen = _len7;
+    if (_len7 == 126)
+    {
+        _payloadLen = ((uint32_t)_header[2] << 8) | _header[3];
+    }
+    else if (_len7 == 127)
+    {
+        if (_header[2] | _header[3] | _header[4] | _header[5])
+        {
+            close(1009);
+            return;
+        }
+        _payloadLen = ((uint32_t)_header[6] << 24) | ((uint32_t)_header[7] << 16) | ((uint32_t)_header[8] << 8) |
+                      _header[9];
+    }
+
+    if (_opcode & 0x08)
+    {
+        // Control frames are short and not fragmented.
+        if (!_fin || (_payloadLen > 125))
+        {
+            close(1002);
+            return;
+        }
+        _controlLen = 0;
+    }
+    else
+    {
+        // Continuation only after the first frame of the message, new message only after the last one.
+        if ((_opcode == INKPLATE_ESP32_WS_CONTINUATION) == (_messageOpcode == 0))
+        {
+            close(1002);
+            return;
+        }
+        if (_opcode != INKPLATE_ESP32_WS_CONTINUATION)
+        {
+            _messageOpcode = _opcode;
+            _messageLen = 0;
+        }
+
+        // Message must fit into the buffer.
+        if (((uint32_t)_messageLen + _payloadLen) > INKPLATE_ESP32_WS_RX_BUFFER_SIZE)
+        {
+            close(1009);
+            return;
+        }
+    }
+
+    _payloadRemaining = _payloadLen;
+    if (_payloadRemaining == 0)
+        frame();
+}
+
+/**
+ * @brief   Helper method for handling the complete frame.
+ *
+ */
+void WiFiWebSocket::frame()
+{
+    // Ready for the next frame.
+    _headerLen = 0;
+    _headerNeeded = 2;
+
+    switch (_opcode)
+    {
+    case INKPLATE_ESP32_WS_PING:
+        // Answer with the same payload.
+        send(INKPLATE_ESP32_WS_PONG, _control, _controlLen);
+        break;
+
+    case INKPLATE_ESP32_WS_PONG:
+        // Nothing to do, keep alive is updated by any received data.
+        break;
+
+    case INKPLATE_ESP32_WS_CLOSE:
+        // Answer with the same status code and close the connection.
+        send(INKPLATE_ESP32_WS_CLOSE, _control, (_controlLen >= 2) ? 2 : 0);
+        stop();
+        break;
+
+    default:
+        // Message is complete with the last frame.
+        if (_fin)
+        {
+            uint8_t _type = _messageOpcode;
+            _messageOpcode = 0;
+            _message[_messageLen] = '\0';
+            _messages++;
+
+            if (_messageCallback != NULL)
+                _messageCallback(_type, _message, _messageLen);
+        }
+        break;
+    }
+}
+
+/**
+ * @brief   Helper method for closing the link (without the close frame).
+ *
+ */
+void WiFiWebSocket::stop()
+{
+    _connected = false;
+
+    // Nothing to do if the link is not used.
+    if (_linkId < 0)
+        return;
+
+    _modem->linkClose(_linkId);
+    _linkId = -1;
+}
@@ -0,0 +1,96 @@
+// Add headerguard do prevent multiple include.
+#ifndef __ESP32_SPI_AT_WEBSOCKET_H__
+#define __ESP32_SPI_AT_WEBSOCKET_H__
+
+// Include main Arduino header file.
+#include <Arduino.h>
+
+// Include main ESP32-C3 AT SPI library.
+#include "esp32SpiAt.h"
+
+// Max. length of the received message (in bytes). Longer messages are refused (connection is closed with 1009).
+#ifndef INKPLATE_ESP32_WS_RX_BUFFER_SIZE
+#define INKPLATE_ESP32_WS_RX_BUFFER_SIZE 1024
+#endif
+
+// Ping is sent if nothing has been received for this time (in milliseconds, 0 - never).
+#ifndef INKPLATE_ESP32_WS_PING_INTERVAL
+#define INKPLATE_ESP32_WS_PING_INTERVAL 30000UL
+#endif
+
+// Timeout for the handshake, the sending and the answer to the ping (in milliseconds).
+#ifndef INKPLATE_ESP32_WS_TIMEOUT
+#define INKPLATE_ESP32_WS_TIMEOUT 10000UL
+#endif
+
+// Frame opcodes (RFC 6455).
+#define INKPLATE_ESP32_WS_CONTINUATION 0x00
+#define INKPLATE_ESP32_WS_TEXT         0x01
+#define INKPLATE_ESP32_WS_BINARY       0x02
+#define INKPLATE_ESP32_WS_CLOSE        0x08
+#define INKPLATE_ESP32_WS_PING         0x09
+#define INKPLATE_ESP32_WS_PONG         0x0A
+
+// Callback for the received message (opcode is TEXT or BINARY, payload is null-terminated, valid only during the
+// call).
+typedef void (*wsMessageCallback)(uint8_t _opcode, const uint8_t *_payload, uint16_t _len);
+
+// Class for the WebSocket client (RFC 6455) on the TCP/SSL link of the modem. Connection stays open, so the server
+// can push the updates as they happen - no repeated connect/handshake/request cycles. Messages are delivered by the
+// callback from loop() (call it often), pings are answered and sent automatically.
+class WiFiWebSocket
+{
+  public:
+    WiFiWebSocket(WiFiClass &_wifiModem = WiFi);
+    bool connect(const char *_host, uint16_t _port, const char *_path, bool _ssl = false,
+                 const char *_protocol = NULL);
+    bool connected();
+    bool sendText(const char *_text);
+    bool sendBinary(const uint8_t *_data, uint16_t _len);
+    bool send(uint8_t _opcode, const uint8_t *_data, uint16_t _len);
+    void onMessage(wsMessageCallback _callback);
+    void setTls(const struct spiAtTlsConfigTypedef *_config);
+    void loop();
+    void close(uint16_t _code = 1000);
+    uint32_t messages();
+
+  private:
+    bool handshake(const char *_host, uint16_t _port, const char *_path, const char *_protocol);
+    bool readLine(char *_line, uint16_t _size, unsigned long _timeout);
+    void parse(uint8_t _c);
+    void frame();
+    void stop();
+
+    // Modem used by this object and the link ID of the connection.
+    WiFiClass *_modem;
+    int _linkId = -1;
+
+    // TLS settings for the SSL connections (used only if set).
+    struct spiAtTlsConfigTypedef _tls;
+    bool _tlsSet = false;
+
+    // Frame parser (header of the current frame and the remaining bytes of its payload).
+    uint8_t _header[14];
+    uint8_t _headerLen = 0;
+    uint8_t _headerNeeded = 2;
+    uint8_t _opcode = 0;
+    bool _fin = false;
+    uint32_t _payloadRemaining = 0;
+
+    // Received message (data frames, with the continuation frames) and the control frame.
+    uint8_t _message[INKPLATE_ESP32_WS_RX_BUFFER_SIZE + 1];
+    uint16_t _messageLen = 0;
+    uint8_t _messageOpcode = 0;
+    uint8_t _control[126];
+    uint8_t _controlLen = 0;
+
+    // Connection status, keep alive and the message callback.
+    bool _connected = false;
+    unsigned long _lastRx = 0;
+    unsigned long _pingTime = 0;
+    bool _pingSent = false;
+    wsMessageCallback _messageCallback = NULL;
+    uint32_t _messages = 0;
+};
+
+#endif
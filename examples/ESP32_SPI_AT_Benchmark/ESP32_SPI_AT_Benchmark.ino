@@ -0,0 +1,288 @@
+// Include library for AT Commands over SPI.
+#include "esp32SpiAt.h"
+
+// Include Typedefs for the AT SPI messages.
+#include "WiFiSPITypedef.h"
+
+// Throughput benchmark of the SPI AT data path. It measures the command round-trip latency, HTTP download and
+// TCP upload throughput and the time spent in the SPI transfers per byte, for each SPI clock and chunk size
+// from the lists below. Results are printed as CSV lines:
+//   bench,<test>,<spi clock [Hz]>,<chunk [bytes]>,<value>,<unit>
+// and compared with the baseline (copy the results of a known good run there). Last line is
+//   result,PASS or result,FAIL,<number of regressions>
+
+// Change WiFi SSID and password here.
+#define WIFI_SSID "Soldered-testingPurposes"
+#define WIFI_PASS "Testing443"
+
+// Host for the upload test. It must accept TCP connection and discard the data (for example run
+// "nc -lk 5000 > /dev/null" on the computer in the same network).
+#define UPLOAD_HOST "192.168.1.100"
+#define UPLOAD_PORT 5000
+
+// Number of bytes sent in the upload test.
+#define UPLOAD_SIZE 65536UL
+
+// Number of round-trips for the latency tests.
+#define LATENCY_ITERATIONS 20
+
+// Max. allowed regression from the baseline (0.10 = 10%).
+#define REGRESSION_THRESHOLD 0.10
+
+// Files for the download test.
+const char *downloadUrls[] = {
+    "https://raw.githubusercontent.com/BornaBiro/ESP32-C3-SPI-AT-Commands/main/lorem_ipsum.txt",
+    "https://raw.githubusercontent.com/BornaBiro/ESP32-C3-SPI-AT-Commands/main/lorem_ipsum_long.txt",
+};
+const char *downloadNames[] = {"http_lorem", "http_lorem_long"};
+
+// SPI clocks and chunk sizes (read buffer for the download, one AT+CIPSEND for the upload) for the sweep.
+const uint32_t spiClocks[] = {10000000UL, 20000000UL, 40000000UL};
+const uint16_t chunkSizes[] = {256, 1024, 4092};
+
+// Baseline results. Value of 0 means it's not set (result is only printed). For latencies lower is better,
+// for throughput higher is better.
+struct benchBaseline
+{
+    const char *test;
+    uint32_t spiClock;
+    uint16_t chunk;
+    float value;
+    bool higherIsBetter;
+};
+
+const benchBaseline baseline[] = {
+    {"ping", 20000000UL, 0, 0, false},
+    {"cwstate", 20000000UL, 0, 0, false},
+    {"cipsta", 20000000UL, 0, 0, false},
+    {"http_lorem_long", 20000000UL, 4092, 0, true},
+    {"upload", 20000000UL, 4092, 0, true},
+};
+
+// Buffer for the downloaded and uploaded data.
+char benchBuffer[INKPLATE_ESP32_SPI_MAX_MESAGE_DATA_BUFFER];
+
+// Number of results worse than the baseline.
+int regressions = 0;
+
+// Benchmark functions.
+void benchLatency(const char *test, uint32_t spiClock, bool (*command)());
+void benchDownload(const char *test, const char *url, uint32_t spiClock, uint16_t chunk);
+void benchUpload(uint32_t spiClock, uint16_t chunk);
+void report(const char *test, uint32_t spiClock, uint16_t chunk, float value, const char *unit);
+void reportError(const char *test, uint32_t spiClock, uint16_t chunk);
+
+void setup()
+{
+    // Setup a Serial communication for debug at 115200 bauds.
+    Serial.begin(115200);
+
+    // Print an welcome message (to know if the Inkplate board and STM32 are alive).
+    Serial.println("ESP32 SPI AT Benchmark");
+
+    // Initialize At Over SPI library.
+    if (!WiFi.init())
+    {
+        Serial.println("ESP32-C3 initializaiton Failed! Code stopped.");
+
+        // No point going on with the code if we can init the ESP32.
+        while (1)
+        {
+            delay(100);
+        }
+    }
+
+    // Connect to the WiFi network.
+    WiFi.setMode(INKPLATE_WIFI_MODE_STA);
+    WiFi.begin(WIFI_SSID, WIFI_PASS);
+    while (!WiFi.connected())
+    {
+        delay(500);
+    }
+
+    // Fill the upload buffer with the printable pattern.
+    for (uint16_t i = 0; i < sizeof(benchBuffer); i++)
+    {
+        benchBuffer[i] = 'A' + (i % 26);
+    }
+
+    // Print the header of the results.
+    Serial.println("bench,test,spi_hz,chunk,value,unit");
+
+    // Run all the tests for each SPI clock.
+    for (uint8_t c = 0; c < sizeof(spiClocks) / sizeof(spiClocks[0]); c++)
+    {
+        WiFi.setSpiClock(spiClocks[c]);
+
+        // Latency does not depend on the chunk size.
+        benchLatency("ping", spiClocks[c], []() { return WiFi.modemPing(); });
+        benchLatency("cwstate", spiClocks[c], []() { return WiFi.connected(); });
+        benchLatency("cipsta", spiClocks[c], []() { return WiFi.localIP() != INADDR_NONE; });
+
+        for (uint8_t k = 0; k < sizeof(chunkSizes) / sizeof(chunkSizes[0]); k++)
+        {
+            for (uint8_t u = 0; u < sizeof(downloadUrls) / sizeof(downloadUrls[0]); u++)
+            {
+                benchDownload(downloadNames[u], downloadUrls[u], spiClocks[c], chunkSizes[k]);
+            }
+
+            benchUpload(spiClocks[c], chunkSizes[k]);
+        }
+    }
+
+    // Print the final result.
+    if (regressions == 0)
+    {
+        Serial.println("result,PASS");
+    }
+    else
+    {
+        Serial.print("result,FAIL,");
+        Serial.println(regressions, DEC);
+    }
+}
+
+void loop()
+{
+    // Empty...
+}
+
+// Measure the average round-trip of the AT command.
+void benchLatency(const char *test, uint32_t spiClock, bool (*command)())
+{
+    unsigned long start = micros();
+    int ok = 0;
+    for (int i = 0; i < LATENCY_ITERATIONS; i++)
+    {
+        if (command())
+            ok++;
+    }
+    unsigned long elapsed = micros() - start;
+
+    // Do not report anything if the command did not work.
+    if (ok != LATENCY_ITERATIONS)
+    {
+        reportError(test, spiClock, 0);
+        return;
+    }
+
+    report(test, spiClock, 0, (float)elapsed / LATENCY_ITERATIONS, "us");
+}
+
+// Measure the HTTP download throughput and SPI read time per byte. Connection time (DNS, TCP and TLS handshake)
+// is not counted as the transfer time.
+void benchDownload(const char *test, const char *url, uint32_t spiClock, uint16_t chunk)
+{
+    WiFiClient client;
+    uint32_t total = 0;
+
+    WiFi.clearSpiStats();
+    unsigned long start = millis();
+    if (client.connect(url))
+    {
+        while (client.available())
+        {
+            total += client.read(benchBuffer, chunk);
+        }
+    }
+    unsigned long elapsed = millis() - start;
+    elapsed = (elapsed > client.handshakeTime()) ? (elapsed - client.handshakeTime()) : 0;
+    client.end();
+
+    if ((total == 0) || (elapsed == 0))
+    {
+        reportError(test, spiClock, chunk);
+        return;
+    }
+
+    report(test, spiClock, chunk, (float)total / elapsed, "kB/s");
+
+    // Time spent in the SPI read per received byte.
+    const struct spiAtStatsTypedef *stats = WiFi.getSpiStats();
+    if (stats->rxBytes != 0)
+        report("spi_read", spiClock, chunk, (float)stats->rxCycles / stats->rxBytes, "cycles/B");
+}
+
+// Measure the TCP upload throughput (one AT+CIPSEND per chunk) and SPI send time per byte.
+void benchUpload(uint32_t spiClock, uint16_t chunk)
+{
+    WiFiSocket socket;
+    uint32_t total = 0;
+
+    if (!socket.connect(UPLOAD_HOST, UPLOAD_PORT))
+    {
+        reportError("upload", spiClock, chunk);
+        return;
+    }
+
+    WiFi.clearSpiStats();
+    unsigned long start = millis();
+    while (total < UPLOAD_SIZE)
+    {
+        if (!WiFi.linkSendTo(socket.linkId(), benchBuffer, chunk))
+            break;
+        total += chunk;
+    }
+    unsigned long elapsed = millis() - start;
+    socket.stop();
+
+    if ((total < UPLOAD_SIZE) || (elapsed == 0))
+    {
+        reportError("upload", spiClock, chunk);
+        return;
+    }
+
+    report("upload", spiClock, chunk, (float)total / elapsed, "kB/s");
+
+    // Time spent in the SPI send per sent byte.
+    const struct spiAtStatsTypedef *stats = WiFi.getSpiStats();
+    if (stats->txBytes != 0)
+        report("spi_send", spiClock, chunk, (float)stats->txCycles / stats->txBytes, "cycles/B");
+}
+
+// Print the result and check it against the baseline.
+void report(const char *test, uint32_t spiClock, uint16_t chunk, float value, const char *unit)
+{
+    Serial.print("bench,");
+    Serial.print(test);
+    Serial.print(',');
+    Serial.print(spiClock, DEC);
+    Serial.print(',');
+    Serial.print(chunk, DEC);
+    Serial.print(',');
+    Serial.print(value, 2);
+    Serial.print(',');
+    Serial.println(unit);
+
+    for (uint8_t i = 0; i < sizeof(baseline) / sizeof(baseline[0]); i++)
+    {
+        const benchBaseline *b = &baseline[i];
+        if ((b->value == 0) || (strcmp(b->test, test) != 0) || (b->spiClock != spiClock) || (b->chunk != chunk))
+            continue;
+
+        bool worse = b->higherIsBetter ? (value < b->value * (1 - REGRESSION_THRESHOLD))
+                                       : (value > b->value * (1 + REGRESSION_THRESHOLD));
+        if (worse)
+        {
+            regressions++;
+            Serial.print("regression,");
+            Serial.print(test);
+            Serial.print(',');
+            Serial.print(b->value, 2);
+            Serial.print(',');
+            Serial.println(value, 2);
+        }
+    }
+}
+
+// Failed test is also a regression.
+void reportError(const char *test, uint32_t spiClock, uint16_t chunk)
+{
+    regressions++;
+    Serial.print("error,");
+    Serial.print(test);
+    Serial.print(',');
+    Serial.print(spiClock, DEC);
+    Serial.print(',');
+    Serial.println(chunk, DEC);
+}
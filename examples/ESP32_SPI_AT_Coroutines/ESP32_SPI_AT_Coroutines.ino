@@ -0,0 +1,114 @@
+// Coroutines need C++20. Add "-std=gnu++20" to the build flags (for example in the build_opt.h file next to
+// this sketch) or the awaitable functions will not be available.
+
+// Include library for AT Commands over SPI.
+#include "esp32SpiAt.h"
+
+// Include Typedefs for the AT SPI messages.
+#include "WiFiSPITypedef.h"
+
+// Change WiFi SSID and password here.
+#define WIFI_SSID ""
+#define WIFI_PASS ""
+
+// URL of the file that will be downloaded.
+#define DOWNLOAD_URL "http://example.com/"
+
+#ifndef INKPLATE_ESP32_COROUTINES
+#error "Build this example with -std=gnu++20"
+#endif
+
+// Create the HTTP client object.
+WiFiClient client;
+
+// Number of times the other work has been done while the file was downloading.
+volatile uint32_t otherWork = 0;
+
+// Download the file without blocking the loop().
+AtTask download()
+{
+    // Check that the modem responds.
+    if (!co_await WiFi.command("AT\r\n", 100))
+    {
+        Serial.println("Modem does not respond!");
+        co_return false;
+    }
+
+    // Connect to the host.
+    if (!co_await client.connectAsync(DOWNLOAD_URL))
+    {
+        Serial.println("HTTP connect failed!");
+        co_return false;
+    }
+
+    // Read the file chunk by chunk.
+    uint32_t total = 0;
+    while (co_await client.readChunk())
+    {
+        char buffer[64];
+        uint16_t len;
+        while ((len = client.read(buffer, sizeof(buffer))) != 0)
+        {
+            total += len;
+        }
+    }
+
+    client.end();
+
+    Serial.print("Downloaded ");
+    Serial.print(total, DEC);
+    Serial.print(" bytes (file size ");
+    Serial.print(client.size(), DEC);
+    Serial.print(" bytes), other work done ");
+    Serial.print(otherWork, DEC);
+    Serial.println(" times in the meantime.");
+
+    co_return true;
+}
+
+void setup()
+{
+    // Setup a Serial communication for debug at 115200 bauds.
+    Serial.begin(115200);
+
+    // Print an welcome message (to know if the Inkplate board and STM32 are alive).
+    Serial.println("Inkplate Motion Code Started!");
+
+    // Initialize At Over SPI library.
+    if (!WiFi.init())
+    {
+        Serial.println("ESP32-C3 initializaiton Failed! Code stopped.");
+
+        // No point going on with the code if we can init the ESP32.
+        while (1)
+        {
+            delay(100);
+        }
+    }
+    Serial.println("ESP32 Initialization OK!");
+
+    // Connect to the WiFi network.
+    WiFi.setMode(INKPLATE_WIFI_MODE_STA);
+    Serial.print("Connecting to the wifi...");
+    WiFi.begin(WIFI_SSID, WIFI_PASS);
+    while (!WiFi.connected())
+    {
+        Serial.print('.');
+        delay(500);
+    }
+    Serial.println("connected!");
+
+    // Start the download. It runs from the loop().
+    if (!AtScheduler.spawn(download()))
+        Serial.println("Download task not started!");
+}
+
+void loop()
+{
+    // Let the tasks go on.
+    AtScheduler.run();
+
+    // Do something else in the meantime (display, sensors...).
+    if (!AtScheduler.idle())
+        otherWork++;
+}
@@ -0,0 +1,122 @@
+// Include library for AT Commands over SPI.
+#include "esp32SpiAt.h"
+
+// Include Typedefs for the AT SPI messages.
+#include "WiFiSPITypedef.h"
+
+// Change WiFi SSID and password here.
+#define WIFI_SSID   "Soldered-testingPurposes"
+#define WIFI_PASS   "Testing443"
+
+// File to download and its SHA-256 (for example, from the manifest next to the file).
+char fileUrl[] = {"https://raw.githubusercontent.com/BornaBiro/ESP32-C3-SPI-AT-Commands/main/lorem_ipsum.txt"};
+char fileSha256[] = {"0000000000000000000000000000000000000000000000000000000000000000"};
+
+// Storage in the RAM. Data goes into the work buffer and it's copied over the valid one only after the
+// verification. With the SD card, write into the temporary file and rename it in commit() instead.
+class RamSink : public DownloadSink
+{
+  public:
+    bool begin(uint32_t _size)
+    {
+        // Do not even try if it can't fit.
+        workLen = 0;
+        return (_size <= sizeof(work));
+    }
+
+    bool write(const uint8_t *_data, uint16_t _len)
+    {
+        if ((workLen + _len) > sizeof(work))
+            return false;
+
+        memcpy(&work[workLen], _data, _len);
+        workLen += _len;
+        return true;
+    }
+
+    bool commit()
+    {
+        memcpy(valid, work, workLen);
+        validLen = workLen;
+        return true;
+    }
+
+    void abort()
+    {
+        workLen = 0;
+    }
+
+    uint8_t valid[8192];
+    uint32_t validLen = 0;
+
+  private:
+    uint8_t work[8192];
+    uint32_t workLen = 0;
+};
+
+RamSink sink;
+
+void setup()
+{
+    // Setup a Serial communication for debug at 115200 bauds.
+    Serial.begin(115200);
+
+    // Print an welcome message (to know if the Inkplate board and STM32 are alive).
+    Serial.println("Inkplate Motion Code Started!");
+
+    // Initialize At Over SPI library.
+    if (!WiFi.init())
+    {
+        Serial.println("ESP32-C3 initializaiton Failed! Code stopped.");
+
+        // No point going on with the code if we can init the ESP32.
+        while (1)
+        {
+            delay(100);
+        }
+    }
+
+    // Connect to the WiFi network.
+    WiFi.setMode(INKPLATE_WIFI_MODE_STA);
+    Serial.print("Connecting to the wifi...");
+    WiFi.begin(WIFI_SSID, WIFI_PASS);
+    while (!WiFi.connected())
+    {
+        Serial.print('.');
+        delay(500);
+    }
+    Serial.println("connected!");
+
+    // Download the file. It's hashed as it arrives, so there is no separate verification pass.
+    WiFiDownload download;
+    if (download.run(fileUrl, sink, fileSha256))
+    {
+        Serial.print("File committed, bytes: ");
+        Serial.print(download.bytes(), DEC);
+        Serial.print(", time: ");
+        Serial.print(download.elapsed(), DEC);
+        Serial.println("ms");
+    }
+    else
+    {
+        Serial.print("Download failed, error: ");
+        Serial.println(download.lastError(), DEC);
+    }
+
+    // Print out the calculated digest (handy for making the manifest).
+    uint8_t digest[INKPLATE_ESP32_SHA256_LEN];
+    download.digest(digest);
+    Serial.print("SHA-256: ");
+    for (int i = 0; i < INKPLATE_ESP32_SHA256_LEN; i++)
+    {
+        if (digest[i] < 0x10)
+            Serial.print('0');
+        Serial.print(digest[i], HEX);
+    }
+    Serial.println();
+}
+
+void loop()
+{
+    // Empty...
+}
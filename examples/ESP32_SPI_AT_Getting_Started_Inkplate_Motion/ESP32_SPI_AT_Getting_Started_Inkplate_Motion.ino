@@ -10,6 +10,10 @@
 // Create an Inkplate Motion Object.
 Inkplate inkplate;
 
+// Receive ring for the background reception. Modem is drained from the handshake interrupt while the display
+// is updating (two largest SPI frames).
+uint8_t rxRing[8192];
+
 void setup()
 {
     // Setup a Serial communication for debug at 115200 bauds.
@@ -44,6 +48,9 @@ void setup()
     inkplate.println("ESP32 Initialization OK!");
     inkplate.partialUpdate(true);
 
+    // Read the data from the modem in the background (partialUpdate() takes a while).
+    WiFi.backgroundRxStart(rxRing, sizeof(rxRing));
+
     //WiFi.config(IPAddress(192, 168, 71, 3), IPAddress(192, 168, 71, 1), IPAddress(255, 255, 255, 0), IPAddress(8, 8, 8, 8), IPAddress(8, 8, 4, 4));
 
     // Set to Access Point to change the MAC Address.
@@ -0,0 +1,92 @@
+// Include library for AT Commands over SPI.
+#include "esp32SpiAt.h"
+
+// Include Typedefs for the AT SPI messages.
+#include "WiFiSPITypedef.h"
+
+// Change WiFi SSID and password here.
+#define WIFI_SSID   "Soldered-testingPurposes"
+#define WIFI_PASS   "Testing443"
+
+// Image to show (BMP or PNG, not interlaced).
+char imageUrl[] = {"https://raw.githubusercontent.com/BornaBiro/ESP32-C3-SPI-AT-Commands/main/image.png"};
+
+// Framebuffer of the display, 4 bits per pixel. Use the framebuffer of the display library instead, if it's
+// available.
+#define FB_WIDTH  400
+#define FB_HEIGHT 300
+uint8_t framebuffer[FB_WIDTH * FB_HEIGHT / 2];
+
+// Work buffer of the decoder. It holds only a few rows and the inflate window, not the whole image.
+uint8_t decoderWork[32770 + (FB_WIDTH * 17)];
+
+void setup()
+{
+    // Setup a Serial communication for debug at 115200 bauds.
+    Serial.begin(115200);
+
+    // Print an welcome message (to know if the Inkplate board and STM32 are alive).
+    Serial.println("Inkplate Motion Code Started!");
+
+    // Initialize At Over SPI library.
+    if (!WiFi.init())
+    {
+        Serial.println("ESP32-C3 initializaiton Failed! Code stopped.");
+
+        // No point going on with the code if we can init the ESP32.
+        while (1)
+        {
+            delay(100);
+        }
+    }
+
+    // Connect to the WiFi network.
+    WiFi.setMode(INKPLATE_WIFI_MODE_STA);
+    Serial.print("Connecting to the wifi...");
+    WiFi.begin(WIFI_SSID, WIFI_PASS);
+    while (!WiFi.connected())
+    {
+        Serial.print('.');
+        delay(500);
+    }
+    Serial.println("connected!");
+
+    // Describe the framebuffer.
+    struct spiAtFramebufferTypedef fb;
+    fb.buffer = framebuffer;
+    fb.width = FB_WIDTH;
+    fb.height = FB_HEIGHT;
+    fb.stride = FB_WIDTH / 2;
+    fb.format = INKPLATE_ESP32_FB_GRAY4;
+
+    // Decode the image into the framebuffer while it arrives.
+    WiFiClient client;
+    ImageDecoder decoder(decoderWork, sizeof(decoderWork));
+    if (client.connect(imageUrl) && decoder.decode(client, &fb, 0, 0))
+    {
+        Serial.print("Image decoded: ");
+        Serial.print(decoder.width(), DEC);
+        Serial.print("x");
+        Serial.print(decoder.height(), DEC);
+        Serial.print(", total time: ");
+        Serial.print(decoder.elapsed(), DEC);
+        Serial.print("ms, waiting for the data: ");
+        Serial.print(decoder.waitTime(), DEC);
+        Serial.println("ms");
+    }
+    else
+    {
+        Serial.print("Image failed, error: ");
+        Serial.println(decoder.lastError(), DEC);
+    }
+
+    // End client HTTP request (MUST HAVE otherwise any other AT command to the modem will fail).
+    client.end();
+
+    // Framebuffer is ready, send it to the display here.
+}
+
+void loop()
+{
+    // Empty...
+}
@@ -0,0 +1,102 @@
+// Include library for AT Commands over SPI.
+#include "esp32SpiAt.h"
+
+// Include Typedefs for the AT SPI messages.
+#include "WiFiSPITypedef.h"
+
+// Change WiFi SSID and password here.
+#define WIFI_SSID   ""
+#define WIFI_PASS   ""
+
+// Change MQTT broker here.
+#define MQTT_BROKER "test.mosquitto.org"
+#define MQTT_PORT   1883
+
+// Number of messages published in the throughput test.
+#define MQTT_TEST_MESSAGES 200
+
+// Create the MQTT client object.
+WiFiMQTT mqtt;
+
+// Callback for the messages received on the subscribed topics.
+void mqttMessage(const char *_topic, const char *_payload, uint16_t _len)
+{
+    Serial.print("Message on ");
+    Serial.print(_topic);
+    Serial.print(": ");
+    Serial.println(_payload);
+}
+
+void setup()
+{
+    // Setup a Serial communication for debug at 115200 bauds.
+    Serial.begin(115200);
+
+    // Print an welcome message (to know if the Inkplate board and STM32 are alive).
+    Serial.println("Inkplate Motion Code Started!");
+
+    // Initialize At Over SPI library.
+    if (!WiFi.init())
+    {
+        Serial.println("ESP32-C3 initializaiton Failed! Code stopped.");
+
+        // No point going on with the code if we can init the ESP32.
+        while (1)
+        {
+            delay(100);
+        }
+    }
+    Serial.println("ESP32 Initialization OK!");
+
+    // Connect to the WiFi network.
+    WiFi.setMode(INKPLATE_WIFI_MODE_STA);
+    Serial.print("Connecting to the wifi...");
+    WiFi.begin(WIFI_SSID, WIFI_PASS);
+    while (!WiFi.connected())
+    {
+        Serial.print('.');
+        delay(500);
+    }
+    Serial.println("connected!");
+
+    // Connect to the MQTT broker.
+    if (!mqtt.connect(MQTT_BROKER, MQTT_PORT, "inkplate-motion"))
+    {
+        Serial.println("MQTT connection failed! Code stopped.");
+        while (1)
+        {
+            delay(100);
+        }
+    }
+    Serial.println("Connected to the MQTT broker!");
+
+    // Subscribe to the command topic.
+    mqtt.onMessage(mqttMessage);
+    mqtt.subscribe("inkplate-motion/cmd", 0);
+
+    // Measure sustained publish rate. Window is limited by INKPLATE_ESP32_MQTT_MAX_PUB_WINDOW (1 by default, modem
+    // refuses the commands sent while it's busy).
+    mqtt.setPublishWindow(INKPLATE_ESP32_MQTT_MAX_PUB_WINDOW);
+    unsigned long startTime = millis();
+    for (int i = 0; i < MQTT_TEST_MESSAGES; i++)
+    {
+        char payload[32];
+        sprintf(payload, "{\"n\":%d,\"t\":%lu}", i, millis());
+        mqtt.publish("inkplate-motion/telemetry", payload, 0);
+    }
+    mqtt.flush();
+    unsigned long elapsedTime = millis() - startTime;
+
+    Serial.print("Published: ");
+    Serial.print(mqtt.published(), DEC);
+    Serial.print(", failed: ");
+    Serial.print(mqtt.failed(), DEC);
+    Serial.print(", messages per second: ");
+    Serial.println((mqtt.published() * 1000.0) / elapsedTime, 1);
+}
+
+void loop()
+{
+    // Keep receiving messages.
+    mqtt.loop();
+}
@@ -0,0 +1,97 @@
+// Include library for AT Commands over SPI.
+#include "esp32SpiAt.h"
+
+// Include Typedefs for the AT SPI messages.
+#include "WiFiSPITypedef.h"
+
+// Change WiFi SSID and password here.
+#define WIFI_SSID   "Soldered-testingPurposes"
+#define WIFI_PASS   "Testing443"
+
+// Static page, it's cached (header and body) so each request needs only one send.
+char indexPage[] = {"<html><body><h1>Inkplate Motion</h1><a href=\"/status\">Status</a></body></html>"};
+
+// Buffer for the cached responses.
+uint8_t cacheBuffer[1024];
+
+// HTTP server.
+WiFiHttpServer server;
+
+// Time of the last statistics print.
+unsigned long lastPrint = 0;
+uint32_t lastRequests = 0;
+
+// Dynamic page, made for each request.
+void statusHandler(WiFiHttpServer &_server, struct spiAtHttpRequestTypedef *_request)
+{
+    char json[64];
+    int len = sprintf(json, "{\"uptime\":%lu,\"requests\":%lu}", millis(), (unsigned long)_server.requests());
+    _server.send(_request->linkId, 200, "application/json", json, len);
+}
+
+void setup()
+{
+    // Setup a Serial communication for debug at 115200 bauds.
+    Serial.begin(115200);
+
+    // Print an welcome message (to know if the Inkplate board and STM32 are alive).
+    Serial.println("Inkplate Motion Code Started!");
+
+    // Initialize At Over SPI library.
+    if (!WiFi.init())
+    {
+        Serial.println("ESP32-C3 initializaiton Failed! Code stopped.");
+
+        // No point going on with the code if we can init the ESP32.
+        while (1)
+        {
+            delay(100);
+        }
+    }
+
+    // Connect to the WiFi network.
+    WiFi.setMode(INKPLATE_WIFI_MODE_STA);
+    Serial.print("Connecting to the wifi...");
+    WiFi.begin(WIFI_SSID, WIFI_PASS);
+    while (!WiFi.connected())
+    {
+        Serial.print('.');
+        delay(500);
+    }
+    Serial.println("connected!");
+
+    // Set the routes and start the server.
+    server.setCache(cacheBuffer, sizeof(cacheBuffer));
+    server.cache("/", "text/html", indexPage, strlen(indexPage));
+    server.on("/status", statusHandler);
+    if (!server.begin(80))
+    {
+        Serial.println("Server failed to start! Code stopped.");
+        while (1)
+        {
+            delay(100);
+        }
+    }
+
+    Serial.print("Server started, open http://");
+    Serial.print(WiFi.localIP());
+    Serial.println("/");
+}
+
+void loop()
+{
+    // Answer the requests.
+    server.handle();
+
+    // Print the requests per second every 10 seconds.
+    if ((unsigned long)(millis() - lastPrint) > 10000UL)
+    {
+        uint32_t requests = server.requests();
+        Serial.print("Requests/s: ");
+        Serial.print((requests - lastRequests) / 10.0, 1);
+        Serial.print(", cache hits: ");
+        Serial.println(server.cacheHits(), DEC);
+        lastRequests = requests;
+        lastPrint = millis();
+    }
+}
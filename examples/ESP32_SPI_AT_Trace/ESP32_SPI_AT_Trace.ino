@@ -0,0 +1,97 @@
+// Include library for AT Commands over SPI.
+#include "esp32SpiAt.h"
+
+// Include Typedefs for the AT SPI messages.
+#include "WiFiSPITypedef.h"
+
+// Example records all SPI packets of a few AT commands into the trace, prints the trace as HEX (so it can be
+// saved from the field unit) and then replays it through the library without the modem - first as fast as
+// possible (only the library code and its response timeouts) and then with the recorded timing.
+
+// Size of the trace buffer (in bytes).
+#define TRACE_SIZE 32768UL
+
+// Trace ring buffer and the buffer for the linear copy of the trace used for the replay.
+uint8_t traceBuffer[TRACE_SIZE];
+uint8_t replayBuffer[TRACE_SIZE];
+uint32_t replayLen = 0;
+
+// AT command sequence that is recorded and replayed.
+void commandSequence();
+
+void setup()
+{
+    // Setup a Serial communication for debug at 115200 bauds.
+    Serial.begin(115200);
+
+    // Print an welcome message (to know if the Inkplate board and STM32 are alive).
+    Serial.println("ESP32 SPI AT Trace example");
+
+    // Initialize At Over SPI library.
+    if (!WiFi.init())
+    {
+        Serial.println("ESP32-C3 initializaiton Failed! Code stopped.");
+
+        // No point going on with the code if we can init the ESP32.
+        while (1)
+        {
+            delay(100);
+        }
+    }
+
+    // Record whole SPI packets, so the trace can be replayed exactly.
+    WiFi.spiTraceStart(traceBuffer, sizeof(traceBuffer), INKPLATE_ESP32_SPI_MAX_MESAGE_DATA_BUFFER);
+    unsigned long recordTime = micros();
+    commandSequence();
+    recordTime = micros() - recordTime;
+    WiFi.spiTraceStop();
+
+    // Copy the trace for the replay.
+    replayLen = WiFi.spiTraceRead(replayBuffer, sizeof(replayBuffer));
+    Serial.print("Trace size: ");
+    Serial.print(replayLen, DEC);
+    Serial.print(" bytes, lost records: ");
+    Serial.println(WiFi.spiTraceDropped(), DEC);
+
+    // Print the trace as HEX.
+    for (uint32_t i = 0; i < replayLen; i++)
+    {
+        if (replayBuffer[i] < 0x10)
+            Serial.print('0');
+        Serial.print(replayBuffer[i], HEX);
+        if ((i % 32) == 31)
+            Serial.println();
+    }
+    Serial.println();
+
+    // Replay it as fast as possible and with the recorded timing.
+    for (int realTime = 0; realTime < 2; realTime++)
+    {
+        WiFi.spiReplayStart(replayBuffer, replayLen, realTime);
+        unsigned long replayTime = micros();
+        commandSequence();
+        replayTime = micros() - replayTime;
+        bool completed = !WiFi.spiReplayActive();
+        WiFi.spiReplayStop();
+
+        Serial.print(realTime ? "Real-time replay: " : "Fast replay: ");
+        Serial.print(replayTime, DEC);
+        Serial.print("us (recorded ");
+        Serial.print(recordTime, DEC);
+        Serial.print("us), mismatches: ");
+        Serial.print(WiFi.spiReplayMismatches(), DEC);
+        Serial.println(completed ? ", whole trace replayed" : ", trace not finished");
+    }
+}
+
+void loop()
+{
+    // Empty...
+}
+
+void commandSequence()
+{
+    WiFi.modemPing();
+    WiFi.connected();
+    WiFi.macAddress();
+}
@@ -0,0 +1,95 @@
+// Include library for AT Commands over SPI.
+#include "esp32SpiAt.h"
+
+// Include Typedefs for the AT SPI messages.
+#include "WiFiSPITypedef.h"
+
+// Change WiFi SSID and password here.
+#define WIFI_SSID   "Soldered-testingPurposes"
+#define WIFI_PASS   "Testing443"
+
+// WebSocket server (echo server here, use your own backend that pushes the updates instead).
+#define WS_HOST "echo.websocket.org"
+#define WS_PORT 443
+#define WS_PATH "/"
+
+// WebSocket client. Connection stays open, so there is no polling - updates arrive as they happen.
+WiFiWebSocket webSocket;
+
+// Time of the last message sent to the server.
+unsigned long lastSend = 0;
+
+// Called from webSocket.loop() for each received message.
+void messageReceived(uint8_t _opcode, const uint8_t *_payload, uint16_t _len)
+{
+    if (_opcode == INKPLATE_ESP32_WS_TEXT)
+    {
+        Serial.print("Message: ");
+        Serial.println((const char *)_payload);
+    }
+    else
+    {
+        Serial.print("Binary message, bytes: ");
+        Serial.println(_len, DEC);
+    }
+}
+
+void setup()
+{
+    // Setup a Serial communication for debug at 115200 bauds.
+    Serial.begin(115200);
+
+    // Print an welcome message (to know if the Inkplate board and STM32 are alive).
+    Serial.println("Inkplate Motion Code Started!");
+
+    // Initialize At Over SPI library.
+    if (!WiFi.init())
+    {
+        Serial.println("ESP32-C3 initializaiton Failed! Code stopped.");
+
+        // No point going on with the code if we can init the ESP32.
+        while (1)
+        {
+            delay(100);
+        }
+    }
+
+    // Connect to the WiFi network.
+    WiFi.setMode(INKPLATE_WIFI_MODE_STA);
+    Serial.print("Connecting to the wifi...");
+    WiFi.begin(WIFI_SSID, WIFI_PASS);
+    while (!WiFi.connected())
+    {
+        Serial.print('.');
+        delay(500);
+    }
+    Serial.println("connected!");
+
+    webSocket.onMessage(messageReceived);
+}
+
+void loop()
+{
+    // Connect (again) if the connection is lost.
+    if (!webSocket.connected())
+    {
+        Serial.print("Connecting to the WebSocket server...");
+        if (!webSocket.connect(WS_HOST, WS_PORT, WS_PATH, true))
+        {
+            Serial.println("failed!");
+            delay(5000);
+            return;
+        }
+        Serial.println("connected!");
+    }
+
+    // Process the received messages (and keep the connection alive).
+    webSocket.loop();
+
+    // Say something every 30 seconds.
+    if ((unsigned long)(millis() - lastSend) > 30000UL)
+    {
+        webSocket.sendText("Hello from Inkplate!");
+        lastSend = millis();
+    }
+}
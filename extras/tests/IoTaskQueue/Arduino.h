@@ -0,0 +1,48 @@
+// Minimal Arduino API for building the I/O task queue on the host (Linux, std::thread).
+#ifndef __ARDUINO_HOST_H__
+#define __ARDUINO_HOST_H__
+
+#include <chrono>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+
+/**
+ * @brief   Time since the first call (in milliseconds).
+ *
+ * @return  unsigned long
+ *          Milliseconds.
+ */
+static inline unsigned long millis()
+{
+    static const std::chrono::steady_clock::time_point _start = std::chrono::steady_clock::now();
+    return (unsigned long)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() -
+                                                                                 _start)
+        .count();
+}
+
+/**
+ * @brief   Time since the first call (in microseconds).
+ *
+ * @return  unsigned long
+ *          Microseconds.
+ */
+static inline unsigned long micros()
+{
+    static const std::chrono::steady_clock::time_point _start = std::chrono::steady_clock::now();
+    return (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() -
+                                                                                 _start)
+        .count();
+}
+
+/**
+ * @brief   Give the CPU to other threads.
+ *
+ */
+static inline void yield()
+{
+    std::this_thread::yield();
+}
+
+#endif
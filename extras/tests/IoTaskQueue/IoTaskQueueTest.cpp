@@ -0,0 +1,333 @@
+// Host test of the I/O task queue (thread-safe mode) - submit, cancel and abandon, with std::thread in place of
+// the RTOS tasks. Modem is replaced with a fake one, so only the queue and the request handshake are tested.
+// Build and run it with "make" (AddressSanitizer) or "make tsan" (ThreadSanitizer).
+
+#define INKPLATE_ESP32_THREAD_SAFE
+
+// Stub Arduino API from this folder.
+#include <Arduino.h>
+
+#include <atomic>
+#include <new>
+#include <thread>
+#include <vector>
+
+// Do not pull in the whole library, the I/O task only needs the modem calls below.
+#define __ESP32_SPI_AT_H__
+
+#define INKPLATE_ESP32_AT_RESULT_OK 0
+static const char esp32AtCmdResponseOK[] = "\r\nOK\r\n";
+
+// Fake modem. Command is "executed" by copying it into the data buffer (response). It can be held (blocked) or
+// delayed, so the test decides when the I/O task finishes the request.
+class WiFiClass
+{
+  public:
+    bool execute(const char *_atCommand, unsigned long _timeout, const char *_expected)
+    {
+        (void)_timeout;
+        (void)_expected;
+
+        executed.fetch_add(1, std::memory_order_relaxed);
+        running.store(true, std::memory_order_release);
+        while (hold.load(std::memory_order_acquire))
+            std::this_thread::yield();
+        if (delayUs != 0)
+            std::this_thread::sleep_for(std::chrono::microseconds(micros() % delayUs));
+
+        strncpy(_dataBuffer, _atCommand, sizeof(_dataBuffer) - 1);
+        _dataBuffer[sizeof(_dataBuffer) - 1] = '\0';
+        running.store(false, std::memory_order_release);
+
+        return true;
+    }
+
+    void poll()
+    {
+    }
+
+    uint8_t lastResult()
+    {
+        return INKPLATE_ESP32_AT_RESULT_OK;
+    }
+
+    char *getDataBuffer()
+    {
+        return _dataBuffer;
+    }
+
+    std::atomic<bool> hold{false};
+    std::atomic<bool> running{false};
+    std::atomic<uint32_t> executed{0};
+    unsigned long delayUs = 0;
+
+  private:
+    char _dataBuffer[64];
+};
+
+WiFiClass WiFi;
+
+// Code under test.
+#include "../../../esp32SpiAtIoTask.h"
+#include "../../../esp32SpiAtIoTask.cpp"
+
+// Number of failed checks.
+static int failures = 0;
+
+/**
+ * @brief   Check the condition and report it if it's not met.
+ *
+ * @param   bool _condition
+ *          Condition that must be true.
+ * @param   const char *_what
+ *          What is checked.
+ */
+static void check(bool _condition, const char *_what)
+{
+    if (!_condition)
+    {
+        printf("  FAILED: %s\n", _what);
+        failures++;
+    }
+}
+
+/**
+ * @brief   Run process() in the loop until stopped (the I/O task).
+ *
+ * @param   WiFiIoTask *_ioTask
+ *          I/O task object.
+ * @param   std::atomic<bool> *_stop
+ *          Set it to stop the loop.
+ */
+static void ioLoop(WiFiIoTask *_ioTask, std::atomic<bool> *_stop)
+{
+    while (!_stop->load(std::memory_order_acquire))
+        _ioTask->process();
+
+    // Finish what is left in the queue.
+    while (_ioTask->process())
+        ;
+}
+
+/**
+ * @brief   Many producers submit the requests at the same time, each one must come back with its own response.
+ *
+ */
+static void testSubmit()
+{
+    static const char *_commands[] = {"AT+T0\r\n", "AT+T1\r\n", "AT+T2\r\n", "AT+T3\r\n"};
+    const int _producers = 4;
+    const int _requests = 2000;
+
+    printf("submit\n");
+
+    WiFiClass _modem;
+    WiFiIoTask _ioTask(_modem);
+    std::atomic<bool> _stop{false};
+    std::atomic<int> _errors{0};
+
+    std::thread _io(ioLoop, &_ioTask, &_stop);
+    std::vector<std::thread> _threads;
+    for (int i = 0; i < _producers; i++)
+    {
+        _threads.emplace_back([&, i]() {
+            char _response[32];
+            for (int j = 0; j < _requests; j++)
+            {
+                if (!_ioTask.request(_commands[i], _response, sizeof(_response), 5000UL) ||
+                    (strcmp(_response, _commands[i]) != 0))
+                    _errors.fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+    }
+    for (std::thread &_thread : _threads)
+        _thread.join();
+    _stop.store(true, std::memory_order_release);
+    _io.join();
+
+    struct spiAtIoStatsTypedef _stats;
+    _ioTask.getStats(&_stats);
+    check(_errors.load() == 0, "every request gets its own response");
+    check(_stats.submitted == (uint32_t)(_producers * _requests), "all requests submitted");
+    check(_stats.completed == (uint32_t)(_producers * _requests), "all requests completed");
+    check((_stats.cancelled == 0) && (_stats.abandoned == 0) && (_stats.queueFull == 0), "nothing lost");
+    check(_stats.maxDepth <= INKPLATE_ESP32_IO_QUEUE_SIZE, "queue depth within the queue size");
+}
+
+/**
+ * @brief   Request that times out in the queue is cancelled - never executed, the waiting task returns only
+ *          after the I/O task releases it.
+ *
+ */
+static void testCancel()
+{
+    printf("cancel\n");
+
+    WiFiClass _modem;
+    WiFiIoTask _ioTask(_modem);
+    struct spiAtRequestTypedef _request;
+    char _response[32] = "untouched";
+    _request.command = "AT\r\n";
+    _request.expected = esp32AtCmdResponseOK;
+    _request.timeout = 1000UL;
+    _request.response = _response;
+    _request.responseLen = sizeof(_response);
+
+    check(_ioTask.submit(&_request), "submitted");
+
+    std::atomic<bool> _returned{false};
+    bool _result = true;
+    std::thread _waiter([&]() {
+        _result = _ioTask.wait(&_request, 10UL);
+        _returned.store(true, std::memory_order_release);
+    });
+
+    // Waiting task must not return while the queue still points to the request.
+    while (_request.state.load(std::memory_order_acquire) != INKPLATE_ESP32_IO_REQ_CANCELLED)
+        std::this_thread::yield();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    check(!_returned.load(std::memory_order_acquire), "waiting task waits for the release");
+
+    // I/O task releases it without running it.
+    check(_ioTask.process(), "cancelled request taken from the queue");
+    _waiter.join();
+
+    struct spiAtIoStatsTypedef _stats;
+    _ioTask.getStats(&_stats);
+    check(!_result, "wait() returns false");
+    check(_modem.executed.load() == 0, "cancelled request not executed");
+    check(strcmp(_response, "untouched") == 0, "response not written");
+    check((_stats.cancelled == 1) && (_stats.completed == 0), "counted as cancelled");
+}
+
+/**
+ * @brief   Request that runs longer than the run timeout is abandoned. The request goes out of scope right
+ *          away and the I/O task must not write into it when it finishes.
+ *
+ */
+static void testAbandon()
+{
+    printf("abandon\n");
+
+    WiFiClass _modem;
+    WiFiIoTask _ioTask(_modem);
+    alignas(struct spiAtRequestTypedef) unsigned char _storage[sizeof(struct spiAtRequestTypedef)];
+    char _response[32] = "untouched";
+    bool _result = true;
+
+    // Command blocks until released.
+    _modem.hold.store(true, std::memory_order_release);
+
+    std::thread _waiter([&]() {
+        struct spiAtRequestTypedef *_request = new (_storage) struct spiAtRequestTypedef;
+        _request->command = "AT\r\n";
+        _request->expected = esp32AtCmdResponseOK;
+        _request->timeout = 1000UL;
+        _request->response = _response;
+        _request->responseLen = sizeof(_response);
+
+        if (_ioTask.submit(_request))
+            _result = _ioTask.wait(_request, 1000UL, 20UL);
+
+        // Request is gone, poison it.
+        _request->~spiAtRequestTypedef();
+        memset(_storage, 0xA5, sizeof(_storage));
+    });
+
+    std::thread _io([&]() { _ioTask.process(); });
+
+    _waiter.join();
+    _modem.hold.store(false, std::memory_order_release);
+    _io.join();
+
+    bool _poisoned = true;
+    for (size_t i = 0; i < sizeof(_storage); i++)
+    {
+        if (_storage[i] != 0xA5)
+            _poisoned = false;
+    }
+
+    struct spiAtIoStatsTypedef _stats;
+    _ioTask.getStats(&_stats);
+    check(!_result, "wait() returns false");
+    check(_modem.executed.load() == 1, "command still executed");
+    check(_poisoned, "abandoned request not written");
+    check(strcmp(_response, "untouched") == 0, "response not written");
+    check((_stats.abandoned == 1) && (_stats.completed == 1), "counted as abandoned");
+}
+
+/**
+ * @brief   Abandon races with the completion. Each request is freed as soon as wait() returns, so a late write
+ *          from the I/O task is caught by the sanitizer. Either the result is there or the request is abandoned.
+ *
+ */
+static void testAbandonRace()
+{
+    const int _requests = 5000;
+
+    printf("abandon race\n");
+
+    WiFiClass _modem;
+    _modem.delayUs = 300;
+    WiFiIoTask _ioTask(_modem);
+    std::atomic<bool> _stop{false};
+    int _done = 0;
+    int _abandoned = 0;
+    int _errors = 0;
+
+    std::thread _io(ioLoop, &_ioTask, &_stop);
+    for (int i = 0; i < _requests; i++)
+    {
+        struct spiAtRequestTypedef *_request = new struct spiAtRequestTypedef;
+        char *_response = new char[32];
+        _request->command = "AT+RACE\r\n";
+        _request->expected = esp32AtCmdResponseOK;
+        _request->timeout = 1000UL;
+        _request->response = _response;
+        _request->responseLen = 32;
+
+        if (!_ioTask.submit(_request))
+        {
+            _errors++;
+        }
+        else if (_ioTask.wait(_request, 1000UL, (unsigned long)(i & 1)))
+        {
+            _done++;
+            if (!_request->result || (strcmp(_response, "AT+RACE\r\n") != 0))
+                _errors++;
+        }
+        else
+        {
+            _abandoned++;
+        }
+
+        delete[] _response;
+        delete _request;
+    }
+    _stop.store(true, std::memory_order_release);
+    _io.join();
+
+    struct spiAtIoStatsTypedef _stats;
+    _ioTask.getStats(&_stats);
+    printf("  %d done, %d abandoned\n", _done, _abandoned);
+    check(_errors == 0, "completed requests have the result");
+    check(_stats.completed == (uint32_t)_requests, "all requests executed");
+    check(_stats.abandoned == (uint32_t)_abandoned, "abandoned count matches");
+}
+
+int main()
+{
+    testSubmit();
+    testCancel();
+    testAbandon();
+    testAbandonRace();
+
+    if (failures != 0)
+    {
+        printf("FAILED (%d)\n", failures);
+        return 1;
+    }
+
+    printf("PASSED\n");
+    return 0;
+}